@@ -148,18 +148,14 @@ void SckESP::SAMbusUpdate()
 			uint8_t pre = netPack[1];
 			ESPMessage wichMessage = static_cast<ESPMessage>(pre);
 
-			// Empty netBuff before starting to store the new message
-			memset(netBuff, 0, sizeof(netBuff));
-
-			// Get content from first package (1 byte less than the rest)
-			memcpy(netBuff, &netPack[2], NETPACK_CONTENT_SIZE - 1);
-
-			// Het the rest of the packages (if they exist)
-			for (uint8_t i=0; i<netPack[0]-1; i++) {
-				if (manager.recvfromAckTimeout(netPack, &len, 500))	{
-					memcpy(&netBuff[(i * NETPACK_CONTENT_SIZE) + (NETPACK_CONTENT_SIZE - 1)], &netPack[1], NETPACK_CONTENT_SIZE);
-				}
-				else return;
+			// Empty netBuff and get content from first package (1 byte less than the rest)
+			uint8_t parts = netFirstPack(netBuff, netPack, len);
+			if (parts == 0) return;
+
+			// Get the rest of the packages (if they exist)
+			for (uint8_t i=1; i<parts; i++) {
+				len = NETPACK_TOTAL_SIZE;
+				if (!manager.recvfromAckTimeout(netPack, &len, 500) || !netNextPack(netBuff, i, parts, netPack, len)) return;
 			}
 
 			// Process message
@@ -198,10 +194,10 @@ void SckESP::receiveMessage(ESPMessage wichMessage)
 			StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
 			JsonObject& json = jsonBuffer.parseObject(netBuff);
 			config.credentials.set = json["cs"];
-			strcpy(config.credentials.ssid, json["ss"]);
-			strcpy(config.credentials.pass, json["pa"]);
+			json["ss"].as<String>().toCharArray(config.credentials.ssid, sizeof(config.credentials.ssid));
+			json["pa"].as<String>().toCharArray(config.credentials.pass, sizeof(config.credentials.pass));
 			config.token.set = json["ts"];
-			strcpy(config.token.token, json["to"]);
+			json["to"].as<String>().toCharArray(config.token.token, sizeof(config.token.token));
 			SAMversion = json["ver"].as<String>();
 			SAMbuildDate = json["bd"].as<String>();
 			uint8_t action = json["ac"];
@@ -365,23 +361,11 @@ bool SckESP::mqttPublish()
 		// }
 		// 	*/
 
-		char thisTime[21];
-		snprintf(thisTime, 21, &netBuff[3]);
-		sprintf(pubPayload, "%s%s%s", "{\"data\":[{\"recorded_at\":\"", thisTime, "\",\"sensors\":[{\"id\":");
-
-		for (uint16_t i=24; i<NETBUFF_SIZE; i++) {
-			
-			char thisChar[2];
-			snprintf(thisChar, 2, &netBuff[i]);
-
-			if (netBuff[i] == ':') sprintf(pubPayload, "%s%s", pubPayload, ",\"value\":");
-			else if (netBuff[i] == ',') sprintf(pubPayload, "%s%s", pubPayload, "},{\"id\":");
-			else sprintf(pubPayload, "%s%s", pubPayload, thisChar);
+		if (!readingsToJson(netBuff, pubPayload, sizeof(pubPayload))) {
+			debugOUT(F("MQTT readings don't fit on the payload !!!"));
+			return false;
 		}
 
-		sprintf(pubPayload, "%s%s", pubPayload, "]}]}");
-
-
 		if (MQTTclient.publish(pubTopic, pubPayload)) {
 			debugOUT(F("MQTT readings published OK !!!"));
 			return true;
@@ -0,0 +1,83 @@
+#include "NameIndex.h"
+
+static char fold(char c)
+{
+	if (c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+	return c;
+}
+
+int8_t NameIndex::compare(const char *text, uint8_t len, const char *name)
+{
+	uint8_t i = 0;
+	for (; i<len && name[i]; i++) {
+		char a = fold(text[i]);
+		char b = fold(name[i]);
+		if (a != b) return a < b ? -1 : 1;
+	}
+	if (i == len) return name[i] ? -2 : 0;
+	return 2;
+}
+uint8_t NameIndex::find(const char *text, uint8_t len)
+{
+	uint8_t place = lowerBound(text, len);
+	if (place < count && compare(text, len, name(place)) == 0) return order[place];
+	return count;
+}
+uint8_t NameIndex::startingWith(const char *text, uint8_t len)
+{
+	// Every name starting with the text comes right after it
+	uint8_t found = count;
+	for (uint8_t place=lowerBound(text, len); place<count; place++) {
+		int8_t result = compare(text, len, name(place));
+		if (result != 0 && result != -2) break;
+		if (order[place] < found) found = order[place];
+	}
+	return found;
+}
+uint8_t NameIndex::prefixOf(const char *text, uint8_t len)
+{
+	if (len == 0) return count;
+
+	uint8_t place = lowerBound(text, len);
+	if (place < count && compare(text, len, name(place)) == 0) return order[place];
+
+	// Prefixes of the text sort before it (longer prefixes closer), going back until the first letter changes
+	while (place > 0) {
+		place--;
+		const char *thisName = name(place);
+		if (fold(thisName[0]) != fold(text[0])) break;
+		if (compare(text, len, thisName) == 2) return order[place];
+	}
+	return count;
+}
+void NameIndex::sort()
+{
+	for (uint8_t i=0; i<count; i++) order[i] = i;
+
+	// Insertion sort, the tables are small and this only runs once
+	for (uint8_t i=1; i<count; i++) {
+		uint8_t item = order[i];
+		const char *itemName = getter(table, item);
+		uint8_t itemLen = strlen(itemName);
+		uint8_t place = i;
+		while (place > 0 && compare(itemName, itemLen, name(place - 1)) < 0) {
+			order[place] = order[place - 1];
+			place--;
+		}
+		order[place] = item;
+	}
+	sorted = true;
+}
+uint8_t NameIndex::lowerBound(const char *text, uint8_t len)
+{
+	if (!sorted) sort();
+
+	uint8_t low = 0;
+	uint8_t high = count;
+	while (low < high) {
+		uint8_t middle = (low + high) / 2;
+		if (compare(text, len, name(middle)) > 0) low = middle + 1;
+		else high = middle;
+	}
+	return low;
+}
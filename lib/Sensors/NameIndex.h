@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Case insensitive name lookup over a fixed table (sensor titles, command names).
+// The index keeps the table items sorted by name (case folded), it's built on the first lookup and searched with binary search.
+// Lookups work on the input text as it is (pointer and length), nothing is copied or allocated.
+// When nothing is found the lookups return the number of items (like SENSOR_COUNT or COM_COUNT).
+class NameIndex
+{
+	public:
+		typedef const char *(*NameGetter)(const void *table, uint8_t item);
+
+		NameIndex(uint8_t *wichOrder, uint8_t wichCount, NameGetter wichGetter, const void *wichTable=0) {
+			order = wichOrder;
+			count = wichCount;
+			getter = wichGetter;
+			table = wichTable;
+		}
+
+		uint8_t find(const char *text, uint8_t len); 		// Name equal to the text
+		uint8_t startingWith(const char *text, uint8_t len); 	// Smallest item whose name starts with the text
+		uint8_t prefixOf(const char *text, uint8_t len); 	// Item whose name is the longest prefix of the text
+
+		// Compares the first len chars of text with a name: 0 if equal, -2/2 if the text is shorter/longer than the name but equal up to there
+		static int8_t compare(const char *text, uint8_t len, const char *name);
+
+	private:
+		uint8_t *order;
+		uint8_t count;
+		NameGetter getter;
+		const void *table;
+		bool sorted = false;
+
+		const char *name(uint8_t place) { return getter(table, order[place]); }
+		void sort();
+		uint8_t lowerBound(const char *text, uint8_t len); 	// First place whose name is not smaller than the text
+};
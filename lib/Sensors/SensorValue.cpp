@@ -0,0 +1,122 @@
+#include "SensorValue.h"
+
+// Floats beyond this can't be formatted with their decimals on the fixed point buffer
+static const float SENSORVALUE_MAX = 1e15;
+
+SensorValue SensorValue::fixed(int32_t wichMantissa, uint8_t wichDecimals)
+{
+	SensorValue value;
+	value.kind = VALUE_FIXED;
+	value.decimals = wichDecimals;
+	value.mantissa = wichMantissa;
+	return value;
+}
+SensorValue SensorValue::parse(const char *text, uint8_t len)
+{
+	if (len == 0 || len >= SENSORVALUE_SIZE) return SensorValue();
+
+	// Plain decimal numbers keep their decimals as fixed point
+	uint8_t i = 0;
+	bool negative = text[0] == '-';
+	if (negative) i++;
+
+	int32_t value = 0;
+	uint8_t digits = 0;
+	uint8_t decimals = 0;
+	bool dot = false;
+	for (; i<len; i++) {
+		if (text[i] == '.' && !dot) dot = true;
+		else if (text[i] >= '0' && text[i] <= '9' && digits < 9) {
+			value = value * 10 + (text[i] - '0');
+			digits++;
+			if (dot) decimals++;
+		} else break;
+	}
+	if (i == len && digits > 0) return fixed(negative ? -value : value, decimals);
+
+	// Anything else goes through strtod (it needs a terminated string)
+	char buff[SENSORVALUE_SIZE];
+	memcpy(buff, text, len);
+	buff[len] = 0;
+
+	char *end;
+	double number = strtod(buff, &end);
+	if (end != &buff[len]) return SensorValue();
+
+	return SensorValue(number);
+}
+void SensorValue::setUnsigned(uint32_t value)
+{
+	if (value > INT32_MAX) {
+		kind = VALUE_FLOAT;
+		number = value;
+	} else {
+		kind = VALUE_FIXED;
+		mantissa = value;
+	}
+}
+bool SensorValue::isNull() const
+{
+	if (kind == VALUE_NULL) return true;
+	if (kind == VALUE_FLOAT && !(fabsf(number) < SENSORVALUE_MAX)) return true;
+	return false;
+}
+float SensorValue::toFloat() const
+{
+	if (isNull()) return 0;
+	if (kind == VALUE_FLOAT) return number;
+
+	float value = mantissa;
+	for (uint8_t i=0; i<decimals; i++) value /= 10;
+	return value;
+}
+int64_t SensorValue::rounded() const
+{
+	if (kind != VALUE_FLOAT) return mantissa;
+
+	double scaled = number;
+	for (uint8_t i=0; i<decimals; i++) scaled *= 10;
+	return (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+bool SensorValue::toFixed(int32_t &wichMantissa, uint8_t &wichDecimals) const
+{
+	if (isNull()) return false;
+
+	int64_t value = rounded();
+	if (value < INT32_MIN || value > INT32_MAX) return false;
+
+	wichMantissa = value;
+	wichDecimals = decimals;
+	return true;
+}
+char *SensorValue::format(char *buff) const
+{
+	if (isNull()) {
+		strcpy(buff, "null");
+		return buff;
+	}
+
+	// Floats are rounded to their decimals and printed as fixed point
+	int64_t value = rounded();
+
+	// Written from the end of the buffer and then moved to the start
+	uint8_t i = SENSORVALUE_SIZE - 1;
+	buff[i] = 0;
+
+	bool negative = value < 0;
+	uint64_t absolute = negative ? -value : value;
+
+	for (uint8_t d=0; d<decimals && i>2; d++) {
+		buff[--i] = '0' + (absolute % 10);
+		absolute /= 10;
+	}
+	if (decimals > 0) buff[--i] = '.';
+	do {
+		buff[--i] = '0' + (absolute % 10);
+		absolute /= 10;
+	} while (absolute > 0 && i > 1);
+	if (negative) buff[--i] = '-';
+
+	memmove(buff, &buff[i], SENSORVALUE_SIZE - i);
+	return buff;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define SENSORVALUE_SIZE 24 	// Buffer needed to format any value (with the terminating zero)
+
+// Sensor readings are kept as numbers (no dynamic memory) and only formatted when they are printed, published or written to the sdcard.
+// Floats are formatted with two decimals, fixed point values (integers or numbers coming back from the readings list) with their own decimals.
+class SensorValue
+{
+	public:
+		enum ValueKind : uint8_t {
+			VALUE_NULL, 		// No reading (error), printed as "null"
+			VALUE_FLOAT,
+			VALUE_FIXED 		// mantissa / 10^decimals
+		};
+
+		ValueKind kind = VALUE_NULL;
+		uint8_t decimals = 0;
+		union {
+			float number;
+			int32_t mantissa;
+		};
+
+		SensorValue() { mantissa = 0; }
+		SensorValue(float value) { kind = VALUE_FLOAT; decimals = 2; number = value; }
+		SensorValue(double value) : SensorValue((float)value) {}
+		SensorValue(int value) { kind = VALUE_FIXED; mantissa = value; }
+		SensorValue(unsigned int value) { setUnsigned(value); }
+		SensorValue(long value) { kind = VALUE_FIXED; mantissa = value; }
+		SensorValue(unsigned long value) { setUnsigned(value); }
+		SensorValue(short value) { kind = VALUE_FIXED; mantissa = value; }
+		SensorValue(unsigned short value) { kind = VALUE_FIXED; mantissa = value; }
+		SensorValue(signed char value) { kind = VALUE_FIXED; mantissa = value; }
+		SensorValue(unsigned char value) { kind = VALUE_FIXED; mantissa = value; }
+
+		static SensorValue fixed(int32_t wichMantissa, uint8_t wichDecimals);
+		static SensorValue parse(const char *text, uint8_t len); 	// Text that is not a number gives a null value
+
+		bool isNull() const; 		// Also true for nan, inf and floats too big to be formatted
+		float toFloat() const;
+		char *format(char *buff) const; 	// buff needs SENSORVALUE_SIZE bytes, returns buff
+		bool toFixed(int32_t &wichMantissa, uint8_t &wichDecimals) const; 	// The formatted number as fixed point (false for null values and floats that don't fit on the mantissa)
+
+	private:
+		void setUnsigned(uint32_t value); 	// Values that don't fit on the mantissa are kept as floats without decimals
+		int64_t rounded() const; 		// Floats rounded to their decimals (the digits that get formatted)
+};
@@ -1,88 +1,111 @@
 #include "Sensors.h"
 
-SensorType AllSensors::getTypeFromString(String strIn)
+// Definitions of the constexpr tables (a single copy on flash)
+constexpr SensorInfo SensorCatalog::list[];
+constexpr PriorityOrder AllSensors::priorized;
+
+OneSensor::OneSensor(SensorType nType)
+{
+	type = nType;
+	location = SensorCatalog::list[nType].location;
+}
+static const char *sensorTitle(const void *table, uint8_t item)
+{
+	return SensorCatalog::list[item].title;
+}
+static const char *sensorShortTitle(const void *table, uint8_t item)
 {
+	return SensorCatalog::list[item].shortTitle;
+}
 
-	SensorType wichSensor = SENSOR_COUNT;
-	uint8_t maxWordsFound = 0;
+AllSensors::AllSensors() :
+	titles(titleOrder, SENSOR_COUNT, sensorTitle),
+	shortTitles(shortTitleOrder, SENSOR_COUNT, sensorShortTitle)
+{
+	for (uint8_t i=0; i<SENSOR_COUNT+1; i++) {
+		runtime[i].everyNint = SensorCatalog::list[i].everyNint;
+		runtime[i].enabled = SensorCatalog::list[i].defaultEnabled;
+	}
+}
 
-	// Get sensor type
-	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+SensorType AllSensors::getTypeFromString(String strIn)
+{
+	return find(strIn.c_str(), min(strIn.length(), 255U));
+}
+String AllSensors::removeSensorName(String strIn)
+{
+	uint8_t wordsToRemove = 0;
+	find(strIn.c_str(), min(strIn.length(), 255U), &wordsToRemove);
 
-		SensorType thisSensor = static_cast<SensorType>(i);
+	const char *rest = strIn.c_str();
+	for (uint8_t i=0; i<wordsToRemove; i++) {
+		while (*rest == ' ') rest++;
+		while (*rest && *rest != ' ') rest++;
+	}
+	while (*rest == ' ') rest++;
 
-		// Makes comparison lower case and not strict
-		String titleCompare = list[thisSensor].title;
-		titleCompare.toLowerCase();
-		strIn.toLowerCase();
+	String result = rest;
+	result.toLowerCase();
+	return result;
+}
+SensorType AllSensors::find(const char *text, uint8_t len, uint8_t *wordsUsed)
+{
+	// Spaces around the name don't count
+	while (len > 0 && text[0] == ' ') {
+		text++;
+		len--;
+	}
+	while (len > 0 && text[len - 1] == ' ') len--;
+
+	uint8_t words = 0;
+	for (uint8_t i=0; i<len; i++) if (text[i] != ' ' && (i == 0 || text[i - 1] == ' ')) words++;
+	if (wordsUsed) *wordsUsed = words;
+	if (len == 0) return SENSOR_COUNT;
 
-		// How many words match in Sensor title
-		uint8_t matchedWords = countMatchedWords(titleCompare, strIn);
+	// The whole text is a name or the start of one (case insensitive)
+	uint8_t found = shortTitles.find(text, len);
+	if (found == SENSOR_COUNT) found = titles.find(text, len);
+	if (found == SENSOR_COUNT) found = titles.startingWith(text, len);
+	if (found == SENSOR_COUNT) found = shortTitles.startingWith(text, len);
+	if (found < SENSOR_COUNT) return static_cast<SensorType>(found);
 
+	// Otherwise the title that contains more of the first words, the rest of the text can be a command or something else
+	uint8_t maxWordsFound = 0;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		uint8_t matchedWords = countMatchedWords(SensorCatalog::list[i].title, text, len);
 		if (matchedWords > maxWordsFound) {
 			maxWordsFound = matchedWords;
-			wichSensor = thisSensor;
+			found = i;
 		}
-
 	}
-	return wichSensor;
+	if (wordsUsed) *wordsUsed = maxWordsFound;
+	return static_cast<SensorType>(found);
 }
-uint8_t AllSensors::countMatchedWords(String baseString, String input)
+uint8_t AllSensors::countMatchedWords(const char *title, const char *text, uint8_t len)
 {
-	
 	uint8_t foundedCount = 0;
-	String word;
-	
-	while (input.length() > 0) {
+	uint8_t start = 0;
+
+	while (start < len) {
 
 		// Get next word
-		if (input.indexOf(" ") > -1) word = input.substring(0, input.indexOf(" "));
-		// Or there is only one left
-		else word = input;
+		uint8_t end = start;
+		while (end < len && text[end] != ' ') end++;
+
+		// If we found one (anywhere in the title)
+		bool found = false;
+		for (const char *pos=title; *pos && !found; pos++) {
+			int8_t result = NameIndex::compare(&text[start], end - start, pos);
+			found = result == 0 || result == -2;
+		}
 
-		// If we found one
-		if (baseString.indexOf(word) > -1) foundedCount += 1;
 		// If next word is not part of the title we asume the rest of the input is a command or something else
-		else break;
+		if (!found) break;
+		foundedCount++;
 
-		// remove what we tested
-		input.replace(word, "");
-		input.trim();
+		start = end;
+		while (start < len && text[start] == ' ') start++;
 	}
 
 	return foundedCount;
 }
-String AllSensors::removeSensorName(String strIn)
-{
-	SensorType wichSensor = getTypeFromString(strIn);
-
-	// Makes comparison lower case and not strict
-	String titleCompare = list[wichSensor].title;
-	titleCompare.toLowerCase();
-	strIn.toLowerCase();
-
-	uint8_t wordsToRemove = countMatchedWords(titleCompare, strIn);
-	for (uint8_t i=0; i<wordsToRemove; i++) {
-		if (strIn.indexOf(" ") > 0) strIn.remove(0, strIn.indexOf(" ")+1);
-		else strIn.remove(0, strIn.length());
-	}
-
-	return strIn;
-}
-SensorType AllSensors::sensorsPriorized(uint8_t index)
-{
-	if (!sorted) {
-		uint8_t sensorCount = 0;
-		for (uint8_t i=0; i<251; i++) {
-			for (uint8_t ii=0; ii<SENSOR_COUNT; ii++) {
-				SensorType thisSensorType = static_cast<SensorType>(ii);
-				if (list[thisSensorType].priority == i) {
-					prioSortedList[sensorCount] = thisSensorType;
-					sensorCount++;
-				}
-			}
-		}
-		sorted = true;
-	}
-	return prioSortedList[index];
-}
@@ -35,4 +35,5 @@ struct Configuration {
 	SensorConfig sensors[SENSOR_COUNT];
 	bool sdDebug = false;
 	uint16_t battDesignCapacity = 2000;
+	bool sdArchive = true; 						// Also write the binary archive on the sdcard (see sam/src/SckArchive.h)
 };
@@ -25,3 +25,53 @@ VersionInt parseVersionStr(String versionStr)
 
 	return versionInt;
 }
+static bool append(char *payload, uint16_t size, uint16_t &pos, const char *text)
+{
+	while (*text) {
+		if (pos + 1 >= size) return false;
+		payload[pos++] = *text++;
+	}
+	payload[pos] = 0;
+	return true;
+}
+uint16_t readingsToJson(const char *readings, char *payload, uint16_t size)
+{
+	char thisTime[21];
+	snprintf(thisTime, sizeof(thisTime), "%s", &readings[3]);
+
+	uint16_t pos = 0;
+	if (!append(payload, size, pos, "{\"data\":[{\"recorded_at\":\"")) return 0;
+	if (!append(payload, size, pos, thisTime)) return 0;
+	if (!append(payload, size, pos, "\",\"sensors\":[{\"id\":")) return 0;
+
+	// Readings start after the time, the closing bracket of the message closes the last sensor
+	uint16_t len = strnlen(readings, NETBUFF_SIZE);
+	for (uint16_t i=24; i<len; i++) {
+		char thisChar[2] = { readings[i], 0 };
+		const char *piece = thisChar;
+		if (readings[i] == ':') piece = ",\"value\":";
+		else if (readings[i] == ',') piece = "},{\"id\":";
+		if (!append(payload, size, pos, piece)) return 0;
+	}
+
+	if (!append(payload, size, pos, "]}]}")) return 0;
+	return pos;
+}
+uint8_t netFirstPack(char *buff, const uint8_t *pack, uint8_t len)
+{
+	memset(buff, 0, NETBUFF_SIZE);
+	if (len < 2 || pack[0] == 0 || pack[0] > NETBUFF_SIZE / NETPACK_CONTENT_SIZE) return 0;
+
+	uint8_t size = min(len - 2, NETPACK_CONTENT_SIZE - 1);
+	memcpy(buff, &pack[2], size);
+	return pack[0];
+}
+bool netNextPack(char *buff, uint8_t part, uint8_t parts, const uint8_t *pack, uint8_t len)
+{
+	if (len < 1 || pack[0] != parts || part == 0 || part >= parts) return false;
+
+	// The last byte of buff is never written: a message of 10 full parts still ends with a 0
+	uint8_t size = min(len - 1, NETPACK_CONTENT_SIZE);
+	memcpy(&buff[(part * NETPACK_CONTENT_SIZE) - 1], &pack[1], size);
+	return true;
+}
@@ -61,3 +61,15 @@ struct VersionInt { uint8_t mayor; uint8_t minor; uint8_t build; };
 
 VersionInt parseVersionStr(String versionStr);
 
+// Turns the readings of a publish message from the SAM into the platform payload (SckESP::mqttPublish):
+// {t:2017-03-24T13:35:14Z,29:48.45,13:66} -> {"data":[{"recorded_at":"2017-03-24T13:35:14Z","sensors":[{"id":29,"value":48.45},{"id":13,"value":66}]}]}
+// Returns the payload length, 0 if it doesn't fit on size
+uint16_t readingsToJson(const char *readings, char *payload, uint16_t size);
+
+// Reassembly of the bus messages (SckBase::ESPbusUpdate, SckESP::SAMbusUpdate). Every packet is [total parts][59 bytes of the
+// message] and the message starts with its type, so the first packet carries one byte less of content.
+// netFirstPack() empties buff (NETBUFF_SIZE), copies the content of the first packet and returns the total parts, 0 if the
+// packet can't start a message (too short, no parts or more than fit on buff). netNextPack() copies part 1 to parts - 1,
+// false if the packet doesn't belong to the message. The content always ends with a 0.
+uint8_t netFirstPack(char *buff, const uint8_t *pack, uint8_t len);
+bool netNextPack(char *buff, uint8_t part, uint8_t parts, const uint8_t *pack, uint8_t len);
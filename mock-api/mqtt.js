@@ -0,0 +1,292 @@
+// Stand-in for the platform MQTT broker and ingestion, to load test with tools/sckfleet.py without touching the real one.
+// Speaks the MQTT 3.1.1 subset the kits use (connect, QoS 0/1 publish, ping), checks the payloads of every topic the ESP
+// publishes (see esp/src/SckESP.cpp) and prints the ingestion rate. Subscribers get the messages like on a real broker.
+//
+// node mqtt.js [-port 1883] [-interval 5] [-o report.json] [-v]
+
+var net = require('net')
+var fs = require('fs')
+
+var options = { port: 1883, interval: 5, report: null, verbose: false }
+var args = process.argv.slice(2)
+while (args.length) {
+  var arg = args.shift()
+  if (arg == '-port') options.port = parseInt(args.shift())
+  else if (arg == '-interval') options.interval = parseFloat(args.shift())
+  else if (arg == '-o') options.report = args.shift()
+  else if (arg == '-v') options.verbose = true
+  else {
+    console.log('USAGE: node mqtt.js [-port 1883] [-interval seconds] [-o report.json] [-v]')
+    process.exit(1)
+  }
+}
+
+var CONNECT = 1, CONNACK = 2, PUBLISH = 3, PUBACK = 4, SUBSCRIBE = 8, SUBACK = 9
+var UNSUBSCRIBE = 10, UNSUBACK = 11, PINGREQ = 12, PINGRESP = 13, DISCONNECT = 14
+
+var ISO_TIME = /^\d{4}-\d\d-\d\dT\d\d:\d\d:\d\dZ$/
+
+// Totals since start and counts of the current interval
+function counters () {
+  return { connects: 0, messages: 0, bytes: 0, readings: 0, groups: 0, hello: 0, info: 0, inventory: 0, other: 0, invalid: 0 }
+}
+var total = counters()
+var lap = counters()
+var started = Date.now()
+var lapStarted = started
+var peak = { messages: 0, readings: 0 }
+var kits = {}         // token -> { groups, newest, oldest }
+var clients = 0
+var maxClients = 0
+var invalidSamples = []
+var subscribers = []  // { socket, filter }
+
+function count (name, amount) {
+  total[name] += amount || 1
+  lap[name] += amount || 1
+}
+
+function invalid (topic, payload, why) {
+  count('invalid')
+  if (invalidSamples.length < 20) invalidSamples.push({ topic: topic, why: why, payload: payload.slice(0, 200) })
+  if (options.verbose) console.log('INVALID ' + topic + ': ' + why)
+}
+
+// {"data":[{"recorded_at":"2017-03-24T13:35:14Z","sensors":[{"id":29,"value":48.45},...]},...]}
+// The kits send one group per message, more than one on data is accepted to try batching
+function ingestReadings (token, topic, payload) {
+  var json
+  try {
+    json = JSON.parse(payload)
+  } catch (e) {
+    return invalid(topic, payload, 'not json')
+  }
+  if (!json || !Array.isArray(json.data) || json.data.length == 0) return invalid(topic, payload, 'no data')
+
+  var readings = 0
+  for (var i = 0; i < json.data.length; i++) {
+    var group = json.data[i]
+    if (typeof group.recorded_at != 'string' || !ISO_TIME.test(group.recorded_at)) return invalid(topic, payload, 'bad recorded_at')
+    if (!Array.isArray(group.sensors) || group.sensors.length == 0) return invalid(topic, payload, 'no sensors')
+    for (var s = 0; s < group.sensors.length; s++) {
+      var sensor = group.sensors[s]
+      if (!Number.isInteger(sensor.id) || sensor.id <= 0) return invalid(topic, payload, 'bad sensor id')
+      if (typeof sensor.value != 'number' || !isFinite(sensor.value)) return invalid(topic, payload, 'bad value for sensor ' + sensor.id)
+    }
+    readings += group.sensors.length
+  }
+
+  var kit = kits[token] || (kits[token] = { groups: 0, newest: null, oldest: null })
+  for (i = 0; i < json.data.length; i++) {
+    var time = json.data[i].recorded_at
+    if (kit.newest === null || time > kit.newest) kit.newest = time
+    if (kit.oldest === null || time < kit.oldest) kit.oldest = time
+  }
+  kit.groups += json.data.length
+  count('groups', json.data.length)
+  count('readings', readings)
+}
+
+// The SAM builds the info json, the ESP publishes it as it is
+function ingestInfo (topic, payload) {
+  var json
+  try {
+    json = JSON.parse(payload)
+  } catch (e) {
+    return invalid(topic, payload, 'not json')
+  }
+  var keys = ['time', 'hw_ver', 'id', 'sam_ver', 'sam_bd', 'mac', 'esp_ver', 'esp_bd']
+  for (var i = 0; i < keys.length; i++) {
+    if (typeof json[keys[i]] != 'string') return invalid(topic, payload, 'missing ' + keys[i])
+  }
+  count('info')
+}
+
+function ingest (topic, payload) {
+  count('messages')
+  count('bytes', payload.length)
+
+  var match = /^device\/sck\/([^/]+)\/(readings|hello|info)$/.exec(topic)
+  if (match) {
+    var token = match[1]
+    if (match[2] == 'readings') ingestReadings(token, topic, payload)
+    else if (match[2] == 'info') ingestInfo(topic, payload)
+    else if (payload == token + ':Hello') count('hello')
+    else invalid(topic, payload, 'bad hello')
+  } else if (topic == 'device/inventory') count('inventory')
+  else count('other')
+}
+
+// + matches one level, # the rest
+function matches (filter, topic) {
+  var f = filter.split('/')
+  var t = topic.split('/')
+  for (var i = 0; i < f.length; i++) {
+    if (f[i] == '#') return true
+    if (i >= t.length || (f[i] != '+' && f[i] != t[i])) return false
+  }
+  return f.length == t.length
+}
+
+function packet (type, flags, body) {
+  var length = body.length
+  var header = [(type << 4) | flags]
+  do {
+    var digit = length % 128
+    length = Math.floor(length / 128)
+    header.push(length > 0 ? digit | 0x80 : digit)
+  } while (length > 0)
+  return Buffer.concat([Buffer.from(header), body])
+}
+
+function string (text) {
+  var bytes = Buffer.from(text)
+  var length = Buffer.alloc(2)
+  length.writeUInt16BE(bytes.length)
+  return Buffer.concat([length, bytes])
+}
+
+function forward (topic, payload) {
+  if (subscribers.length == 0) return
+  var message = null
+  for (var i = 0; i < subscribers.length; i++) {
+    if (!matches(subscribers[i].filter, topic)) continue
+    if (!message) message = packet(PUBLISH, 0, Buffer.concat([string(topic), payload]))
+    subscribers[i].socket.write(message)
+  }
+}
+
+function handle (socket, type, flags, body) {
+  switch (type) {
+    case CONNECT:
+      count('connects')
+      socket.write(packet(CONNACK, 0, Buffer.from([0, 0])))
+      break
+
+    case PUBLISH:
+      var topicLength = body.readUInt16BE(0)
+      var topic = body.toString('utf8', 2, 2 + topicLength)
+      var qos = (flags >> 1) & 3
+      var start = 2 + topicLength
+      if (qos > 0) {
+        var id = body.slice(start, start + 2)
+        start += 2
+        socket.write(packet(PUBACK, 0, id))
+      }
+      var payload = body.slice(start)
+      ingest(topic, payload.toString('utf8'))
+      forward(topic, payload)
+      break
+
+    case SUBSCRIBE:
+      var granted = []
+      var pos = 2
+      while (pos < body.length) {
+        var length = body.readUInt16BE(pos)
+        subscribers.push({ socket: socket, filter: body.toString('utf8', pos + 2, pos + 2 + length) })
+        pos += 3 + length
+        granted.push(0)
+      }
+      socket.write(packet(SUBACK, 0, Buffer.concat([body.slice(0, 2), Buffer.from(granted)])))
+      break
+
+    case UNSUBSCRIBE:
+      subscribers = subscribers.filter(function (s) { return s.socket != socket })
+      socket.write(packet(UNSUBACK, 0, body.slice(0, 2)))
+      break
+
+    case PINGREQ:
+      socket.write(packet(PINGRESP, 0, Buffer.alloc(0)))
+      break
+
+    case DISCONNECT:
+      socket.end()
+      break
+  }
+}
+
+var server = net.createServer(function (socket) {
+  clients++
+  if (clients > maxClients) maxClients = clients
+  socket.setNoDelay(true)
+
+  // Packets can come split or several on one chunk
+  var pending = Buffer.alloc(0)
+  socket.on('data', function (chunk) {
+    pending = pending.length ? Buffer.concat([pending, chunk]) : chunk
+    while (pending.length >= 2) {
+      var length = 0
+      var multiplier = 1
+      var pos = 1
+      var complete = false
+      while (pos < pending.length && pos <= 4) {
+        var digit = pending[pos++]
+        length += (digit & 0x7F) * multiplier
+        multiplier *= 128
+        if ((digit & 0x80) == 0) {
+          complete = true
+          break
+        }
+      }
+      if (!complete) {
+        if (pos > 4) socket.destroy()
+        return
+      }
+      if (pending.length < pos + length) return
+      handle(socket, pending[0] >> 4, pending[0] & 0x0F, pending.slice(pos, pos + length))
+      pending = pending.slice(pos + length)
+    }
+  })
+  socket.on('close', function () {
+    clients--
+    subscribers = subscribers.filter(function (s) { return s.socket != socket })
+  })
+  socket.on('error', function () {})
+})
+
+function printLap () {
+  var now = Date.now()
+  var seconds = (now - lapStarted) / 1000
+  var messages = lap.messages / seconds
+  var readings = lap.readings / seconds
+  if (messages > peak.messages) peak.messages = messages
+  if (readings > peak.readings) peak.readings = readings
+  if (lap.messages > 0 || lap.connects > 0) {
+    console.log(new Date(now).toISOString() + ' clients: ' + clients + ' connects: ' + lap.connects +
+      ' msg/s: ' + messages.toFixed(0) + ' readings/s: ' + readings.toFixed(0) + ' KB/s: ' + (lap.bytes / 1024 / seconds).toFixed(1) +
+      ' hello: ' + lap.hello + ' info: ' + lap.info + ' invalid: ' + lap.invalid)
+  }
+  lap = counters()
+  lapStarted = now
+}
+
+function report () {
+  var seconds = (Date.now() - started) / 1000
+  return {
+    seconds: seconds,
+    totals: total,
+    kits: Object.keys(kits).length,
+    maxClients: maxClients,
+    averageMessages: total.messages / seconds,
+    averageReadings: total.readings / seconds,
+    peakMessages: peak.messages,
+    peakReadings: peak.readings,
+    invalidSamples: invalidSamples
+  }
+}
+
+function finish () {
+  printLap()
+  var result = report()
+  console.log('Received ' + total.messages + ' messages (' + total.groups + ' groups, ' + total.readings + ' readings) from ' +
+    result.kits + ' kits, ' + total.invalid + ' invalid')
+  if (options.report) fs.writeFileSync(options.report, JSON.stringify(result, null, 1))
+  process.exit(0)
+}
+
+server.listen(options.port, function () {
+  console.log('MQTT stand-in listening on port ' + options.port)
+})
+setInterval(printLap, options.interval * 1000)
+process.on('SIGINT', finish)
+process.on('SIGTERM', finish)
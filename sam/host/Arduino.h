@@ -0,0 +1,396 @@
+#pragma once
+
+// Arduino API for building the firmware on the host: the native env (see platformio.ini and hal.cpp) and the host harnesses (see list_powercut.cpp).
+// Time comes from hostClock, pins, UARTs, I2C devices and the other peripherals are plain memory that tests and scripts can drive (see HostScript.h).
+// Harnesses that only use the storage modules don't need hal.cpp, they define SerialUSB (and hostFlash) themselves.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+
+#include "sam.h"
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define TWO_PI 6.283185307179586476925286766559
+
+#define PROGMEM
+#define F(text) (text)
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+#define constrain(amt, low, high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define digitalPinToInterrupt(pin) (pin)
+
+// Arduino min/max take mixed types
+template<class A, class B> inline auto min(A a, B b) -> typename std::common_type<A, B>::type { return a < b ? a : b; }
+template<class A, class B> inline auto max(A a, B b) -> typename std::common_type<A, B>::type { return a > b ? a : b; }
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) { return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min; }
+inline long random(long howbig) { return howbig ? rand() % howbig : 0; }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+inline void randomSeed(unsigned long seed) { srand(seed); }
+inline bool isDigit(int c) { return isdigit(c); }
+
+// **** Time
+// Virtual time (default) only moves when the firmware waits (delay, sleep) plus a small tick on every read, so busy waits end and runs are repeatable.
+// Real time follows the workstation clock.
+class HostClock
+{
+	public:
+		bool virtualTime = true;
+		uint32_t tick = 10; 				// Micros added on every millis()/micros() call in virtual time
+		uint64_t end = UINT64_MAX; 			// Micros when the native run stops (see main.cpp)
+		uint64_t boot = 0; 				// Micros when the kit last booted (a reset keeps the run going, see main.cpp)
+		uint32_t epoch = 0; 				// Time of the outside world (network, NTP) when the run started
+
+		uint64_t now(); 				// Micros since the run started
+		uint64_t uptime() { return now() - boot; } 	// Micros since the kit booted (millis() and micros())
+		void advance(uint64_t wichMicros); 		// Waits (virtual time jumps, real time sleeps)
+		void reset(uint64_t fromMicros=0); 		// Starts counting from here (a run that continues after a reset)
+
+	private:
+		uint64_t virtualMicros = 0;
+		uint64_t realStart = 0;
+};
+extern HostClock hostClock;
+
+inline unsigned long millis() { return hostClock.uptime() / 1000; }
+inline unsigned long micros() { return hostClock.uptime(); }
+inline void delay(unsigned long ms) { hostClock.advance((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { hostClock.advance(us); }
+inline void yield() {}
+
+// **** Pins
+typedef void (*voidFuncPtr)(void);
+
+// Digital pins start HIGH (buttons and detect lines have pull ups), analog inputs start at 0.
+// Setting a pin runs the handler attached to it if the change matches its mode.
+// Listeners see every digitalWrite of the firmware (the ESP and the PM sensor follow their power pins, see HostDevices.h).
+class HostPins
+{
+	public:
+		static const uint8_t COUNT = 64;
+		uint8_t digital[COUNT];
+		uint8_t mode[COUNT];
+		uint16_t analog[COUNT];
+		voidFuncPtr handler[COUNT];
+		uint8_t handlerMode[COUNT];
+		uint32_t interruptsRun = 0; 			// Wakes LowPower (see hostSleep() on hal.cpp)
+		std::vector<std::function<void(uint8_t pin, uint8_t value)> > listeners;
+
+		HostPins() { reset(); }
+		void reset()
+		{
+			for (uint8_t i=0; i<COUNT; i++) {
+				digital[i] = HIGH;
+				mode[i] = INPUT;
+				analog[i] = 0;
+				handler[i] = 0;
+				handlerMode[i] = 0;
+			}
+		}
+		void set(uint8_t pin, uint8_t value); 		// From the outside world (runs interrupts)
+};
+extern HostPins hostPins;
+
+inline void pinMode(uint8_t pin, uint8_t mode) { if (pin < HostPins::COUNT) hostPins.mode[pin] = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin >= HostPins::COUNT) return;
+	hostPins.digital[pin] = value;
+	for (size_t i=0; i<hostPins.listeners.size(); i++) hostPins.listeners[i](pin, value);
+}
+inline int digitalRead(uint8_t pin) { return pin < HostPins::COUNT ? hostPins.digital[pin] : LOW; }
+inline int analogRead(uint8_t pin) { return pin < HostPins::COUNT ? hostPins.analog[pin] : 0; }
+inline void analogWrite(uint8_t pin, int value) { if (pin < HostPins::COUNT) hostPins.analog[pin] = value; }
+inline void analogReadResolution(int bits) {}
+inline void analogWriteResolution(int bits) {}
+inline void analogReference(int mode) {}
+inline void attachInterrupt(uint8_t pin, voidFuncPtr wichHandler, int wichMode) { if (pin < HostPins::COUNT) { hostPins.handler[pin] = wichHandler; hostPins.handlerMode[pin] = wichMode; } }
+inline void detachInterrupt(uint8_t pin) { if (pin < HostPins::COUNT) hostPins.handler[pin] = 0; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#define AR_DEFAULT 0
+#define AR_INTERNAL1V0 1
+#define AR_INTERNAL2V23 2
+
+// **** Strings
+class String
+{
+	private:
+		std::string s;
+
+		static std::string fromNumber(unsigned long long value, uint8_t base, bool negative=false) {
+			if (base < 2) base = 10;
+			std::string out;
+			do {
+				uint8_t digit = value % base;
+				out.insert(out.begin(), digit < 10 ? '0' + digit : 'A' + digit - 10);
+				value /= base;
+			} while (value > 0);
+			if (negative) out.insert(out.begin(), '-');
+			return out;
+		}
+		static std::string fromSigned(long long value, uint8_t base) {
+			if (value < 0 && base == 10) return fromNumber(-(unsigned long long)value, base, true);
+			return fromNumber((unsigned long)value, base);
+		}
+
+	public:
+		String(const char *str="") : s(str ? str : "") {}
+		String(const std::string &str) : s(str) {}
+		explicit String(char c) : s(1, c) {}
+		explicit String(unsigned char value, uint8_t base=10) : s(fromNumber(value, base)) {}
+		explicit String(int value, uint8_t base=10) : s(fromSigned(value, base)) {}
+		explicit String(unsigned int value, uint8_t base=10) : s(fromNumber(value, base)) {}
+		explicit String(long value, uint8_t base=10) : s(fromSigned(value, base)) {}
+		explicit String(unsigned long value, uint8_t base=10) : s(fromNumber(value, base)) {}
+		explicit String(float value, uint8_t decimals=2) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimals, value); s = b; }
+		explicit String(double value, uint8_t decimals=2) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimals, value); s = b; }
+
+		unsigned int length() const { return s.length(); }
+		const char *c_str() const { return s.c_str(); }
+		char charAt(unsigned int i) const { return i < s.length() ? s[i] : 0; }
+		void setCharAt(unsigned int i, char c) { if (i < s.length()) s[i] = c; }
+		char operator[](unsigned int i) const { return charAt(i); }
+		char &operator[](unsigned int i) { return s[i]; }
+		bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+		bool concat(const String &str) { s += str.s; return true; }
+		bool concat(const char *str) { s += str; return true; }
+		bool concat(char c) { s += c; return true; }
+		template<class T> bool concat(T value) { return concat(String(value)); }
+		String &operator+=(const String &str) { s += str.s; return *this; }
+		String &operator+=(const char *str) { s += str; return *this; }
+		String &operator+=(char c) { s += c; return *this; }
+		template<class T> String &operator+=(T value) { return *this += String(value); }
+
+		friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+		friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+		friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+		friend String operator+(const String &a, char b) { return String(a.s + b); }
+		template<class T> friend String operator+(const String &a, T b) { return a + String(b); }
+
+		bool equals(const String &str) const { return s == str.s; }
+		bool equalsIgnoreCase(const String &str) const { return strcasecmp(s.c_str(), str.s.c_str()) == 0; }
+		int compareTo(const String &str) const { return strcmp(s.c_str(), str.s.c_str()); }
+		bool operator==(const String &str) const { return s == str.s; }
+		bool operator==(const char *str) const { return s == str; }
+		bool operator!=(const String &str) const { return s != str.s; }
+		bool operator!=(const char *str) const { return s != str; }
+		bool operator<(const String &str) const { return s < str.s; }
+		bool startsWith(const String &str, unsigned int offset=0) const { return offset <= s.length() && s.compare(offset, str.s.length(), str.s) == 0; }
+		bool endsWith(const String &str) const { return s.length() >= str.s.length() && s.compare(s.length() - str.s.length(), str.s.length(), str.s) == 0; }
+
+		int indexOf(char c, unsigned int from=0) const { size_t p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+		int indexOf(const String &str, unsigned int from=0) const { size_t p = s.find(str.s, from); return p == std::string::npos ? -1 : (int)p; }
+		int lastIndexOf(char c) const { size_t p = s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+		int lastIndexOf(const String &str) const { size_t p = s.rfind(str.s); return p == std::string::npos ? -1 : (int)p; }
+
+		String substring(unsigned int from) const { return substring(from, s.length()); }
+		String substring(unsigned int from, unsigned int to) const {
+			if (from > to) std::swap(from, to);
+			if (from >= s.length()) return String();
+			if (to > s.length()) to = s.length();
+			return String(s.substr(from, to - from));
+		}
+		void replace(char find, char replace) { std::replace(s.begin(), s.end(), find, replace); }
+		void replace(const String &find, const String &replace) {
+			if (find.s.empty()) return;
+			for (size_t p = s.find(find.s); p != std::string::npos; p = s.find(find.s, p + replace.s.length())) s.replace(p, find.s.length(), replace.s);
+		}
+		void remove(unsigned int index) { if (index < s.length()) s.erase(index); }
+		void remove(unsigned int index, unsigned int count) { if (index < s.length()) s.erase(index, count); }
+		void trim() {
+			size_t first = s.find_first_not_of(" \t\r\n\v\f");
+			if (first == std::string::npos) { s.clear(); return; }
+			s = s.substr(first, s.find_last_not_of(" \t\r\n\v\f") - first + 1);
+		}
+		void toLowerCase() { for (size_t i=0; i<s.length(); i++) s[i] = tolower(s[i]); }
+		void toUpperCase() { for (size_t i=0; i<s.length(); i++) s[i] = toupper(s[i]); }
+
+		long toInt() const { return atol(s.c_str()); }
+		float toFloat() const { return atof(s.c_str()); }
+		double toDouble() const { return atof(s.c_str()); }
+		void toCharArray(char *buff, unsigned int size, unsigned int index=0) const { getBytes((unsigned char *)buff, size, index); }
+		void getBytes(unsigned char *buff, unsigned int size, unsigned int index=0) const {
+			if (size == 0) return;
+			size_t len = index < s.length() ? std::min((size_t)size - 1, s.length() - index) : 0;
+			if (len) memcpy(buff, s.c_str() + index, len);
+			buff[len] = 0;
+		}
+};
+
+// **** Serial ports
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buff, size_t size) {
+			for (size_t i=0; i<size; i++) write(buff[i]);
+			return size;
+		}
+		size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+		size_t write(const char *buff, size_t size) { return write((const uint8_t *)buff, size); }
+
+		size_t print(const char *str) { return write(str); }
+		size_t print(const String &str) { return write(str.c_str()); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(unsigned char value, int base=DEC) { return print((unsigned long)value, base); }
+		size_t print(int value, int base=DEC) { return print((long)value, base); }
+		size_t print(unsigned int value, int base=DEC) { return print((unsigned long)value, base); }
+		size_t print(long value, int base=DEC) { return print(String(value, base)); }
+		size_t print(unsigned long value, int base=DEC) { return print(String(value, base)); }
+		size_t print(double value, int decimals=2) { return print(String(value, decimals)); }
+
+		size_t println() { return write("\r\n"); }
+		template<class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+		template<class T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		virtual void flush() {}
+
+		void setTimeout(unsigned long wichTimeout) {}
+		size_t readBytes(uint8_t *buff, size_t size) {
+			size_t count = 0;
+			while (count < size && available()) buff[count++] = read();
+			return count;
+		}
+		size_t readBytes(char *buff, size_t size) { return readBytes((uint8_t *)buff, size); }
+		String readStringUntil(char terminator) {
+			String out;
+			while (available()) {
+				char c = read();
+				if (c == terminator) break;
+				out += c;
+			}
+			return out;
+		}
+};
+
+// Serial port with an input queue, bytes written go to the output vector (and to a hook if there is one)
+// When the input is empty the refill hook is asked for more bytes (UART devices simulated by scripts, see HostScript.h)
+class HostStream : public Stream
+{
+	public:
+		std::deque<uint8_t> input;
+		std::vector<uint8_t> output;
+		bool keepOutput = false;
+		std::function<void(const uint8_t *data, size_t size)> onWrite;
+		std::function<void(HostStream &port)> refill;
+
+		void feed(const void *data, size_t size) { input.insert(input.end(), (const uint8_t *)data, (const uint8_t *)data + size); }
+		void feed(const char *text) { feed(text, strlen(text)); }
+		void attach(int inFd, int outFd); 		// Connects the port to file descriptors (pipes, fifos, a pty) instead of the queues
+
+		size_t write(uint8_t c) { return write(&c, 1); }
+		size_t write(const uint8_t *buff, size_t size) {
+			if (keepOutput) output.insert(output.end(), buff, buff + size);
+			if (onWrite) onWrite(buff, size);
+			return size;
+		}
+		using Print::write;
+		int available() {
+			if (input.empty() && refill) refill(*this);
+			return input.size();
+		}
+		int read() {
+			if (!available()) return -1;
+			uint8_t c = input.front();
+			input.pop_front();
+			return c;
+		}
+		int peek() { return available() ? input.front() : -1; }
+
+		void begin(unsigned long baud) {}
+		void begin(unsigned long baud, uint16_t config) {}
+		void end() {}
+		operator bool() { return true; }
+};
+
+// USB console, prints on stdout unless something else is attached to onWrite
+class HostSerial : public HostStream
+{
+	public:
+		uint32_t lineBaud = 115200; 		// Speed set by the computer on the port (only matters to the ESP bridge)
+
+		HostSerial() { onWrite = [](const uint8_t *data, size_t size) { fwrite(data, 1, size, stdout); }; }
+		uint32_t baud() { return lineBaud; }
+};
+extern HostSerial SerialUSB;
+
+// SERCOM UARTs (ESP and PM sensor) and I2C buses, each sercom knows what runs on it so scripts can find them (see HostScript.h)
+class Uart;
+class TwoWire;
+class SERCOM
+{
+	public:
+		uint8_t number;
+		Uart *uart = 0;
+		TwoWire *wire = 0;
+
+		constexpr SERCOM(uint8_t wichNumber) : number(wichNumber) {} 	// Constant initialization: UARTs and buses register themselves from other global constructors
+};
+extern SERCOM sercom0, sercom1, sercom2, sercom3, sercom4, sercom5;
+SERCOM *hostSercom(uint8_t wichNumber);
+enum SercomRXPad { SERCOM_RX_PAD_0, SERCOM_RX_PAD_1, SERCOM_RX_PAD_2, SERCOM_RX_PAD_3 };
+enum SercomUartTXPad { UART_TX_PAD_0, UART_TX_PAD_2, UART_TX_RTS_CTS_PAD_0_2_3 };
+
+class Uart : public HostStream
+{
+	public:
+		Uart(SERCOM *wichSercom, uint8_t rxPin, uint8_t txPin, SercomRXPad rxPad, SercomUartTXPad txPad) { wichSercom->uart = this; }
+		void IrqHandler() {}
+};
+extern Uart Serial1; 				// ESP, on sercom0
+#define SerialESP Serial1
+
+static const uint8_t SDA = 20;
+static const uint8_t SCL = 21;
+
+// **** System
+void NVIC_SystemReset(); 		// Runs hostReset, or ends the native run if there is none (see hal.cpp)
+extern void (*hostReset)();
@@ -0,0 +1,21 @@
+#pragma once
+
+// Low power modes for the host build: sleeping moves the clock to the next wake up source (see hostSleep() on hal.cpp)
+
+#include <Arduino.h>
+
+void hostSleep(uint64_t wichMicros); 		// Until the time passes, an RTC alarm or a pin interrupt
+
+class ArduinoLowPowerClass
+{
+	public:
+		void idle() { hostSleep(UINT64_MAX); }
+		void idle(uint32_t millis) { hostSleep((uint64_t)millis * 1000); }
+		void sleep() { hostSleep(UINT64_MAX); }
+		void sleep(uint32_t millis) { hostSleep((uint64_t)millis * 1000); }
+		void deepSleep() { hostSleep(UINT64_MAX); }
+		void deepSleep(uint32_t millis) { hostSleep((uint64_t)millis * 1000); }
+		void attachInterruptWakeup(uint32_t pin, voidFuncPtr callback, uint32_t mode) { attachInterrupt(pin, callback, mode); }
+};
+
+extern ArduinoLowPowerClass LowPower;
@@ -0,0 +1,18 @@
+#pragma once
+
+// Emulated eeprom (FlashStorage) for the host build: kept in memory, a new run starts erased
+
+#include <Arduino.h>
+
+template<class T>
+class FlashStorageClass
+{
+	public:
+		void write(T data) { value = data; }
+		T read() { return value; }
+
+	private:
+		T value;
+};
+
+#define FlashStorage(name, T) FlashStorageClass<T> name
@@ -0,0 +1,445 @@
+#include "HostDevices.h"
+#include "Wire.h"
+#include "../src/Pins.h"
+
+#include <time.h>
+
+HostMetrics hostMetrics;
+HostEsp hostEsp;
+HostPms hostPms;
+HostBattery hostBattery;
+HostUrban hostUrban;
+
+// **** Metrics
+#define METRIC(name, kind) { #name, &HostMetrics::name, HostMetrics::kind }
+const HostMetrics::Field HostMetrics::fields[] = {
+	METRIC(boots, WORLD), METRIC(espBoots, WORLD), METRIC(espOnMillis, WORLD), METRIC(wifiConnects, WORLD), METRIC(wifiErrors, WORLD),
+	METRIC(timeSyncs, WORLD), METRIC(hellos, WORLD), METRIC(infos, WORLD), METRIC(publishes, WORLD), METRIC(publishErrors, WORLD),
+	METRIC(readingsPublished, WORLD), METRIC(latencySum, WORLD), METRIC(latencyMax, WORLD), METRIC(pmFrames, WORLD), METRIC(pmOnMillis, WORLD),
+	METRIC(wakeups, KIT_SUM), METRIC(wakeReading, KIT_SUM), METRIC(wakePublish, KIT_SUM), METRIC(wakeHeartbeat, KIT_SUM), METRIC(wakeReset, KIT_SUM),
+	METRIC(wakeFixed, KIT_SUM), METRIC(wakeEarly, KIT_SUM), METRIC(sleptSeconds, KIT_SUM), METRIC(awakeMillis, KIT_SUM),
+	METRIC(sdBytes, KIT_SUM), METRIC(sdSyncs, KIT_SUM), METRIC(flashProgrammed, KIT_SUM), METRIC(flashErased, KIT_SUM),
+	METRIC(minFreeRam, KIT_MIN), METRIC(minHeadroom, KIT_MIN), METRIC(pendingGroups, KIT_LAST), METRIC(logBytes, KIT_LAST),
+};
+const uint8_t HostMetrics::fieldCount = sizeof(fields) / sizeof(fields[0]);
+
+void HostMetrics::add(const HostMetrics &previousBoots)
+{
+	for (uint8_t i=0; i<fieldCount; i++) {
+		uint64_t &value = this->*fields[i].value;
+		uint64_t previous = previousBoots.*fields[i].value;
+		if (fields[i].kind == KIT_SUM) value += previous;
+		else if (fields[i].kind == KIT_MIN) value = std::min(value, previous);
+	}
+}
+bool HostMetrics::save(FILE *file)
+{
+	for (uint8_t i=0; i<fieldCount; i++) fprintf(file, "%s %llu\n", fields[i].name, (unsigned long long)(this->*fields[i].value));
+	return !ferror(file);
+}
+bool HostMetrics::load(const char *name, uint64_t value)
+{
+	for (uint8_t i=0; i<fieldCount; i++) {
+		if (strcmp(fields[i].name, name)) continue;
+		this->*fields[i].value = value;
+		return true;
+	}
+	return false;
+}
+
+// **** ESP
+HostEsp::HostEsp() : driver(link), manager(driver, ESP_ADDRESS) {}
+
+void HostEsp::begin()
+{
+	manager.init();
+
+	// Whatever the SAM writes reaches the ESP if it's running, what the ESP writes arrives to the SAM
+	Serial1.onWrite = [this](const uint8_t *data, size_t size) { if (on) link.feed(data, size); };
+	Serial1.refill = [this](HostStream &port) { poll(); };
+	link.onWrite = [](const uint8_t *data, size_t size) { Serial1.feed(data, size); };
+
+	hostPins.listeners.push_back([this](uint8_t pin, uint8_t value) { if (pin == pinPOWER_ESP || pin == pinESP_CH_PD) power(); });
+	power();
+}
+uint64_t HostEsp::onMillis()
+{
+	return hostMetrics.espOnMillis + (on ? (hostClock.now() - poweredAt) / 1000 : 0);
+}
+void HostEsp::power()
+{
+	// Powered through a transistor (LOW) and enabled with CH_PD (HIGH)
+	bool value = digitalRead(pinPOWER_ESP) == LOW && digitalRead(pinESP_CH_PD) == HIGH;
+	if (value == on) return;
+	on = value;
+
+	if (on) {
+		poweredAt = hostClock.now();
+		if (alive && !replaying) answer(SAMMES_BOOTED, "{\"mac\":\"5C:CF:7F:00:00:01\",\"ver\":\"0.9.8-host\",\"bd\":\"2026-01-01T00:00:00Z\"}", bootMillis);
+	} else {
+		hostMetrics.espOnMillis += (hostClock.now() - poweredAt) / 1000;
+		link.input.clear();
+		pending.clear();
+		incoming.clear();
+		partsReceived = 0;
+		booted = false;
+		connecting = false;
+		connected = false;
+	}
+}
+void HostEsp::poll()
+{
+	if (!on) return;
+
+	// Nobody listens while booting
+	if (!booted) link.input.clear();
+
+	while (booted && manager.available()) {
+		uint8_t netPack[NETPACK_TOTAL_SIZE];
+		uint8_t len = sizeof(netPack);
+		if (!manager.recvfromAck(netPack, &len) || len < 2) continue;
+
+		// The first part starts with the message type, the content goes on in the next parts
+		if (partsReceived == 0) incoming.clear();
+		incoming.append((const char *)&netPack[1], len - 1);
+		if (++partsReceived < netPack[0]) continue;
+		partsReceived = 0;
+		incoming.push_back(0);
+		if (!replaying) received(static_cast<ESPMessage>((uint8_t)incoming[0]), incoming.c_str() + 1);
+	}
+
+	// Packets recorded while this ESP was off are lost, like they would be
+	uint64_t now = hostClock.now();
+	while (!replayed.empty() && replayed.front().first <= now) {
+		std::vector<uint8_t> &packet = replayed.front().second;
+		if (replayed.front().first >= poweredAt) {
+			if (packet.size() >= 2 && packet[1] == SAMMES_BOOTED) booted = true;
+			sendPacket(packet.data(), packet.size());
+		}
+		replayed.pop_front();
+	}
+
+	while (!pending.empty() && pending.front().due <= now) {
+		Pending next = pending.front();
+		pending.pop_front();
+
+		switch (next.message) {
+			case SAMMES_BOOTED: booted = true; hostMetrics.espBoots++; break;
+			case SAMMES_WIFI_CONNECTED: if (!connected) hostMetrics.wifiConnects++; connected = true; connecting = false; break;
+			case SAMMES_SSID_ERROR:
+			case SAMMES_PASS_ERROR:
+			case SAMMES_WIFI_UNKNOWN_ERROR: connecting = false; hostMetrics.wifiErrors++; break;
+			default: break;
+		}
+		send(next.message, next.content);
+	}
+}
+void HostEsp::received(ESPMessage message, const char *content)
+{
+	switch (message) {
+		case ESPMES_SET_CONFIG:
+		{
+			// Connects or starts the AP as the config says
+			const char *action = strstr(content, "\"ac\":");
+			if (action && atoi(action + 5) == ESPMES_CONNECT) connect();
+			break;
+		}
+		case ESPMES_CONNECT:
+			connect();
+			break;
+
+		case ESPMES_GET_NETINFO:
+			answer(SAMMES_NETINFO, "{\"hn\":\"Smartcitizen0001\",\"ip\":\"192.168.1.100\"}", 0);
+			break;
+
+		case ESPMES_GET_TIME:
+		{
+			// NTP only answers once the wifi is up
+			if (!connected) break;
+			char epoch[12];
+			snprintf(epoch, sizeof(epoch), "%lu", (unsigned long)(hostClock.epoch + hostClock.now() / 1000000));
+			answer(SAMMES_TIME, epoch, 100);
+			hostMetrics.timeSyncs++;
+			break;
+		}
+		case ESPMES_MQTT_HELLO:
+			if (!connected) break;
+			answer(SAMMES_MQTT_HELLO_OK, "", publishMillis);
+			hostMetrics.hellos++;
+			break;
+
+		case ESPMES_MQTT_INFO:
+			answer(connected && publishOk ? SAMMES_MQTT_INFO_OK : SAMMES_MQTT_INFO_ERROR, "", publishMillis);
+			if (connected && publishOk) hostMetrics.infos++;
+			break;
+
+		case ESPMES_MQTT_CUSTOM:
+			answer(connected && publishOk ? SAMMES_MQTT_CUSTOM_OK : SAMMES_MQTT_CUSTOM_ERROR, "", publishMillis);
+			break;
+
+		case ESPMES_MQTT_PUBLISH:
+		{
+			if (!connected || !publishOk) {
+				answer(SAMMES_MQTT_PUBLISH_ERROR, "", publishMillis);
+				hostMetrics.publishErrors++;
+				break;
+			}
+			answer(SAMMES_MQTT_PUBLISH_OK, "", publishMillis);
+			hostMetrics.publishes++;
+
+			// {t:2017-03-24T13:35:14Z,29:48.45,13:66}
+			for (const char *c=content; *c; c++) if (*c == ',') hostMetrics.readingsPublished++;
+			const char *isoTime = strstr(content, "t:");
+			struct tm fields = {};
+			if (isoTime && strptime(isoTime + 2, "%Y-%m-%dT%H:%M:%SZ", &fields)) {
+				int64_t latency = (int64_t)(hostClock.epoch + hostClock.now() / 1000000) - (int64_t)timegm(&fields);
+				if (latency < 0) latency = 0;
+				hostMetrics.latencySum += latency;
+				if ((uint64_t)latency > hostMetrics.latencyMax) hostMetrics.latencyMax = latency;
+			}
+			break;
+		}
+		default: break;
+	}
+}
+void HostEsp::connect()
+{
+	if (connected) answer(SAMMES_WIFI_CONNECTED, "", 0);
+	if (connected || connecting) return;
+	connecting = true;
+
+	SAMMessage result = SAMMES_WIFI_CONNECTED;
+	if (wifi == WIFI_SSID_ERROR) result = SAMMES_SSID_ERROR;
+	else if (wifi == WIFI_PASS_ERROR) result = SAMMES_PASS_ERROR;
+	else if (wifi == WIFI_UNKNOWN_ERROR) result = SAMMES_WIFI_UNKNOWN_ERROR;
+	answer(result, "", connectMillis);
+}
+void HostEsp::answer(SAMMessage message, const std::string &content, uint32_t delayMillis)
+{
+	Pending next = { hostClock.now() + (uint64_t)delayMillis * 1000, message, content };
+	std::deque<Pending>::iterator it = pending.end();
+	while (it != pending.begin() && (it - 1)->due > next.due) it--;
+	pending.insert(it, next);
+}
+void HostEsp::send(SAMMessage message, const std::string &content)
+{
+	// Same parts the SAM sends: [total parts][content], the type goes first and the text ends with a 0
+	std::string netBuff(1, (char)message);
+	netBuff += content;
+	netBuff.push_back(0);
+	uint8_t totalParts = (netBuff.size() + NETPACK_CONTENT_SIZE - 1) / NETPACK_CONTENT_SIZE;
+	netBuff.resize(totalParts * NETPACK_CONTENT_SIZE, 0);
+
+	for (uint8_t i=0; i<totalParts; i++) {
+		uint8_t netPack[NETPACK_TOTAL_SIZE];
+		netPack[0] = totalParts;
+		memcpy(&netPack[1], &netBuff[i * NETPACK_CONTENT_SIZE], NETPACK_CONTENT_SIZE);
+		sendPacket(netPack, sizeof(netPack));
+	}
+}
+void HostEsp::sendPacket(const uint8_t *packet, size_t size)
+{
+	// Not waiting for the acks: the SAM only answers them while this runs inside its Serial1 reads
+	driver.setHeaderTo(SAM_ADDRESS);
+	driver.setHeaderId(++lastId);
+	driver.setHeaderFlags(RH_FLAGS_NONE);
+	driver.send(packet, size);
+}
+void HostEsp::replay(uint64_t due, const uint8_t *packet, size_t size)
+{
+	replayed.push_back(std::make_pair(due, std::vector<uint8_t>(packet, packet + size)));
+}
+
+// **** PMS5003
+void HostPms::begin()
+{
+	if (sercom5.uart) sercom5.uart->refill = [this](HostStream &port) { frame(port); };
+	hostPins.listeners.push_back([this](uint8_t pin, uint8_t value) { if (pin == pinBOARD_CONN_7) power(value == HIGH); }); 	// pinPM_ENABLE
+}
+void HostPms::set(const uint16_t *newValues, uint8_t count)
+{
+	for (uint8_t i=0; i<count && i<9; i++) values[i] = newValues[i];
+	recorded.clear();
+}
+void HostPms::setFrame(const uint8_t *bytes, size_t size)
+{
+	recorded.assign(bytes, bytes + size);
+}
+uint64_t HostPms::onMillis()
+{
+	return hostMetrics.pmOnMillis + (on ? (hostClock.now() - poweredAt) / 1000 : 0);
+}
+void HostPms::power(bool value)
+{
+	if (value == on) return;
+	on = value;
+	if (on) {
+		poweredAt = hostClock.now();
+		nextFrame = poweredAt + 1000000;
+	} else hostMetrics.pmOnMillis += (hostClock.now() - poweredAt) / 1000;
+}
+void HostPms::frame(HostStream &port)
+{
+	uint64_t now = hostClock.now();
+	if (!on || !plugged || now < nextFrame) return;
+	while (nextFrame <= now) nextFrame += 1000000;
+
+	if (!recorded.empty()) {
+		port.feed(recorded.data(), recorded.size());
+		hostMetrics.pmFrames++;
+		return;
+	}
+
+	// 42 4d, length, pm1 pm2.5 pm10 (standard particle), the same (atmospheric), particle counts, reserved, checksum
+	uint16_t data[13] = { 28, values[0], values[1], values[2], values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7], values[8] };
+	uint8_t bytes[32] = { 0x42, 0x4d };
+	for (uint8_t i=0; i<13; i++) {
+		bytes[2 + i * 2] = data[i] >> 8;
+		bytes[3 + i * 2] = data[i] & 0xFF;
+	}
+	uint16_t sum = 0;
+	for (uint8_t i=0; i<30; i++) sum += bytes[i];
+	bytes[30] = sum >> 8;
+	bytes[31] = sum & 0xFF;
+
+	port.feed(bytes, sizeof(bytes));
+	hostMetrics.pmFrames++;
+}
+
+// **** Battery and charger
+static void gaugeCommand(HostI2CDevice &gauge, const uint8_t *data, size_t size)
+{
+	// Control subcommands go through register 0, the ones the firmware waits on change the flags
+	if (size != 3 || data[0] != 0) return;
+	uint16_t subcommand = data[1] | data[2] << 8;
+	uint16_t flags = gauge.registers[6] | gauge.registers[7] << 8;
+	if (subcommand == 0x0013) gauge.setRegister16(6, flags | 0x10); 		// Config update
+	else if (subcommand == 0x0042) gauge.setRegister16(6, flags & ~0x10); 	// Soft reset
+	else if (subcommand == 0x0008) gauge.setRegister16(0, 0x1202); 		// Chem ID
+}
+
+void HostBattery::begin()
+{
+	registers();
+}
+void HostBattery::set(uint8_t newPercent, uint16_t newMilliVolts, int16_t newMilliAmps)
+{
+	bool changed = newPercent != percent;
+	percent = newPercent;
+	milliVolts = newMilliVolts;
+	milliAmps = newMilliAmps;
+	registers();
+	if (changed && present) pulse(pinGAUGE_INT);
+}
+void HostBattery::setPresent(bool value)
+{
+	present = value;
+	registers();
+	pulse(pinCHARGER_INT);
+}
+void HostBattery::setUsb(bool value)
+{
+	usb = value;
+	registers();
+	pulse(pinCHARGER_INT);
+}
+void HostBattery::registers()
+{
+	// Battery insertion is read on the ADC (low: inserted), the gauge only answers with a battery
+	hostAdc.RESULT.reg = present ? 100 : 1000;
+	if (!present) Wire.remove(0x55);
+	else {
+		if (!Wire.devices.count(0x55)) Wire.device(0x55).onWrite = gaugeCommand;
+		HostI2CDevice &gauge = Wire.device(0x55);
+		gauge.setRegister16(0x04, milliVolts);
+		gauge.setRegister16(0x10, milliAmps);
+		gauge.setRegister16(0x18, (int32_t)milliVolts * milliAmps / 1000);
+		gauge.setRegister16(0x1C, percent);
+		gauge.setRegister16(0x20, 100);
+		gauge.setRegister16(0x2A, 2000 * percent / 100);
+	}
+
+	// System status: VBUS from a USB adapter and power good
+	Wire.device(0x6B).registers[8] = usb ? 0x84 : 0x00;
+}
+void HostBattery::pulse(uint8_t pin)
+{
+	hostPins.set(pin, LOW);
+	hostPins.set(pin, HIGH);
+}
+
+// **** Urban board
+// The light sensor counts for its integration time (ITIME register) and the SHT31 answers its single shot command,
+// the barometer keeps its readings in the data registers like the real one
+static void lightCommand(HostI2CDevice &device, const uint8_t *data, size_t size)
+{
+	if (size < 3 || data[0] != 0x80 || !(data[1] & 0x02)) return; 	// Configuration with ADC_EN
+	float integrationMs = 2.8 * 964 * (256 - device.registers[0x81]) / 1000;
+	uint16_t visible = min(65535.0, hostUrban.light * integrationMs / (102.6 * 1.0167));
+	device.setRegister16(0x94, visible);
+	device.setRegister16(0x96, visible / 10); 	// Infrared, in the range of the first lux formula
+	device.registers[0x80] |= 0x10; 			// ADC_VALID
+}
+static void addWithCrc(std::deque<uint8_t> &out, uint16_t value)
+{
+	uint8_t bytes[2] = { (uint8_t)(value >> 8), (uint8_t)(value & 0xFF) };
+	uint8_t crc = 0xFF;
+	for (uint8_t i=0; i<2; i++) {
+		crc ^= bytes[i];
+		for (uint8_t b=0; b<8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+	}
+	out.push_back(bytes[0]);
+	out.push_back(bytes[1]);
+	out.push_back(crc);
+}
+static void shtCommand(HostI2CDevice &device, const uint8_t *data, size_t size)
+{
+	if (size != 2) return;
+	device.responses.clear();
+	if (data[0] != 0x24 || data[1] != 0x00) return; 	// Single shot, high repeatability
+	addWithCrc(device.responses, constrain((hostUrban.temperature + 45) * 65535 / 175, 0, 65535));
+	addWithCrc(device.responses, constrain(hostUrban.humidity * 65535 / 100, 0, 65535));
+}
+
+void HostUrban::begin()
+{
+	registers();
+}
+void HostUrban::set(float newLight, float newTemperature, float newHumidity, float newPressure)
+{
+	light = newLight;
+	temperature = newTemperature;
+	humidity = newHumidity;
+	pressure = newPressure;
+	registers();
+}
+void HostUrban::setPlugged(bool value)
+{
+	plugged = value;
+	registers();
+}
+void HostUrban::registers()
+{
+	const uint8_t addresses[] = { 0x29, 0x44, 0x60, 0x57 };
+	if (!plugged) {
+		for (uint8_t address : addresses) Wire.remove(address);
+		return;
+	}
+	for (uint8_t address : addresses) if (!Wire.devices.count(address)) {
+		if (address == 0x29) Wire.device(address).onWrite = lightCommand;
+		if (address == 0x44) Wire.device(address).onWrite = shtCommand;
+	}
+
+	// MPL3115A2: pressure in Pa Q18.2, temperature in C Q8.4, both left aligned
+	HostI2CDevice &barometer = Wire.device(0x60);
+	uint32_t rawPressure = (uint32_t)(pressure * 1000 * 4) << 4;
+	int16_t rawTemperature = (int16_t)(temperature * 16) << 4;
+	barometer.registers[0x01] = rawPressure >> 16;
+	barometer.registers[0x02] = rawPressure >> 8;
+	barometer.registers[0x03] = rawPressure;
+	barometer.registers[0x04] = rawTemperature >> 8;
+	barometer.registers[0x05] = rawTemperature;
+	barometer.registers[0x0C] = 0xC4; 			// WHO_AM_I
+
+	Wire.device(0x57).registers[0xFF] = 0x15; 		// MAX30105 part id
+}
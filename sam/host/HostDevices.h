@@ -0,0 +1,175 @@
+#pragma once
+
+// The devices around the SAM, modeled well enough to run the kit unattended for days of virtual time (see tools/scksim.py):
+//
+//	HostEsp		the ESP firmware as the SAM sees it on Serial1: boots when powered, joins the wifi, answers time and MQTT requests
+//	HostPms		PMS5003 particle sensor: one frame per second on SerialPM while it's powered
+//	HostBattery	fuel gauge (0x55) and charger (0x6B): battery charge and whether the kit is on USB
+//	HostUrban	urban board sensors on Wire: light (BH1730), temperature and humidity (SHT31), pressure (MPL3115A2), MAX30105
+//
+// Scripts and traces drive them (esp, pm, battery, power and urban events, see HostScript.h). What they see goes to hostMetrics,
+// main.cpp adds what the firmware counts and writes the report.
+
+#include <Arduino.h>
+#include "RHReliableDatagram.h"
+#include "Shared.h"
+
+// Counters of a native run. The kit side (wakeups, storage, RAM) is reset with the kit, main.cpp adds up the boots.
+struct HostMetrics
+{
+	enum Kind { WORLD, KIT_SUM, KIT_MIN, KIT_LAST };
+	struct Field { const char *name; uint64_t HostMetrics::*value; Kind kind; };
+	static const Field fields[];
+	static const uint8_t fieldCount;
+
+	// Outside world
+	uint64_t boots = 0;
+	uint64_t espBoots = 0;
+	uint64_t espOnMillis = 0;
+	uint64_t wifiConnects = 0;
+	uint64_t wifiErrors = 0;
+	uint64_t timeSyncs = 0;
+	uint64_t hellos = 0;
+	uint64_t infos = 0;
+	uint64_t publishes = 0;
+	uint64_t publishErrors = 0;
+	uint64_t readingsPublished = 0;
+	uint64_t latencySum = 0; 			// Seconds between a reading and its publish
+	uint64_t latencyMax = 0;
+	uint64_t pmFrames = 0;
+	uint64_t pmOnMillis = 0;
+
+	// Kit
+	uint64_t wakeups = 0;
+	uint64_t wakeReading = 0;
+	uint64_t wakePublish = 0;
+	uint64_t wakeHeartbeat = 0;
+	uint64_t wakeReset = 0;
+	uint64_t wakeFixed = 0;
+	uint64_t wakeEarly = 0;
+	uint64_t sleptSeconds = 0;
+	uint64_t awakeMillis = 0;
+	uint64_t sdBytes = 0;
+	uint64_t sdSyncs = 0;
+	uint64_t flashProgrammed = 0;
+	uint64_t flashErased = 0;
+	uint64_t minFreeRam = UINT64_MAX;
+	uint64_t minHeadroom = UINT64_MAX;
+	uint64_t pendingGroups = 0; 			// Readings waiting on the flash to be published
+	uint64_t logBytes = 0;
+
+	void add(const HostMetrics &previousBoots); 	// Adds the kit counters of the previous boots to these
+	bool save(FILE *file);
+	bool load(const char *name, uint64_t value); 	// One line of a saved file
+};
+extern HostMetrics hostMetrics;
+
+class HostEsp
+{
+	public:
+		enum WifiResult { WIFI_OK, WIFI_SSID_ERROR, WIFI_PASS_ERROR, WIFI_UNKNOWN_ERROR };
+
+		bool alive = true; 				// A dead ESP never boots
+		WifiResult wifi = WIFI_OK;
+		bool publishOk = true; 				// The MQTT broker accepts publishes
+		uint32_t bootMillis = 1500;
+		uint32_t connectMillis = 3000;
+		uint32_t publishMillis = 800; 			// Answer to hello, info and publish messages
+		bool replaying = false; 			// Only the packets of a recorded kit go to the SAM (see HostReplay), nothing is answered
+
+		HostEsp();
+		void begin(); 					// Takes Serial1 and follows the ESP power pins
+		bool powered() { return on; }
+		uint64_t onMillis(); 				// Including the current power on
+		void replay(uint64_t due, const uint8_t *packet, size_t size); 	// A recorded packet, sent at its time if the ESP is on
+
+	private:
+		struct Pending {
+			uint64_t due;
+			SAMMessage message;
+			std::string content;
+		};
+
+		HostStream link; 				// The ESP end of Serial1
+		RH_Serial driver;
+		RHReliableDatagram manager;
+		std::deque<Pending> pending; 			// Answers waiting for their time, in order
+		std::deque<std::pair<uint64_t, std::vector<uint8_t> > > replayed; 	// Recorded packets waiting for their time, in order
+		std::string incoming; 				// Parts received of a message
+		uint8_t partsReceived = 0;
+		uint8_t lastId = 0;
+		bool on = false;
+		bool booted = false;
+		bool connecting = false;
+		bool connected = false;
+		uint64_t poweredAt = 0;
+
+		void power();
+		void poll(); 					// Runs when the SAM looks at Serial1
+		void received(ESPMessage message, const char *content);
+		void connect();
+		void answer(SAMMessage message, const std::string &content, uint32_t delayMillis);
+		void send(SAMMessage message, const std::string &content);
+		void sendPacket(const uint8_t *packet, size_t size);
+};
+extern HostEsp hostEsp;
+
+class HostPms
+{
+	public:
+		bool plugged = true;
+		uint16_t values[9] = { 8, 12, 15, 1500, 450, 90, 12, 4, 2 }; 	// pm1 pm2.5 pm10 (ug/m3), pn0.3 pn0.5 pn1 pn2.5 pn5 pn10 (per 0.1L)
+
+		void begin(); 					// Takes SerialPM and follows its power pin
+		void set(const uint16_t *newValues, uint8_t count);
+		void setFrame(const uint8_t *bytes, size_t size); 	// Sends these bytes instead of a frame of the values (a recorded kit)
+		uint64_t onMillis();
+
+	private:
+		std::vector<uint8_t> recorded;
+		bool on = false;
+		uint64_t poweredAt = 0;
+		uint64_t nextFrame = 0;
+
+		void power(bool value);
+		void frame(HostStream &port);
+};
+extern HostPms hostPms;
+
+class HostBattery
+{
+	public:
+		bool present = true;
+		bool usb = true; 				// The charger sees a USB adapter
+		uint8_t percent = 80;
+		uint16_t milliVolts = 3900;
+		int16_t milliAmps = -25;
+
+		void begin(); 					// Plugs the gauge and the charger on Wire
+		void set(uint8_t newPercent, uint16_t newMilliVolts, int16_t newMilliAmps); 	// Raises the gauge interrupt when the percent changes
+		void setPresent(bool value);
+		void setUsb(bool value); 			// Raises the charger interrupt
+
+	private:
+		void registers();
+		void pulse(uint8_t pin);
+};
+extern HostBattery hostBattery;
+
+class HostUrban
+{
+	public:
+		bool plugged = true;
+		float light = 300; 				// lux
+		float temperature = 22; 			// C
+		float humidity = 45; 				// %
+		float pressure = 101.3; 			// kPa
+
+		void begin(); 					// Plugs the board on Wire
+		void set(float newLight, float newTemperature, float newHumidity, float newPressure);
+		void setPlugged(bool value);
+
+	private:
+		void registers();
+};
+extern HostUrban hostUrban;
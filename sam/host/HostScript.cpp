@@ -0,0 +1,483 @@
+#include "HostScript.h"
+#include "HostDevices.h"
+#include "Wire.h"
+#include "I2S.h"
+#include "SckTrace.h"
+
+#include <sstream>
+
+HostScript hostScript;
+HostReplay hostReplay;
+
+static const struct { const char *name; uint8_t minWords; } eventNames[] = {
+	{ "usb", 1 }, { "pin", 3 }, { "analog", 3 }, { "uart", 3 }, { "i2c", 5 }, { "i2c-answer", 4 }, { "i2c-remove", 3 }, { "i2s", 2 },
+	{ "esp", 2 }, { "pm", 2 }, { "battery", 2 }, { "power", 2 }, { "urban", 2 }, { "trace", 3 }, { "replay", 2 }, { "end", 1 },
+};
+
+static bool known(const std::vector<std::string> &words)
+{
+	for (auto &e : eventNames) if (!words.empty() && words[0] == e.name && words.size() >= e.minWords) return true;
+	return false;
+}
+static bool leavesState(const std::string &name)
+{
+	return name != "usb" && name != "i2c-answer";
+}
+
+static uint32_t number(const std::string &text)
+{
+	return strtoul(text.c_str(), 0, 0);
+}
+static std::vector<uint8_t> hexBytes(const std::vector<std::string> &words, size_t from)
+{
+	std::vector<uint8_t> bytes;
+	for (size_t w=from; w<words.size(); w++) {
+		for (size_t i=0; i+1<words[w].size(); i+=2) bytes.push_back(strtoul(words[w].substr(i, 2).c_str(), 0, 16));
+	}
+	return bytes;
+}
+static SERCOM *sercomByName(const std::string &name)
+{
+	if (name == "esp") return &sercom0;
+	if (name == "aux") return &sercom1;
+	if (name == "wire") return &sercom3;
+	if (name == "pm") return &sercom5;
+	if (name.compare(0, 6, "sercom") == 0) return hostSercom(number(name.substr(6)));
+	return 0;
+}
+
+// Samples of a WAV file for the microphone (the i2s event plays them over and over, noise_bench too)
+bool HostScript::loadWav(const char *path, std::vector<int32_t> &samples)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4)) return false;
+
+	uint16_t channels = 0, bits = 0;
+	size_t pos = 12;
+	while (pos + 8 <= data.size()) {
+		uint32_t size = data[pos + 4] | data[pos + 5] << 8 | data[pos + 6] << 16 | (uint32_t)data[pos + 7] << 24;
+		const uint8_t *chunk = &data[pos + 8];
+		if (pos + 8 + size > data.size()) size = data.size() - pos - 8;
+
+		if (!memcmp(&data[pos], "fmt ", 4) && size >= 16) {
+			if ((chunk[0] | chunk[1] << 8) != 1) return false; 		// Only PCM
+			channels = chunk[2] | chunk[3] << 8;
+			bits = chunk[14] | chunk[15] << 8;
+		} else if (!memcmp(&data[pos], "data", 4) && channels && bits) {
+			uint8_t bytes = bits / 8;
+			if (bytes < 2 || bytes > 4) return false;
+			for (size_t i=0; i + bytes * channels <= size; i+=bytes * channels) {
+				int32_t sample = 0;
+				for (uint8_t b=0; b<bytes; b++) sample |= (int32_t)chunk[i + b] << (8 * (4 - bytes + b));
+				samples.push_back(sample);
+			}
+			return !samples.empty();
+		}
+		pos += 8 + size + (size & 1);
+	}
+	return false;
+}
+
+bool HostScript::load(const char *path)
+{
+	std::ifstream file(path);
+	if (!file) {
+		fprintf(stderr, "Can't open script %s\n", path);
+		return false;
+	}
+
+	uint64_t last = 0;
+	uint32_t lineNumber = 0;
+	std::string line;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+
+		Event event;
+		event.line = lineNumber;
+		std::istringstream words(line);
+		std::string word;
+		while (words >> word) event.words.push_back(word);
+		if (event.words.empty()) continue;
+
+		std::string &when = event.words[0];
+		bool relative = when[0] == '+';
+		double seconds = atof(when.c_str() + (relative ? 1 : 0));
+		event.micros = (relative ? last : 0) + (uint64_t)(seconds * 1000000);
+		event.words.erase(event.words.begin());
+
+		if (!known(event.words) || event.micros < last) {
+			fprintf(stderr, "%s:%u: bad event: %s\n", path, lineNumber, line.c_str());
+			return false;
+		}
+		size_t start = line.find(event.words[0]) + event.words[0].size();
+		size_t first = line.find_first_not_of(" \t", start);
+		if (first != std::string::npos) event.rest = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+		last = event.micros;
+		events.push_back(event);
+	}
+	return true;
+}
+void HostScript::skip(uint64_t wichMicros)
+{
+	runUntil(wichMicros, true);
+}
+uint64_t HostScript::next()
+{
+	uint64_t when = position < events.size() ? events[position].micros : UINT64_MAX;
+	for (auto &trace : traces) if (!trace.done) when = std::min(when, trace.next.micros);
+	return std::min(when, hostReplay.next());
+}
+void HostScript::run()
+{
+	runUntil(hostClock.now(), false);
+}
+void HostScript::runUntil(uint64_t wichMicros, bool replaying)
+{
+	// Script and trace events in time order
+	while (true) {
+		Trace *trace = 0;
+		uint64_t when = position < events.size() ? events[position].micros : UINT64_MAX;
+		for (auto &t : traces) {
+			if (t.done || t.next.micros >= when) continue;
+			when = t.next.micros;
+			trace = &t;
+		}
+		hostReplay.runUntil(std::min(when, wichMicros), replaying);
+		if (when == UINT64_MAX || when > wichMicros) return;
+
+		// Copied: applying it can add traces
+		Event event = trace ? trace->next : events[position++];
+		std::string source = trace ? trace->path : "script";
+		if (trace) readRow(*trace);
+
+		if (replaying && !leavesState(event.words[0])) continue;
+		if (!apply(event)) fprintf(stderr, "%s line %u: can't run %s\n", source.c_str(), event.line, event.words[0].c_str());
+	}
+}
+bool HostScript::readRow(Trace &trace)
+{
+	std::string line;
+	while (true) {
+		if (!std::getline(*trace.file, line)) {
+			if (!trace.loop || !trace.rows) {
+				trace.done = true;
+				return false;
+			}
+			// Next lap
+			trace.file->clear();
+			trace.file->seekg(0);
+			trace.start += trace.loop;
+			trace.line = 0;
+			trace.rows = 0;
+			continue;
+		}
+		trace.line++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		std::replace(line.begin(), line.end(), ',', ' ');
+
+		Event event;
+		event.line = trace.line;
+		std::istringstream words(line);
+		std::string word;
+		while (words >> word) event.words.push_back(word);
+		if (event.words.empty() || !(isdigit(event.words[0][0]) || event.words[0][0] == '.')) continue; 	// Header rows
+
+		event.micros = trace.start + (uint64_t)(atof(event.words[0].c_str()) * 1000000);
+		event.words[0] = trace.event;
+		for (size_t i=1; i<event.words.size(); i++) event.rest += (i > 1 ? " " : "") + event.words[i];
+		if (!known(event.words) || event.micros < trace.next.micros) {
+			fprintf(stderr, "%s:%u: bad row: %s\n", trace.path.c_str(), trace.line, line.c_str());
+			continue;
+		}
+
+		trace.next = event;
+		trace.rows++;
+		return true;
+	}
+}
+bool HostScript::apply(const Event &event)
+{
+	const std::vector<std::string> &w = event.words;
+	const std::string &name = w[0];
+
+	if (name == "usb") {
+		SerialUSB.feed(event.rest.c_str());
+		SerialUSB.feed("\r\n");
+
+	} else if (name == "pin") {
+		hostPins.set(number(w[1]), number(w[2]));
+
+	} else if (name == "analog") {
+		if (number(w[1]) >= HostPins::COUNT) return false;
+		hostPins.analog[number(w[1])] = number(w[2]);
+
+	} else if (name == "uart") {
+		SERCOM *sercom = sercomByName(w[1]);
+		if (!sercom || !sercom->uart) return false;
+		std::vector<uint8_t> bytes = hexBytes(w, 2);
+		sercom->uart->feed(bytes.data(), bytes.size());
+
+	} else if (name.compare(0, 3, "i2c") == 0) {
+		SERCOM *sercom = sercomByName(w[1]);
+		if (!sercom || !sercom->wire) return false;
+		TwoWire &bus = *sercom->wire;
+		uint8_t address = number(w[2]);
+
+		if (name == "i2c") {
+			std::vector<uint8_t> bytes = hexBytes(w, 4);
+			bus.device(address).setRegister(number(w[3]), bytes.data(), bytes.size());
+		} else if (name == "i2c-answer") {
+			std::vector<uint8_t> bytes = hexBytes(w, 3);
+			HostI2CDevice &device = bus.device(address);
+			device.responses.insert(device.responses.end(), bytes.begin(), bytes.end());
+		} else bus.remove(address);
+
+	} else if (name == "i2s") {
+		if (w[1] == "noise") I2S.source = nullptr;
+		else if (w[1] == "sine" && w.size() >= 4) {
+			double hz = atof(w[2].c_str());
+			double level = atof(w[3].c_str()) * 2147483647.0;
+			std::shared_ptr<double> phase(new double(0));
+			I2S.source = [hz, level, phase]() {
+				*phase = fmod(*phase + 2 * PI * hz / I2S.sampleRate, 2 * PI);
+				return (int32_t)(level * sin(*phase));
+			};
+		} else if (w[1] == "wav" && w.size() >= 3) {
+			std::shared_ptr<std::vector<int32_t> > samples(new std::vector<int32_t>);
+			if (!loadWav(w[2].c_str(), *samples)) return false;
+			std::shared_ptr<size_t> next(new size_t(0));
+			I2S.source = [samples, next]() { int32_t sample = (*samples)[*next]; *next = (*next + 1) % samples->size(); return sample; };
+		} else return false;
+
+	} else if (name == "esp") {
+		if (w[1] == "on" || w[1] == "off") hostEsp.alive = w[1] == "on";
+		else if (w[1] == "wifi" && w.size() >= 3) {
+			if (w[2] == "ok") hostEsp.wifi = HostEsp::WIFI_OK;
+			else if (w[2] == "ssid") hostEsp.wifi = HostEsp::WIFI_SSID_ERROR;
+			else if (w[2] == "pass") hostEsp.wifi = HostEsp::WIFI_PASS_ERROR;
+			else if (w[2] == "unknown") hostEsp.wifi = HostEsp::WIFI_UNKNOWN_ERROR;
+			else return false;
+		} else if (w[1] == "publish" && w.size() >= 3 && (w[2] == "ok" || w[2] == "error")) hostEsp.publishOk = w[2] == "ok";
+		else if (w[1] == "delay" && w.size() >= 4) {
+			uint32_t millis = atof(w[3].c_str()) * 1000;
+			if (w[2] == "boot") hostEsp.bootMillis = millis;
+			else if (w[2] == "connect") hostEsp.connectMillis = millis;
+			else if (w[2] == "publish") hostEsp.publishMillis = millis;
+			else return false;
+		} else return false;
+
+	} else if (name == "pm") {
+		if (w[1] == "plug" || w[1] == "unplug") hostPms.plugged = w[1] == "plug";
+		else {
+			if (w.size() < 4) return false;
+			uint16_t values[9];
+			uint8_t count = 0;
+			for (size_t i=1; i<w.size() && count<9; i++) values[count++] = atof(w[i].c_str()) + 0.5;
+			hostPms.set(values, count);
+		}
+
+	} else if (name == "battery") {
+		if (w[1] == "none") {
+			if (hostBattery.present) hostBattery.setPresent(false);
+		} else {
+			if (!hostBattery.present) hostBattery.setPresent(true);
+			uint8_t percent = constrain(atoi(w[1].c_str()), 0, 100);
+			uint16_t milliVolts = w.size() > 2 ? atoi(w[2].c_str()) : 3500 + percent * 7; 	// 3.5V empty, 4.2V full
+			int16_t milliAmps = w.size() > 3 ? atoi(w[3].c_str()) : hostBattery.milliAmps;
+			hostBattery.set(percent, milliVolts, milliAmps);
+		}
+
+	} else if (name == "power") {
+		if (w[1] != "usb" && w[1] != "battery") return false;
+		if (hostBattery.usb != (w[1] == "usb")) hostBattery.setUsb(w[1] == "usb");
+
+	} else if (name == "urban") {
+		if (w[1] == "plug" || w[1] == "unplug") hostUrban.setPlugged(w[1] == "plug");
+		else {
+			if (w.size() < 5) return false;
+			hostUrban.set(atof(w[1].c_str()), atof(w[2].c_str()), atof(w[3].c_str()), atof(w[4].c_str()));
+		}
+
+	} else if (name == "trace") {
+		Trace trace;
+		trace.file.reset(new std::ifstream(w[1].c_str()));
+		if (!*trace.file) return false;
+		std::vector<std::string> check(1, w[2]);
+		while (check.size() < 16) check.push_back("0");
+		if (w[2] == "trace" || w[2] == "replay" || !known(check)) return false;
+
+		trace.path = w[1];
+		trace.event = w[2];
+		trace.start = event.micros;
+		trace.loop = w.size() > 3 ? atof(w[3].c_str()) * 1000000 : 0;
+		trace.line = 0;
+		trace.rows = 0;
+		trace.next.micros = 0;
+		trace.done = false;
+		readRow(trace);
+		traces.push_back(trace);
+
+	} else if (name == "replay") {
+		uint8_t streams = SCKTRACE_ALL_STREAMS;
+		if (w.size() > 2) {
+			const char *titles[TRACE_RECORD_COUNT] = { "", "pm", "i2c", "i2s", "bus" };
+			streams = 0;
+			for (uint8_t i=1; i<TRACE_RECORD_COUNT; i++) if (w[2].find(titles[i]) != std::string::npos) streams |= 1 << i;
+		}
+		if (!hostReplay.load(w[1].c_str(), event.micros, streams)) return false;
+
+	} else if (name == "end") {
+		ended = true;
+	}
+	return true;
+}
+
+// **** Recordings of real kits
+static bool readVarint(const std::vector<uint8_t> &data, size_t &pos, uint64_t &value)
+{
+	value = 0;
+	for (uint8_t shift=0; shift<64 && pos < data.size(); shift+=7) {
+		uint8_t byte = data[pos++];
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+bool HostReplay::load(const char *path, uint64_t wichStart, uint8_t wichStreams)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.size() < 28 || memcmp(&data[0], "SCKT", 4) || data[4] != SCKTRACE_VERSION) {
+		fprintf(stderr, "%s is not a trace of the kit (version %u)\n", path, SCKTRACE_VERSION);
+		return false;
+	}
+	memcpy(&recordedEpoch, &data[8], 4);
+	version.assign((const char *)&data[12], strnlen((const char *)&data[12], 16));
+
+	records.clear();
+	position = 0;
+	start = wichStart;
+	streams = wichStreams & data[6];
+
+	// A recording cut by a power loss ends on a broken record
+	uint64_t micros = wichStart;
+	uint32_t counts[TRACE_RECORD_COUNT] = {};
+	size_t pos = 28;
+	while (pos < data.size()) {
+		Record record;
+		uint64_t elapsed, size;
+		record.type = data[pos++];
+		if (!readVarint(data, pos, elapsed) || !readVarint(data, pos, size) || pos + size > data.size()) break;
+		micros += elapsed;
+		record.micros = micros;
+		record.data.assign(data.begin() + pos, data.begin() + pos + size);
+		pos += size;
+
+		if (record.type >= TRACE_RECORD_COUNT || !(streams & (1 << record.type))) continue;
+		counts[record.type]++;
+		records.push_back(record);
+	}
+	fprintf(stderr, "Replaying %s (%s, recorded on %u): %u pm, %u i2c, %u i2s, %u bus records over %.0f seconds\n", path, version.c_str(), recordedEpoch,
+		counts[TRACE_PM], counts[TRACE_I2C], counts[TRACE_I2S], counts[TRACE_BUS], (micros - wichStart) / 1000000.0);
+
+	// The ESP model only passes the recorded packets on, the microphone plays the recorded buffers
+	if (streams & (1 << TRACE_BUS)) hostEsp.replaying = true;
+	if (counts[TRACE_I2S]) {
+		noise.clear();
+		I2S.source = [this]() {
+			if (I2S.begun != noiseBegun) {
+				noiseBegun = I2S.begun;
+				noiseNext = 0;
+			}
+			if (noise.empty() || hostClock.now() - I2S.begun < 101000) return (int32_t)0; 	// Discarded anyway
+			int32_t sample = noise[noiseNext];
+			noiseNext = (noiseNext + 1) % noise.size();
+			return sample;
+		};
+	}
+	return true;
+}
+uint64_t HostReplay::next()
+{
+	if (position >= records.size()) return UINT64_MAX;
+	return std::max(start, records[position].micros - std::min(records[position].micros, (uint64_t)HOSTREPLAY_LEAD));
+}
+void HostReplay::runUntil(uint64_t wichMicros, bool replaying)
+{
+	// The packets recorded after a reset answer messages the kit won't send again, the ESP model takes over
+	if (replaying && (streams & (1 << TRACE_BUS))) {
+		streams &= ~(1 << TRACE_BUS);
+		hostEsp.replaying = false;
+		fprintf(stderr, "The kit reset while replaying, the ESP answers from now on instead of the recording\n");
+	}
+	while (position < records.size() && next() <= wichMicros) {
+		const Record &record = records[position++];
+		if (record.type == TRACE_BUS && !(streams & (1 << TRACE_BUS))) continue;
+		apply(record);
+	}
+}
+void HostReplay::apply(const Record &record)
+{
+	const std::vector<uint8_t> &data = record.data;
+
+	switch (record.type) {
+		case TRACE_PM:
+			hostPms.setFrame(data.data(), data.size());
+			break;
+
+		case TRACE_I2C:
+		{
+			bool registers = data.size() > 0 && (data[0] & 0x80);
+			if (data.size() < 3 || data.size() < 3u + data[2] + registers) break;
+			uint8_t busNumber = data[0] & 0x7F;
+			TwoWire *bus = (busNumber ? sercom1 : sercom3).wire;
+			if (!bus) break;
+			uint8_t address = data[1];
+			uint8_t writtenSize = data[2];
+			const uint8_t *read = &data[3 + writtenSize];
+			size_t readSize = data.size() - 3 - writtenSize;
+			HostI2CDevice &device = bus->device(address);
+
+			// A register is kept until the kit reads it again, the answer to a command comes when the command is written
+			if (writtenSize == 1 && !registers) {
+				device.setRegister(data[3], read, readSize);
+				break;
+			}
+			std::vector<uint8_t> key = { busNumber, address, writtenSize };
+			key.insert(key.end(), &data[3], read);
+			answers[key].assign(read, read + readSize);
+			if (hooked.insert(busNumber << 8 | address).second) {
+				auto previous = device.onWrite;
+				device.onWrite = [this, previous, busNumber, address](HostI2CDevice &device, const uint8_t *written, size_t size) {
+					if (previous) previous(device, written, size);
+					std::vector<uint8_t> key = { busNumber, address, (uint8_t)size };
+					key.insert(key.end(), written, written + size);
+					auto answer = answers.find(key);
+					if (answer == answers.end()) return;
+					const std::vector<uint8_t> &bytes = answer->second;
+					if (bytes.size() > 0 && registered.count(key)) device.setRegister(bytes[0], &bytes[1], bytes.size() - 1);
+					else device.responses.assign(bytes.begin(), bytes.end());
+				};
+			}
+			if (registers) registered.insert(key);
+			break;
+		}
+		case TRACE_I2S:
+		{
+			// 24 bits samples, left justified like the microphone gives them
+			noise.clear();
+			for (size_t i=0; i+2<data.size(); i+=3) noise.push_back((int32_t)((uint32_t)data[i] << 8 | (uint32_t)data[i + 1] << 16 | (uint32_t)data[i + 2] << 24));
+			break;
+		}
+		case TRACE_BUS:
+			hostEsp.replay(record.micros, data.data(), data.size());
+			break;
+	}
+}
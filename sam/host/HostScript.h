@@ -0,0 +1,117 @@
+#pragma once
+
+// The outside world of the native build, scripted: a text file with one timed event per line (# starts a comment).
+//
+//	<seconds> <event> [arguments]		seconds since the run started, +seconds for a time after the previous event
+//
+//	usb <text>				types a line on the console
+//	pin <pin> <0|1>				sets a digital input (runs its interrupt)
+//	analog <pin> <value>			sets an analog input
+//	uart <esp|pm|sercomN> <hex bytes>	bytes arriving to a UART
+//	i2c <wire|aux|sercomN> <address> <register> <hex bytes>	sets registers of a device (plugging it on the bus)
+//	i2c-answer <bus> <address> <hex bytes>	queues the answer to the next reads of a device
+//	i2c-remove <bus> <address>		unplugs a device
+//	i2s noise|sine <hz> <level 0-1>|wav <file.wav>	what the microphone hears (wav files loop, first channel only)
+//	esp on|off				a working ESP or a dead one that never boots (see HostDevices.h)
+//	esp wifi ok|ssid|pass|unknown		what joining the wifi gives
+//	esp publish ok|error			whether the MQTT broker takes the publishes
+//	esp delay boot|connect|publish <seconds>	time the ESP takes to boot, join the wifi and answer MQTT messages
+//	pm <pm1> <pm2.5> <pm10> [pn0.3 pn0.5 pn1 pn2.5 pn5 pn10]	what the PMS5003 measures
+//	pm plug|unplug				plugs or unplugs the PMS5003
+//	battery <percent> [mV] [mA]|none	battery charge (the gauge raises its interrupt when the percent changes), none removes it
+//	power usb|battery			plugs or unplugs USB power (plugging it resets the kit, like the real one)
+//	urban <lux> <C> <%> <kPa>|plug|unplug	what the urban board measures (light, temperature, humidity, pressure), plugs or unplugs it
+//	trace <file.csv> <event> [loop seconds]	replays a recorded trace of an event from now on: every row is the seconds
+//						and the arguments, like 60,8,12,15 for pm. With a loop time the trace starts over after it
+//	replay <file.skt> [pm,i2c,i2s,bus]	replays a recording of a real kit (trace command, see HostReplay) from now on,
+//						all of it or only some streams
+//	end					ends the run, even if the kit was busy (or resetting) when its time came
+//
+// Numbers can be decimal or 0x hex, hex bytes are like 42 4d 00 1c or 424d001c.
+// A run that goes on after a reset of the kit skips to that time: the events that leave something behind (pins, devices,
+// the microphone, the world around) are replayed, the ones that only happen once (usb, i2c-answer) are not.
+
+#include <Arduino.h>
+#include <fstream>
+#include <memory>
+#include <map>
+#include <set>
+
+class HostScript
+{
+	public:
+		bool ended = false;
+
+		bool load(const char *path); 		// Prints the offending line and returns false on errors
+		void skip(uint64_t wichMicros); 		// Goes on from this time of a previous run
+		uint64_t next(); 				// hostClock micros of the next event, UINT64_MAX if there is none
+		void run(); 					// Runs the events that are due
+		static bool loadWav(const char *path, std::vector<int32_t> &samples); 	// PCM 16, 24 or 32 bits, first channel, left justified on 32 bits
+
+	private:
+		struct Event {
+			uint64_t micros;
+			uint32_t line;
+			std::vector<std::string> words;
+			std::string rest; 				// Text after the event name (usb)
+		};
+		struct Trace {
+			std::shared_ptr<std::ifstream> file;
+			std::string path;
+			std::string event; 				// Name of the event of every row
+			uint64_t start; 				// hostClock micros of the row at 0 seconds
+			uint64_t loop; 					// Micros between laps, 0: play once
+			uint32_t line;
+			uint32_t rows; 					// Rows on this lap
+			Event next;
+			bool done;
+		};
+		std::vector<Event> events;
+		size_t position = 0;
+		std::vector<Trace> traces; 			// Read one row at a time
+
+		void runUntil(uint64_t wichMicros, bool replaying);
+		bool readRow(Trace &trace);
+		bool apply(const Event &event);
+};
+
+extern HostScript hostScript;
+
+// Recordings of real kits (TRACEnnn.SKT files of the trace command, see SckTrace.h) played through the drivers: PMS frames go
+// to the PMS model, I2C transactions to the devices (registers, or the answer to a command like the SHT31 one), noise buffers to
+// the microphone and ESP packets through the ESP model, that stops answering on its own.
+// Readings are put in place HOSTREPLAY_LEAD before the time the kit read them, so the same reading of a build with the same
+// configuration finds them. Noise buffers start after the 100 ms getReading() discards, and play again until the next one.
+#define HOSTREPLAY_LEAD 500000 		// micros
+
+class HostReplay
+{
+	public:
+		uint8_t streams = 0; 				// Bits (1 << TraceRecord) of the replayed streams
+		uint32_t recordedEpoch = 0; 			// When the recording started on the kit
+		std::string version; 				// SAM version of the kit
+
+		bool load(const char *path, uint64_t start, uint8_t wichStreams); 	// Replaces the previous one
+		uint64_t next(); 				// hostClock micros of the next record, UINT64_MAX if there is none
+		void runUntil(uint64_t wichMicros, bool replaying); 	// After a reset (replaying) the bus is left to the ESP model
+
+	private:
+		struct Record {
+			uint64_t micros; 			// When it was recorded, on hostClock
+			uint8_t type;
+			std::vector<uint8_t> data;
+		};
+		std::vector<Record> records;
+		size_t position = 0;
+		uint64_t start = 0;
+		std::map<std::vector<uint8_t>, std::vector<uint8_t> > answers; 	// Bus, address and written bytes of a command: what was read
+		std::set<uint16_t> hooked; 			// Devices that look for commands (bus << 8 | address)
+		std::set<std::vector<uint8_t> > registered; 	// Answers that go to the registers (first byte) instead of the responses
+		std::vector<int32_t> noise; 			// Last noise buffer, left justified on 32 bits
+		size_t noiseNext = 0;
+		uint64_t noiseBegun = 0;
+
+		void apply(const Record &record);
+};
+
+extern HostReplay hostReplay;
@@ -0,0 +1,59 @@
+#pragma once
+
+// I2S microphone for the host build. Samples come from source (set by scripts, see HostScript.h), by default a quiet
+// noise floor. Every read takes the time of one sample of the stereo frame, so capture loops last what they do on the kit.
+// The kit mic only drives one channel: the other one reads 0, like the real bus.
+
+#include <Arduino.h>
+
+#define I2S_PHILIPS_MODE 0
+#define I2S_RIGHT_JUSTIFIED_MODE 1
+#define I2S_LEFT_JUSTIFIED_MODE 2
+
+class I2SClass
+{
+	public:
+		std::function<int32_t()> source; 		// Next mic sample, left justified on 32 bits
+		long sampleRate = 44100;
+		uint32_t samplesRead = 0;
+		uint64_t begun = 0; 				// hostClock micros of the last begin()
+
+		bool begin(int mode, long rate, int bits)
+		{
+			if (rate <= 0) return false;
+			sampleRate = rate;
+			begun = hostClock.now();
+			channel = 0;
+			remainder = 0;
+			return true;
+		}
+		void end() {}
+		int available() { return 8; }
+		int read()
+		{
+			remainder += 500000;
+			hostClock.advance(remainder / sampleRate);
+			remainder %= sampleRate;
+			channel ^= 1;
+			if (!channel) return 0;
+			samplesRead++;
+			if (source) return source();
+
+			// Noise floor
+			seed = seed * 1103515245 + 12345;
+			return ((int32_t)(seed >> 14 & 0x3FFFF) - 0x20000) * 256;
+		}
+		int read(void *buff, size_t size)
+		{
+			int32_t value = read();
+			memcpy(buff, &value, size < 4 ? size : 4);
+			return size;
+		}
+
+	private:
+		uint8_t channel = 0;
+		uint32_t remainder = 0;
+		uint32_t seed = 1;
+};
+
+extern I2SClass I2S;
@@ -0,0 +1,97 @@
+#pragma once
+
+// RadioHead reliable datagrams for the host build: acknowledged messages with retries over RH_Serial.
+// Waits follow hostClock, so with nothing on the other end of the port a send gives up after timeout x retries of virtual time.
+
+#include "RH_Serial.h"
+
+class RHReliableDatagram
+{
+	public:
+		RHReliableDatagram(RH_Serial &wichDriver, uint8_t wichAddress=0) : driver(wichDriver), thisAddress(wichAddress) {}
+
+		bool init()
+		{
+			driver.setThisAddress(thisAddress);
+			driver.setHeaderFrom(thisAddress);
+			return driver.init();
+		}
+		void setThisAddress(uint8_t address) { thisAddress = address; init(); }
+		void setTimeout(uint16_t wichTimeout) { timeout = wichTimeout; }
+		void setRetries(uint8_t wichRetries) { retries = wichRetries; }
+		uint32_t retransmissions() { return retransmitted; }
+		bool available() { return driver.available(); }
+
+		bool sendtoWait(uint8_t *buf, uint8_t len, uint8_t address)
+		{
+			uint8_t sequence = ++lastSequence;
+			for (uint8_t attempt=0; attempt<=retries; attempt++) {
+				driver.setHeaderTo(address);
+				driver.setHeaderId(sequence);
+				driver.setHeaderFlags(attempt ? RH_FLAGS_RETRY : RH_FLAGS_NONE, RH_FLAGS_ACK | RH_FLAGS_RETRY);
+				driver.send(buf, len);
+				if (address == RH_BROADCAST_ADDRESS) return true;
+				if (attempt) retransmitted++;
+
+				uint32_t sent = millis();
+				uint32_t wait = timeout + (timeout * random(0, 256) / 256);
+				while (millis() - sent < wait) {
+					if (!driver.available()) continue;
+					uint8_t from = driver.headerFrom();
+					uint8_t to = driver.headerTo();
+					uint8_t id = driver.headerId();
+					uint8_t flags = driver.headerFlags();
+					driver.recv(0, 0);
+					if (from == address && to == thisAddress && (flags & RH_FLAGS_ACK) && id == sequence) return true;
+					if (!(flags & RH_FLAGS_ACK) && id == seenIds[from]) acknowledge(id, from);
+				}
+			}
+			return false;
+		}
+		bool recvfromAck(uint8_t *buf, uint8_t *len, uint8_t *from=0, uint8_t *to=0, uint8_t *id=0, uint8_t *flags=0)
+		{
+			if (!driver.available()) return false;
+			uint8_t rxFrom = driver.headerFrom();
+			uint8_t rxTo = driver.headerTo();
+			uint8_t rxId = driver.headerId();
+			uint8_t rxFlags = driver.headerFlags();
+			if (!driver.recv(buf, len)) return false;
+			if (rxFlags & RH_FLAGS_ACK) return false;
+
+			if (rxTo == thisAddress) acknowledge(rxId, rxFrom);
+			if ((rxFlags & RH_FLAGS_RETRY) && seenIds[rxFrom] == rxId) return false; 	// Already delivered
+			seenIds[rxFrom] = rxId;
+
+			if (from) *from = rxFrom;
+			if (to) *to = rxTo;
+			if (id) *id = rxId;
+			if (flags) *flags = rxFlags;
+			return true;
+		}
+		bool recvfromAckTimeout(uint8_t *buf, uint8_t *len, uint16_t wichTimeout, uint8_t *from=0, uint8_t *to=0, uint8_t *id=0, uint8_t *flags=0)
+		{
+			uint32_t started = millis();
+			while (millis() - started < wichTimeout) {
+				if (driver.available() && recvfromAck(buf, len, from, to, id, flags)) return true;
+			}
+			return false;
+		}
+
+	private:
+		RH_Serial &driver;
+		uint8_t thisAddress;
+		uint16_t timeout = 200;
+		uint8_t retries = 3;
+		uint8_t lastSequence = 0;
+		uint8_t seenIds[256] = {};
+		uint32_t retransmitted = 0;
+
+		void acknowledge(uint8_t id, uint8_t from)
+		{
+			uint8_t ack = '!';
+			driver.setHeaderTo(from);
+			driver.setHeaderId(id);
+			driver.setHeaderFlags(RH_FLAGS_ACK, RH_FLAGS_ACK | RH_FLAGS_RETRY);
+			driver.send(&ack, 1);
+		}
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+// RadioHead serial driver for the host build, with the same framing as RH_Serial so the other end of the port
+// (a pipe to an ESP stand-in, see HostStream::attach) talks to it like the ESP does:
+// DLE STX to from id flags payload DLE ETX fcs (DLE bytes inside the frame are doubled, fcs is CRC-CCITT, low byte first).
+
+#include <Arduino.h>
+
+#define RH_BROADCAST_ADDRESS 0xFF
+#define RH_FLAGS_NONE 0x00
+#define RH_FLAGS_ACK 0x80
+#define RH_FLAGS_RETRY 0x40
+#define RH_SERIAL_HEADER_LEN 4
+#define RH_SERIAL_MAX_PAYLOAD_LEN 64
+#define RH_SERIAL_MAX_MESSAGE_LEN (RH_SERIAL_MAX_PAYLOAD_LEN - RH_SERIAL_HEADER_LEN)
+
+#define DLE 0x10
+#define STX 0x02
+#define ETX 0x03
+
+inline uint16_t RHcrc_ccitt_update(uint16_t crc, uint8_t data)
+{
+	data ^= crc & 0xFF;
+	data ^= data << 4;
+	return (((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3);
+}
+
+class RH_Serial
+{
+	public:
+		uint32_t rxGood = 0;
+		uint32_t rxBad = 0;
+		uint32_t txGood = 0;
+
+		RH_Serial(Stream &wichSerial) : serial(wichSerial) {}
+
+		bool init() { return true; }
+		void setThisAddress(uint8_t address) { thisAddress = address; }
+		void setHeaderTo(uint8_t to) { txTo = to; }
+		void setHeaderFrom(uint8_t from) { txFrom = from; }
+		void setHeaderId(uint8_t id) { txId = id; }
+		void setHeaderFlags(uint8_t set, uint8_t clear=0xFF) { txFlags = (txFlags & ~clear) | set; }
+		uint8_t headerTo() { return rxBuf[0]; }
+		uint8_t headerFrom() { return rxBuf[1]; }
+		uint8_t headerId() { return rxBuf[2]; }
+		uint8_t headerFlags() { return rxBuf[3]; }
+		uint8_t maxMessageLength() { return RH_SERIAL_MAX_MESSAGE_LEN; }
+
+		bool available()
+		{
+			while (!rxValid && serial.available()) handleRx(serial.read());
+			return rxValid;
+		}
+		bool waitAvailableTimeout(uint16_t timeout)
+		{
+			uint32_t started = millis();
+			while (millis() - started < timeout) if (available()) return true;
+			return false;
+		}
+		bool waitPacketSent() { return true; }
+
+		bool recv(uint8_t *buf, uint8_t *len)
+		{
+			if (!available()) return false;
+			if (buf && len) {
+				uint8_t size = rxLen - RH_SERIAL_HEADER_LEN;
+				if (*len > size) *len = size;
+				memcpy(buf, rxBuf + RH_SERIAL_HEADER_LEN, *len);
+			}
+			rxValid = false;
+			return true;
+		}
+		bool send(const uint8_t *data, uint8_t len)
+		{
+			if (len > RH_SERIAL_MAX_MESSAGE_LEN) return false;
+			txFcs = 0xFFFF;
+			serial.write((uint8_t)DLE);
+			serial.write((uint8_t)STX);
+			txData(txTo);
+			txData(txFrom);
+			txData(txId);
+			txData(txFlags);
+			for (uint8_t i=0; i<len; i++) txData(data[i]);
+			serial.write((uint8_t)DLE);
+			txFcs = RHcrc_ccitt_update(txFcs, DLE);
+			serial.write((uint8_t)ETX);
+			txFcs = RHcrc_ccitt_update(txFcs, ETX);
+			txFcs = ~txFcs;
+			serial.write((uint8_t)(txFcs & 0xFF));
+			serial.write((uint8_t)(txFcs >> 8));
+			txGood++;
+			return true;
+		}
+
+	private:
+		enum RxState { RX_IDLE, RX_DLE, RX_DATA, RX_ESCAPE, RX_FCS1, RX_FCS2 };
+
+		Stream &serial;
+		uint8_t thisAddress = 0;
+		uint8_t txTo = RH_BROADCAST_ADDRESS, txFrom = RH_BROADCAST_ADDRESS, txId = 0, txFlags = 0;
+		uint16_t txFcs = 0;
+		RxState rxState = RX_IDLE;
+		uint8_t rxBuf[RH_SERIAL_MAX_PAYLOAD_LEN];
+		uint8_t rxLen = 0;
+		uint16_t rxFcs = 0;
+		uint16_t rxReceivedFcs = 0;
+		bool rxValid = false;
+
+		void txData(uint8_t c)
+		{
+			if (c == DLE) serial.write((uint8_t)DLE);
+			serial.write(c);
+			txFcs = RHcrc_ccitt_update(txFcs, c);
+		}
+		void rxData(uint8_t c)
+		{
+			if (rxLen >= sizeof(rxBuf)) {
+				rxBad++;
+				rxState = RX_IDLE;
+				return;
+			}
+			rxBuf[rxLen++] = c;
+			rxFcs = RHcrc_ccitt_update(rxFcs, c);
+		}
+		void handleRx(uint8_t c)
+		{
+			switch (rxState) {
+				case RX_IDLE:
+					if (c == DLE) rxState = RX_DLE;
+					break;
+				case RX_DLE:
+					if (c == STX) {
+						rxLen = 0;
+						rxFcs = 0xFFFF;
+						rxState = RX_DATA;
+					} else rxState = RX_IDLE;
+					break;
+				case RX_DATA:
+					if (c == DLE) rxState = RX_ESCAPE;
+					else rxData(c);
+					break;
+				case RX_ESCAPE:
+					if (c == ETX) {
+						rxFcs = RHcrc_ccitt_update(rxFcs, DLE);
+						rxFcs = RHcrc_ccitt_update(rxFcs, ETX);
+						rxState = RX_FCS1;
+					} else if (c == DLE) {
+						rxData(DLE);
+						if (rxState == RX_ESCAPE) rxState = RX_DATA;
+					} else {
+						rxBad++;
+						rxState = RX_IDLE;
+					}
+					break;
+				case RX_FCS1:
+					rxReceivedFcs = c;
+					rxState = RX_FCS2;
+					break;
+				case RX_FCS2:
+					rxReceivedFcs |= (uint16_t)c << 8;
+					rxState = RX_IDLE;
+					if (rxLen < RH_SERIAL_HEADER_LEN || rxReceivedFcs != (uint16_t)~rxFcs) {
+						rxBad++;
+						break;
+					}
+					if (rxBuf[0] != thisAddress && rxBuf[0] != RH_BROADCAST_ADDRESS) break;
+					rxGood++;
+					rxValid = true;
+					break;
+			}
+		}
+};
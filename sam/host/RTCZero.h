@@ -0,0 +1,133 @@
+#pragma once
+
+// RTC for the host build: the epoch follows hostClock from the moment it was set.
+// Alarms are checked by the native loop and by LowPower (see hal.cpp), nextAlarm() says when the next one is due.
+
+#include <Arduino.h>
+#include <time.h>
+
+class RTCZero
+{
+	public:
+		enum Alarm_Match { MATCH_OFF, MATCH_SS, MATCH_MMSS, MATCH_HHMMSS, MATCH_DHHMMSS, MATCH_MMDDHHMMSS, MATCH_YYMMDDHHMMSS };
+
+		static RTCZero *active; 			// The RTC the firmware started (hal.cpp wakes it)
+		static uint32_t startEpoch; 			// Time of the RTC when it starts, 0: not configured (like after a power loss)
+		static int64_t keptOffset; 			// offset() of an RTC that kept running through a reset of the kit, 0: none
+
+		void begin(bool resetTime=false)
+		{
+			active = this;
+			if (configured) return;
+			if (keptOffset) {
+				offsetMicros = keptOffset;
+				configured = true;
+			} else if (startEpoch) setEpoch(startEpoch);
+		}
+		bool isConfigured() { return configured; }
+
+		uint32_t getEpoch() { return (offsetMicros + (int64_t)hostClock.now()) / 1000000; }
+		uint32_t getY2kEpoch() { return getEpoch() - 946684800; }
+		void setEpoch(uint32_t epoch)
+		{
+			offsetMicros = (int64_t)epoch * 1000000 - (int64_t)hostClock.now();
+			configured = true;
+			if (match != MATCH_OFF) enableAlarm(match);
+		}
+
+		uint8_t getSeconds() { return field().tm_sec; }
+		uint8_t getMinutes() { return field().tm_min; }
+		uint8_t getHours() { return field().tm_hour; }
+		uint8_t getDay() { return field().tm_mday; }
+		uint8_t getMonth() { return field().tm_mon + 1; }
+		uint8_t getYear() { return field().tm_year - 100; }
+		void setTime(uint8_t hours, uint8_t minutes, uint8_t seconds) { setFields(getYear(), getMonth(), getDay(), hours, minutes, seconds); }
+		void setDate(uint8_t day, uint8_t month, uint8_t year) { setFields(year, month, day, getHours(), getMinutes(), getSeconds()); }
+
+		void setAlarmTime(uint8_t hours, uint8_t minutes, uint8_t seconds) { alarm.tm_hour = hours; alarm.tm_min = minutes; alarm.tm_sec = seconds; }
+		void setAlarmDate(uint8_t day, uint8_t month, uint8_t year) { alarm.tm_mday = day; alarm.tm_mon = month - 1; alarm.tm_year = year + 100; }
+		void setAlarmEpoch(uint32_t epoch) { time_t t = epoch; gmtime_r(&t, &alarm); }
+		void enableAlarm(Alarm_Match wichMatch)
+		{
+			match = wichMatch;
+			alarmEpoch = nextMatch(getEpoch() + 1);
+		}
+		void disableAlarm() { match = MATCH_OFF; }
+		void attachInterrupt(voidFuncPtr callback) { alarmCallback = callback; }
+		void detachInterrupt() { alarmCallback = 0; }
+		void standbyMode() {}
+
+		// Host side
+		int64_t offset() { return configured ? offsetMicros : 0; } 	// Epoch in micros minus hostClock micros
+		uint64_t nextAlarm() 				// hostClock micros of the next alarm, UINT64_MAX if there is none
+		{
+			if (match == MATCH_OFF || !alarmCallback || alarmEpoch == 0) return UINT64_MAX;
+			int64_t due = (int64_t)alarmEpoch * 1000000 - offsetMicros;
+			return due < 0 ? 0 : due;
+		}
+		bool poll() 					// Runs the alarm if it's due
+		{
+			if (nextAlarm() > hostClock.now()) return false;
+			voidFuncPtr callback = alarmCallback;
+			alarmEpoch = match == MATCH_YYMMDDHHMMSS ? 0 : nextMatch(alarmEpoch + 1);
+			callback();
+			return true;
+		}
+
+	private:
+		bool configured = false;
+		int64_t offsetMicros = 0;
+		struct tm alarm = {};
+		Alarm_Match match = MATCH_OFF;
+		uint32_t alarmEpoch = 0;
+		voidFuncPtr alarmCallback = 0;
+
+		struct tm field()
+		{
+			time_t t = getEpoch();
+			struct tm fields;
+			gmtime_r(&t, &fields);
+			return fields;
+		}
+		void setFields(uint8_t year, uint8_t month, uint8_t day, uint8_t hours, uint8_t minutes, uint8_t seconds)
+		{
+			struct tm fields = {};
+			fields.tm_year = year + 100;
+			fields.tm_mon = month - 1;
+			fields.tm_mday = day;
+			fields.tm_hour = hours;
+			fields.tm_min = minutes;
+			fields.tm_sec = seconds;
+			setEpoch(timegm(&fields));
+		}
+		uint32_t nextMatch(uint32_t from) 		// First second from this one that matches the alarm
+		{
+			uint32_t period = 0;
+			uint32_t offset = 0;
+			switch (match) {
+				case MATCH_OFF: return 0;
+				case MATCH_SS: period = 60; offset = alarm.tm_sec; break;
+				case MATCH_MMSS: period = 3600; offset = alarm.tm_min * 60 + alarm.tm_sec; break;
+				case MATCH_HHMMSS: period = 86400; offset = alarm.tm_hour * 3600 + alarm.tm_min * 60 + alarm.tm_sec; break;
+				case MATCH_YYMMDDHHMMSS: {
+					struct tm fields = alarm;
+					uint32_t epoch = timegm(&fields);
+					return epoch >= from ? epoch : 0;
+				}
+				default: {
+					// Day and month matches: look for the day
+					for (uint32_t day=from / 86400; day<from / 86400 + 1500; day++) {
+						time_t t = (time_t)day * 86400;
+						struct tm fields;
+						gmtime_r(&t, &fields);
+						if (fields.tm_mday != alarm.tm_mday) continue;
+						if (match == MATCH_MMDDHHMMSS && fields.tm_mon != alarm.tm_mon) continue;
+						uint32_t epoch = day * 86400 + alarm.tm_hour * 3600 + alarm.tm_min * 60 + alarm.tm_sec;
+						if (epoch >= from) return epoch;
+					}
+					return 0;
+				}
+			}
+			return from + (offset + period - from % period) % period;
+		}
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+// Pin multiplexing report for the host build (the pinmux command)
+
+#include <Arduino.h>
+
+#define PINS_COUNT 42
+
+inline char *pinmux_report(uint8_t pin, char *buff, const char *pinName)
+{
+	sprintf(buff, "Pin %u: mode %u, digital %u, analog %u", pin, hostPins.mode[pin], hostPins.digital[pin], hostPins.analog[pin]);
+	return buff;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// SPI bus for the host build: nothing is attached to it (the flash and the sdcard are simulated above the bus, see SPIFlash.h and SdFat.h)
+
+#include <Arduino.h>
+
+class SPIClass
+{
+	public:
+		void begin() {}
+		void end() {}
+		uint8_t transfer(uint8_t data) { return 0xFF; }
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,81 @@
+#pragma once
+
+// In-memory NOR flash with the SPIMemory (SPIFlash 3.2.1) API used by the firmware.
+// Like the real chip, bytes can only be programmed when erased (0xFF) and erase works on 4KB sectors.
+// powerBudget counts programmed/erased bytes, when it reaches zero the operation is cut in the middle (the byte being
+// programmed gets only some of its bits cleared) and PowerCut is thrown, simulating a reset.
+
+#include <vector>
+
+struct PowerCut {};
+
+class FlashChip
+{
+	public:
+		std::vector<uint8_t> memory;
+		long powerBudget = -1; 				// -1: no power cuts
+		uint32_t programmedBytes = 0;
+		uint32_t erasedSectors = 0;
+
+		FlashChip() : memory(4194304, 0xFF) {}
+
+		void consume(uint32_t address, uint8_t value, bool erasing)
+		{
+			if (powerBudget < 0) return;
+			if (powerBudget-- > 0) return;
+
+			// Leave the interrupted byte half done
+			if (erasing) memory[address] |= (uint8_t)rand();
+			else memory[address] &= value | (uint8_t)rand();
+			throw PowerCut();
+		}
+};
+
+extern FlashChip hostFlash;
+
+class SPIFlash
+{
+	public:
+		SPIFlash(uint8_t cs) {}
+
+		bool begin(uint32_t flashChipSize=0) { return true; }
+		void setClock(uint32_t clockSpeed) {}
+		uint32_t getCapacity() { return hostFlash.memory.size(); }
+
+		uint8_t readByte(uint32_t address, bool fastRead=false) { return hostFlash.memory[address]; }
+		bool readByteArray(uint32_t address, uint8_t *data, size_t size, bool fastRead=false)
+		{
+			if (address + size > hostFlash.memory.size()) return false;
+			memcpy(data, &hostFlash.memory[address], size);
+			return true;
+		}
+
+		bool writeByte(uint32_t address, uint8_t data, bool errorCheck=true) { return writeByteArray(address, &data, 1, errorCheck); }
+		bool writeByteArray(uint32_t address, uint8_t *data, size_t size, bool errorCheck=true)
+		{
+			if (address + size > hostFlash.memory.size()) return false;
+
+			// Same check SPIMemory does before programming (_notPrevWritten)
+			for (size_t i=0; i<size; i++) if (hostFlash.memory[address + i] != 0xFF) return false;
+
+			for (size_t i=0; i<size; i++) {
+				hostFlash.consume(address + i, data[i], false);
+				hostFlash.memory[address + i] = data[i];
+				hostFlash.programmedBytes++;
+			}
+			return true;
+		}
+
+		bool eraseSector(uint32_t address)
+		{
+			address &= ~0xFFFUL;
+			if (address >= hostFlash.memory.size()) return false;
+
+			for (uint32_t i=0; i<4096; i++) {
+				hostFlash.consume(address + i, 0xFF, true);
+				hostFlash.memory[address + i] = 0xFF;
+			}
+			hostFlash.erasedSectors++;
+			return true;
+		}
+};
@@ -0,0 +1,95 @@
+// RAM telemetry of the native build (replaces src/SckMemory.cpp, see platformio.ini).
+// There is no SAMD21 memory map on the host: allocations are counted through operator new/delete (Strings are
+// std::string here) and the free RAM is what a 32KB kit would have left after the heap in use. Static RAM and the
+// stack are not counted, so the numbers are good to compare runs, not to know how close a kit is to the limit.
+
+#include "SckMemory.h"
+
+#include <new>
+#include <malloc.h>
+
+#define SCKMEMORY_HOST_RAM 32768
+
+volatile uint8_t SckMemory::tag = PERF_LOOP;
+uint32_t SckMemory::allocations[PERF_COUNT] = {};
+uint32_t SckMemory::frees = 0;
+uint32_t SckMemory::failed = 0;
+
+static uint32_t heapUsed = 0;
+static uint32_t heapPeak = 0;
+static uint32_t heapBase = 0; 		// What the host (flash image, buffers of the HAL) had allocated before setup()
+
+void *operator new(size_t size)
+{
+	void *ptr = malloc(size ? size : 1);
+	SckMemory::allocations[SckMemory::tag]++;
+	if (!ptr) {
+		SckMemory::failed++;
+		throw std::bad_alloc();
+	}
+	heapUsed += malloc_usable_size(ptr);
+	if (heapUsed > heapPeak) heapPeak = heapUsed;
+	return ptr;
+}
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+void operator delete(void *ptr) noexcept
+{
+	if (!ptr) return;
+	SckMemory::frees++;
+	heapUsed -= malloc_usable_size(ptr);
+	free(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete(void *ptr, size_t size) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete[](void *ptr, size_t size) noexcept
+{
+	operator delete(ptr);
+}
+
+void SckMemory::paintStack()
+{
+	heapBase = heapUsed;
+	heapPeak = heapUsed;
+}
+void SckMemory::update()
+{
+	uint32_t nowFree = freeRam();
+	if (nowFree < minFree) minFree = nowFree;
+}
+uint32_t SckMemory::gap()
+{
+	uint32_t used = heapUsed > heapBase ? heapUsed - heapBase : 0;
+	return used < SCKMEMORY_HOST_RAM ? SCKMEMORY_HOST_RAM - used : 0;
+}
+uint32_t SckMemory::heapFree(uint16_t *blocks, uint32_t *largest)
+{
+	if (blocks) *blocks = 0;
+	if (largest) *largest = 0;
+	return 0;
+}
+uint32_t SckMemory::freeRam()
+{
+	return gap() + heapFree();
+}
+uint32_t SckMemory::largestBlock()
+{
+	return gap();
+}
+uint32_t SckMemory::stackUsed()
+{
+	return 0;
+}
+uint32_t SckMemory::headroom()
+{
+	uint32_t peak = heapPeak - heapBase;
+	return peak < SCKMEMORY_HOST_RAM ? SCKMEMORY_HOST_RAM - peak : 0;
+}
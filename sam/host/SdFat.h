@@ -0,0 +1,125 @@
+#pragma once
+
+// Sdcard for the host build: a directory of the workstation (hostSd.path) is the root of the card.
+// The card is present when the directory exists, hal.cpp sets the card detect pin accordingly.
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define O_READ O_RDONLY
+#define O_WRITE O_WRONLY
+#define O_AT_END 0x40000000 			// Not a host flag: seek to the end after opening
+#define FILE_READ O_READ
+#define FILE_WRITE (O_RDWR | O_CREAT | O_AT_END)
+
+#define SPI_FULL_SPEED 1
+#define SPI_HALF_SPEED 2
+#define SPI_QUARTER_SPEED 4
+
+struct HostSdCard {
+	std::string path = "sdcard";
+	uint32_t bytesWritten = 0;
+	uint32_t syncs = 0;
+
+	std::string file(const char *name) { return path + "/" + name; }
+	bool present()
+	{
+		struct stat info;
+		return !path.empty() && stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+	}
+};
+extern HostSdCard hostSd;
+
+class SdFat;
+
+class File : public Stream
+{
+	public:
+		File() {}
+		File(int wichFd, const std::string &wichPath) : fd(wichFd), path(wichPath) {}
+
+		operator bool() { return fd >= 0; }
+		bool isOpen() { return fd >= 0; }
+		bool close()
+		{
+			if (fd < 0) return false;
+			::close(fd);
+			fd = -1;
+			return true;
+		}
+		bool sync()
+		{
+			hostSd.syncs++;
+			return fd >= 0;
+		}
+
+		size_t write(uint8_t c) { return write(&c, 1); }
+		size_t write(const uint8_t *buff, size_t size)
+		{
+			if (fd < 0) return 0;
+			ssize_t written = ::write(fd, buff, size);
+			if (written < 0) return 0;
+			hostSd.bytesWritten += written;
+			return written;
+		}
+		using Print::write;
+
+		int read(void *buff, size_t size) { return fd < 0 ? -1 : ::read(fd, buff, size); }
+		int read()
+		{
+			uint8_t c;
+			return read(&c, 1) == 1 ? c : -1;
+		}
+		int peek()
+		{
+			int c = read();
+			if (c >= 0) lseek(fd, -1, SEEK_CUR);
+			return c;
+		}
+		int available() { return fd < 0 ? 0 : size() - position(); }
+
+		bool seek(uint32_t pos) { return fd >= 0 && lseek(fd, pos, SEEK_SET) == (off_t)pos; }
+		uint32_t position() { return fd < 0 ? 0 : lseek(fd, 0, SEEK_CUR); }
+		uint32_t size()
+		{
+			struct stat info;
+			return fd >= 0 && fstat(fd, &info) == 0 ? info.st_size : 0;
+		}
+		bool rename(SdFat *dir, const char *newName);
+
+	private:
+		int fd = -1;
+		std::string path;
+};
+
+class SdFat
+{
+	public:
+		bool begin(uint8_t csPin, uint8_t spiDivisor=SPI_FULL_SPEED) { return hostSd.present(); }
+
+		bool exists(const char *name) { return access(hostSd.file(name).c_str(), F_OK) == 0; }
+		bool remove(const char *name) { return unlink(hostSd.file(name).c_str()) == 0; }
+		bool rename(const char *oldName, const char *newName) { return ::rename(hostSd.file(oldName).c_str(), hostSd.file(newName).c_str()) == 0; }
+		bool mkdir(const char *name) { return ::mkdir(hostSd.file(name).c_str(), 0755) == 0; }
+		SdFat *vwd() { return this; }
+
+		File open(const char *name, int mode=FILE_READ)
+		{
+			if (!hostSd.present()) return File();
+			std::string path = hostSd.file(name);
+			int fd = ::open(path.c_str(), mode & ~O_AT_END, 0644);
+			if (fd < 0) return File();
+			if (mode & O_AT_END) lseek(fd, 0, SEEK_END);
+			return File(fd, path);
+		}
+};
+
+inline bool File::rename(SdFat *dir, const char *newName)
+{
+	std::string newPath = hostSd.file(newName);
+	if (::rename(path.c_str(), newPath.c_str()) != 0) return false;
+	path = newPath;
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// I2C buses for the host build. Each bus has its own devices, an address without a device NACKs like an empty bus.
+// A device is a register file: the first byte of a write sets the register pointer, the rest are stored from there and
+// reads go on from the pointer. Devices that answer commands instead (SHT31, Atlas) queue their answers in responses,
+// onWrite sees every finished write so scripts and traces can react to commands (see HostScript.h).
+
+#include <Arduino.h>
+#include <map>
+
+class HostI2CDevice
+{
+	public:
+		uint8_t registers[256] = {};
+		uint8_t pointer = 0;
+		std::deque<uint8_t> responses; 			// Read before the registers when not empty
+		std::function<void(HostI2CDevice &device, const uint8_t *data, size_t size)> onWrite;
+		uint32_t writes = 0;
+		uint32_t reads = 0;
+
+		void setRegister(uint8_t wichRegister, const uint8_t *data, size_t size) { for (size_t i=0; i<size; i++) registers[(uint8_t)(wichRegister + i)] = data[i]; }
+		void setRegister16(uint8_t wichRegister, uint16_t value) { registers[wichRegister] = value & 0xFF; registers[(uint8_t)(wichRegister + 1)] = value >> 8; } 	// Little endian (gauge and charger)
+
+		void received(const uint8_t *data, size_t size)
+		{
+			writes++;
+			if (size > 0) {
+				pointer = data[0];
+				for (size_t i=1; i<size; i++) registers[pointer++] = data[i];
+			}
+			if (onWrite) onWrite(*this, data, size);
+		}
+		uint8_t next()
+		{
+			reads++;
+			if (!responses.empty()) {
+				uint8_t value = responses.front();
+				responses.pop_front();
+				return value;
+			}
+			return registers[pointer++];
+		}
+};
+
+class TwoWire : public Stream
+{
+	public:
+		std::map<uint8_t, HostI2CDevice> devices;
+		uint32_t transactions = 0;
+
+		TwoWire(SERCOM *wichSercom, uint8_t sdaPin, uint8_t sclPin) { wichSercom->wire = this; }
+
+		HostI2CDevice &device(uint8_t address) { return devices[address]; } 	// Adds it if it's not there
+		void remove(uint8_t address) { devices.erase(address); }
+
+		void begin() {}
+		void begin(uint8_t address) {}
+		void end() {}
+		void setClock(uint32_t frequency) {}
+		void onService() {}
+
+		void beginTransmission(uint8_t address)
+		{
+			txAddress = address;
+			txBuffer.clear();
+		}
+		uint8_t endTransmission(bool stopBit=true)
+		{
+			transactions++;
+			std::map<uint8_t, HostI2CDevice>::iterator it = devices.find(txAddress);
+			if (it == devices.end()) return 2; 		// NACK on address
+			it->second.received(txBuffer.data(), txBuffer.size());
+			return 0;
+		}
+		uint8_t requestFrom(uint8_t address, size_t quantity, bool stopBit)
+		{
+			transactions++;
+			rxBuffer.clear();
+			std::map<uint8_t, HostI2CDevice>::iterator it = devices.find(address);
+			if (it == devices.end()) return 0;
+			for (size_t i=0; i<quantity; i++) rxBuffer.push_back(it->second.next());
+			return quantity;
+		}
+		uint8_t requestFrom(uint8_t address, size_t quantity) { return requestFrom(address, quantity, true); }
+
+		size_t write(uint8_t data) { txBuffer.push_back(data); return 1; }
+		size_t write(const uint8_t *data, size_t size) { txBuffer.insert(txBuffer.end(), data, data + size); return size; }
+		using Print::write;
+		int available() { return rxBuffer.size(); }
+		int read()
+		{
+			if (rxBuffer.empty()) return -1;
+			uint8_t value = rxBuffer.front();
+			rxBuffer.pop_front();
+			return value;
+		}
+		int peek() { return rxBuffer.empty() ? -1 : rxBuffer.front(); }
+
+	private:
+		uint8_t txAddress = 0;
+		std::vector<uint8_t> txBuffer;
+		std::deque<uint8_t> rxBuffer;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,58 @@
+#pragma once
+
+// Host stand-in for the Adafruit MPL3115A2 driver: found when a device answers on 0x60 (HostUrban, or a script), readings
+// come from its data registers like the real chip (OUT_P 0x01-0x03 in Pa Q18.2 or m Q16.4 with CTRL_REG1 ALT, OUT_T 0x04-0x05 in C Q8.4)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <math.h>
+
+class Adafruit_MPL3115A2
+{
+	public:
+		bool begin()
+		{
+			Wire.beginTransmission(0x60);
+			return Wire.endTransmission() == 0;
+		}
+		float getPressure()
+		{
+			uint8_t data[3];
+			if (!read(0x01, data, 3)) return 0;
+			uint32_t raw = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+			return (raw >> 4) / 4.0;
+		}
+		float getAltitude()
+		{
+			// In altimeter mode (CTRL_REG1 ALT, a replayed kit left it there) OUT_P has the altitude in meters, Q16.4
+			uint8_t control;
+			if (read(0x26, &control, 1) && (control & 0x80)) {
+				uint8_t data[3];
+				if (!read(0x01, data, 3)) return 0;
+				int32_t raw = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8);
+				return raw / 65536.0;
+			}
+			return 44330.77 * (1 - pow(getPressure() / seaPressure, 0.1902632));
+		}
+		float getTemperature()
+		{
+			uint8_t data[2];
+			if (!read(0x04, data, 2)) return 0;
+			int16_t raw = ((int16_t)data[0] << 8) | data[1];
+			return (raw >> 4) / 16.0;
+		}
+		void setSeaPressure(float pascal) { seaPressure = pascal; }
+
+	private:
+		float seaPressure = 101326;
+
+		bool read(uint8_t wichRegister, uint8_t *data, uint8_t size)
+		{
+			Wire.beginTransmission(0x60);
+			Wire.write(wichRegister);
+			if (Wire.endTransmission(false) != 0) return false;
+			Wire.requestFrom((uint8_t)0x60, (size_t)size);
+			for (uint8_t i=0; i<size; i++) data[i] = Wire.read();
+			return true;
+		}
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for DallasTemperature: no sensors on the bus, readings are DEVICE_DISCONNECTED_C
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C -127
+
+typedef uint8_t DeviceAddress[8];
+
+class DallasTemperature
+{
+	public:
+		DallasTemperature(OneWire *wire) {}
+		void begin() {}
+		bool getAddress(uint8_t *address, uint8_t index) { memset(address, 0, 8); return false; }
+		bool setResolution(uint8_t resolution) { return false; }
+		void setWaitForConversion(bool wait) {}
+		void requestTemperatures() {}
+		float getTempC(const uint8_t *address) { return DEVICE_DISCONNECTED_C; }
+};
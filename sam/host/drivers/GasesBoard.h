@@ -0,0 +1,31 @@
+#pragma once
+
+// Host stand-in for the Gases Pro board library: start() fails, the board is not found
+
+#include <Arduino.h>
+
+struct Electrode {
+	uint8_t nWE = 0;
+	uint8_t resistor = 0;
+};
+struct Slot {
+	Electrode electrode_A;
+	Electrode electrode_W;
+};
+
+class GasesBoard
+{
+	public:
+		Slot Slot1, Slot2, Slot3;
+
+		bool start() { return false; }
+		bool stop() { return true; }
+		float getElectrode(Electrode wichElectrode) { return 0; }
+		float getTemperature() { return 0; }
+		float getHumidity() { return 0; }
+		void setPot(Electrode wichElectrode, uint32_t value) {}
+		uint32_t getPot(Electrode wichElectrode) { return 0; }
+		void setTesterCurrent(int16_t wichCurrent, uint8_t wichSlot) {}
+		void runTester(uint8_t wichSlot) {}
+		bool autoTest() { return false; }
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for the Chirp soil moisture sensor library: the sensor is never found (I2Cdetect fails first)
+
+#include <Arduino.h>
+
+class I2CSoilMoistureSensor
+{
+	public:
+		I2CSoilMoistureSensor(uint8_t addr=0x20) {}
+		void begin(bool wait=false) {}
+		unsigned int getCapacitance() { return 0; }
+		bool setAddress(int addr, bool reset) { return false; }
+		void changeSensor(int addr, bool wait=false) {}
+		int getAddress() { return 0; }
+		void startMeasureLight() {}
+		unsigned int getLight(bool wait=false) { return 0; }
+		int getTemperature() { return 0; }
+		void sleep() {}
+		bool isBusy() { return false; }
+		uint8_t getVersion() { return 0; }
+};
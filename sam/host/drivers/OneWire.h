@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for OneWire: an empty bus
+
+#include <Arduino.h>
+
+class OneWire
+{
+	public:
+		OneWire(uint8_t pin) {}
+		uint8_t reset() { return 0; }
+};
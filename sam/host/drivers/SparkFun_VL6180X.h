@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for the SparkFun VL6180x library: init fails, the sensor is not found
+
+#include <Arduino.h>
+
+enum vl6180x_als_gain { GAIN_20, GAIN_10, GAIN_5, GAIN_2_5, GAIN_1_67, GAIN_1_25, GAIN_1, GAIN_40 };
+
+class VL6180x
+{
+	public:
+		VL6180x(uint8_t address) {}
+		uint8_t VL6180xInit() { return 1; }
+		void VL6180xDefautSettings() {}
+		uint8_t getDistance() { return 0; }
+		float getAmbientLight(vl6180x_als_gain gain) { return 0; }
+};
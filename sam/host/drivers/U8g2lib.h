@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for U8g2: the OLED display draws nothing, a single page per frame
+
+#include <Arduino.h>
+
+#define U8X8_PIN_NONE 255
+#define U8G2_R0 0
+#define u8g2_font_ncenB14_tr 0
+#define u8g2_font_helvB10_tf 0
+#define u8g2_font_helvB12_tf 0
+#define u8g2_font_helvB18_tf 0
+#define u8g2_font_helvB24_tf 0
+
+class U8G2_SSD1327_SEEED_96X96_F_HW_I2C
+{
+	public:
+		U8G2_SSD1327_SEEED_96X96_F_HW_I2C(int rotation, uint8_t reset=U8X8_PIN_NONE, uint8_t clock=U8X8_PIN_NONE, uint8_t data=U8X8_PIN_NONE) {}
+		bool begin() { return true; }
+		void clearDisplay() {}
+		void firstPage() {}
+		uint8_t nextPage() { return 0; }
+		void setFont(int font) {}
+		void drawStr(int x, int y, const char *text) {}
+		void drawXBM(int x, int y, int w, int h, const uint8_t *bitmap) {}
+		int getStrWidth(const char *text) { return strlen(text) * 8; }
+};
@@ -0,0 +1,537 @@
+// Fuzz and property tests of the parsers that take bytes from outside the SAM.
+//
+// The first byte of an input picks the target, so one corpus covers all of them:
+//	0 bus		packets from the ESP on Serial1: RH_Serial frames, reassembly (ESPbusUpdate) and receiveMessage with its JSON
+//	1 netpack	netFirstPack/netNextPack alone (the ESP reassembles with them too) and the round trip of the sendMessage parts
+//	2 pm		PMS5003 frames on SerialPM (Sck_PM::update), compared with a reference parser
+//	3 atlas		answers of an Atlas board on the aux bus (Atlas::getResponse), compared with a reference parser
+//	4 commands	console lines (AllCommands::in and every command behind it)
+// Besides the sanitizers every target checks that the strings the kit keeps (outBuff, config) still end inside their buffers.
+//
+// Built with libFuzzer it's a normal fuzz target. Without it the program runs its own loop: inputs built from valid ones (frames,
+// messages and commands, mutated or not) for every target, checking the properties and printing the inputs per second each
+// parser takes. A failing input is saved as fuzz-<target>.crash, files given as arguments run again (libFuzzer's crash files too).
+//
+// Build and run (from sam/host, ArduinoJson is the one pio run -e native downloads):
+//	g++ -std=gnu++11 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all -D_FORTIFY_SOURCE=2 -D__GIT_HASH__=\"fuzz\" -D__ISO_DATE__=\"fuzz\" -I. -Idrivers -I../src -I../../lib/Sensors -I../../lib/Shared -I../.pio/libdeps/native/ArduinoJson/src fuzz_parsers.cpp hal.cpp HostScript.cpp HostDevices.cpp SckMemoryHost.cpp $(ls ../src/*.cpp | grep -v SckMemory.cpp) ../../lib/Sensors/*.cpp ../../lib/Shared/*.cpp -x c++ -include Arduino.h ../src/SmartCitizenKit.ino -o /tmp/fuzz_parsers
+//	/tmp/fuzz_parsers [runs per target] [seed]
+//	/tmp/fuzz_parsers file [file ...]
+// With libFuzzer: the same line with clang++, -D libfuzzer and -fsanitize=fuzzer,address,undefined, then /tmp/fuzz_parsers corpus_dir
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <signal.h>
+
+#include "HostDevices.h"
+#include "../src/SckBase.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#else
+#include <execinfo.h>
+#endif
+
+void setup();
+extern SckBase base;
+extern Uart SerialPM;
+
+enum Target { TARGET_BUS, TARGET_NETPACK, TARGET_PM, TARGET_ATLAS, TARGET_COMMANDS, TARGET_COUNT };
+static const char *targetNames[TARGET_COUNT] = { "bus", "netpack", "pm", "atlas", "commands" };
+
+struct KitReset {}; 				// NVIC_SystemReset() from a command or a message, the kit goes on without booting again
+
+static std::string currentInput; 		// [target][input], saved when something fails
+static uint32_t consoleBytes = 0;
+static uint32_t resets = 0;
+
+static void saveInput()
+{
+	if (currentInput.empty()) return;
+	std::string name = std::string("fuzz-") + targetNames[(uint8_t)currentInput[0] % TARGET_COUNT] + ".crash";
+	FILE *file = fopen(name.c_str(), "wb");
+	if (!file) return;
+	fwrite(currentInput.data(), 1, currentInput.size(), file);
+	fclose(file);
+	fprintf(stderr, "Input saved on %s\n", name.c_str());
+}
+static void fail(const char *why)
+{
+	fprintf(stderr, "FAILED %s: %s\n", targetNames[(uint8_t)currentInput[0] % TARGET_COUNT], why);
+	abort();
+}
+
+// The strings the parsers write to must end inside their buffers
+static bool ends(const char *buff, size_t size) { return strnlen(buff, size) < size; }
+static void checkKit()
+{
+	if (!ends(base.outBuff, sizeof(base.outBuff))) fail("outBuff is not terminated");
+	if (!ends(base.config.credentials.ssid, sizeof(base.config.credentials.ssid))) fail("ssid is not terminated");
+	if (!ends(base.config.credentials.pass, sizeof(base.config.credentials.pass))) fail("pass is not terminated");
+	if (!ends(base.config.token.token, sizeof(base.config.token.token))) fail("token is not terminated");
+	if (!ends(base.config.mac.address, sizeof(base.config.mac.address))) fail("mac address is not terminated");
+}
+
+// **** Bus: the ESP end of Serial1
+static HostStream espSide;
+static RH_Serial espDriver(espSide);
+static uint8_t espId = 0;
+
+// Records [n][n bytes]: up to 60 bytes go as one RH_Serial packet from the ESP, more are n - 60 raw bytes on the port
+static void busTarget(const uint8_t *data, size_t size)
+{
+	Serial1.input.clear();
+	size_t pos = 0;
+	while (pos < size) {
+		uint8_t n = data[pos++];
+		bool raw = n > NETPACK_TOTAL_SIZE;
+		size_t count = min((size_t)(raw ? n - NETPACK_TOTAL_SIZE : n), size - pos);
+		if (raw) Serial1.feed(&data[pos], count);
+		else {
+			espDriver.setHeaderTo(SAM_ADDRESS);
+			espDriver.setHeaderId(++espId);
+			espDriver.send(&data[pos], count);
+		}
+		pos += count;
+	}
+
+	// Every update takes one message (waiting for its parts)
+	for (uint8_t i=0; i<64 && !Serial1.input.empty(); i++) {
+		try {
+			base.inputUpdate();
+		} catch (KitReset &) {
+			resets++;
+		}
+	}
+	checkKit();
+}
+
+// **** Netpack: the reassembly alone, on buffers of the exact size so any read past them is caught
+static void netpackTarget(const uint8_t *data, size_t size)
+{
+	if (size == 0) return;
+	std::vector<char> buff(NETBUFF_SIZE);
+
+	if (data[0] & 1) {
+
+		// Round trip: the rest is the content of a message, sent in parts like SckBase::sendMessage() and put back together
+		std::string content;
+		for (size_t i=2; i<size && content.size() < NETBUFF_SIZE - 2; i++) if (data[i]) content.push_back(data[i]);
+		std::vector<char> sent(NETBUFF_SIZE, 'x'); 	// What was on netBuff before stays after the 0
+		sent[0] = size > 1 && data[1] ? data[1] : 1;
+		memcpy(&sent[1], content.c_str(), content.size() + 1);
+		uint8_t totalParts = (strlen(sent.data()) + NETPACK_CONTENT_SIZE - 1) / NETPACK_CONTENT_SIZE;
+
+		uint8_t parts = 0;
+		for (uint8_t i=0; i<totalParts; i++) {
+			std::vector<uint8_t> pack(NETPACK_TOTAL_SIZE);
+			pack[0] = totalParts;
+			memcpy(&pack[1], &sent[i * NETPACK_CONTENT_SIZE], NETPACK_CONTENT_SIZE);
+			if (i == 0) parts = netFirstPack(buff.data(), pack.data(), pack.size());
+			else if (!netNextPack(buff.data(), i, parts, pack.data(), pack.size())) fail("a part of the message was refused");
+		}
+		if (parts != totalParts) fail("wrong number of parts");
+		if (content != buff.data()) fail("the message changed on the way");
+		return;
+	}
+
+	// Packets as they come: [len][len bytes] records, the first one starts the message
+	size_t pos = 1;
+	uint8_t parts = 0;
+	for (uint8_t i=0; pos < size; i++) {
+		uint8_t len = min((size_t)data[pos++], size - pos);
+		std::vector<uint8_t> pack(&data[pos], &data[pos] + len);
+		pos += len;
+		if (i == 0) {
+			parts = netFirstPack(buff.data(), pack.data(), len);
+			if (parts == 0 && buff[0] != 0) fail("refused packet left content");
+			if (parts > NETBUFF_SIZE / NETPACK_CONTENT_SIZE) fail("more parts than fit on the buffer");
+		} else if (i < parts) {
+			bool accepted = netNextPack(buff.data(), i, parts, pack.data(), len);
+			if (accepted != (len >= 1 && pack[0] == parts)) fail("packet accepted or refused by mistake");
+		}
+	}
+	if (buff[NETBUFF_SIZE - 1] != 0) fail("the message doesn't end with a 0");
+}
+
+// **** PM: bytes on SerialPM after update() empties it
+static Sck_PM *pm;
+static std::vector<uint8_t> pmInput;
+static uint32_t pmRefills = 0;
+
+static bool pmReference(const uint8_t *data, size_t size, uint16_t *values)
+{
+	// Waits for a full frame, looks for the start chars and the checksum of the 30 bytes after them
+	if (size < 32) return false;
+	size_t start = 0;
+	while (start < size && data[start] != 0x42) start++;
+	if (start + 1 >= size || data[start + 1] != 0x4d) return false;
+	if (size - (start + 2) < 30) return false;
+
+	const uint8_t *buff = &data[start + 2];
+	uint16_t sum = 0x42 + 0x4d;
+	for (uint8_t i=0; i<28; i++) sum += buff[i];
+	if (sum != (buff[28] << 8) + buff[29]) return false;
+
+	const uint8_t at[9] = { 2, 4, 6, 14, 16, 18, 20, 22, 24 };
+	for (uint8_t i=0; i<9; i++) values[i] = (buff[at[i]] << 8) + buff[at[i] + 1];
+	return true;
+}
+static void pmTarget(const uint8_t *data, size_t size)
+{
+	pmInput.assign(data, data + size);
+	pmRefills = 0;
+	SerialPM.input.clear();
+	hostClock.advance(2000000); 	// One reading per second and a second after a failure
+
+	bool result = pm->update();
+	uint16_t expected[9];
+	if (result != pmReference(data, size, expected)) fail(result ? "took a wrong frame" : "refused a good frame");
+	if (!result) return;
+
+	uint16_t got[9] = { pm->pm1, pm->pm25, pm->pm10, pm->pn03, pm->pn05, pm->pn1, pm->pn25, pm->pn5, pm->pn10 };
+	if (memcmp(got, expected, sizeof(got))) fail("wrong values");
+}
+
+// **** Atlas: the 20 bytes the board answers (the rest are 0, like the padding of the board)
+static Atlas *atlas;
+
+static void atlasTarget(const uint8_t *data, size_t size)
+{
+	auxWire.remove(atlas->deviceAddress);
+	HostI2CDevice &board = auxWire.device(atlas->deviceAddress);
+	board.responses.assign(data, data + min(size, (size_t)20));
+
+	uint8_t code = atlas->getResponse();
+
+	// Codes 0, 2, 254 and 255 come alone, any other one is followed by a text that ends with a 0
+	uint8_t bytes[20] = {};
+	memcpy(bytes, data, min(size, (size_t)20));
+	uint8_t expectedCode = bytes[0];
+	std::string expected;
+	if (expectedCode != 0 && expectedCode != 2 && expectedCode < 254) {
+		expected.assign((const char *)&bytes[1], strnlen((const char *)&bytes[1], 19));
+		expectedCode = expected.empty() ? 2 : 1;
+	}
+	if (code != expectedCode) fail("wrong response code");
+	if (code == 1 && expected != atlas->atlasResponse.c_str()) fail("wrong response text");
+	if (code == 1 && atlas->atlasResponse.length() != expected.size()) fail("response has bytes after the 0");
+}
+
+// **** Commands: one per line, the bridge to flash the ESP is left out (it runs until USB goes quiet)
+static void commandsTarget(const uint8_t *data, size_t size)
+{
+	// Commands that wait for a key get one
+	SerialUSB.refill = [](HostStream &port) { port.feed("\n"); };
+
+	std::string text((const char *)data, size);
+	size_t pos = 0;
+	while (pos <= text.size()) {
+		size_t end = text.find('\n', pos);
+		if (end == std::string::npos) end = text.size();
+		std::string line = text.substr(pos, end - pos);
+		pos = end + 1;
+		if (line.find("-flash") != std::string::npos) continue;
+
+		try {
+			base.commands.in(&base, String(line.c_str()));
+		} catch (KitReset &) {
+			resets++;
+		}
+		checkKit();
+	}
+
+	SerialUSB.refill = nullptr;
+	SerialUSB.input.clear();
+}
+
+static void runInput(const uint8_t *data, size_t size)
+{
+	if (size == 0) return;
+	currentInput.assign((const char *)data, size);
+	switch (data[0] % TARGET_COUNT) {
+		case TARGET_BUS: busTarget(data + 1, size - 1); break;
+		case TARGET_NETPACK: netpackTarget(data + 1, size - 1); break;
+		case TARGET_PM: pmTarget(data + 1, size - 1); break;
+		case TARGET_ATLAS: atlasTarget(data + 1, size - 1); break;
+		case TARGET_COMMANDS: commandsTarget(data + 1, size - 1); break;
+	}
+}
+
+static void boot()
+{
+	// The kit on USB with its battery and the urban board, no ESP (the bus target is the ESP) and no PM (the pm target feeds it)
+	RTCZero::startEpoch = 1546300800;
+	hostClock.reset();
+	hostClock.epoch = RTCZero::startEpoch;
+	hostBattery.begin();
+	hostUrban.begin();
+	SerialUSB.onWrite = [](const uint8_t *data, size_t size) { consoleBytes += size; };
+	hostReset = []() { throw KitReset(); };
+
+	espDriver.setHeaderFrom(ESP_ADDRESS);
+	espSide.onWrite = [](const uint8_t *data, size_t size) { Serial1.feed(data, size); };
+	SerialPM.refill = [](HostStream &port) { if (pmRefills++ == 1) port.feed(pmInput.data(), pmInput.size()); }; 	// After update() empties the port
+
+	setup();
+
+	static RTCZero pmRtc;
+	pm = new Sck_PM(&pmRtc);
+	atlas = new Atlas(SENSOR_ATLAS_PH);
+
+	// Timeouts of hundreds of ms are polled on millis(): a ms on every read keeps them short
+	hostClock.tick = 1000;
+}
+
+#ifdef libfuzzer
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static bool booted = false;
+	if (!booted) {
+		boot();
+		booted = true;
+	}
+	runInput(data, size);
+	return 0;
+}
+
+#else
+
+// **** Inputs of the standalone loop: valid ones and mutations of them
+static uint32_t pick(uint32_t to) { return rand() % to; }
+static bool chance(uint32_t oneIn) { return pick(oneIn) == 0; }
+
+static std::string randomText(size_t maxLen)
+{
+	const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 -_.,:;'\"{}[]\\/%";
+	std::string text(pick(maxLen + 1), ' ');
+	for (size_t i=0; i<text.size(); i++) text[i] = chance(50) ? pick(256) : chars[pick(sizeof(chars) - 1)];
+	return text;
+}
+static std::string randomWord(size_t maxLen)
+{
+	std::string text(1 + pick(maxLen), ' ');
+	for (size_t i=0; i<text.size(); i++) text[i] = 'a' + pick(26);
+	return text;
+}
+static std::string randomJsonValue(uint8_t depth)
+{
+	switch (pick(depth < 2 ? 8 : 6)) {
+		case 0: return "\"" + randomWord(chance(4) ? 300 : 20) + "\"";
+		case 1: return std::to_string((int32_t)rand() - RAND_MAX / 2);
+		case 2: return std::to_string(pick(100000) / 7.0);
+		case 3: return chance(2) ? "true" : "false";
+		case 4: return "null";
+		case 5: return "\"" + randomText(40) + "\"";
+		case 6: return "[" + randomJsonValue(depth + 1) + "," + randomJsonValue(depth + 1) + "]";
+		default: return "{\"a\":" + randomJsonValue(depth + 1) + "}";
+	}
+}
+
+// A message from the ESP as the records of the bus target, expectedSsid is set when it's a config that has to be taken
+static std::string busInput(std::string &expectedSsid)
+{
+	const char *keys[] = { "mo", "pi", "ss", "pa", "to", "ip", "hn", "mac", "ver", "bd" };
+	uint8_t type = chance(10) ? pick(256) : pick(SAMMES_COUNT);
+	std::string content;
+	bool configSsid = false;
+
+	if (type == SAMMES_SET_CONFIG && chance(2)) {
+		// A good config
+		expectedSsid = randomWord(chance(4) ? 100 : 30);
+		content = "{\"mo\":\"net\",\"pi\":" + std::to_string(60 + pick(3000)) + ",\"ss\":\"" + expectedSsid + "\",\"pa\":\"" + randomWord(20) + "\",\"to\":\"" + randomWord(6) + "\"}";
+		if (expectedSsid.size() >= sizeof(base.config.credentials.ssid)) expectedSsid.resize(sizeof(base.config.credentials.ssid) - 1);
+		configSsid = true;
+	} else if (type == SAMMES_SET_CONFIG || type == SAMMES_NETINFO || type == SAMMES_BOOTED) {
+		content = "{";
+		for (uint8_t i=pick(8); i>0; i--) content += std::string("\"") + keys[pick(10)] + "\":" + randomJsonValue(0) + (i > 1 ? "," : "");
+		content += chance(10) ? "" : "}";
+	} else if (type == SAMMES_TIME) content = chance(2) ? std::to_string(1500000000 + pick(200000000)) : randomText(20);
+	else content = randomText(chance(10) ? 700 : 100);
+
+	// In parts like HostEsp::send()
+	std::string netBuff(1, (char)type);
+	netBuff += content;
+	netBuff.push_back(0);
+	uint8_t totalParts = (netBuff.size() + NETPACK_CONTENT_SIZE - 1) / NETPACK_CONTENT_SIZE;
+	netBuff.resize(totalParts * NETPACK_CONTENT_SIZE, 0);
+	std::vector<std::string> packets;
+	for (uint8_t i=0; i<totalParts; i++) packets.push_back(std::string(1, (char)totalParts) + netBuff.substr(i * NETPACK_CONTENT_SIZE, NETPACK_CONTENT_SIZE));
+	if (totalParts > NETBUFF_SIZE / NETPACK_CONTENT_SIZE) configSsid = false;
+
+	// Broken on the way
+	if (chance(3)) {
+		configSsid = false;
+		std::string &packet = packets[pick(packets.size())];
+		switch (pick(6)) {
+			case 0: packet[0] = pick(256); break;
+			case 1: packets.erase(packets.begin() + pick(packets.size())); break;
+			case 2: packets.insert(packets.begin() + pick(packets.size() + 1), packets[pick(packets.size())]); break;
+			case 3: packet.resize(pick(packet.size() + 1)); break;
+			case 4: packet[pick(packet.size())] = pick(256); break;
+			case 5: std::swap(packets[pick(packets.size())], packets[pick(packets.size())]); break;
+		}
+	}
+
+	std::string records(1, (char)TARGET_BUS);
+	for (size_t i=0; i<packets.size(); i++) {
+		records.push_back((char)packets[i].size());
+		records += packets[i];
+		if (chance(30)) {
+			configSsid = false;
+			std::string noise = randomText(80);
+			records.push_back((char)(NETPACK_TOTAL_SIZE + noise.size()));
+			records += noise;
+		}
+	}
+	if (!configSsid) expectedSsid.clear();
+	return records;
+}
+static std::string netpackInput()
+{
+	std::string input(1, (char)TARGET_NETPACK);
+	if (chance(2)) {
+		input.push_back(1);
+		input.push_back(pick(256));
+		return input + randomText(chance(4) ? 700 : 200);
+	}
+	input.push_back(0);
+	for (uint8_t i=pick(14); i>0; i--) {
+		std::string packet(chance(4) ? pick(70) : NETPACK_TOTAL_SIZE, 'a');
+		for (size_t b=0; b<packet.size(); b++) packet[b] = pick(256);
+		if (!packet.empty() && chance(2)) packet[0] = pick(12);
+		input.push_back((char)packet.size());
+		input += packet;
+	}
+	return input;
+}
+static std::string pmInputFrame()
+{
+	uint8_t frame[32] = { 0x42, 0x4d, 0, 28 };
+	for (uint8_t i=4; i<30; i++) frame[i] = pick(256);
+	uint16_t sum = 0;
+	for (uint8_t i=0; i<30; i++) sum += frame[i];
+	frame[30] = sum >> 8;
+	frame[31] = sum & 0xFF;
+
+	std::string input(1, (char)TARGET_PM);
+	if (chance(3)) input += randomText(20); 		// Half a frame or noise before it
+	input.append((const char *)frame, sizeof(frame));
+	if (chance(3)) input[1 + pick(input.size() - 1)] = pick(256);
+	if (chance(4)) input.resize(1 + pick(input.size()));
+	if (chance(4)) input += randomText(40);
+	return input;
+}
+static std::string atlasInput()
+{
+	const uint8_t codes[] = { 0, 1, 2, 254, 255 };
+	std::string input(1, (char)TARGET_ATLAS);
+	input.push_back(chance(5) ? pick(256) : codes[pick(sizeof(codes))]);
+	char reading[32];
+	if (chance(2)) snprintf(reading, sizeof(reading), "%.3f", pick(1400000) / 100000.0);
+	else snprintf(reading, sizeof(reading), "%u,%.2f", pick(100000), pick(10000) / 100.0);
+	input += chance(4) ? randomText(25) : std::string(reading) + std::string(pick(10), '\0');
+	return input;
+}
+static std::string commandsInput()
+{
+	const char *parameters[] = { "-enable", "-disable", "-interval", "-mode", "sdcard", "network", "-pubint", "-readint", "-archive", "on", "off",
+		"-wifi", "\"", "-token", "-defaults", "-from", "-cap", "-otg", "-charge", "-on", "-off", "-sync", "-reset", "-info", "-details",
+		"-publish", "-sd", "-notime", "-noms", "-binary", "-nocobs", "-sdcard", "-espcom", "-list", "-journal", "-scheduled", "-tick",
+		"'", "temperature", "humidity", "noise dba", "battery", "light", "pm 2.5", ",", "0", "1", "60", "99999999999", "-1" };
+
+	std::string input(1, (char)TARGET_COMMANDS);
+	for (uint8_t l=1+pick(3); l>0; l--) {
+		std::string line = chance(20) ? "zz" : base.commands.com_list[pick(COM_COUNT)].title;
+		if (chance(10)) for (size_t i=0; i<line.size(); i++) line[i] = toupper(line[i]);
+		for (uint8_t p=pick(6); p>0; p--) {
+			line += chance(8) ? "" : " ";
+			line += chance(8) ? randomText(chance(4) ? 300 : 30) : parameters[pick(sizeof(parameters) / sizeof(parameters[0]))];
+		}
+		for (size_t i=0; i<line.size(); i++) if (line[i] == '\n') line[i] = ' ';
+		input += line + (l > 1 ? "\n" : "");
+	}
+	return input;
+}
+
+// Failed properties and the checks of _FORTIFY_SOURCE abort, the sanitizers end on their own
+static void aborted(int signal)
+{
+#if defined(__SANITIZE_ADDRESS__)
+	__sanitizer_print_stack_trace();
+#else
+	void *frames[32];
+	backtrace_symbols_fd(frames, backtrace(frames, 32), STDERR_FILENO);
+#endif
+	saveInput();
+	fflush(stdout);
+	_exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	signal(SIGABRT, aborted);
+#if defined(__SANITIZE_ADDRESS__)
+	__sanitizer_set_death_callback(saveInput);
+#endif
+	boot();
+
+	// Files: run them again
+	if (argc > 1 && !isdigit(argv[1][0])) {
+		for (int i=1; i<argc; i++) {
+			FILE *file = fopen(argv[i], "rb");
+			if (!file) {
+				fprintf(stderr, "Can't open %s\n", argv[i]);
+				return 1;
+			}
+			std::vector<uint8_t> input;
+			int c;
+			while ((c = fgetc(file)) != EOF) input.push_back(c);
+			fclose(file);
+			runInput(input.data(), input.size());
+			printf("%s: OK\n", argv[i]);
+		}
+		return 0;
+	}
+
+	uint32_t runs = argc > 1 ? strtoul(argv[1], 0, 10) : 20000;
+	uint32_t seed = argc > 2 ? strtoul(argv[2], 0, 10) : time(0);
+	srand(seed);
+	printf("%lu runs per target, seed %lu\n", (unsigned long)runs, (unsigned long)seed);
+
+	for (uint8_t target=0; target<TARGET_COUNT; target++) {
+		double seconds = 0;
+		uint64_t bytes = 0;
+		uint32_t configsTaken = 0;
+		for (uint32_t r=0; r<runs; r++) {
+			std::string expectedSsid;
+			std::string input;
+			switch (target) {
+				case TARGET_BUS: input = busInput(expectedSsid); break;
+				case TARGET_NETPACK: input = netpackInput(); break;
+				case TARGET_PM: input = pmInputFrame(); break;
+				case TARGET_ATLAS: input = atlasInput(); break;
+				default: input = commandsInput(); break;
+			}
+
+			std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+			runInput((const uint8_t *)input.data(), input.size());
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+			bytes += input.size();
+
+			// A good config from the ESP has to be taken
+			if (!expectedSsid.empty()) {
+				if (expectedSsid != base.config.credentials.ssid) fail("good config not taken");
+				configsTaken++;
+			}
+		}
+		printf("%-10s %8lu inputs  %10.0f inputs/s  %8.2f MB/s", targetNames[target], (unsigned long)runs, runs / seconds, bytes / seconds / 1e6);
+		if (configsTaken) printf("  (%lu configs taken)", (unsigned long)configsTaken);
+		printf("\n");
+	}
+	printf("%lu kit resets, %lu bytes on the console\n", (unsigned long)resets, (unsigned long)consoleBytes);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,165 @@
+// Globals and the pieces of the host HAL that are not inline (see Arduino.h)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <I2S.h>
+#include <RTCZero.h>
+#include <ArduinoLowPower.h>
+#include <SdFat.h>
+#include <SPIFlash.h>
+#include "HostScript.h"
+
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+HostClock hostClock;
+HostPins hostPins;
+
+// Registers
+HostGclk hostGclk;
+HostAdc hostAdc;
+HostPm hostPm;
+HostPort hostPort;
+HostTc hostTc5;
+HostTcc hostTcc1;
+uint32_t REG_GCLK_GENCTRL, REG_GCLK_GENDIV, REG_GCLK_CLKCTRL;
+uint32_t REG_TCC1_WAVE, REG_TCC1_PER, REG_TCC1_CC0, REG_TCC1_CC1, REG_TCC1_CTRLA;
+
+// The firmware reads the chip serial number from its fixed addresses (SckBase::getUniqueID), the page is mapped there
+static bool mapSerialNumber()
+{
+	void *page = mmap((void *)0x0080A000, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (page != (void *)0x0080A000) {
+		fprintf(stderr, "Can't map the serial number page, publishing the kit info will crash\n");
+		return false;
+	}
+	uint32_t *words = (uint32_t *)page;
+	words[0x00C / 4] = 0x5CC20001;
+	words[0x040 / 4] = 0x5CC20002;
+	words[0x044 / 4] = 0x5CC20003;
+	words[0x048 / 4] = 0x5CC20004;
+	return true;
+}
+static bool serialNumberMapped = mapSerialNumber();
+
+// Peripherals
+SERCOM sercom0(0), sercom1(1), sercom2(2), sercom3(3), sercom4(4), sercom5(5);
+HostSerial SerialUSB;
+Uart Serial1(&sercom0, 0, 0, SERCOM_RX_PAD_3, UART_TX_PAD_2);
+TwoWire Wire(&sercom3, SDA, SCL);
+SPIClass SPI;
+I2SClass I2S;
+ArduinoLowPowerClass LowPower;
+HostSdCard hostSd;
+FlashChip hostFlash;
+RTCZero *RTCZero::active = 0;
+uint32_t RTCZero::startEpoch = 0;
+int64_t RTCZero::keptOffset = 0;
+
+// **** Time
+uint64_t HostClock::now()
+{
+	if (virtualTime) return virtualMicros += tick;
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - realStart;
+}
+void HostClock::advance(uint64_t wichMicros)
+{
+	if (virtualTime) virtualMicros += wichMicros;
+	else std::this_thread::sleep_for(std::chrono::microseconds(wichMicros));
+}
+void HostClock::reset(uint64_t fromMicros)
+{
+	virtualMicros = fromMicros;
+	realStart = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - fromMicros;
+}
+
+void hostSleep(uint64_t wichMicros)
+{
+	uint64_t now = hostClock.now();
+	uint64_t deadline = wichMicros == UINT64_MAX ? UINT64_MAX : now + wichMicros;
+	uint32_t interruptsBefore = hostPins.interruptsRun;
+
+	while (true) {
+		// Wake up on the first of: the time asked, an RTC alarm, something from the script (it can be a pin interrupt) or the end of the run
+		uint64_t wake = std::min(deadline, hostClock.end);
+		if (RTCZero::active) wake = std::min(wake, RTCZero::active->nextAlarm());
+		wake = std::min(wake, hostScript.next());
+		if (wake == UINT64_MAX) {
+			fprintf(stderr, "Sleeping with nothing that can wake the kit up, ending the run\n");
+			exit(0);
+		}
+
+		now = hostClock.now();
+		if (wake > now) hostClock.advance(wake - now);
+
+		hostScript.run();
+		bool alarm = RTCZero::active && RTCZero::active->poll();
+		now = hostClock.now();
+		if (now >= hostClock.end || hostScript.ended) exit(0); 	// The run ends while the kit sleeps (atexit handlers save and report)
+		if (alarm || hostPins.interruptsRun != interruptsBefore || now >= deadline) return;
+	}
+}
+
+// **** Pins
+void HostPins::set(uint8_t pin, uint8_t value)
+{
+	if (pin >= COUNT) return;
+	uint8_t previous = digital[pin];
+	digital[pin] = value;
+
+	if (!handler[pin]) return;
+	bool run = false;
+	switch (handlerMode[pin]) {
+		case CHANGE: run = value != previous; break;
+		case FALLING: run = previous && !value; break;
+		case RISING: run = !previous && value; break;
+		case LOW: run = !value; break;
+		case HIGH: run = value; break;
+	}
+	if (run) {
+		interruptsRun++;
+		handler[pin]();
+	}
+}
+
+// **** Serial ports
+void HostStream::attach(int inFd, int outFd)
+{
+	if (inFd >= 0) {
+		fcntl(inFd, F_SETFL, fcntl(inFd, F_GETFL) | O_NONBLOCK);
+		refill = [inFd](HostStream &port) {
+			uint8_t buff[256];
+			ssize_t count = ::read(inFd, buff, sizeof(buff));
+			if (count > 0) port.feed(buff, count);
+		};
+	}
+	if (outFd >= 0) {
+		onWrite = [outFd](const uint8_t *data, size_t size) {
+			while (size > 0) {
+				ssize_t written = ::write(outFd, data, size);
+				if (written <= 0) return;
+				data += written;
+				size -= written;
+			}
+		};
+	}
+}
+SERCOM *hostSercom(uint8_t wichNumber)
+{
+	SERCOM *all[] = { &sercom0, &sercom1, &sercom2, &sercom3, &sercom4, &sercom5 };
+	return wichNumber < 6 ? all[wichNumber] : 0;
+}
+
+// **** System
+void (*hostReset)() = 0;
+
+void NVIC_SystemReset()
+{
+	if (hostReset) hostReset();
+	fprintf(stderr, "\nThe kit reset itself at %.3f s, ending the run\n", hostClock.now() / 1000000.0);
+	exit(0);
+}
@@ -0,0 +1,176 @@
+// Compression benchmark for the readings log (SckList).
+//
+// Loads readings from sdcard CSV files written by the kit (the 4 header lines followed by one line per reading group),
+// stores them on a simulated flash as text groups and as compressed groups and reports the space used and the time
+// needed to save and to read back every group (as netPublish does). Without files a synthetic trace is used.
+//
+// Build and run (from sam/host):
+//	g++ -std=gnu++11 -O2 -I. -I../src -I../../lib/Sensors list_bench.cpp ../src/SckList.cpp ../src/SckJournal.cpp ../../lib/Sensors/SensorValue.cpp -o /tmp/list_bench
+//	/tmp/list_bench [19-01-01.CSV ...]
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <math.h>
+
+#include "SckJournal.h"
+#include "SckList.h"
+
+HostSerial SerialUSB;
+FlashChip hostFlash;
+HostPins hostPins;
+
+struct Row {
+	uint32_t time;
+	std::vector<std::string> values;
+};
+
+static const uint32_t maxRows = 20000;
+
+// 2019-01-01T10:00:00Z -> epoch
+static uint32_t isoToEpoch(const std::string &iso)
+{
+	int y, m, d, hh, mm, ss;
+	if (sscanf(iso.c_str(), "%d-%d-%dT%d:%d:%d", &y, &m, &d, &hh, &mm, &ss) != 6) return 0;
+
+	y -= m <= 2;
+	int era = y / 400;
+	int yoe = y - era * 400;
+	int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	long days = era * 146097L + doe - 719468;
+
+	return days * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+static bool loadCSV(const char *fileName, std::vector<Row> &rows)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open()) return false;
+
+	std::string line;
+	uint8_t headerLines = 0;
+	while (std::getline(file, line) && rows.size() < maxRows) {
+
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (headerLines < 4) {
+			headerLines++;
+			continue;
+		}
+
+		Row row;
+		std::stringstream ss(line);
+		std::string cell;
+		bool first = true;
+		while (std::getline(ss, cell, ',')) {
+			if (first) row.time = isoToEpoch(cell);
+			else row.values.push_back(cell);
+			first = false;
+		}
+		if (row.time > 0) rows.push_back(row);
+	}
+	return true;
+}
+
+// Urban board defaults: battery, light, temperature, humidity, noise, pressure, PM
+static void syntheticTrace(std::vector<Row> &rows)
+{
+	srand(1);
+	for (uint32_t i=0; i<maxRows; i++) {
+		double hour = (i % 1440) / 60.0;
+		char buff[16];
+		Row row;
+		row.time = 1546300800 + i * 60;
+
+		snprintf(buff, sizeof(buff), "%u", 100 - (i / 200) % 100);							row.values.push_back(buff);
+		snprintf(buff, sizeof(buff), "%u", (uint32_t)fmax(0, 800 * sin((hour - 6) * M_PI / 12)) + rand() % 5);		row.values.push_back(buff);
+		snprintf(buff, sizeof(buff), "%.2f", 18 + 6 * sin((hour - 9) * M_PI / 12) + (rand() % 20) / 100.0);		row.values.push_back(buff);
+		snprintf(buff, sizeof(buff), "%.2f", 60 - 15 * sin((hour - 9) * M_PI / 12) + (rand() % 50) / 100.0);		row.values.push_back(buff);
+		snprintf(buff, sizeof(buff), "%.2f", 45 + (rand() % 1500) / 100.0);						row.values.push_back(buff);
+		snprintf(buff, sizeof(buff), "%.2f", 101.3 + (rand() % 10) / 100.0);						row.values.push_back(buff);
+		for (uint8_t pm=0; pm<3; pm++) {
+			snprintf(buff, sizeof(buff), "%u", 8 + pm * 3 + rand() % 4);						row.values.push_back(buff);
+		}
+		rows.push_back(row);
+	}
+}
+
+struct Result {
+	uint32_t groups;
+	uint32_t bytes;
+	double saveMicros;
+	double readMicros;
+};
+
+static Result run(const std::vector<Row> &rows, bool compress)
+{
+	hostFlash.memory.assign(hostFlash.memory.size(), 0xFF);
+
+	SckJournal *journal = new SckJournal;
+	SckList *list = new SckList;
+	journal->begin();
+	list->begin(journal);
+	list->compress = compress;
+
+	Result result = {0, 0, 0, 0};
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t r=0; r<rows.size(); r++) {
+		list->createGroup(rows[r].time);
+		for (uint8_t i=0; i<rows[r].values.size(); i++) list->appendReading(static_cast<SensorType>(i), SensorValue::parse(rows[r].values[i].c_str(), rows[r].values[i].size()));
+		if (!list->saveLastGroup()) break;
+		result.groups++;
+	}
+	auto saved = std::chrono::steady_clock::now();
+
+	// Read every group like netPublish does, checking the values come back exactly the same
+	for (uint32_t g=0; g<result.groups; g++) {
+		const Row &row = rows[result.groups - 1 - g];
+		if (list->getTime(g) != row.time) printf("ERROR: wrong time on group %u\n", g);
+		uint16_t readings = list->countReadings(g);
+		for (uint16_t i=0; i<readings; i++) {
+			OneReading reading = list->readReading(g, i);
+			char value[SENSORVALUE_SIZE];
+			char expected[SENSORVALUE_SIZE];
+			SensorValue::parse(row.values[i].c_str(), row.values[i].size()).format(expected);
+			if (strcmp(reading.value.format(value), expected) != 0) printf("ERROR: group %u reading %u: %s != %s\n", g, i, value, expected);
+		}
+	}
+	auto read = std::chrono::steady_clock::now();
+
+	result.bytes = list->usedBytes();
+	result.saveMicros = std::chrono::duration<double, std::micro>(saved - start).count() / result.groups;
+	result.readMicros = std::chrono::duration<double, std::micro>(read - saved).count() / result.groups;
+
+	delete list;
+	delete journal;
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<Row> rows;
+
+	if (argc > 1) {
+		for (int i=1; i<argc; i++) {
+			if (!loadCSV(argv[i], rows)) printf("ERROR: can't open %s\n", argv[i]);
+		}
+		printf("data: %u groups from %d files\n", (uint32_t)rows.size(), argc - 1);
+	} else {
+		syntheticTrace(rows);
+		printf("data: %u synthetic groups (pass sdcard CSV files to use real data)\n", (uint32_t)rows.size());
+	}
+	if (rows.empty()) return 1;
+
+	Result text = run(rows, false);
+	Result compressed = run(rows, true);
+
+	printf("%-12s %8s %10s %12s %12s %12s\n", "format", "groups", "bytes", "bytes/group", "save us/grp", "read us/grp");
+	printf("%-12s %8u %10u %12.1f %12.2f %12.2f\n", "text", text.groups, text.bytes, (double)text.bytes / text.groups, text.saveMicros, text.readMicros);
+	printf("%-12s %8u %10u %12.1f %12.2f %12.2f\n", "compressed", compressed.groups, compressed.bytes, (double)compressed.bytes / compressed.groups, compressed.saveMicros, compressed.readMicros);
+	printf("ratio: %.2f (including %u bytes of record header and flags per group)\n", ((double)text.bytes / text.groups) / ((double)compressed.bytes / compressed.groups), SCKLIST_HEADER_SIZE + SCKLIST_TRAILER_SIZE);
+
+	return 0;
+}
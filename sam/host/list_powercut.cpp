@@ -0,0 +1,242 @@
+// Power cut test for the readings log (SckList) and the config journal (SckJournal).
+//
+// Runs the same operations the kit does (save a group, delete the newest one, flag a group as published on the sdcard, save
+// the configuration as one journal batch) against a simulated flash chip, cutting the power at random points. After every
+// cut the list is started again from the flash contents and compared with a model: it must match the state before or after
+// the interrupted operation, and the configuration keys must all come from the same save.
+//
+// Build and run (from sam/host):
+//	g++ -std=gnu++11 -O2 -I. -I../src -I../../lib/Sensors list_powercut.cpp ../src/SckList.cpp ../src/SckJournal.cpp ../../lib/Sensors/SensorValue.cpp -o /tmp/list_powercut
+//	/tmp/list_powercut [iterations] [seed]
+
+#include <vector>
+#include <utility>
+
+#include "SckJournal.h"
+#include "SckList.h"
+
+HostSerial SerialUSB;
+FlashChip hostFlash;
+HostPins hostPins;
+
+struct ModelGroup {
+	uint32_t time;
+	std::vector<std::pair<SensorType, std::string> > readings;
+	bool sdPublished;
+};
+typedef std::vector<ModelGroup> Model; 	// Oldest first (SckList counts groups from the newest)
+
+// Every configuration save writes its number on three keys of different sizes
+struct ConfigValues {
+	uint8_t mode;
+	uint32_t interval;
+	uint8_t token[16];
+};
+static ConfigValues configValues(uint32_t save)
+{
+	ConfigValues values;
+	values.mode = save & 0xFF;
+	values.interval = save;
+	memset(values.token, save & 0xFF, sizeof(values.token));
+	return values;
+}
+
+struct Kit {
+	SckJournal journal;
+	SckList list;
+};
+
+static Kit *boot()
+{
+	Kit *kit = new Kit;
+	kit->journal.begin();
+	kit->list.begin(&kit->journal);
+	return kit;
+}
+
+static bool configMatches(SckJournal &journal, uint32_t save)
+{
+	ConfigValues expected = configValues(save);
+	ConfigValues stored;
+	if (save == 0) return !journal.has(JKEY_MODE) && !journal.has(JKEY_PUBLISH_INTERVAL) && !journal.has(JKEY_TOKEN);
+	if (!journal.read(JKEY_MODE, &stored.mode, sizeof(stored.mode))) return false;
+	if (!journal.read(JKEY_PUBLISH_INTERVAL, &stored.interval, sizeof(stored.interval))) return false;
+	if (!journal.read(JKEY_TOKEN, stored.token, sizeof(stored.token))) return false;
+	return stored.mode == expected.mode && stored.interval == expected.interval && !memcmp(stored.token, expected.token, sizeof(stored.token));
+}
+static bool matches(SckList &list, const Model &model)
+{
+	if (list.countGroups() != model.size()) return false;
+
+	for (uint32_t i=0; i<model.size(); i++) {
+		const ModelGroup &group = model[model.size() - 1 - i];
+
+		if (list.getTime(i) != group.time) return false;
+		if (list.countReadings(i) != group.readings.size()) return false;
+		if (list.getFlag(i, SckList::SD_PUBLISHED) != (int8_t)group.sdPublished) return false;
+
+		for (uint8_t r=0; r<group.readings.size(); r++) {
+			OneReading reading = list.readReading(i, r);
+			if (reading.type != group.readings[r].first) return false;
+			char value[SENSORVALUE_SIZE];
+			if (group.readings[r].second != reading.value.format(value)) return false;
+		}
+	}
+	return true;
+}
+
+// The model keeps the values as the list prints them (there is no "-0.00")
+static std::string formatted(const char *text)
+{
+	char value[SENSORVALUE_SIZE];
+	return SensorValue::parse(text, strlen(text)).format(value);
+}
+static ModelGroup randomGroup(uint32_t time, const Model &model)
+{
+	ModelGroup group;
+	group.time = time;
+	group.sdPublished = false;
+
+	// Most of the time the same sensors as the previous group with slowly changing values, like the kit does
+	if (!model.empty() && rand() % 4 != 0) {
+		group.readings = model.back().readings;
+		for (uint8_t i=0; i<group.readings.size(); i++) {
+			double value = atof(group.readings[i].second.c_str());
+			if (group.readings[i].second == "null" || rand() % 3 == 0) continue;
+			char text[24];
+			snprintf(text, sizeof(text), "%.2f", value + (rand() % 200 - 100) / 100.0);
+			group.readings[i].second = formatted(text);
+		}
+		return group;
+	}
+
+	// Some big groups so the log wraps around the flash in a reasonable time
+	uint8_t readings = 1 + rand() % ((rand() % 8 == 0) ? 40 : 10);
+	for (uint8_t i=0; i<readings; i++) {
+		char value[16];
+		switch (rand() % 6) {
+			case 0: snprintf(value, sizeof(value), "null"); break;
+			case 1: snprintf(value, sizeof(value), "%d", rand() % 5000 - 100); break;
+			default: snprintf(value, sizeof(value), "%.2f", (rand() % 100000) / 100.0);
+		}
+		group.readings.push_back(std::make_pair(static_cast<SensorType>(rand() % SENSOR_COUNT), formatted(value)));
+	}
+	return group;
+}
+
+// Applies one random operation to the model and the list, returns false if the list refused it
+static bool operation(Kit &kit, Model &model, uint32_t &time, uint32_t &configSave)
+{
+	SckList &list = kit.list;
+	uint8_t dice = rand() % 100;
+
+	if (dice < 45 || model.empty()) {
+
+		ModelGroup group = randomGroup(time += 60, model);
+		list.compress = rand() % 8 != 0; 	// Both formats can be mixed on the same log
+		model.push_back(group);
+
+		list.createGroup(group.time);
+		for (uint8_t i=0; i<group.readings.size(); i++) list.appendReading(group.readings[i].first, SensorValue::parse(group.readings[i].second.c_str(), group.readings[i].second.size()));
+		return list.saveLastGroup();
+
+	} else if (dice < 90) {
+
+		// Deleting the newest group is what happens after publishing
+		model.pop_back();
+		return list.delLastGroup();
+
+	} else if (dice < 95) {
+
+		ConfigValues values = configValues(++configSave);
+		if (!kit.journal.beginBatch(3 * 4 + sizeof(values))) return false;
+		kit.journal.write(JKEY_MODE, &values.mode, sizeof(values.mode));
+		kit.journal.write(JKEY_PUBLISH_INTERVAL, &values.interval, sizeof(values.interval));
+		kit.journal.write(JKEY_TOKEN, values.token, sizeof(values.token));
+		return kit.journal.commitBatch();
+
+	} else {
+
+		uint32_t wichGroup = rand() % model.size();
+		model[model.size() - 1 - wichGroup].sdPublished = true;
+		list.setFlag(wichGroup, SckList::SD_PUBLISHED, true);
+		return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = argc > 1 ? atol(argv[1]) : 20000;
+	uint32_t seed = argc > 2 ? atol(argv[2]) : 1;
+	srand(seed);
+
+	Model model;
+	uint32_t time = 1500000000;
+	uint32_t configSave = 0;
+	uint32_t cuts = 0, keptOld = 0, keptNew = 0, torn = 0, scanned = 0, full = 0;
+
+	Kit *kit = boot();
+	if (!kit->list.usingFlash) {
+		printf("ERROR: list is not using flash\n");
+		return 1;
+	}
+
+	for (uint32_t i=0; i<iterations; i++) {
+
+		Model before = model;
+		uint32_t configBefore = configSave;
+		// One in four operations gets a power cut, usually while writing a group and sometimes during an erase or a journal compaction
+		if (rand() % 4 == 0) hostFlash.powerBudget = rand() % 4 == 0 ? rand() % 9000 : rand() % 400;
+		else hostFlash.powerBudget = -1;
+
+		bool cut = false;
+		try {
+			if (!operation(*kit, model, time, configSave)) {
+				// Log full: delete everything so it starts again
+				full++;
+				model = before;
+				hostFlash.powerBudget = -1;
+				while (kit->list.countGroups() > 0) kit->list.delLastGroup();
+				model.clear();
+			}
+		} catch (PowerCut &) {
+			cut = true;
+		}
+		hostFlash.powerBudget = -1;
+
+		// Reboot after every cut, and from time to time without one
+		if (cut || i % 50 == 0) {
+
+			delete kit;
+			kit = boot();
+			torn += kit->list.tornRecords;
+			scanned += kit->list.recoveredGroups;
+
+			bool newConfig = configMatches(kit->journal, configSave);
+			if (matches(kit->list, model) && newConfig) {
+				if (cut) keptNew++;
+			} else if (cut && matches(kit->list, before) && (newConfig || configMatches(kit->journal, configBefore))) {
+				keptOld++;
+				model = before;
+				if (!newConfig) configSave = configBefore;
+			} else {
+				printf("ERROR: recovered list doesn't match on iteration %u (seed %u, %s)\n", i, seed, cut ? "after power cut" : "clean reboot");
+				printf("Expected %u groups, found %u\n", (uint32_t)model.size(), kit->list.countGroups());
+				return 1;
+			}
+			if (cut) cuts++;
+		}
+	}
+
+	printf("iterations: %u\n", iterations);
+	printf("power cuts: %u (recovered previous state: %u, recovered new state: %u)\n", cuts, keptOld, keptNew);
+	printf("interrupted records skipped: %u\n", torn);
+	printf("groups found after checkpoint on boot: %u\n", scanned);
+	printf("log full: %u\n", full);
+	printf("flash: %u bytes programmed, %u sectors erased\n", hostFlash.programmedBytes, hostFlash.erasedSectors);
+	printf("journal: %u records, %u compactions\n", kit->journal.recordsWritten, kit->journal.compactions);
+	printf("OK\n");
+
+	delete kit;
+	return 0;
+}
@@ -0,0 +1,208 @@
+// Tests and benchmark for the sensor and command name lookup (AllSensors::find and NameIndex).
+//
+// Checks exact and prefix matches of every sensor title and short title (in any case) against a brute force search,
+// checks that texts that are not a name still give the same sensor as the old word matching and times both.
+//
+// Build and run (from sam/host):
+//	g++ -std=gnu++11 -O2 -I. -I../../lib/Sensors lookup_bench.cpp ../../lib/Sensors/Sensors.cpp ../../lib/Sensors/NameIndex.cpp ../../lib/Sensors/SensorValue.cpp -o /tmp/lookup_bench
+//	/tmp/lookup_bench
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <strings.h>
+
+#include "Sensors.h"
+
+static uint32_t failures = 0;
+
+static void check(bool condition, const char *what, const std::string &text)
+{
+	if (condition) return;
+	printf("FAIL: %s [%s]\n", what, text.c_str());
+	failures++;
+}
+static std::string lower(std::string text)
+{
+	for (size_t i=0; i<text.size(); i++) text[i] = tolower(text[i]);
+	return text;
+}
+static std::string upper(std::string text)
+{
+	for (size_t i=0; i<text.size(); i++) text[i] = toupper(text[i]);
+	return text;
+}
+
+// The word matching as it was done with Arduino Strings (indexOf, replace and trim)
+static uint8_t oldCountMatchedWords(std::string baseString, std::string input)
+{
+	uint8_t foundedCount = 0;
+	std::string word;
+	while (input.length() > 0) {
+		size_t space = input.find(" ");
+		word = space != std::string::npos ? input.substr(0, space) : input;
+		if (baseString.find(word) != std::string::npos) foundedCount += 1;
+		else break;
+		for (size_t pos; (pos = input.find(word)) != std::string::npos;) input.erase(pos, word.length());
+		size_t first = input.find_first_not_of(' ');
+		input = first == std::string::npos ? "" : input.substr(first, input.find_last_not_of(' ') - first + 1);
+	}
+	return foundedCount;
+}
+static SensorType oldGetTypeFromString(const std::string &strIn)
+{
+	SensorType wichSensor = SENSOR_COUNT;
+	uint8_t maxWordsFound = 0;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		uint8_t matchedWords = oldCountMatchedWords(lower(SensorCatalog::list[i].title), lower(strIn));
+		if (matchedWords > maxWordsFound) {
+			maxWordsFound = matchedWords;
+			wichSensor = static_cast<SensorType>(i);
+		}
+	}
+	return wichSensor;
+}
+
+// What find() should return when the whole text is a name or the start of one
+static SensorType bruteForceName(const std::string &text)
+{
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) if (strcasecmp(SensorCatalog::list[i].shortTitle, text.c_str()) == 0) return static_cast<SensorType>(i);
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) if (strcasecmp(SensorCatalog::list[i].title, text.c_str()) == 0) return static_cast<SensorType>(i);
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) if (strncasecmp(SensorCatalog::list[i].title, text.c_str(), text.size()) == 0) return static_cast<SensorType>(i);
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) if (strncasecmp(SensorCatalog::list[i].shortTitle, text.c_str(), text.size()) == 0) return static_cast<SensorType>(i);
+	return SENSOR_COUNT;
+}
+static SensorType find(AllSensors &sensors, const std::string &text)
+{
+	return sensors.find(text.c_str(), text.size());
+}
+
+static void testNames(AllSensors &sensors)
+{
+	uint32_t checked = 0;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		const char *names[2] = { SensorCatalog::list[i].title, SensorCatalog::list[i].shortTitle };
+		for (uint8_t n=0; n<2; n++) {
+			std::string name = names[n];
+
+			// Exact, in any case and with spaces around
+			SensorType expected = bruteForceName(name);
+			check(find(sensors, name) == expected, "exact", name);
+			check(find(sensors, lower(name)) == expected, "exact lower case", name);
+			check(find(sensors, upper(name)) == expected, "exact upper case", name);
+			check(find(sensors, "  " + name + " ") == expected, "exact with spaces", name);
+			check(expected <= i, "exact gives the first sensor with that name", name);
+
+			// Every prefix
+			for (size_t len=1; len<name.size(); len++) {
+				std::string prefix = name.substr(0, len);
+				if (prefix[len - 1] == ' ') continue;
+				check(find(sensors, lower(prefix)) == bruteForceName(prefix), "prefix", prefix);
+				checked++;
+			}
+			checked += 4;
+		}
+	}
+	printf("names: %u lookups checked\n", checked);
+}
+static void testWords(AllSensors &sensors, std::vector<std::string> &inputs)
+{
+	// Words of the titles in different orders, followed by something that is not part of a name (like a control command)
+	std::vector<std::string> words;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		std::string title = lower(SensorCatalog::list[i].title);
+		size_t start = 0;
+		while (start < title.size()) {
+			size_t end = title.find(' ', start);
+			if (end == std::string::npos) end = title.size();
+			words.push_back(title.substr(start, end - start));
+			start = end + 1;
+		}
+	}
+
+	srand(1);
+	uint32_t checked = 0;
+	for (uint32_t n=0; n<20000; n++) {
+		std::string text = words[rand() % words.size()];
+		uint8_t count = rand() % 3;
+		for (uint8_t w=0; w<count; w++) text += " " + words[rand() % words.size()];
+		if (rand() % 2) text += " -oneshot 60";
+		inputs.push_back(text);
+
+		if (bruteForceName(text) != SENSOR_COUNT) continue;
+		check(find(sensors, text) == oldGetTypeFromString(text), "words", text);
+		checked++;
+	}
+	printf("words: %u lookups checked\n", checked);
+
+	// What the control command gets after the sensor name
+	check(std::string(sensors.removeSensorName("noise dba FFT").c_str()) == "fft", "removeSensorName", "noise dba FFT");
+	check(std::string(sensors.removeSensorName("pm -oneshot 60").c_str()) == "-oneshot 60", "removeSensorName", "pm -oneshot 60");
+	check(std::string(sensors.removeSensorName("Temperature").c_str()) == "", "removeSensorName", "Temperature");
+	check(find(sensors, "") == SENSOR_COUNT, "empty", "");
+	check(find(sensors, "xyzzy") == SENSOR_COUNT, "not found", "xyzzy");
+}
+
+static const char *comNames[] = { "re", "read", "readings", "reset", "sensor", "saved", "sleep" };
+static const char *comName(const void *table, uint8_t item)
+{
+	return ((const char **)table)[item];
+}
+static void testPrefixOf()
+{
+	uint8_t order[7];
+	NameIndex index(order, 7, comName, comNames);
+
+	struct { const char *text; uint8_t expected; } cases[] = {
+		{ "read", 1 },
+		{ "READ temperature", 1 },
+		{ "readings -details", 2 },
+		{ "readx", 1 },
+		{ "rex", 0 },
+		{ "reset", 3 },
+		{ "r", 7 },
+		{ "sensor -enable noise", 4 },
+		{ "Sleep -tick", 6 },
+		{ "zz", 7 },
+		{ "", 7 },
+	};
+	for (auto &c : cases) check(index.prefixOf(c.text, strlen(c.text)) == c.expected, "prefixOf", c.text);
+	check(index.find("READINGS", 8) == 2, "find", "READINGS");
+	check(index.find("readi", 5) == 7, "find", "readi");
+	check(index.startingWith("readi", 5) == 2, "startingWith", "readi");
+	check(index.startingWith("s", 1) == 4, "startingWith", "s");
+	printf("prefixOf: %u cases checked\n", (uint32_t)(sizeof(cases) / sizeof(cases[0])));
+}
+
+int main()
+{
+	AllSensors sensors;
+	std::vector<std::string> inputs;
+
+	testNames(sensors);
+	testWords(sensors, inputs);
+	testPrefixOf();
+
+	// Typical names typed or scripted on the shell, plus the random word inputs
+	const char *typical[] = { "temperature", "humidity", "noise dba", "light", "pm 2.5", "battery", "ext temperature", "co resistance", "BATT", "NOISE_A" };
+	for (auto t : typical) inputs.push_back(t);
+
+	uint32_t rounds = 20;
+	volatile uint32_t sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t r=0; r<rounds; r++) for (auto &text : inputs) sink += oldGetTypeFromString(text);
+	auto middle = std::chrono::steady_clock::now();
+	for (uint32_t r=0; r<rounds; r++) for (auto &text : inputs) sink += find(sensors, text);
+	auto end = std::chrono::steady_clock::now();
+
+	double lookups = (double)rounds * inputs.size();
+	printf("old word matching: %8.2f us/lookup\n", std::chrono::duration<double, std::micro>(middle - start).count() / lookups);
+	printf("name index:        %8.2f us/lookup\n", std::chrono::duration<double, std::micro>(end - middle).count() / lookups);
+
+	if (failures) {
+		printf("%u FAILURES\n", failures);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,312 @@
+// Entry point of the native build (pio run -e native): runs the firmware on the workstation (see Arduino.h).
+//
+//	.pio/build/native/program [options]
+//
+//	-t seconds		stop after this time (default: until the script ends or forever)
+//	-script file		timed events from the outside world (see HostScript.h)
+//	-sd dir			directory used as the sdcard (default: sdcard, the card is inserted if it exists)
+//	-flash file		keeps the flash chip (readings and config) on this file between runs
+//	-epoch seconds		time of the world and of the RTC when it starts, 0: RTC not set (default: the workstation time)
+//	-esp in out		connects the ESP port to these pipes or fifos (RH_Serial framing, see RH_Serial.h) instead of the ESP model
+//	-realtime		follow the workstation clock instead of the virtual time
+//	-loop micros		virtual time every pass of loop() takes on top of the clock reads (default: 0). Runs of days go much
+//				faster with the time of the real loop (around 1000)
+//	-report file.json	counters of the whole run when it ends (publishes, latency, wakeups, storage, RAM, see HostDevices.h)
+//	-series file.csv	the same counters over time, one row every -every seconds (default: 3600)
+//
+// The console is stdin/stdout. The kit runs with the models of HostDevices.h around it: an ESP on a working wifi, a PMS5003,
+// a battery and USB power (the console is silent off USB, like on the kit). When the kit resets the run goes on: time, the
+// flash and the counters are saved, the program starts again and skips the script to that time (-resume is that state file).
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <RTCZero.h>
+#include <SdFat.h>
+#include <SPIFlash.h>
+#include "HostScript.h"
+#include "HostDevices.h"
+#include "../src/SckBase.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+void serialEventRun() __attribute__((weak));
+extern SckBase base;
+
+static std::vector<std::string> arguments;
+static std::string flashFile;
+static bool tempFlash = false; 			// Flash file made for the resets of this run
+static std::string stateFile;
+static std::string reportFile;
+static std::string seriesFile;
+static uint64_t seriesEvery = 3600000000ULL;
+static uint64_t nextSample = 0;
+static HostMetrics previousBoots;
+static double previousReal = 0; 		// Workstation seconds before the last reset
+static std::chrono::steady_clock::time_point started;
+
+static void usage()
+{
+	fprintf(stderr, "USAGE: program [-t seconds] [-script file] [-sd dir] [-flash file] [-epoch seconds] [-esp in out] [-realtime] [-loop micros] [-report file.json] [-series file.csv] [-every seconds]\n");
+	exit(1);
+}
+
+// Counters of the run so far: the models' plus what the firmware counts on this boot and the previous ones
+static HostMetrics snapshot()
+{
+	HostMetrics m = hostMetrics;
+	m.espOnMillis = hostEsp.onMillis();
+	m.pmOnMillis = hostPms.onMillis();
+
+	SckBase::SleepStats &stats = base.sleepStats;
+	m.wakeups = stats.wakeups;
+	m.wakeReading = stats.reasons[SckBase::WAKE_READING];
+	m.wakePublish = stats.reasons[SckBase::WAKE_PUBLISH];
+	m.wakeHeartbeat = stats.reasons[SckBase::WAKE_HEARTBEAT];
+	m.wakeReset = stats.reasons[SckBase::WAKE_RESET];
+	m.wakeFixed = stats.reasons[SckBase::WAKE_FIXED];
+	m.wakeEarly = stats.early;
+	m.sleptSeconds = stats.sleptSeconds;
+	m.awakeMillis = stats.awakeMillis;
+	m.sdBytes = hostSd.bytesWritten;
+	m.sdSyncs = hostSd.syncs;
+	m.flashProgrammed = hostFlash.programmedBytes;
+	m.flashErased = hostFlash.erasedSectors;
+	m.minFreeRam = base.memory.minFree;
+	m.minHeadroom = base.memory.headroom();
+	m.pendingGroups = base.readingsList.countGroups();
+	m.logBytes = base.readingsList.usedBytes();
+
+	m.add(previousBoots);
+	return m;
+}
+static double realSeconds()
+{
+	return previousReal + std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+static void sample()
+{
+	if (seriesFile.empty()) return;
+	uint64_t now = hostClock.now();
+	if (now < nextSample) return;
+	while (nextSample <= now) nextSample += seriesEvery;
+
+	FILE *file = fopen(seriesFile.c_str(), "a");
+	if (!file) return;
+	if (ftell(file) == 0) fprintf(file, "seconds,epoch,boots,wakeups,publishes,publishErrors,readingsPublished,pendingGroups,logBytes,flashProgrammed,sdBytes,minFreeRam,espOnSeconds\n");
+	HostMetrics m = snapshot();
+	fprintf(file, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+		(unsigned long long)(now / 1000000), (unsigned long long)(hostClock.epoch + now / 1000000), (unsigned long long)m.boots,
+		(unsigned long long)m.wakeups, (unsigned long long)m.publishes, (unsigned long long)m.publishErrors, (unsigned long long)m.readingsPublished,
+		(unsigned long long)m.pendingGroups, (unsigned long long)m.logBytes, (unsigned long long)m.flashProgrammed, (unsigned long long)m.sdBytes,
+		(unsigned long long)m.minFreeRam, (unsigned long long)(m.espOnMillis / 1000));
+	fclose(file);
+}
+static void report()
+{
+	HostMetrics m = snapshot();
+	double seconds = hostClock.now() / 1000000.0;
+	double latency = m.publishes ? (double)m.latencySum / m.publishes : 0;
+
+	uint8_t enabled = 0;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) if (base.sensors[static_cast<SensorType>(i)].enabled) enabled++;
+
+	if (!reportFile.empty()) {
+		FILE *file = fopen(reportFile.c_str(), "w");
+		if (file) {
+			fprintf(file, "{\n\t\"seconds\": %.3f,\n\t\"realSeconds\": %.3f,\n", seconds, realSeconds());
+			fprintf(file, "\t\"readInterval\": %u,\n\t\"publishInterval\": %u,\n\t\"enabledSensors\": %u,\n", (unsigned)base.config.readInterval, (unsigned)base.config.publishInterval, enabled);
+			fprintf(file, "\t\"latencyAverage\": %.1f,\n", latency);
+			for (uint8_t i=0; i<HostMetrics::fieldCount; i++) {
+				uint64_t value = m.*HostMetrics::fields[i].value;
+				if (value == UINT64_MAX) fprintf(file, "\t\"%s\": null%s\n", HostMetrics::fields[i].name, i + 1 < HostMetrics::fieldCount ? "," : "");
+				else fprintf(file, "\t\"%s\": %llu%s\n", HostMetrics::fields[i].name, (unsigned long long)value, i + 1 < HostMetrics::fieldCount ? "," : "");
+			}
+			fprintf(file, "}\n");
+			fclose(file);
+		}
+	}
+
+	fprintf(stderr, "\nNative run: %.3f s of kit time in %.3f s\n", seconds, realSeconds());
+	if (m.boots > 1 || m.publishes || m.wakeups) {
+		fprintf(stderr, "Boots: %llu, wakeups: %llu, awake %.1f%%\n", (unsigned long long)m.boots, (unsigned long long)m.wakeups, seconds > 0 ? 100.0 - m.sleptSeconds * 100.0 / seconds : 0);
+		fprintf(stderr, "Publishes: %llu (%llu errors), %llu readings, latency %.1f s average, %llu s max\n", (unsigned long long)m.publishes,
+			(unsigned long long)m.publishErrors, (unsigned long long)m.readingsPublished, latency, (unsigned long long)m.latencyMax);
+		fprintf(stderr, "Waiting on flash: %llu groups (log %llu bytes), flash programmed %llu bytes, sdcard %llu bytes\n", (unsigned long long)m.pendingGroups,
+			(unsigned long long)m.logBytes, (unsigned long long)m.flashProgrammed, (unsigned long long)m.sdBytes);
+		fprintf(stderr, "ESP on %.1f%% of the time, lowest free RAM %llu bytes\n", seconds > 0 ? m.espOnMillis / 10.0 / seconds : 0, (unsigned long long)m.minFreeRam);
+	}
+}
+
+static void saveFlash()
+{
+	if (flashFile.empty()) return;
+	FILE *file = fopen(flashFile.c_str(), "wb");
+	if (!file) return;
+	fwrite(hostFlash.memory.data(), 1, hostFlash.memory.size(), file);
+	fclose(file);
+}
+static void finish()
+{
+	saveFlash();
+	report();
+	if (tempFlash) unlink(flashFile.c_str());
+	if (!stateFile.empty()) unlink(stateFile.c_str());
+}
+
+// The RAM of the kit is lost, everything else goes on: save it and start the program again
+static void reboot()
+{
+	if (stateFile.empty()) {
+		char name[] = "/tmp/sckstateXXXXXX";
+		int fd = mkstemp(name);
+		if (fd < 0) return;
+		close(fd);
+		stateFile = name;
+	}
+	if (flashFile.empty()) {
+		flashFile = stateFile + ".flash";
+		tempFlash = true;
+	}
+	saveFlash();
+
+	FILE *file = fopen(stateFile.c_str(), "w");
+	if (!file) return;
+	fprintf(file, "micros %llu\n", (unsigned long long)hostClock.now());
+	fprintf(file, "rtc %lld\n", (long long)(RTCZero::active ? RTCZero::active->offset() : 0));
+	fprintf(file, "epoch %lu\n", (unsigned long)hostClock.epoch);
+	fprintf(file, "nextSample %llu\n", (unsigned long long)nextSample);
+	fprintf(file, "real %.6f\n", realSeconds());
+	fprintf(file, "tempFlash %u\n", tempFlash);
+	fprintf(file, "flash %s\n", flashFile.c_str());
+	snapshot().save(file);
+	fclose(file);
+
+	fprintf(stderr, "\nThe kit reset itself at %.3f s\n", hostClock.now() / 1000000.0);
+	fflush(stdout);
+	fflush(stderr);
+
+	std::vector<char *> argv;
+	for (size_t i=0; i<arguments.size(); i++) {
+		if (arguments[i] == "-resume") i++;
+		else argv.push_back(&arguments[i][0]);
+	}
+	std::string resume = "-resume";
+	argv.push_back(&resume[0]);
+	argv.push_back(&stateFile[0]);
+	argv.push_back(0);
+	execv("/proc/self/exe", argv.data());
+	fprintf(stderr, "Can't restart the program, ending the run\n");
+}
+static bool resume(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Can't open %s\n", path);
+		return false;
+	}
+	char name[64];
+	char text[4096];
+	while (fscanf(file, "%63s %4095[^\n]", name, text) == 2) {
+		std::string key = name;
+		if (key == "micros") {
+			hostClock.reset(strtoull(text, 0, 10));
+			hostClock.boot = hostClock.now();
+		} else if (key == "rtc") {
+			RTCZero::keptOffset = strtoll(text, 0, 10);
+			RTCZero::startEpoch = 0;
+		}
+		else if (key == "epoch") hostClock.epoch = strtoul(text, 0, 10);
+		else if (key == "nextSample") nextSample = strtoull(text, 0, 10);
+		else if (key == "real") previousReal = atof(text);
+		else if (key == "tempFlash") tempFlash = atoi(text);
+		else if (key == "flash") flashFile = text;
+		else if (previousBoots.load(name, strtoull(text, 0, 10))) hostMetrics.load(name, strtoull(text, 0, 10));
+	}
+	fclose(file);
+	stateFile = path;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = 0;
+	bool espModel = true;
+	uint32_t loopMicros = 0;
+	std::string resumeFile;
+	RTCZero::startEpoch = time(0);
+
+	arguments.assign(argv, argv + argc);
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		bool more = i + 1 < argc;
+		if (arg == "-t" && more) seconds = atof(argv[++i]);
+		else if (arg == "-script" && more) {
+			if (!hostScript.load(argv[++i])) return 1;
+		} else if (arg == "-sd" && more) hostSd.path = argv[++i];
+		else if (arg == "-flash" && more) flashFile = argv[++i];
+		else if (arg == "-epoch" && more) RTCZero::startEpoch = strtoul(argv[++i], 0, 10);
+		else if (arg == "-esp" && i + 2 < argc) {
+			int inFd = open(argv[i + 1], O_RDWR); 	// Read-write so opening a fifo doesn't wait for the other end
+			int outFd = open(argv[i + 2], O_RDWR);
+			if (inFd < 0 || outFd < 0) {
+				fprintf(stderr, "Can't open %s or %s\n", argv[i + 1], argv[i + 2]);
+				return 1;
+			}
+			Serial1.attach(inFd, outFd);
+			espModel = false;
+			i += 2;
+		} else if (arg == "-realtime") hostClock.virtualTime = false;
+		else if (arg == "-loop" && more) loopMicros = strtoul(argv[++i], 0, 10);
+		else if (arg == "-report" && more) reportFile = argv[++i];
+		else if (arg == "-series" && more) seriesFile = argv[++i];
+		else if (arg == "-every" && more) seriesEvery = atof(argv[++i]) * 1000000;
+		else if (arg == "-resume" && more) resumeFile = argv[++i];
+		else usage();
+	}
+
+	hostClock.reset();
+	hostClock.epoch = RTCZero::startEpoch ? RTCZero::startEpoch : time(0);
+	if (!resumeFile.empty()) {
+		if (!resume(resumeFile.c_str())) return 1;
+	} else if (!seriesFile.empty()) unlink(seriesFile.c_str());
+	if (seconds > 0) hostClock.end = seconds * 1000000;
+
+	if (!flashFile.empty()) {
+		FILE *file = fopen(flashFile.c_str(), "rb");
+		if (file) {
+			if (fread(hostFlash.memory.data(), 1, hostFlash.memory.size(), file) != hostFlash.memory.size()) fprintf(stderr, "%s is shorter than the flash, the rest is erased\n", flashFile.c_str());
+			fclose(file);
+		}
+	}
+
+	// The kit is plugged to the workstation with a battery and the urban board (scripts can change it, see HostScript.h),
+	// the sdcard is inserted if its directory exists
+	hostBattery.begin();
+	hostUrban.begin();
+	hostPms.begin();
+	if (espModel) hostEsp.begin();
+	if (hostSd.present()) hostPins.digital[pinCARD_DETECT] = LOW;
+	if (!resumeFile.empty()) hostScript.skip(hostClock.now());
+
+	SerialUSB.attach(STDIN_FILENO, STDOUT_FILENO);
+	started = std::chrono::steady_clock::now();
+	hostMetrics.boots++;
+	hostReset = reboot;
+	atexit(finish);
+
+	setup();
+	while (!hostScript.ended && hostClock.now() < hostClock.end) {
+		hostScript.run();
+		if (RTCZero::active) RTCZero::active->poll();
+		loop();
+		if (loopMicros && hostClock.virtualTime) hostClock.advance(loopMicros);
+		if (serialEventRun) serialEventRun();
+		sample();
+	}
+	return 0;
+}
@@ -0,0 +1,339 @@
+// Test bench of the noise readings (Sck_Noise::getReading) with recorded or generated sound.
+//
+// WAV files play on the microphone model (like the i2s wav event of the scripts) and every frame goes through the firmware
+// path as it is: I2S capture, dynamic scale, Hann window, Q15 FFT, equalization and weighting tables, RMS and dB. The 512
+// samples the firmware took go through a reference in double precision too (DFT, Hann window, IEC 61672 A and C curves and
+// the same equalization of the microphone), and the bench prints the difference per octave band and for the whole reading,
+// with the host CPU time per frame of both (SckBench has the times of every step on the kit).
+//
+// Levels use the calibration of the firmware: a full scale sine on the WAV (0 dBFS peak) is 120 dB SPL. The calibrated
+// signals of tools/Microphone/CORPUS have their levels on its README (corpus.py makes them again).
+//
+// Build and run (from sam/host, ArduinoJson is the one pio run -e native downloads):
+//	g++ -std=gnu++11 -O2 -D__GIT_HASH__=\"bench\" -D__ISO_DATE__=\"bench\" -I. -Idrivers -I../src -I../../lib/Sensors -I../../lib/Shared -I../.pio/libdeps/native/ArduinoJson/src noise_bench.cpp hal.cpp HostScript.cpp HostDevices.cpp SckMemoryHost.cpp $(ls ../src/*.cpp | grep -v SckMemory.cpp) ../../lib/Sensors/*.cpp ../../lib/Shared/*.cpp -x c++ -include Arduino.h ../src/SmartCitizenKit.ino -o /tmp/noise_bench
+//	/tmp/noise_bench [-frames N] [-tolerance dB] [-csv file] [-baseline file | -nobaseline] ../../tools/Microphone/CORPUS/*.wav
+// Exits with 1 when the reading of a frame is more than -tolerance dB (default 0.5) away from the reference. Files and weightings
+// on the baseline (baseline.csv next to the WAV files by default) have a known difference with the reference, and every frame has
+// to stay within the tolerance of it. Rows with their own tolerance are signals whose frames spread (noises, tones off the FFT
+// bins): their frames are checked with it, and the mean of the frames still with -tolerance.
+
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "HostScript.h"
+#include "../src/SckUrban.h" 		// With the tables of the microphone (SckSoundTables.h)
+
+static const double bandCenters[] = { 63, 125, 250, 500, 1000, 2000, 4000, 8000, 16000 };
+#define BAND_COUNT (sizeof(bandCenters) / sizeof(bandCenters[0]))
+
+static const SensorType weightings[] = { SENSOR_NOISE_DBZ, SENSOR_NOISE_DBA, SENSOR_NOISE_DBC };
+static const char *weightingNames[] = { "dBZ", "dBA", "dBC" };
+
+struct Levels {
+	double total;
+	double bands[BAND_COUNT];
+};
+
+// Octave band of an FFT bin, -1 for DC
+static int band(uint16_t bin)
+{
+	double freq = bin * 44100.0 / Sck_Noise::SAMPLE_NUM;
+	for (uint8_t b=0; b<BAND_COUNT; b++) {
+		if (freq >= bandCenters[b] / sqrt(2) && freq < bandCenters[b] * sqrt(2)) return b;
+	}
+	return -1;
+}
+
+// dB SPL of an RMS value on 24 bits (FULL_SCALE_DBSPL and FULL_SCALE_DBFS of Sck_Noise)
+static double toDb(double rms)
+{
+	if (rms <= 0) return 0;
+	return 120 + 20 * log10(sqrt(2) * rms / pow(2, 24));
+}
+
+// The bands of the last reading, with the RMS of getReading() on the bins of every band
+static Levels firmwareLevels(Sck_Noise &noise)
+{
+	Levels levels;
+	levels.total = noise.readingDB;
+
+	double sums[BAND_COUNT] = {};
+	for (uint16_t i=1; i<Sck_Noise::FFT_NUM; i++) {
+		int b = band(i);
+		if (b >= 0) sums[b] += pow(noise.readingFFT[i], 2) / Sck_Noise::FFT_NUM;
+	}
+	for (uint8_t b=0; b<BAND_COUNT; b++) levels.bands[b] = toDb(sqrt(sums[b]) / 0.61177 * sqrt(Sck_Noise::FFT_NUM) / sqrt(2));
+	return levels;
+}
+
+// IEC 61672 weighting curves, gain at a frequency
+static double weighting(SensorType wichSensor, double freq)
+{
+	double f2 = freq * freq;
+	double f1 = pow(20.598997, 2), f4 = pow(12194.217, 2);
+	if (wichSensor == SENSOR_NOISE_DBA) {
+		double ra = f4 * f2 * f2 / ((f2 + f1) * sqrt((f2 + pow(107.65265, 2)) * (f2 + pow(737.86223, 2))) * (f2 + f4));
+		return ra * pow(10, 2.0 / 20);
+	}
+	if (wichSensor == SENSOR_NOISE_DBC) {
+		double rc = f4 * f2 / ((f2 + f1) * (f2 + f4));
+		return rc * pow(10, 0.062 / 20);
+	}
+	return 1;
+}
+
+// The same reading in double precision, from the raw samples of the microphone (left justified on 32 bits)
+static Levels referenceLevels(const int32_t *raw, SensorType wichSensor)
+{
+	const uint16_t N = Sck_Noise::SAMPLE_NUM;
+	static double cosTable[N], sinTable[N];
+	if (cosTable[0] == 0) {
+		for (uint16_t n=0; n<N; n++) {
+			cosTable[n] = cos(2 * PI * n / N);
+			sinTable[n] = sin(2 * PI * n / N);
+		}
+	}
+
+	// 24 bits samples without their mean, through a Hann window
+	double x[N];
+	double mean = 0;
+	for (uint16_t n=0; n<N; n++) mean += raw[n] / 128.0 / N;
+	double windowPower = 0;
+	for (uint16_t n=0; n<N; n++) {
+		double w = 0.5 - 0.5 * cosTable[n];
+		x[n] = (raw[n] / 128.0 - mean) * w;
+		windowPower += w * w;
+	}
+
+	// Single sided power of every bin: the RMS of a sine on the bins of its main lobe
+	Levels levels;
+	double total = 0;
+	double sums[BAND_COUNT] = {};
+	for (uint16_t k=1; k<N/2; k++) {
+		double re = 0, im = 0;
+		for (uint16_t n=0; n<N; n++) {
+			uint16_t i = (uint32_t)k * n % N;
+			re += x[n] * cosTable[i];
+			im -= x[n] * sinTable[i];
+		}
+		double gain = equalTab[k] / 65536.0 * weighting(wichSensor, k * 44100.0 / N);
+		double power = 2 * (re * re + im * im) / (N * windowPower) * gain * gain;
+		total += power;
+		int b = band(k);
+		if (b >= 0) sums[b] += power;
+	}
+	levels.total = toDb(sqrt(total));
+	for (uint8_t b=0; b<BAND_COUNT; b++) levels.bands[b] = toDb(sqrt(sums[b]));
+	return levels;
+}
+
+struct Result {
+	uint32_t frames = 0;
+	uint32_t failed = 0; 				// getReading() returned false
+	double firmware = 0; 				// Sums of the readings, for the means
+	double reference = 0;
+	double maxError = 0; 				// Of the whole reading
+	double worstError = 0; 				// The frame furthest from the expected error
+	double bandError[BAND_COUNT] = {}; 		// Sums of the errors
+	double bandMax[BAND_COUNT] = {};
+	double firmwareMicros = 0;
+	double referenceMicros = 0;
+};
+
+// Known differences with the reference (firmware - reference, mean of the frames), by file name and weighting
+struct Known {
+	double error = 0;
+	double tolerance = 0; 				// Of every frame when they spread, 0 uses -tolerance
+};
+typedef std::map<std::string, Known> Baseline;
+
+static std::string baseName(const std::string &path)
+{
+	size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::vector<std::string> csvFields(const std::string &line)
+{
+	std::vector<std::string> fields;
+	std::stringstream stream(line);
+	std::string field;
+	while (std::getline(stream, field, ',')) fields.push_back(field);
+	return fields;
+}
+
+// Any CSV with file, weighting and error columns (the header names them), tolerance is optional
+static bool loadBaseline(const std::string &fileName, Baseline &baseline)
+{
+	std::ifstream in(fileName.c_str());
+	std::string line;
+	if (!in || !std::getline(in, line)) return false;
+
+	std::vector<std::string> header = csvFields(line);
+	int fileColumn = -1, weightingColumn = -1, errorColumn = -1, toleranceColumn = -1;
+	for (size_t i=0; i<header.size(); i++) {
+		if (header[i] == "file") fileColumn = i;
+		else if (header[i] == "weighting") weightingColumn = i;
+		else if (header[i] == "error") errorColumn = i;
+		else if (header[i] == "tolerance") toleranceColumn = i;
+	}
+	if (fileColumn < 0 || weightingColumn < 0 || errorColumn < 0) return false;
+
+	while (std::getline(in, line)) {
+		std::vector<std::string> fields = csvFields(line);
+		if ((int)fields.size() <= std::max(fileColumn, std::max(weightingColumn, errorColumn))) continue;
+		Known &known = baseline[baseName(fields[fileColumn]) + "," + fields[weightingColumn]];
+		known.error = atof(fields[errorColumn].c_str());
+		if (toleranceColumn >= 0 && toleranceColumn < (int)fields.size()) known.tolerance = atof(fields[toleranceColumn].c_str());
+	}
+	return true;
+}
+
+static double elapsedMicros(std::chrono::steady_clock::time_point since)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void usage()
+{
+	printf("USAGE:\n\nnoise_bench [-frames N] [-tolerance dB] [-csv file] [-baseline file | -nobaseline] file.wav [file.wav ...]\n");
+	printf("  -frames N: readings of every weighting on every file (default: 4)\n");
+	printf("  -tolerance dB: biggest difference of a frame with the reference (or with the known difference on the baseline) before failing (default: 0.5)\n");
+	printf("  -csv file: one row per file and weighting with every number\n");
+	printf("  -baseline file: known differences with the reference (default: baseline.csv next to the first WAV file)\n");
+	printf("  -nobaseline: compare with the reference only\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t frames = 4;
+	double tolerance = 0.5;
+	const char *csvName = 0;
+	std::string baselineName;
+	bool useBaseline = true;
+	std::vector<std::string> files;
+
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-frames" && i + 1 < argc) frames = atoi(argv[++i]);
+		else if (arg == "-tolerance" && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if (arg == "-csv" && i + 1 < argc) csvName = argv[++i];
+		else if (arg == "-baseline" && i + 1 < argc) baselineName = argv[++i];
+		else if (arg == "-nobaseline") useBaseline = false;
+		else if (arg[0] == '-') usage();
+		else files.push_back(arg);
+	}
+	if (files.empty() || !frames) usage();
+
+	Baseline baseline;
+	if (useBaseline) {
+		bool given = !baselineName.empty();
+		if (!given) baselineName = files[0].substr(0, files[0].size() - baseName(files[0]).size()) + "baseline.csv";
+		if (loadBaseline(baselineName, baseline)) printf("Baseline: %s (%u known differences)\n", baselineName.c_str(), (unsigned)baseline.size());
+		else if (given) {
+			fprintf(stderr, "Can't read the baseline %s (it needs file, weighting and error columns)\n", baselineName.c_str());
+			return 1;
+		}
+	}
+
+	FILE *csv = 0;
+	if (csvName) {
+		csv = fopen(csvName, "w");
+		if (!csv) {
+			fprintf(stderr, "Can't write %s\n", csvName);
+			return 1;
+		}
+		fprintf(csv, "file,weighting,frames,failed,firmware,reference,error,max error,expected error,tolerance");
+		for (uint8_t b=0; b<BAND_COUNT; b++) fprintf(csv, ",%g Hz error,%g Hz max error", bandCenters[b], bandCenters[b]);
+		fprintf(csv, ",firmware us,reference us\n");
+	}
+
+	Sck_Noise noise;
+	noise.start();
+
+	bool failed = false;
+	for (size_t f=0; f<files.size(); f++) {
+		std::vector<int32_t> samples;
+		if (!HostScript::loadWav(files[f].c_str(), samples)) {
+			fprintf(stderr, "Can't read %s (PCM 16, 24 or 32 bits WAV files)\n", files[f].c_str());
+			failed = true;
+			continue;
+		}
+
+		// Keeps what the microphone gave: the firmware takes the last nonzero samples of a reading
+		std::vector<int32_t> given;
+		size_t next = 0;
+		I2S.source = [&]() {
+			int32_t sample = samples[next];
+			next = (next + 1) % samples.size();
+			if (sample) given.push_back(sample);
+			return sample;
+		};
+
+		printf("\n%s (%.2f s)\n", files[f].c_str(), samples.size() / 44100.0);
+		printf("       frames  firmware reference   error |");
+		for (uint8_t b=0; b<BAND_COUNT; b++) printf(" %6g", bandCenters[b]);
+		printf(" | us/frame firmware reference\n");
+
+		for (uint8_t w=0; w<sizeof(weightings) / sizeof(weightings[0]); w++) {
+			Result result;
+			Baseline::const_iterator known = baseline.find(baseName(files[f]) + "," + weightingNames[w]);
+			double expected = known == baseline.end() ? 0 : known->second.error;
+			double allowed = known == baseline.end() || known->second.tolerance <= 0 ? tolerance : known->second.tolerance;
+			result.worstError = expected;
+			for (uint32_t i=0; i<frames; i++) {
+				given.clear();
+				auto started = std::chrono::steady_clock::now();
+				bool ok = noise.getReading(weightings[w]);
+				result.firmwareMicros += elapsedMicros(started);
+				if (!ok || given.size() < Sck_Noise::SAMPLE_NUM) {
+					result.failed++;
+					continue;
+				}
+
+				Levels firmware = firmwareLevels(noise);
+				started = std::chrono::steady_clock::now();
+				Levels reference = referenceLevels(&given[given.size() - Sck_Noise::SAMPLE_NUM], weightings[w]);
+				result.referenceMicros += elapsedMicros(started);
+
+				result.frames++;
+				result.firmware += firmware.total;
+				result.reference += reference.total;
+				double error = firmware.total - reference.total;
+				if (fabs(error) > fabs(result.maxError)) result.maxError = error;
+				if (fabs(error - expected) > fabs(result.worstError - expected)) result.worstError = error;
+				for (uint8_t b=0; b<BAND_COUNT; b++) {
+					double bandError = firmware.bands[b] - reference.bands[b];
+					result.bandError[b] += bandError;
+					if (fabs(bandError) > fabs(result.bandMax[b])) result.bandMax[b] = bandError;
+				}
+			}
+
+			uint32_t count = result.frames ? result.frames : 1;
+			double meanError = (result.firmware - result.reference) / count;
+			printf("  %s %4u/%-4u %9.2f %9.2f %7.2f |", weightingNames[w], result.frames, frames, result.firmware / count, result.reference / count, meanError);
+			for (uint8_t b=0; b<BAND_COUNT; b++) printf(" %6.2f", result.bandError[b] / count);
+			printf(" | %17.0f %9.0f\n", result.firmwareMicros / frames, result.referenceMicros / count);
+
+			if (csv) {
+				fprintf(csv, "%s,%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", files[f].c_str(), weightingNames[w], result.frames, result.failed, result.firmware / count, result.reference / count, meanError, result.maxError, expected, allowed);
+				for (uint8_t b=0; b<BAND_COUNT; b++) fprintf(csv, ",%.3f,%.3f", result.bandError[b] / count, result.bandMax[b]);
+				fprintf(csv, ",%.0f,%.0f\n", result.firmwareMicros / frames, result.referenceMicros / count);
+			}
+
+			if (result.failed || fabs(result.worstError - expected) > allowed || fabs(meanError - expected) > tolerance) {
+				printf("  FAILED: %u frames without reading, frame error %.2f dB, mean error %.2f dB (expected %.2f, tolerance %.2f per frame and %.2f on the mean)\n", result.failed, result.worstError, meanError, expected, allowed, tolerance);
+				failed = true;
+			}
+		}
+	}
+	if (csv) fclose(csv);
+
+	printf("\nBand columns are the mean difference in dB with the reference on every octave band\n");
+	return failed ? 1 : 0;
+}
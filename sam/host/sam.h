@@ -0,0 +1,123 @@
+#pragma once
+
+// SAMD21 registers used by the firmware, as plain memory (see Arduino.h).
+// Writes are kept so tests can look at them, busy flags always read 0 and ready flags 1 so the firmware never waits for the hardware.
+
+#include <stdint.h>
+
+struct HostBusyBits { static const uint32_t SYNCBUSY = 0; };
+struct HostAdcFlags { static const uint8_t RESRDY = 1; };
+struct HostTcCtrla { static const uint16_t SWRST = 0; };
+struct HostTccBusyBits { static const uint32_t ENABLE = 0, WAVE = 0, PER = 0, CC0 = 0, CC1 = 0; };
+
+// Generic clocks
+struct HostGclk {
+	union { HostBusyBits bit; uint8_t reg; } STATUS;
+	union { uint16_t reg; } CLKCTRL;
+};
+
+// ADC
+struct HostAdc {
+	union { struct { uint8_t SWRST:1; uint8_t ENABLE:1; uint8_t RUNSTDBY:1; } bit; uint8_t reg; } CTRLA;
+	union { struct { uint32_t MUXPOS:5; uint32_t :3; uint32_t MUXNEG:5; } bit; uint32_t reg; } INPUTCTRL;
+	union { HostAdcFlags bit; uint8_t reg; } INTFLAG;
+	union { uint16_t reg; } RESULT; 			// Value returned by every conversion
+	union { HostBusyBits bit; uint8_t reg; } STATUS;
+	union { struct { uint8_t FLUSH:1; uint8_t START:1; } bit; uint8_t reg; } SWTRIG;
+};
+
+// Power manager
+struct HostPm {
+	union { uint8_t reg; } RCAUSE;
+};
+
+// Ports
+struct HostPortGroup {
+	union { struct { uint8_t PMUXEN:1; uint8_t INEN:1; uint8_t PULLEN:1; } bit; uint8_t reg; } PINCFG[32];
+	union { uint8_t reg; } PMUX[16];
+};
+struct HostPort {
+	HostPortGroup Group[2];
+};
+#define PORTA 0
+#define PORTB 1
+
+// Timers
+struct HostTcCount16 {
+	union { HostTcCtrla bit; uint16_t reg; } CTRLA;
+	union { struct { uint8_t OVF:1; uint8_t ERR:1; uint8_t :1; uint8_t SYNCRDY:1; uint8_t MC0:1; uint8_t MC1:1; } bit; uint8_t reg; } INTENSET;
+	union { struct { uint8_t OVF:1; uint8_t ERR:1; uint8_t :1; uint8_t SYNCRDY:1; uint8_t MC0:1; uint8_t MC1:1; } bit; uint8_t reg; } INTFLAG;
+	union { HostBusyBits bit; uint8_t reg; } STATUS;
+	union { uint16_t reg; } CC[2];
+};
+struct HostTc {
+	HostTcCount16 COUNT16;
+};
+struct HostTcc {
+	union { uint32_t reg; } CTRLA;
+	union { HostTccBusyBits bit; uint32_t reg; } SYNCBUSY;
+};
+
+extern HostGclk hostGclk;
+extern HostAdc hostAdc;
+extern HostPm hostPm;
+extern HostPort hostPort;
+extern HostTc hostTc5;
+extern HostTcc hostTcc1;
+
+#define GCLK (&hostGclk)
+#define ADC (&hostAdc)
+#define PM (&hostPm)
+#define PORT (&hostPort)
+#define TC5 (&hostTc5)
+#define TCC1 (&hostTcc1)
+
+// Registers the firmware writes through the REG_ names
+extern uint32_t REG_GCLK_GENCTRL, REG_GCLK_GENDIV, REG_GCLK_CLKCTRL;
+extern uint32_t REG_TCC1_WAVE, REG_TCC1_PER, REG_TCC1_CC0, REG_TCC1_CC1, REG_TCC1_CTRLA;
+
+#define GCLK_CLKCTRL_ID(value) ((value) & 0x3F)
+#define GCLK_CLKCTRL_GEN_GCLK0 (0x0 << 8)
+#define GCLK_CLKCTRL_GEN_GCLK4 (0x4 << 8)
+#define GCLK_CLKCTRL_CLKEN (0x1 << 14)
+#define GCLK_CLKCTRL_ID_TCC0_TCC1 0x1A
+#define GCM_TC4_TC5 0x1C
+#define GCLK_GENCTRL_ID(value) ((value) & 0xF)
+#define GCLK_GENCTRL_SRC_DFLL48M (0x7 << 8)
+#define GCLK_GENCTRL_GENEN (0x1 << 16)
+#define GCLK_GENCTRL_IDC (0x1 << 17)
+#define GCLK_GENDIV_ID(value) ((value) & 0xF)
+#define GCLK_GENDIV_DIV(value) (((value) & 0xFFFF) << 8)
+
+#define ADC_INTFLAG_RESRDY 0x1
+#define ADC_INPUTCTRL_MUXPOS_PIN6 6
+#define ADC_Channel6 6
+
+#define PORT_PMUX_PMUXE_F 0x5
+#define PORT_PMUX_PMUXO_F (0x5 << 4)
+
+#define TC_CTRLA_SWRST 0x1
+#define TC_CTRLA_ENABLE 0x2
+#define TC_CTRLA_MODE_COUNT16 (0x0 << 2)
+#define TC_CTRLA_WAVEGEN_MFRQ (0x1 << 5)
+#define TC_CTRLA_PRESCALER_DIV1024 (0x7 << 8)
+#define TC_STATUS_SYNCBUSY 0x80
+
+#define TCC_CTRLA_ENABLE 0x2
+#define TCC_CTRLA_PRESCALER_DIV1 (0x0 << 8)
+#define TCC_CTRLA_PRESCALER_DIV2 (0x1 << 8)
+#define TCC_CTRLA_PRESCALER_DIV4 (0x2 << 8)
+#define TCC_CTRLA_PRESCALER_DIV8 (0x3 << 8)
+#define TCC_CTRLA_PRESCALER_DIV16 (0x4 << 8)
+#define TCC_CTRLA_PRESCALER_DIV64 (0x5 << 8)
+#define TCC_CTRLA_PRESCALER_DIV256 (0x6 << 8)
+#define TCC_CTRLA_PRESCALER_DIV1024 (0x7 << 8)
+#define TCC_SYNCBUSY_MASK 0xFFFFFFFF
+#define TCC_WAVE_WAVEGEN_NPWM 0x2
+
+// Interrupts
+enum IRQn_Type { TC5_IRQn = 20 };
+inline void NVIC_EnableIRQ(IRQn_Type irq) {}
+inline void NVIC_DisableIRQ(IRQn_Type irq) {}
+inline void NVIC_ClearPendingIRQ(IRQn_Type irq) {}
+inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {}
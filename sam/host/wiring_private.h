@@ -0,0 +1,9 @@
+#pragma once
+
+// Pin multiplexing for the host build: the selected function is only remembered (see hostPins.mode)
+
+#include <Arduino.h>
+
+enum EPioType { PIO_NOT_A_PIN=-1, PIO_EXTINT=0, PIO_ANALOG, PIO_SERCOM, PIO_SERCOM_ALT, PIO_TIMER, PIO_TIMER_ALT, PIO_COM, PIO_AC_CLK, PIO_DIGITAL, PIO_INPUT, PIO_INPUT_PULLUP, PIO_OUTPUT };
+
+inline int pinPeripheral(uint32_t pin, EPioType peripheral) { return pin < HostPins::COUNT ? 0 : -1; }
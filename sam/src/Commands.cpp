@@ -1,5 +1,6 @@
 #include "Commands.h"
 #include "SckBase.h"
+#include "SckStream.h"
 
 
 void AllCommands::in(SckBase* base, String strIn)
@@ -13,25 +14,14 @@ void AllCommands::in(SckBase* base, String strIn)
 		return;
 	}
 
-	CommandType reqComm = COM_COUNT;
+	// Search in the command list (case insensitive, the parameters follow the command name)
+	CommandType reqComm = static_cast<CommandType>(titles.prefixOf(strIn.c_str(), min(strIn.length(), 255U)));
 
-	// Search in the command list
-	for (uint8_t i=0; i < COM_COUNT; ++i) {
-
-		CommandType thisType = static_cast<CommandType>(i);
-
-		OneCom *thisCommand = &com_list[thisType];
-
-		if (strIn.startsWith(thisCommand->title)) {
-			reqComm = thisType;
-			strIn.replace(thisCommand->title, "");
-			strIn.trim();
-			break;
-		}
-	}
-
-	if (reqComm < COM_COUNT) com_list[reqComm].function(base, strIn);
-	else base->sckOut("Unrecognized command!!");
+	if (reqComm < COM_COUNT) {
+		strIn.remove(0, strlen(com_list[reqComm].title));
+		strIn.trim();
+		com_list[reqComm].function(base, strIn);
+	} else base->sckOut("Unrecognized command!!");
 }
 void AllCommands::wildCard(SckBase* base, String strIn)
 {
@@ -143,7 +133,7 @@ void sensorConfig_com(SckBase* base, String parameters)
 
 			thisType = base->sensors.sensorsPriorized(i);
 
-			if (!base->sensors[thisType].enabled) base->sckOut(base->sensors[thisType].title);
+			if (!base->sensors[thisType].enabled) base->sckOut(base->sensors.info(thisType).title);
 		}
 
 		sprintf(base->outBuff, "\r\nEnabled\r\n----------");
@@ -152,7 +142,7 @@ void sensorConfig_com(SckBase* base, String parameters)
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 
 			thisType = base->sensors.sensorsPriorized(i);
-			if (base->sensors[thisType].enabled) base->sckOut(String(base->sensors[thisType].title) + " (" + String(base->sensors[thisType].everyNint * base->config.readInterval) + " sec)");
+			if (base->sensors[thisType].enabled) base->sckOut(String(base->sensors.info(thisType).title) + " (" + String(base->sensors[thisType].everyNint * base->config.readInterval) + " sec)");
 		}
 
 	} else {
@@ -165,7 +155,7 @@ void sensorConfig_com(SckBase* base, String parameters)
 			return;
 		} else if (parameters.indexOf("-enable") >=0) {
 			if (!base->enableSensor(sensorToChange)) {
-				sprintf(base->outBuff, "Failed enabling %s", base->sensors[sensorToChange].title);
+				sprintf(base->outBuff, "Failed enabling %s", base->sensors.info(sensorToChange).title);
 				base->sckOut();
 			} else {
 				// Enable extra sensors for PM
@@ -220,7 +210,7 @@ void sensorConfig_com(SckBase* base, String parameters)
 			}
 		} else if (parameters.indexOf("-disable") >=0) {
 			if (!base->disableSensor(sensorToChange)) {
-				sprintf(base->outBuff, "Failed disabling %s", base->sensors[sensorToChange].title);
+				sprintf(base->outBuff, "Failed disabling %s", base->sensors.info(sensorToChange).title);
 				base->sckOut();
 			} else {
 				// Enable extra sensors for PM
@@ -283,7 +273,7 @@ void sensorConfig_com(SckBase* base, String parameters)
 			uint8_t everyNint_pre = intervalInt / base->config.readInterval;
 			if (everyNint_pre > 0 && everyNint_pre < 255) {
 				base->sensors[sensorToChange].everyNint = everyNint_pre;
-				base->sckOut(msg + String(base->sensors[sensorToChange].title));
+				base->sckOut(msg + String(base->sensors.info(sensorToChange).title));
 			} else {
 				base->sckOut("Wrong new interval!!!");
 			}
@@ -294,16 +284,17 @@ void sensorConfig_com(SckBase* base, String parameters)
 void readSensor_com(SckBase* base, String parameters)
 {
 	SensorType wichType = base->sensors.getTypeFromString(parameters);
-	OneSensor sensorToRead = base->sensors[wichType];
+	const SensorInfo &info = base->sensors.info(wichType);
+	OneSensor sensorToRead(wichType);
 
-	if (!sensorToRead.enabled) {
-		sprintf(base->outBuff, "%s sensor is disabled!!!", sensorToRead.title);
+	if (!base->sensors[wichType].enabled) {
+		sprintf(base->outBuff, "%s sensor is disabled!!!", info.title);
 		base->sckOut();
 		return;
 	} else base->getReading(&sensorToRead);
 
-	if (sensorToRead.state == 0) sprintf(base->outBuff, "%s: %s %s", sensorToRead.title, sensorToRead.reading.c_str(), sensorToRead.unit);
-	else if (sensorToRead.state == -1) sprintf(base->outBuff, "ERROR reading %s sensor!!!", sensorToRead.title);
+	if (sensorToRead.state == 0) sprintf(base->outBuff, "%s: %s %s", info.title, sensorToRead.reading.format(base->valueBuff), info.unit);
+	else if (sensorToRead.state == -1) sprintf(base->outBuff, "ERROR reading %s sensor!!!", info.title);
 	else sprintf(base->outBuff, "Your reading will be ready in %i seconds try again!!", sensorToRead.state);
 	base->sckOut();
 }
@@ -328,8 +319,38 @@ void monitorSensor_com(SckBase* base, String parameters)
 	bool sdSave = false;
 	bool printTime = true;
 	bool printMs = true;
+	bool binary = false;
+	bool cobs = true;
+	bool raw = false;
+	uint8_t rawChannels = 0;
 
+	// The sensor each raw channel comes from (it has to be enabled, so its driver is started)
+	const SensorType rawSensors[RAW_COUNT] = { SENSOR_NOISE_DBA, SENSOR_CO_RESISTANCE, SENSOR_NO2_RESISTANCE, SENSOR_PM_25 };
+
+	if (parameters.indexOf("-binary") >=0) {
+		binary = true;
+		parameters.replace("-binary", "");
+		parameters.trim();
+	}
+	if (parameters.indexOf("-raw") >=0) {
+		if (!binary) {
+			base->sckOut("ERROR raw driver data can only be sent as a binary stream (-binary -raw)!!!");
+			return;
+		}
+		raw = true;
+		parameters.replace("-raw", "");
+		parameters.trim();
+	}
+	if (parameters.indexOf("-nocobs") >=0) {
+		cobs = false;
+		parameters.replace("-nocobs", "");
+		parameters.trim();
+	}
 	if (parameters.indexOf("-sd") >=0) {
+		if (binary) {
+			base->sckOut("ERROR binary stream can't be saved to sd card!!!");
+			return;
+		}
 		sdSave = true;
 		parameters.replace("-sd", "");
 		parameters.trim();
@@ -337,7 +358,10 @@ void monitorSensor_com(SckBase* base, String parameters)
 			base->sckOut("ERROR No sd card found!!!");
 			return;
 		}
-		base->monitorFile.file = base->sd.open(base->monitorFile.name, FILE_WRITE);
+		if (!base->sdSelect() || !base->sdWriter.open(base->sd, base->monitorFileName)) {
+			base->sckOut("ERROR opening monitor file!!!");
+			return;
+		}
 	}
 	if (parameters.indexOf("-notime") >=0) {
 		printTime = false;
@@ -364,17 +388,37 @@ void monitorSensor_com(SckBase* base, String parameters)
 				parameters.trim();
 			}
 
+			if (raw) {
+				RawChannel thisChannel = SckStream::getRawChannel(thisSensor.c_str());
+				if (thisChannel == RAW_COUNT) {
+					sprintf(base->outBuff, "ERROR unknown raw channel %s (%s, %s, %s or %s)!!!", thisSensor.c_str(), SckStream::rawTitles[RAW_NOISE], SckStream::rawTitles[RAW_MICS_CO], SckStream::rawTitles[RAW_MICS_NO2], SckStream::rawTitles[RAW_PM]);
+					base->sckOut();
+					return;
+				}
+				if (!base->sensors[rawSensors[thisChannel]].enabled) {
+					sprintf(base->outBuff, "%s is disabled, enable it first!!!", base->sensors.info(rawSensors[thisChannel]).title);
+					base->sckOut();
+					return;
+				}
+				rawChannels |= 1 << thisChannel;
+				continue;
+			}
+
 			SensorType thisSensorType = base->sensors.getTypeFromString(thisSensor);
 
 			if (base->sensors[thisSensorType].enabled) {
 				sensorsToMonitor[index] = thisSensorType;
 				index ++;
 			} else {
-				sprintf(base->outBuff, "%s is disabled, enable it first!!!", base->sensors[thisSensorType].title);
+				sprintf(base->outBuff, "%s is disabled, enable it first!!!", base->sensors.info(thisSensorType).title);
 				base->sckOut();
 				return;
 			}
 		}
+	} else if (raw) {
+		for (uint8_t i=0; i<RAW_COUNT; i++) {
+			if (base->sensors[rawSensors[i]].enabled) rawChannels |= 1 << i;
+		}
 	} else {
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 			if (base->sensors[static_cast<SensorType>(i)].enabled) {
@@ -385,15 +429,68 @@ void monitorSensor_com(SckBase* base, String parameters)
 
 	}
 
+	// The command runs on the first line end, the second one of a \r\n would stop the monitor right away
+	while (SerialUSB.peek() == '\r' || SerialUSB.peek() == '\n') SerialUSB.read();
+
+	if (raw) {
+		if (rawChannels == 0) {
+			base->sckOut("ERROR no raw channel with its sensor enabled!!!");
+			return;
+		}
+
+		// Text header with the channels on the stream and their payload size, binary frames after the #START line (see SckStream.h)
+		uint8_t count = 0;
+		for (uint8_t i=0; i<RAW_COUNT; i++) if (rawChannels & (1 << i)) count++;
+		sprintf(base->outBuff, "#SCKSTREAM %u %s %u", SCKSTREAM_VERSION, cobs ? "cobs" : "raw", count);
+		SerialUSB.println(base->outBuff);
+		for (uint8_t i=0; i<RAW_COUNT; i++) {
+			if (!(rawChannels & (1 << i))) continue;
+			sprintf(base->outBuff, "#%u\traw\t%s\t%u\t%lu", i, SckStream::rawTitles[i], SckStream::rawSizes[i], (unsigned long)SckStream::rawRates[i]);
+			SerialUSB.println(base->outBuff);
+		}
+		SerialUSB.println("#START");
+
+		SckStream stream;
+		stream.begin(cobs);
+		if (!base->streamRaw(rawChannels, stream)) base->sckOut("ERROR starting the microphone!!!");
+		return;
+	}
+
+	if (binary) {
+		// Text header with the sensors on the stream, binary frames after the #START line (see SckStream.h)
+		sprintf(base->outBuff, "#SCKSTREAM %u %s %u", SCKSTREAM_VERSION, cobs ? "cobs" : "raw", index);
+		SerialUSB.println(base->outBuff);
+		for (uint8_t i=0; i<index; i++) {
+			const SensorInfo &info = base->sensors.info(sensorsToMonitor[i]);
+			sprintf(base->outBuff, "#%u\t%u\t%s\t%s", sensorsToMonitor[i], info.id, info.title, info.unit);
+			SerialUSB.println(base->outBuff);
+		}
+		SerialUSB.println("#START");
+
+		SckStream stream;
+		stream.begin(cobs);
+		uint8_t frameBuff[SCKSTREAM_MAX];
+		while (!SerialUSB.available()) {
+			for (uint8_t i=0; i<index; i++) {
+				OneSensor wichSensor(sensorsToMonitor[i]);
+				base->getReading(&wichSensor);
+				if (wichSensor.state != 0) wichSensor.reading = SensorValue();
+				uint8_t len = stream.frame(frameBuff, sensorsToMonitor[i], micros(), wichSensor.reading);
+				SerialUSB.write(frameBuff, len);
+			}
+		}
+		return;
+	}
+
 	// Titles
 	strncpy(base->outBuff, "", 240);
 	if (printTime) sprintf(base->outBuff, "%s\t", "Time");
 	if (printMs) sprintf(base->outBuff, "%s%s\t", base->outBuff, "Miliseconds");
 	for (uint8_t i=0; i<index; i++) {
-		sprintf(base->outBuff, "%s%s", base->outBuff, base->sensors[sensorsToMonitor[i]].title);
+		sprintf(base->outBuff, "%s%s", base->outBuff, base->sensors.info(sensorsToMonitor[i]).title);
 		if (i < index - 1) sprintf(base->outBuff, "%s\t", base->outBuff);
 	}
-	if (sdSave) base->monitorFile.file.println(base->outBuff);
+	if (sdSave) base->sdWriter.println(base->outBuff);
 	base->sckOut();
 
 	// Readings
@@ -407,16 +504,16 @@ void monitorSensor_com(SckBase* base, String parameters)
 		lastMillis = millis();
 		for (uint8_t i=0; i<index; i++) {
 			// TODO check what will happen here when one shot PM is implemented
-			OneSensor wichSensor = base->sensors[sensorsToMonitor[i]];
+			OneSensor wichSensor(sensorsToMonitor[i]);
 			base->getReading(&wichSensor);
-			if (wichSensor.state == 0) sprintf(base->outBuff, "%s%s", base->outBuff, wichSensor.reading.c_str());
+			if (wichSensor.state == 0) sprintf(base->outBuff, "%s%s", base->outBuff, wichSensor.reading.format(base->valueBuff));
 			else sprintf(base->outBuff, "%s%s", base->outBuff, "none");
 			if (i < index - 1) sprintf(base->outBuff, "%s\t", base->outBuff);
 		}
-		if (sdSave) base->monitorFile.file.println(base->outBuff);
+		if (sdSave) base->sdWriter.println(base->outBuff);
 		base->sckOut();
 	}
-	base->monitorFile.file.close();
+	if (sdSave) base->sdWriter.close();
 }
 void readings_com(SckBase* base, String parameters)
 {
@@ -447,7 +544,7 @@ void readings_com(SckBase* base, String parameters)
 			base->sckOut();
 			for (uint16_t re=0; re<readingsOnThisGroup; re++) {
 				OneReading thisReading = base->readingsList.readReading(thisGroup, re);
-				sprintf(base->outBuff, "%s: %s %s", base->sensors[thisReading.type].title, thisReading.value.c_str(), base->sensors[thisReading.type].unit);
+				sprintf(base->outBuff, "%s: %s %s", base->sensors.info(thisReading.type).title, thisReading.value.format(base->valueBuff), base->sensors.info(thisReading.type).unit);
 				base->sckOut();
 			}
 		}
@@ -458,13 +555,69 @@ void readings_com(SckBase* base, String parameters)
 	// TODO code for -publish option
 	/* base->publish(); */
 }
-extern "C" char *sbrk(int i);
+void export_com(SckBase* base, String parameters)
+{
+	SckList &list = base->readingsList;
+	uint32_t from = list.logStart();
+
+	// Resume an interrupted export
+	if (parameters.indexOf("-from") >=0) {
+		parameters.replace("-from", "");
+		parameters.trim();
+		from = strtoul(parameters.c_str(), NULL, 10);
+		if (from < list.logStart() || from > list.logEnd()) {
+			sprintf(base->outBuff, "ERROR address outside of the stored log (%lu - %lu)!!!", list.logStart(), list.logEnd());
+			base->sckOut();
+			return;
+		}
+	}
+
+	// Text header with the log limits and the sensors (to decode the readings), binary chunks after the #START line
+	sprintf(base->outBuff, "#SCKEXPORT %u %lu %lu %lu %lu", SCKSTREAM_VERSION, list.logStart(), list.logEnd(), from, list.usingFlash ? SCKLIST_SECTOR_SIZE : 1UL);
+	SerialUSB.println(base->outBuff);
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		const SensorInfo &info = base->sensors.info(static_cast<SensorType>(i));
+		sprintf(base->outBuff, "#%u\t%u\t%s\t%s", i, info.id, info.title, info.unit);
+		SerialUSB.println(base->outBuff);
+	}
+	SerialUSB.println("#START");
+
+	// Chunks: [address 4B][size 2B][log bytes][crc32 4B] little endian, the crc covers everything before it. A chunk without bytes ends the export.
+	uint8_t chunk[6 + SCKSTREAM_EXPORT_CHUNK + 4];
+	while (!SerialUSB.available()) {
+		uint16_t len = list.exportBytes(from, &chunk[6], SCKSTREAM_EXPORT_CHUNK);
+		for (uint8_t i=0; i<4; i++) chunk[i] = (from >> (8 * i)) & 0xFF;
+		chunk[4] = len & 0xFF;
+		chunk[5] = len >> 8;
+		uint32_t crc = SckStream::crc32(0, chunk, 6 + len);
+		for (uint8_t i=0; i<4; i++) chunk[6 + len + i] = (crc >> (8 * i)) & 0xFF;
+		SerialUSB.write(chunk, 6 + len + 4);
+
+		if (len == 0) break;
+		from += len;
+	}
+}
 void freeRAM_com(SckBase* base, String parameters)
 {
+	SckMemory &memory = base->memory;
+
+	uint16_t blocks = 0;
+	uint32_t largestFragment = 0;
+	uint32_t heapFree = memory.heapFree(&blocks, &largestFragment);
+	uint32_t free = memory.gap() + heapFree;
+
+	sprintf(base->outBuff, "Free RAM: %lu bytes (lowest: %lu bytes)", free, memory.minFree < free ? memory.minFree : free);
+	base->sckOut();
+
+	sprintf(base->outBuff, "Heap: %lu bytes free inside the heap in %u blocks (biggest %lu), largest block available %lu bytes", heapFree, blocks, largestFragment, memory.largestBlock());
+	base->sckOut();
+
+	sprintf(base->outBuff, "Stack: %lu bytes used at most, closest it got to the heap: %lu bytes", memory.stackUsed(), memory.headroom());
+	base->sckOut();
 
-	char stack_dummy = 0;
-	uint32_t free = &stack_dummy - sbrk(0);
-	sprintf(base->outBuff, "Free RAM: %lu bytes", free);
+	sprintf(base->outBuff, "Allocations:");
+	for (uint8_t i=0; i<PERF_COUNT; i++) sprintf(base->outBuff, "%s %s %lu,", base->outBuff, base->perf.titles[i], SckMemory::allocations[i]);
+	sprintf(base->outBuff, "%s frees %lu, failed %lu", base->outBuff, SckMemory::frees, SckMemory::failed);
 	base->sckOut();
 }
 void batt_com(SckBase* base, String parameters)
@@ -577,6 +730,12 @@ void charger_com(SckBase* base, String parameters)
 		sprintf(base->outBuff, "Charging safety timer: %u hours (0: disabled)", base->charger.chargeTimer());
 		base->sckOut();
 
+		sprintf(base->outBuff, "Power checks: %lu (%lu polls, %lu gauge events, %lu charger events)", base->powerStats.checks, base->powerStats.polls, base->powerStats.gaugeEvents, base->powerStats.chargerEvents);
+		base->sckOut();
+
+		sprintf(base->outBuff, "I2C transactions: %lu charger, %lu gauge, battery pin conversions: %lu", base->charger.i2cCount, base->battery.i2cCount, base->battery.adcCount);
+		base->sckOut();
+
 	// Set
 	} else {
 
@@ -624,6 +783,12 @@ void config_com(SckBase* base, String parameters)
 				uint32_t readIntV = readIntC.toInt();
 				if (readIntV >= minimal_publish_interval && readIntV <= base->config.publishInterval) base->config.readInterval = readIntV;
 			}
+			int16_t archiveI = parameters.indexOf("-archive");
+			if (archiveI >= 0) {
+				String archiveC = parameters.substring(archiveI+9);
+				if (archiveC.startsWith("on")) base->config.sdArchive = true;
+				else if (archiveC.startsWith("off")) base->config.sdArchive = false;
+			}
 			int16_t credI = parameters.indexOf("-wifi");
 			SerialUSB.println(credI);
 			if (credI >= 0) {
@@ -660,8 +825,11 @@ void config_com(SckBase* base, String parameters)
 
 	sprintf(base->outBuff, "%sMode: %s\r\nPublish interval: %lu\r\n", base->outBuff, base->modeTitles[currentConfig.mode], currentConfig.publishInterval);
 	sprintf(base->outBuff, "%sReading interval: %lu\r\n", base->outBuff, currentConfig.readInterval);
+	sprintf(base->outBuff, "%sSdcard archive: %s", base->outBuff, currentConfig.sdArchive ? "on" : "off");
+	base->sckOut();
 
-	sprintf(base->outBuff, "%sWifi credentials: ", base->outBuff);
+	// Credentials can take half of outBuff
+	sprintf(base->outBuff, "Wifi credentials: ");
 	if (currentConfig.credentials.set) sprintf(base->outBuff, "%s%s - %s\r\n", base->outBuff, currentConfig.credentials.ssid, currentConfig.credentials.pass);
 	else sprintf(base->outBuff, "%snot configured\r\n", base->outBuff);
 
@@ -681,7 +849,7 @@ void esp_com(SckBase* base, String parameters)
 	else if (parameters.startsWith("-flash")) {
 		parameters.replace("-flash ", "");
 		uint32_t speed = parameters.toInt();
-		if (speed >= 115200 && speed <= 921600) base->espFlashSpeed = speed;
+		if (speed >= 115200 && speed <= BRIDGE_MAX_BAUD) base->espFlashSpeed = speed;
 		base->ESPcontrol(base->ESP_FLASH);
 	} else if (parameters.equals("-sleep")) base->ESPcontrol(base->ESP_SLEEP);
 	else if (parameters.equals("-wake")) base->ESPcontrol(base->ESP_WAKEUP);
@@ -749,6 +917,11 @@ void debug_com(SckBase* base, String parameters)
 			sprintf(base->outBuff, "Reading list debug: %s", base->readingsList.debug ? "true" : "false");
 			base->sckOut();
 		}
+		if (parameters.indexOf("-journal") >= 0) {
+			base->journal.debug = ! base->journal.debug;
+			sprintf(base->outBuff, "Config journal debug: %s", base->journal.debug ? "true" : "false");
+			base->sckOut();
+		}
 
 	// Get
 	} else {
@@ -758,6 +931,14 @@ void debug_com(SckBase* base, String parameters)
 		base->sckOut();
 		sprintf(base->outBuff, "Readings list debug: %s", base->readingsList.debug ? "true" : "false");
 		base->sckOut();
+		sprintf(base->outBuff, "Config journal debug: %s", base->journal.debug ? "true" : "false");
+		base->sckOut();
+		sprintf(base->outBuff, "Sdcard writer: %lu flushes, %lu bytes written, %u bytes pending, last flush %u bytes in %lu us (max %lu us)", base->sdWriter.flushes, base->sdWriter.bytesWritten, base->sdWriter.pending(), base->sdWriter.lastFlushBytes, base->sdWriter.lastFlushMicros, base->sdWriter.maxFlushMicros);
+		base->sckOut();
+		if (base->journal.ready) {
+			sprintf(base->outBuff, "Config journal: %u keys, %u/%u bytes used, %lu writes, %lu skipped, %lu compactions", base->journal.countKeys(), base->journal.usedBytes(), SCKJOURNAL_SECTOR_SIZE, base->journal.recordsWritten, base->journal.writesSkipped, base->journal.compactions);
+			base->sckOut();
+		}
 	}
 }
 void shell_com(SckBase* base, String parameters)
@@ -782,3 +963,135 @@ void custom_mqtt_com(SckBase* base, String parameters)
 	int16_t mfourth = parameters.indexOf("'", mthird + 1);
 	base->mqttCustom(parameters.substring(mfirst + 1, msecond).c_str(), parameters.substring(mthird + 1, mfourth).c_str());
 }
+void sleep_com(SckBase* base, String parameters)
+{
+	if (parameters.indexOf("-tick") >= 0) base->tickSleep = true;
+	else if (parameters.indexOf("-scheduled") >= 0) base->tickSleep = false;
+	if (parameters.indexOf("-reset") >= 0) {
+		SckBase::SleepStats emptyStats;
+		base->sleepStats = emptyStats;
+		base->lastWakeMillis = 0;
+	}
+
+	SckBase::SleepStats &stats = base->sleepStats;
+	uint32_t elapsed = stats.sleptSeconds + (stats.awakeMillis / 1000);
+
+	sprintf(base->outBuff, "Sleep mode: %s\r\n", base->tickSleep ? "fixed tick" : "until next deadline");
+	sprintf(base->outBuff, "%sWake ups: %lu (%.1f per hour), slept %lu s\r\n", base->outBuff, stats.wakeups, elapsed > 0 ? (stats.wakeups * 3600.0) / elapsed : 0, stats.sleptSeconds);
+	sprintf(base->outBuff, "%sAverage awake time: %lu ms\r\n", base->outBuff, stats.awakeCycles > 0 ? stats.awakeMillis / stats.awakeCycles : 0);
+	sprintf(base->outBuff, "%sWoken up by: reading %lu, publish %lu, led %lu, reset %lu, tick %lu, interrupt %lu", base->outBuff, stats.reasons[base->WAKE_READING], stats.reasons[base->WAKE_PUBLISH], stats.reasons[base->WAKE_HEARTBEAT], stats.reasons[base->WAKE_RESET], stats.reasons[base->WAKE_FIXED], stats.early);
+	base->sckOut();
+}
+void energy_com(SckBase* base, String parameters)
+{
+	SckEnergy &energy = base->energy;
+	energy.flush();
+
+	EnergyDay *days[2] = {&energy.today, &energy.yesterday};
+	const char *dayTitles[2] = {"Today", "Yesterday"};
+
+	for (uint8_t d=0; d<2; d++) {
+		EnergyDay &thisDay = *days[d];
+		if (d > 0 && thisDay.day == 0) break;
+
+		char date[21] = "clock not synced";
+		if (thisDay.day > 0) {
+			base->epoch2iso(thisDay.day * 86400, date);
+			date[10] = 0;
+		}
+
+		sprintf(base->outBuff, "%s (%s): %.1f mAh", dayTitles[d], date, energy.totalmAh(thisDay));
+		base->sckOut();
+
+		for (uint8_t i=0; i<ENERGY_COUNT; i++) {
+			EnergyDomain wichDomain = static_cast<EnergyDomain>(i);
+			sprintf(base->outBuff, "  %s: %.2f mAh (on for %.2f hours)", energy.titles[i], energy.mAh(thisDay, wichDomain), thisDay.onMillis[i] / 3600000.0);
+			base->sckOut();
+		}
+
+		if (thisDay.gaugeUsed >= energy.GAUGE_MIN_MAH) sprintf(base->outBuff, "  Gauge measured %lu mAh on battery vs %.1f mAh estimated (values scaled by %.2f)", thisDay.gaugeUsed, thisDay.gaugeEstimated / 3600000.0, energy.ratio(thisDay));
+		else sprintf(base->outBuff, "  Gauge measured %lu mAh on battery, not enough to scale the estimates", thisDay.gaugeUsed);
+		base->sckOut();
+	}
+}
+void perf_com(SckBase* base, String parameters)
+{
+	SckPerf &perf = base->perf;
+
+	if (parameters.indexOf("-reset") >= 0) perf.reset();
+
+	int16_t infoI = parameters.indexOf("-info");
+	if (infoI >= 0) {
+		String infoC = parameters.substring(infoI+6);
+		infoC.trim();
+		base->perfInfoInterval = infoC.toInt();
+		base->lastInfoTime = base->rtc.getEpoch();
+	}
+
+	base->sckOut("Stage\tcount\tavg us\tmax us\t<100us\t<1ms\t<10ms\t<100ms\t<1s\t>=1s");
+	for (uint8_t i=0; i<PERF_COUNT; i++) {
+		SckPerf::StageStats &stats = perf.stages[i];
+		sprintf(base->outBuff, "%s\t%lu\t%lu\t%lu", perf.titles[i], stats.count, stats.count > 0 ? (uint32_t)(stats.totalMicros / stats.count) : 0, stats.maxMicros);
+		for (uint8_t b=0; b<SCKPERF_BUCKETS; b++) sprintf(base->outBuff, "%s\t%lu", base->outBuff, stats.buckets[b]);
+		base->sckOut();
+	}
+
+	sprintf(base->outBuff, "Stalls over %lu ms: %lu", (uint32_t)SCKPERF_STALL_MICROS / 1000, perf.stallCount);
+	base->sckOut();
+
+	// Newest first
+	for (uint8_t i=0; i<perf.stallsStored; i++) {
+		SckPerf::Stall &stall = perf.stalls[(perf.stallIndex + SCKPERF_STALLS - 1 - i) % SCKPERF_STALLS];
+		base->epoch2iso(stall.time, base->ISOtimeBuff);
+		sprintf(base->outBuff, "  %s %s %lu ms", base->ISOtimeBuff, perf.titles[stall.stage], stall.micros / 1000);
+		base->sckOut();
+	}
+
+	if (base->perfInfoInterval > 0) sprintf(base->outBuff, "Info publish with loop stats every %u hours", base->perfInfoInterval);
+	else sprintf(base->outBuff, "Loop stats are published with the info message after booting");
+	base->sckOut();
+}
+void trace_com(SckBase* base, String parameters)
+{
+	SckTrace &trace = base->trace;
+	const char *streamTitles[TRACE_RECORD_COUNT] = { "", "pm", "i2c", "i2s", "bus" };
+
+	if (!trace.recording()) {
+		int16_t onlyI = parameters.indexOf("-only");
+		if (onlyI >= 0) {
+			String onlyC = parameters.substring(onlyI+6);
+			onlyC.trim();
+			if (onlyC.indexOf(" ") > 0) onlyC = onlyC.substring(0, onlyC.indexOf(" "));
+			trace.streams = 0;
+			for (uint8_t i=1; i<TRACE_RECORD_COUNT; i++) if (onlyC.indexOf(streamTitles[i]) >= 0) trace.streams |= 1 << i;
+		}
+
+		int16_t i2sI = parameters.indexOf("-i2s");
+		if (i2sI >= 0) {
+			String i2sC = parameters.substring(i2sI+5);
+			i2sC.trim();
+			trace.i2sDecimation = constrain(i2sC.toInt(), 1, 255);
+		}
+	}
+
+	if (parameters.indexOf("-start") >= 0) {
+		if (trace.recording()) base->sckOut("Already recording");
+		else if (!base->sdSelect() || !trace.start(base->sd, base->SAMversion.c_str())) base->sckOut("ERROR: can't start the recording (is there an sdcard?)");
+	}
+	if (parameters.indexOf("-stop") >= 0 && trace.recording()) {
+		if (!base->sdSelect() || !trace.stop()) base->sckOut("ERROR: the last records could not be written");
+	}
+
+	if (trace.recording()) sprintf(base->outBuff, "Recording on %s for %lu seconds", trace.fileName, base->rtc.getEpoch() - trace.started);
+	else if (trace.fileName[0]) sprintf(base->outBuff, "Not recording, last recording on %s", trace.fileName);
+	else sprintf(base->outBuff, "Not recording");
+	base->sckOut();
+
+	sprintf(base->outBuff, "Streams:");
+	for (uint8_t i=1; i<TRACE_RECORD_COUNT; i++) {
+		if (trace.streams & (1 << i)) sprintf(base->outBuff, "%s %s (%lu records)", base->outBuff, streamTitles[i], trace.records[i]);
+	}
+	base->sckOut();
+	sprintf(base->outBuff, "One of every %u noise readings, %lu bytes written, %lu records dropped", trace.i2sDecimation, trace.bytes, trace.dropped);
+	base->sckOut();
+}
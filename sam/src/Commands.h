@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <Wire.h>
+#include <NameIndex.h>
 
 extern TwoWire auxWire;
 
@@ -21,6 +22,7 @@ enum CommandType {
 	COM_CONTROL_SENSOR,
 	COM_MONITOR_SENSOR,
 	COM_READINGS,
+	COM_EXPORT,
 	COM_GET_FREERAM,
 	COM_BATT,
 	COM_I2C_DETECT,
@@ -34,6 +36,10 @@ enum CommandType {
 	COM_DEBUG,
 	COM_SHELL,
 	COM_CUSTOM_MQTT,
+	COM_SLEEP,
+	COM_ENERGY,
+	COM_PERF,
+	COM_TRACE,
 
 	COM_COUNT
 };
@@ -50,6 +56,7 @@ void readSensor_com(SckBase* base, String parameters);
 void controlSensor_com(SckBase* base, String parameters);
 void monitorSensor_com(SckBase* base, String parameters);
 void readings_com(SckBase* base, String parameters);
+void export_com(SckBase* base, String parameters);
 void freeRAM_com(SckBase* base, String parameters);
 void batt_com(SckBase* base, String parameters);
 void i2cDetect_com(SckBase* base, String parameters);
@@ -63,6 +70,10 @@ void hello_com(SckBase* base, String parameters);
 void debug_com(SckBase* base, String parameters);
 void shell_com(SckBase* base, String parameters);
 void custom_mqtt_com(SckBase* base, String parameters);
+void sleep_com(SckBase* base, String parameters);
+void energy_com(SckBase* base, String parameters);
+void perf_com(SckBase* base, String parameters);
+void trace_com(SckBase* base, String parameters);
 void ramGet_com(SckBase* base, String parameters);
 
 typedef void (*com_function)(SckBase* , String);
@@ -99,21 +110,26 @@ class AllCommands {
 			OneCom {80,	COM_LIST_SENSOR,	"sensor",	"Shows/sets enabled/disabled sensor [-enable or -disable sensor-name] or [-interval sensor-name interval(seconds)]",			sensorConfig_com},
 			OneCom {90,	COM_READ_SENSOR,	"read",		"Reads sensor [sensorName]",														readSensor_com},
 			OneCom {90,	COM_CONTROL_SENSOR,	"control",	"Control sensor [sensorName] [command]",												controlSensor_com},
-			OneCom {90,	COM_MONITOR_SENSOR,	"monitor",	"Continously read sensor [-sd] [-notime] [-noms] [sensorName[,sensorNameN]]",								monitorSensor_com},
+			OneCom {90,	COM_MONITOR_SENSOR,	"monitor",	"Continously read sensor [-sd] [-notime] [-noms] [-binary [-nocobs] [-raw]] [sensorName[,sensorNameN] | rawChannel[,rawChannelN]]",								monitorSensor_com},
 			OneCom {90,	COM_READINGS,		"saved",	"Shows locally stored sensor readings [-details] [-publish]",											readings_com},
-			OneCom {90,	COM_GET_FREERAM,	"free",		"Shows the amount of free RAM memory",													freeRAM_com},
+			OneCom {90,	COM_EXPORT,		"export",	"Binary dump of the stored readings for tools/sck.py export [-from address]",								export_com},
+			OneCom {90,	COM_GET_FREERAM,	"free",		"Shows free RAM, heap fragmentation, stack use and allocations",													freeRAM_com},
 			OneCom {90,	COM_BATT, 		"batt",		"Shows/set the battery state [-cap mAh]",														batt_com},
 			OneCom {90,	COM_I2C_DETECT,		"i2c",		"Search the I2C bus for devices",													i2cDetect_com},
 			OneCom {90,	COM_CHARGER,		"charger",	"Controls or shows charger configuration [-otg on/off] [-charge on/off]",								charger_com},
-			OneCom {90,	COM_CONFIG,		"config",	"Shows/sets configuration [-defaults] [-mode sdcard/network] [-pubint seconds] [-readint seconds] [-wifi \"ssid\" [\"pass\"]] [-token token]", config_com},
+			OneCom {90,	COM_CONFIG,		"config",	"Shows/sets configuration [-defaults] [-mode sdcard/network] [-pubint seconds] [-readint seconds] [-archive on/off] [-wifi \"ssid\" [\"pass\"]] [-token token]", config_com},
 			OneCom {100,	COM_ESP_CONTROL,	"esp",		"Controls or shows info from ESP [-on -off -sleep -wake -reboot -flash]",								esp_com},
 			OneCom {100,	COM_NETINFO,		"netinfo",	"Shows network information",														netInfo_com},
 			OneCom {100,	COM_TIME,		"time",		"Shows/sets time [epoch time] [-sync]",													time_com},
 			OneCom {100,	COM_STATE,		"state",	"Shows state flags",															state_com},
 			OneCom {100,	COM_HELLO,		"hello",	"Sends MQTT hello to platform",														hello_com},
-			OneCom {100,	COM_DEBUG, 		"debug", 	"Toggle debug messages [-sdcard] [-espcom] [-list]", 												debug_com},
+			OneCom {100,	COM_DEBUG, 		"debug", 	"Toggle debug messages [-sdcard] [-espcom] [-list] [-journal]", 												debug_com},
 			OneCom {100,	COM_SHELL, 		"shell", 	"Shows or sets shell mode [-on] [-off]",												shell_com},
 			OneCom {100,	COM_CUSTOM_MQTT,	"mqtt", 	"Publish custom mqtt message ('topic' 'message')",											custom_mqtt_com},
+			OneCom {100,	COM_SLEEP,		"sleep", 	"Shows sleep stats or sets sleep mode [-scheduled] [-tick] [-reset]",									sleep_com},
+			OneCom {100,	COM_ENERGY,		"energy", 	"Shows estimated consumption of each subsystem for today and yesterday",									energy_com},
+			OneCom {100,	COM_PERF,		"perf", 	"Shows main loop timing and stalls [-reset] [-info hours (periodic info publish, 0: off)]",						perf_com},
+			OneCom {100,	COM_TRACE,		"trace", 	"Records the raw inputs of the drivers on the sdcard to replay them on the native build [-start] [-stop] [-only pm,i2c,i2s,bus] [-i2s decimation]",		trace_com},
 		};
 
 		OneCom & operator[](CommandType type) {
@@ -124,5 +140,10 @@ class AllCommands {
 		void wildCard(SckBase* base, String strIn);
 
 	private:
+		static const char *comTitle(const void *table, uint8_t item) {
+			return ((const OneCom *)table)[item].title;
+		}
+		uint8_t titleOrder[COM_COUNT];
+		NameIndex titles = NameIndex(titleOrder, COM_COUNT, comTitle, com_list);
 
 };
@@ -0,0 +1,276 @@
+#include "SckArchive.h"
+
+static const char indexMagic[4] = {'S', 'C', 'K', 'I'};
+static const char headerMagic[4] = {'S', 'C', 'K', 'H'};
+static const char dataMagic[4] = {'S', 'C', 'K', 'D'};
+static const uint16_t HEADER_FIXED_SIZE = 16;
+static const uint16_t DATA_HEADER_SIZE = 8;
+
+bool SckArchive::open(SdFat &sd, AllSensors &sensors, const char *wichFile, uint32_t time)
+{
+	if (isOpen) close();
+
+	buildLayout(sensors);
+	if (columns == 0) return false;
+
+	bool sameFile = strncmp(fileName, wichFile, sizeof(fileName)) == 0;
+
+	file = sd.open(wichFile, O_RDWR | O_CREAT);
+	if (!file) {
+		debugOut("Archive: can't open file!");
+		return false;
+	}
+	isOpen = true;
+	strncpy(fileName, wichFile, sizeof(fileName) - 1);
+
+	uint32_t fileSize = file.size();
+
+	// The cached block is only used if the file didn't change since we wrote it (the card could have been replaced)
+	if (!sameFile || fileSize != (blockNumber + 1) * SCKARCHIVE_BLOCK_SIZE) blockValid = false;
+
+	bool result = true;
+	if (fileSize == 0) result = create(sensors, time);
+	else if (!blockValid) result = load();
+
+	// Enabled sensors changed: append a new segment
+	if (result && index.layout != layout) {
+		debugOut("Archive: sensors changed, starting a new segment");
+		result = writeSegment(sensors, time, (file.size() + SCKARCHIVE_BLOCK_SIZE - 1) / SCKARCHIVE_BLOCK_SIZE);
+	}
+
+	if (!result) {
+		file.close();
+		isOpen = false;
+		blockValid = false;
+	}
+
+	return result;
+}
+bool SckArchive::append(uint32_t time)
+{
+	if (!isOpen || !blockValid) return false;
+
+	uint16_t records;
+	memcpy(&records, &block[4], 2);
+
+	// Records never cross a block boundary
+	if (DATA_HEADER_SIZE + (records + 1) * recordSize > SCKARCHIVE_BLOCK_SIZE) {
+		if (blockDirty && !writeBlock(blockNumber, block)) return false;
+		startDataBlock(blockNumber + 1);
+		records = 0;
+	}
+
+	uint8_t hour = (time % 86400) / 3600;
+	if (index.hourData[hour] == SCKARCHIVE_NONE) {
+		index.hourHeader[hour] = index.headerBlock;
+		index.hourData[hour] = blockNumber;
+		indexDirty = true;
+	}
+
+	recordIndex = DATA_HEADER_SIZE + records * recordSize;
+	memcpy(&block[recordIndex], &time, 4);
+	float missing = NAN;
+	for (uint8_t i=0; i<columns; i++) memcpy(&block[recordIndex + 4 + (i * 4)], &missing, 4);
+
+	records++;
+	memcpy(&block[4], &records, 2);
+	blockDirty = true;
+	recordsWritten++;
+
+	return true;
+}
+bool SckArchive::setValue(SensorType wichSensor, const SensorValue &value)
+{
+	if (!isOpen || !blockDirty || column[wichSensor] == 0xFF) return false;
+
+	// Null values are left as missing
+	if (value.isNull()) return false;
+
+	float number = value.toFloat();
+	memcpy(&block[recordIndex + 4 + (column[wichSensor] * 4)], &number, 4);
+
+	return true;
+}
+bool SckArchive::close()
+{
+	if (!isOpen) return false;
+
+	bool result = true;
+
+	if (blockDirty) {
+		result = writeBlock(blockNumber, block);
+		blockDirty = false;
+	}
+
+	// The index only changes once per hour or when a new segment starts
+	if (indexDirty) {
+		file.seek(0);
+		if (file.write((const uint8_t *)&index, sizeof(index)) != sizeof(index)) result = false;
+		indexDirty = false;
+	}
+
+	file.close();
+	isOpen = false;
+	if (!result) blockValid = false;
+
+	return result;
+}
+void SckArchive::buildLayout(AllSensors &sensors)
+{
+	columns = 0;
+	layout = 0xFFFF;
+	memset(column, 0xFF, sizeof(column));
+
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		SensorType wichSensor = sensors.sensorsPriorized(i);
+		if (sensors[wichSensor].enabled) {
+			column[wichSensor] = columns;
+			columns++;
+			layout = crc16(layout, wichSensor);
+		}
+	}
+
+	recordSize = 4 + (columns * 4);
+}
+bool SckArchive::create(AllSensors &sensors, uint32_t time)
+{
+	memset(&index, 0xFF, sizeof(index));
+	memcpy(index.magic, indexMagic, 4);
+	index.version = SCKARCHIVE_VERSION;
+	index.reserved = 0;
+
+	memset(block, 0xFF, SCKARCHIVE_BLOCK_SIZE);
+	memcpy(block, &index, sizeof(index));
+	if (!writeBlock(0, block)) return false;
+
+	debugOut("Archive: new file created");
+
+	return writeSegment(sensors, time, 1);
+}
+bool SckArchive::load()
+{
+	file.seek(0);
+	if (file.read(&index, sizeof(index)) != sizeof(index) || memcmp(index.magic, indexMagic, 4) != 0 || index.version != SCKARCHIVE_VERSION) {
+		debugOut("Archive: invalid file!");
+		return false;
+	}
+
+	uint32_t blocks = (file.size() + SCKARCHIVE_BLOCK_SIZE - 1) / SCKARCHIVE_BLOCK_SIZE;
+
+	// Keep filling the last data block if it has the current layout
+	if (blocks > 1 && index.layout == layout) {
+		memset(block, 0xFF, SCKARCHIVE_BLOCK_SIZE);
+		file.seek((blocks - 1) * SCKARCHIVE_BLOCK_SIZE);
+		file.read(block, SCKARCHIVE_BLOCK_SIZE);
+
+		uint16_t records, size;
+		memcpy(&records, &block[4], 2);
+		memcpy(&size, &block[6], 2);
+
+		if (memcmp(block, dataMagic, 4) == 0 && size == recordSize && DATA_HEADER_SIZE + (records * recordSize) <= SCKARCHIVE_BLOCK_SIZE) {
+			blockNumber = blocks - 1;
+			blockValid = true;
+			blockDirty = false;
+			return true;
+		}
+	}
+
+	startDataBlock(blocks);
+	return true;
+}
+bool SckArchive::writeSegment(AllSensors &sensors, uint32_t time, uint32_t wichBlock)
+{
+	uint16_t headerSize = HEADER_FIXED_SIZE;
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		SensorType wichSensor = sensors.sensorsPriorized(i);
+		if (column[wichSensor] != 0xFF) headerSize += 2 + strlen(sensors.info(wichSensor).shortTitle) + 1 + strlen(sensors.info(wichSensor).unit) + 1;
+	}
+	uint8_t headerBlocks = (headerSize + SCKARCHIVE_BLOCK_SIZE - 1) / SCKARCHIVE_BLOCK_SIZE;
+
+	uint8_t fixed[HEADER_FIXED_SIZE];
+	memcpy(fixed, headerMagic, 4);
+	fixed[4] = SCKARCHIVE_VERSION;
+	fixed[5] = columns;
+	fixed[6] = headerBlocks;
+	fixed[7] = 0;
+	memcpy(&fixed[8], &time, 4);
+	memcpy(&fixed[12], &recordSize, 2);
+	memcpy(&fixed[14], &layout, 2);
+
+	// The header is streamed through the block buffer
+	uint16_t pos = 0;
+	uint32_t thisBlock = wichBlock;
+	memset(block, 0, SCKARCHIVE_BLOCK_SIZE);
+	if (!putHeader(fixed, HEADER_FIXED_SIZE, pos, thisBlock)) return false;
+
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		SensorType wichSensor = sensors.sensorsPriorized(i);
+		if (column[wichSensor] == 0xFF) continue;
+
+		uint8_t typeId[2] = {(uint8_t)wichSensor, sensors.info(wichSensor).id};
+		if (!putHeader(typeId, 2, pos, thisBlock)) return false;
+		if (!putHeader((const uint8_t *)sensors.info(wichSensor).shortTitle, strlen(sensors.info(wichSensor).shortTitle) + 1, pos, thisBlock)) return false;
+		if (!putHeader((const uint8_t *)sensors.info(wichSensor).unit, strlen(sensors.info(wichSensor).unit) + 1, pos, thisBlock)) return false;
+	}
+	if (pos > 0 && !writeBlock(thisBlock, block)) return false;
+
+	index.layout = layout;
+	index.headerBlock = wichBlock;
+	indexDirty = true;
+
+	startDataBlock(wichBlock + headerBlocks);
+
+	return true;
+}
+bool SckArchive::putHeader(const uint8_t *data, uint16_t len, uint16_t &pos, uint32_t &wichBlock)
+{
+	for (uint16_t i=0; i<len; i++) {
+		block[pos++] = data[i];
+		if (pos == SCKARCHIVE_BLOCK_SIZE) {
+			if (!writeBlock(wichBlock, block)) return false;
+			wichBlock++;
+			pos = 0;
+			memset(block, 0, SCKARCHIVE_BLOCK_SIZE);
+		}
+	}
+	return true;
+}
+void SckArchive::startDataBlock(uint32_t wichBlock)
+{
+	memset(block, 0xFF, SCKARCHIVE_BLOCK_SIZE);
+	memcpy(block, dataMagic, 4);
+	uint16_t records = 0;
+	memcpy(&block[4], &records, 2);
+	memcpy(&block[6], &recordSize, 2);
+
+	blockNumber = wichBlock;
+	blockValid = true;
+	blockDirty = false;
+}
+bool SckArchive::writeBlock(uint32_t wichBlock, const uint8_t *data)
+{
+	uint32_t started = micros();
+	if (!file.seek(wichBlock * SCKARCHIVE_BLOCK_SIZE)) return false;
+	bool result = file.write(data, SCKARCHIVE_BLOCK_SIZE) == SCKARCHIVE_BLOCK_SIZE;
+	busyMicros += micros() - started;
+	if (!result) {
+		debugOut("Archive: error writing block!");
+		return false;
+	}
+	blocksWritten++;
+	return true;
+}
+uint16_t SckArchive::crc16(uint16_t crc, uint8_t data)
+{
+	// CRC-16/CCITT (polynomial 0x1021)
+	crc ^= (uint16_t)data << 8;
+	for (uint8_t b=0; b<8; b++) {
+		if (crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+		else crc <<= 1;
+	}
+	return crc;
+}
+void SckArchive::debugOut(const char *text)
+{
+	if (debug) SerialUSB.println(text);
+}
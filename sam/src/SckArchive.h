@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include "SdFat.h"
+
+#include "Sensors.h"
+
+// Binary daily archive written on the sdcard alongside the CSV files (one YY-MM-DD.SCK file per day).
+// The file is a sequence of 512 bytes blocks, every write covers a whole block so the card never has to merge partial sectors.
+//
+// Block 0 (index):	[SCKI][version][reserved][layout 2B][current header block 4B] [header block of each hour 4B]x24 [first data block of each hour 4B]x24
+// Header blocks:	[SCKH][version][columns][header blocks][reserved][created 4B][record size 2B][layout 2B] {[sensor type][sensor id][shortTitle\0][unit\0]}*
+// Data blocks:		[SCKD][records 2B][record size 2B] {[time 4B][value float 4B]x columns}*
+//
+// When the enabled sensors change a new segment (header blocks followed by data blocks) is appended to the same file, so there is no need to rename files.
+// Values are stored as floats in the CSV column order, missing or non numeric values are stored as NaN.
+// All numbers are little endian. tools/sckarchive.py converts the files to CSV.
+
+#define SCKARCHIVE_BLOCK_SIZE 512
+#define SCKARCHIVE_VERSION 1
+#define SCKARCHIVE_NONE 0xFFFFFFFF
+
+struct ArchiveIndex {
+	char magic[4];
+	uint8_t version;
+	uint8_t reserved;
+	uint16_t layout;
+	uint32_t headerBlock;
+	uint32_t hourHeader[24];
+	uint32_t hourData[24];
+};
+
+class SckArchive
+{
+	private:
+		File file;
+		char fileName[13] = "";
+		bool isOpen = false;
+
+		uint8_t block[SCKARCHIVE_BLOCK_SIZE]; 		// Last data block (it is kept between publishes so appending doesn't need to read the card)
+		uint32_t blockNumber = 0;
+		bool blockValid = false;
+		bool blockDirty = false;
+
+		ArchiveIndex index;
+		bool indexDirty = false;
+
+		// Current layout (enabled sensors in CSV order)
+		uint8_t column[SENSOR_COUNT]; 			// Column of each sensor type (0xFF if disabled)
+		uint8_t columns = 0;
+		uint16_t layout = 0;
+		uint16_t recordSize = 0;
+		uint16_t recordIndex = 0; 			// Start of the record being filled
+
+		void buildLayout(AllSensors &sensors);
+		bool load(); 						// Reads the index and the last block of an existing file
+		bool create(AllSensors &sensors, uint32_t time);
+		bool writeSegment(AllSensors &sensors, uint32_t time, uint32_t wichBlock);
+		bool putHeader(const uint8_t *data, uint16_t len, uint16_t &pos, uint32_t &wichBlock);
+		bool writeBlock(uint32_t wichBlock, const uint8_t *data);
+		void startDataBlock(uint32_t wichBlock);
+		uint16_t crc16(uint16_t crc, uint8_t data);
+		void debugOut(const char *msg);
+
+	public:
+		bool debug = false;
+
+		// Stats
+		uint32_t blocksWritten = 0;
+		uint32_t recordsWritten = 0;
+		uint32_t busyMicros = 0; 			// Total time spent writing blocks
+
+		bool open(SdFat &sd, AllSensors &sensors, const char *wichFile, uint32_t time); 	// Opens (or creates) the archive, starts a new segment if the enabled sensors changed
+		bool append(uint32_t time); 								// Starts a new record, all values are missing until they are set
+		bool setValue(SensorType wichSensor, const SensorValue &value);
+		bool close(); 										// Writes the pending blocks and closes the file
+};
@@ -180,30 +180,30 @@ void AuxBoards::getReading(OneSensor *wichSensor)
 {
 	wichSensor->state = 0;
 	switch (wichSensor->type) {
-		case SENSOR_GASESBOARD_SLOT_1A:	 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot1.electrode_A)); return;
-		case SENSOR_GASESBOARD_SLOT_1W: 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot1.electrode_W)); return;
-		case SENSOR_GASESBOARD_SLOT_2A: 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot2.electrode_A)); return;
-		case SENSOR_GASESBOARD_SLOT_2W: 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot2.electrode_W)); return;
-		case SENSOR_GASESBOARD_SLOT_3A: 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot3.electrode_A)); return;
-		case SENSOR_GASESBOARD_SLOT_3W: 	wichSensor->reading = String(gasBoard.getElectrode(gasBoard.Slot3.electrode_W)); return;
-		case SENSOR_GASESBOARD_HUMIDITY: 	wichSensor->reading = String(gasBoard.getHumidity()); return;
-		case SENSOR_GASESBOARD_TEMPERATURE: 	wichSensor->reading = String(gasBoard.getTemperature()); return;
-		case SENSOR_GROOVE_I2C_ADC: 		wichSensor->reading = String(grooveI2C_ADC.getReading()); return;
-		case SENSOR_INA219_BUSVOLT: 		wichSensor->reading = String(ina219.getReading(ina219.BUS_VOLT)); return;
-		case SENSOR_INA219_SHUNT: 		wichSensor->reading = String(ina219.getReading(ina219.SHUNT_VOLT)); return;
-		case SENSOR_INA219_CURRENT: 		wichSensor->reading = String(ina219.getReading(ina219.CURRENT)); return;
-		case SENSOR_INA219_LOADVOLT: 		wichSensor->reading = String(ina219.getReading(ina219.LOAD_VOLT)); return;
-		case SENSOR_WATER_TEMP_DS18B20:		wichSensor->reading = String(waterTemp_DS18B20.getReading()); return;
-		case SENSOR_ATLAS_TEMPERATURE: 		if (atlasTEMP.getReading()) 	{ wichSensor->reading = String(atlasTEMP.newReading); return; } break;
-		case SENSOR_ATLAS_PH:			if (atlasPH.getReading()) 	{ wichSensor->reading = String(atlasPH.newReading); return; } break;
-		case SENSOR_ATLAS_EC:			if (atlasEC.getReading()) 	{ wichSensor->reading = String(atlasEC.newReading); return; } break;
-		case SENSOR_ATLAS_EC_SG:		if (atlasEC.getReading()) 	{ wichSensor->reading = String(atlasEC.newReadingB); return; } break;
-		case SENSOR_ATLAS_DO:			if (atlasDO.getReading()) 	{ wichSensor->reading = String(atlasDO.newReading); return; } break;
-		case SENSOR_ATLAS_DO_SAT:		if (atlasDO.getReading()) 	{ wichSensor->reading = String(atlasDO.newReadingB); return; } break;
-		case SENSOR_CHIRP_MOISTURE_RAW:		if (moistureChirp.getReading(SENSOR_CHIRP_MOISTURE_RAW)) { wichSensor->reading = String(moistureChirp.raw); return; } break;
-		case SENSOR_CHIRP_MOISTURE:		if (moistureChirp.getReading(SENSOR_CHIRP_MOISTURE)) { wichSensor->reading = String(moistureChirp.moisture); return; } break;
-		case SENSOR_CHIRP_TEMPERATURE:		if (moistureChirp.getReading(SENSOR_CHIRP_TEMPERATURE)) { wichSensor->reading = String(moistureChirp.temperature); return; } break;
-		case SENSOR_CHIRP_LIGHT:		if (moistureChirp.getReading(SENSOR_CHIRP_LIGHT)) { wichSensor->reading = String(moistureChirp.light); return; } break;
+		case SENSOR_GASESBOARD_SLOT_1A:	 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot1.electrode_A); return;
+		case SENSOR_GASESBOARD_SLOT_1W: 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot1.electrode_W); return;
+		case SENSOR_GASESBOARD_SLOT_2A: 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot2.electrode_A); return;
+		case SENSOR_GASESBOARD_SLOT_2W: 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot2.electrode_W); return;
+		case SENSOR_GASESBOARD_SLOT_3A: 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot3.electrode_A); return;
+		case SENSOR_GASESBOARD_SLOT_3W: 	wichSensor->reading = gasBoard.getElectrode(gasBoard.Slot3.electrode_W); return;
+		case SENSOR_GASESBOARD_HUMIDITY: 	wichSensor->reading = gasBoard.getHumidity(); return;
+		case SENSOR_GASESBOARD_TEMPERATURE: 	wichSensor->reading = gasBoard.getTemperature(); return;
+		case SENSOR_GROOVE_I2C_ADC: 		wichSensor->reading = grooveI2C_ADC.getReading(); return;
+		case SENSOR_INA219_BUSVOLT: 		wichSensor->reading = ina219.getReading(ina219.BUS_VOLT); return;
+		case SENSOR_INA219_SHUNT: 		wichSensor->reading = ina219.getReading(ina219.SHUNT_VOLT); return;
+		case SENSOR_INA219_CURRENT: 		wichSensor->reading = ina219.getReading(ina219.CURRENT); return;
+		case SENSOR_INA219_LOADVOLT: 		wichSensor->reading = ina219.getReading(ina219.LOAD_VOLT); return;
+		case SENSOR_WATER_TEMP_DS18B20:		wichSensor->reading = waterTemp_DS18B20.getReading(); return;
+		case SENSOR_ATLAS_TEMPERATURE: 		if (atlasTEMP.getReading()) 	{ wichSensor->reading = atlasTEMP.newReading; return; } break;
+		case SENSOR_ATLAS_PH:			if (atlasPH.getReading()) 	{ wichSensor->reading = atlasPH.newReading; return; } break;
+		case SENSOR_ATLAS_EC:			if (atlasEC.getReading()) 	{ wichSensor->reading = atlasEC.newReading; return; } break;
+		case SENSOR_ATLAS_EC_SG:		if (atlasEC.getReading()) 	{ wichSensor->reading = atlasEC.newReadingB; return; } break;
+		case SENSOR_ATLAS_DO:			if (atlasDO.getReading()) 	{ wichSensor->reading = atlasDO.newReading; return; } break;
+		case SENSOR_ATLAS_DO_SAT:		if (atlasDO.getReading()) 	{ wichSensor->reading = atlasDO.newReadingB; return; } break;
+		case SENSOR_CHIRP_MOISTURE_RAW:		if (moistureChirp.getReading(SENSOR_CHIRP_MOISTURE_RAW)) { wichSensor->reading = moistureChirp.raw; return; } break;
+		case SENSOR_CHIRP_MOISTURE:		if (moistureChirp.getReading(SENSOR_CHIRP_MOISTURE)) { wichSensor->reading = moistureChirp.moisture; return; } break;
+		case SENSOR_CHIRP_TEMPERATURE:		if (moistureChirp.getReading(SENSOR_CHIRP_TEMPERATURE)) { wichSensor->reading = moistureChirp.temperature; return; } break;
+		case SENSOR_CHIRP_LIGHT:		if (moistureChirp.getReading(SENSOR_CHIRP_LIGHT)) { wichSensor->reading = moistureChirp.light; return; } break;
 		case SENSOR_EXT_A_PM_1:
 		case SENSOR_EXT_A_PM_25:
 		case SENSOR_EXT_A_PM_10:
@@ -212,7 +212,7 @@ void AuxBoards::getReading(OneSensor *wichSensor)
 		case SENSOR_EXT_A_PN_1:
 		case SENSOR_EXT_A_PN_25:
 		case SENSOR_EXT_A_PN_5:
-		case SENSOR_EXT_A_PN_10:		wichSensor->reading = String(pmSensor.getReading(SLOT_A, wichSensor->type)); return;
+		case SENSOR_EXT_A_PN_10:		wichSensor->reading = pmSensor.getReading(SLOT_A, wichSensor->type); return;
 		case SENSOR_EXT_B_PM_1:
 		case SENSOR_EXT_B_PM_25:
 		case SENSOR_EXT_B_PM_10:
@@ -221,7 +221,7 @@ void AuxBoards::getReading(OneSensor *wichSensor)
 		case SENSOR_EXT_B_PN_1:
 		case SENSOR_EXT_B_PN_25:
 		case SENSOR_EXT_B_PN_5:
-		case SENSOR_EXT_B_PN_10: 		wichSensor->reading = String(pmSensor.getReading(SLOT_B, wichSensor->type)); return;
+		case SENSOR_EXT_B_PN_10: 		wichSensor->reading = pmSensor.getReading(SLOT_B, wichSensor->type); return;
 		case SENSOR_EXT_PM_1:
 		case SENSOR_EXT_PM_25:
 		case SENSOR_EXT_PM_10:
@@ -230,21 +230,21 @@ void AuxBoards::getReading(OneSensor *wichSensor)
 		case SENSOR_EXT_PN_1:
 		case SENSOR_EXT_PN_25:
 		case SENSOR_EXT_PN_5:
-		case SENSOR_EXT_PN_10: 			wichSensor->reading = String(pmSensor.getReading(SLOT_AVG, wichSensor->type)); return;
-		case SENSOR_PM_DALLAS_TEMP: 		wichSensor->reading = String(pmDallasTemp.getReading()); return;
-		case SENSOR_DALLAS_TEMP: 		if (dallasTemp.getReading()) 			{ wichSensor->reading = String(dallasTemp.reading); return; } break;
-		case SENSOR_SHT31_TEMP: 		if (sht31.getReading()) 				{ wichSensor->reading = String(sht31.temperature); return; } break;
-		case SENSOR_SHT31_HUM: 			if (sht31.getReading()) 				{ wichSensor->reading = String(sht31.humidity); return; } break;
-		case SENSOR_RANGE_DISTANCE: 		if (range.getReading(SENSOR_RANGE_DISTANCE)) 	{ wichSensor->reading = String(range.readingDistance); return; } break;
-		case SENSOR_RANGE_LIGHT: 		if (range.getReading(SENSOR_RANGE_LIGHT)) 	{ wichSensor->reading = String(range.readingLight); return; } break;
-		case SENSOR_BME680_TEMPERATURE:		if (bme680.getReading()) 			{ wichSensor->reading = String(bme680.temperature); return; } break;
-		case SENSOR_BME680_HUMIDITY:		if (bme680.getReading()) 			{ wichSensor->reading = String(bme680.humidity); return; } break;
-		case SENSOR_BME680_PRESSURE:		if (bme680.getReading()) 			{ wichSensor->reading = String(bme680.pressure); return; } break;
-		case SENSOR_BME680_VOCS:		if (bme680.getReading()) 			{ wichSensor->reading = String(bme680.VOCgas); return; } break;
+		case SENSOR_EXT_PN_10: 			wichSensor->reading = pmSensor.getReading(SLOT_AVG, wichSensor->type); return;
+		case SENSOR_PM_DALLAS_TEMP: 		wichSensor->reading = pmDallasTemp.getReading(); return;
+		case SENSOR_DALLAS_TEMP: 		if (dallasTemp.getReading()) 			{ wichSensor->reading = dallasTemp.reading; return; } break;
+		case SENSOR_SHT31_TEMP: 		if (sht31.getReading()) 				{ wichSensor->reading = sht31.temperature; return; } break;
+		case SENSOR_SHT31_HUM: 			if (sht31.getReading()) 				{ wichSensor->reading = sht31.humidity; return; } break;
+		case SENSOR_RANGE_DISTANCE: 		if (range.getReading(SENSOR_RANGE_DISTANCE)) 	{ wichSensor->reading = range.readingDistance; return; } break;
+		case SENSOR_RANGE_LIGHT: 		if (range.getReading(SENSOR_RANGE_LIGHT)) 	{ wichSensor->reading = range.readingLight; return; } break;
+		case SENSOR_BME680_TEMPERATURE:		if (bme680.getReading()) 			{ wichSensor->reading = bme680.temperature; return; } break;
+		case SENSOR_BME680_HUMIDITY:		if (bme680.getReading()) 			{ wichSensor->reading = bme680.humidity; return; } break;
+		case SENSOR_BME680_PRESSURE:		if (bme680.getReading()) 			{ wichSensor->reading = bme680.pressure; return; } break;
+		case SENSOR_BME680_VOCS:		if (bme680.getReading()) 			{ wichSensor->reading = bme680.VOCgas; return; } break;
 		default: break;
 	}
 
-	wichSensor->reading = "null";
+	wichSensor->reading = SensorValue();
 	wichSensor->state = -1;
 }
 
@@ -940,8 +940,10 @@ uint8_t Atlas::getResponse()
 
 		} default : {
 
+			// The text ends with a 0, the rest of the 20 bytes are padding
 			while (auxWire.available()) {
 				char buff = auxWire.read();
+				if (buff == 0) break;
 				atlasResponse += buff;
 			}
 			auxWire.endTransmission();
@@ -15,7 +15,7 @@ RHReliableDatagram manager(driver, SAM_ADDRESS);
 // Auxiliary I2C devices
 AuxBoards auxBoards;
 
-// Eeprom flash emulation to store persistent variables
+// Eeprom flash emulation to store persistent variables (only used if the flash journal is not available and to migrate old configurations)
 FlashStorage(eepromConfig, Configuration);
 
 void SckBase::setup()
@@ -57,7 +57,8 @@ void SckBase::setup()
 	pinMode(pinBATT_INSERTION, INPUT_PULLUP);
 	pinPeripheral(pinBATT_INSERTION, PIO_ANALOG);
 	pinMode(pinGAUGE_INT, INPUT_PULLUP);
-	attachInterrupt(pinGAUGE_INT, ISR_battery, FALLING);
+	LowPower.attachInterruptWakeup(pinGAUGE_INT, ISR_battery, FALLING);
+	LowPower.attachInterruptWakeup(pinCHARGER_INT, ISR_charger, FALLING); 	// The charger pulses INT on VBUS, charge status and fault changes
 
 	// RTC setup
 	rtc.begin();
@@ -85,9 +86,6 @@ void SckBase::setup()
 	attachInterrupt(pinCARD_DETECT, ISR_sdDetect, CHANGE);
 	sdDetect();
 
-	// Flash storage
-	/* readingsList.flashStart(); */
-
 /* #define autoTest  // Uncomment for doing Gases autotest, you also need to uncomment  TODO complete this */
 
 #ifdef autoTest
@@ -113,6 +111,21 @@ void SckBase::setup()
 	loadConfig();
 	if (st.mode == MODE_NOT_CONFIGURED) writeHeader = true;
 
+	// Flash storage (readings saved before the reset are recovered)
+	if (readingsList.begin(&journal)) {
+		sprintf(outBuff, "Readings stored on flash: %lu groups recovered", readingsList.countGroups());
+		sckOut();
+	} else {
+		sckOut("ERROR starting flash memory, readings will be stored on RAM!!!");
+	}
+
+	// Energy ledger (today's counters continue after a reset)
+	if (journal.ready) {
+		journal.read(JKEY_ENERGY_TODAY, &energy.today, sizeof(EnergyDay));
+		journal.read(JKEY_ENERGY_YESTERDAY, &energy.yesterday, sizeof(EnergyDay));
+	}
+	energy.set(ENERGY_AWAKE, energy.AWAKE_CURRENT);
+
 	bool saveNeeded = false;
 
 	// Urban board
@@ -123,16 +136,16 @@ void SckBase::setup()
 		// Check which urban board sensors are enabled
 		uint8_t urbanSensorCount = 0;
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			OneSensor *wichSensor = &sensors[sensors.sensorsPriorized(i)];
-			if (wichSensor->location == BOARD_URBAN && wichSensor->enabled) urbanSensorCount++;
+			SensorType wichSensor = sensors.sensorsPriorized(i);
+			if (sensors.info(wichSensor).location == BOARD_URBAN && sensors[wichSensor].enabled) urbanSensorCount++;
 		}
 
 		// If there is none enabled, we enable default sensors
 		if (urbanSensorCount == 0) {
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-				OneSensor *wichSensor = &sensors[sensors.sensorsPriorized(i)];
-				if (wichSensor->location == BOARD_URBAN && wichSensor->defaultEnabled && !wichSensor->enabled) {
-					enableSensor(wichSensor->type);
+				SensorType wichSensor = sensors.sensorsPriorized(i);
+				if (sensors.info(wichSensor).location == BOARD_URBAN && sensors.info(wichSensor).defaultEnabled && !sensors[wichSensor].enabled) {
+					enableSensor(wichSensor);
 					saveNeeded = true;
 				}
 			}
@@ -145,8 +158,8 @@ void SckBase::setup()
  		// Find out if urban was reinstalled just now
 		bool justInstalled = true;
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
-			if (wichSensor->location == BOARD_URBAN && wichSensor->enabled) {
+			SensorType wichSensor = static_cast<SensorType>(i);
+			if (sensors.info(wichSensor).location == BOARD_URBAN && sensors[wichSensor].enabled) {
 				justInstalled = false;
 			}
 		}
@@ -154,16 +167,16 @@ void SckBase::setup()
 		if (justInstalled) {
 			sckOut("Enabling default sensors...");
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-				OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
-				if (wichSensor->location == BOARD_URBAN) wichSensor->enabled = wichSensor->defaultEnabled;
+				SensorType wichSensor = static_cast<SensorType>(i);
+				if (sensors.info(wichSensor).location == BOARD_URBAN) sensors[wichSensor].enabled = sensors.info(wichSensor).defaultEnabled;
 			}
 			saveConfig();
 		}
 
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
-			if (wichSensor->enabled) urban.start(wichSensor->type);
-			else urban.stop(wichSensor->type);
+			SensorType wichSensor = static_cast<SensorType>(i);
+			if (sensors[wichSensor].enabled) urban.start(wichSensor);
+			else urban.stop(wichSensor);
 		}
 
 	} else {
@@ -173,8 +186,8 @@ void SckBase::setup()
  		// Find out if urban was removed just now
 		bool justRemoved = false;
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
-			if (wichSensor->location == BOARD_URBAN && wichSensor->enabled) {
+			SensorType wichSensor = static_cast<SensorType>(i);
+			if (sensors.info(wichSensor).location == BOARD_URBAN && sensors[wichSensor].enabled) {
 				justRemoved = true;
 			}
 		}
@@ -182,8 +195,8 @@ void SckBase::setup()
 		if (justRemoved) {
 			sckOut("Disabling sensors...");
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-				OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
-				if (wichSensor->location == BOARD_URBAN && wichSensor->enabled) disableSensor(wichSensor->type);
+				SensorType wichSensor = static_cast<SensorType>(i);
+				if (sensors.info(wichSensor).location == BOARD_URBAN && sensors[wichSensor].enabled) disableSensor(wichSensor);
 			}
 			saveConfig();
 		}
@@ -193,17 +206,17 @@ void SckBase::setup()
 	// Detect and enable auxiliary boards
 	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 
-		OneSensor *wichSensor = &sensors[sensors.sensorsPriorized(i)];
+		SensorType wichSensor = sensors.sensorsPriorized(i);
 
-		if (wichSensor->location == BOARD_AUX) {
-			if (enableSensor(wichSensor->type)) {
-				wichSensor->enabled = true;
+		if (sensors.info(wichSensor).location == BOARD_AUX) {
+			if (enableSensor(wichSensor)) {
+				sensors[wichSensor].enabled = true;
 				saveNeeded = true;
-			} else if (wichSensor->enabled)  {
-				disableSensor(wichSensor->type);
-				sprintf(outBuff, "Removed: %s... ", wichSensor->title);
+			} else if (sensors[wichSensor].enabled)  {
+				disableSensor(wichSensor);
+				sprintf(outBuff, "Removed: %s... ", sensors.info(wichSensor).title);
 				sckOut();
-				wichSensor->enabled = false;
+				sensors[wichSensor].enabled = false;
 				saveNeeded = true;
 			}
 		}
@@ -213,20 +226,39 @@ void SckBase::setup()
 }
 void SckBase::update()
 {
+	perf.loop();
+
+	// Records the drivers staged on the last loop
+	if (trace.recording() && sdSelect()) trace.update();
+
 	if (millis() - reviewStateMillis > 500) {
 		reviewStateMillis = millis();
+		uint32_t perfStart = perf.start(PERF_STATE);
 		reviewState();
+		perf.end(PERF_STATE, perfStart);
 	}
 
-	if (millis() - updatePowerMillis > 1000) {
+	if (battPendingEvent || chargerPendingEvent || millis() - updatePowerMillis > 1000) {
 		updatePowerMillis = millis();
+		uint32_t perfStart = perf.start(PERF_POWER);
 		updatePower();
+		perf.end(PERF_POWER, perfStart);
 	}
 
+	if (millis() - updateEnergyMillis > 1000) {
+		updateEnergyMillis = millis();
+		updateEnergy();
+		memory.update();
+	}
+
+	if (perfInfoInterval > 0 && infoPublished && rtc.getEpoch() - lastInfoTime >= perfInfoInterval * 3600UL) infoPublished = false;
+
 	if (butState != butOldState) {
+		uint32_t perfStart = perf.start(PERF_BUTTON);
 		buttonEvent();
 		butOldState = butState;
 		while(!butState) buttonStillDown();
+		perf.end(PERF_BUTTON, perfStart);
 	}
 }
 
@@ -257,6 +289,9 @@ void SckBase::reviewState()
 
 	if (sdInitPending) sdInit();
 
+	// Don't keep readings waiting on RAM for too long
+	if (sdWriter.syncDue() && sdSelect()) sdWriter.sync();
+
 	// SD card debug check file size and backup big files.
 	if (config.sdDebug) {
 		// Just do this every hour
@@ -592,12 +627,11 @@ void SckBase::enterSetup()
 }
 void SckBase::printState()
 {
-	// TODO fix bug: after configuring wrong wifi, restart kit, wait for error and sdcard publish and type "state" command.
-	// it will enter setup mode !?!? and if you type "state" command again it will reboot.
+	// Each block starts on an empty buffer (appending to the previous one overflowed outBuff)
 	char t[] = "true";
 	char f[] = "false";
 
-	sprintf(outBuff, "%s\r\nonSetup: %s\r\n", outBuff, st.onSetup  ? t : f);
+	sprintf(outBuff, "\r\nonSetup: %s\r\n", st.onSetup  ? t : f);
 	sprintf(outBuff, "%stokenSet: %s\r\n", outBuff, st.tokenSet  ? t : f);
 	sprintf(outBuff, "%shelloPending: %s\r\n", outBuff, st.helloPending  ? t : f);
 	sprintf(outBuff, "%smode: %s\r\n", outBuff, modeTitles[st.mode]);
@@ -606,7 +640,7 @@ void SckBase::printState()
 	sprintf(outBuff, "%sinfoPublished: %s\r\n", outBuff, infoPublished  ? t : f);
 	sckOut(PRIO_HIGH, false);
 
-	sprintf(outBuff, "%s\r\nespON: %s\r\n", outBuff, st.espON  ? t : f);
+	sprintf(outBuff, "\r\nespON: %s\r\n", st.espON  ? t : f);
 	sprintf(outBuff, "%sespBooting: %s\r\n", outBuff, st.espBooting  ? t : f);
 	sprintf(outBuff, "%swifiSet: %s\r\n", outBuff, st.wifiSet  ? t : f);
 	sprintf(outBuff, "%swifiOK: %s\r\n", outBuff, st.wifiStat.ok ? t : f);
@@ -617,7 +651,7 @@ void SckBase::printState()
 	sprintf(outBuff, "%stimeError: %s\r\n", outBuff, st.timeStat.error ? t : f);
 	sckOut(PRIO_HIGH, false);
 
-	sprintf(outBuff, "%s\r\npublishOK: %s\r\n", outBuff, st.publishStat.ok ? t : f);
+	sprintf(outBuff, "\r\npublishOK: %s\r\n", st.publishStat.ok ? t : f);
 	sprintf(outBuff, "%spublishError: %s\r\n", outBuff, st.publishStat.error ? t : f);
 	sprintf(outBuff, "%stime to next publish: %li\r\n", outBuff, config.publishInterval - (rtc.getEpoch() - lastPublishTime));
 	sprintf(outBuff, "%stimeToPublish: %s\r\n", outBuff, timeToPublish ? t : f);
@@ -630,6 +664,8 @@ void SckBase::inputUpdate()
 
 	if (SerialUSB.available()) {
 
+		uint32_t perfStart = perf.start(PERF_INPUT);
+
 		char buff = SerialUSB.read();
 		uint16_t blen = serialBuff.length();
 
@@ -674,9 +710,13 @@ void SckBase::inputUpdate()
 			SerialUSB.print(buff);				// Echo
 
 		}
+
+		perf.end(PERF_INPUT, perfStart);
 	}
 
+	uint32_t perfStart = perf.start(PERF_ESPBUS);
 	ESPbusUpdate();
+	perf.end(PERF_ESPBUS, perfStart);
 }
 
 // **** Output
@@ -691,7 +731,7 @@ void SckBase::sckOut(String strOut, PrioLevels priority, bool newLine)
 		return;
 	}
 	outRepetitions = 0;
-	strOut.toCharArray(outBuff, strOut.length()+1);
+	strOut.toCharArray(outBuff, sizeof(outBuff));
 	sckOut(priority, newLine);
 }
 void SckBase::sckOut(const char *strOut, PrioLevels priority, bool newLine)
@@ -705,7 +745,8 @@ void SckBase::sckOut(const char *strOut, PrioLevels priority, bool newLine)
 		return;
 	}
 	outRepetitions = 0;
-	strncpy(outBuff, strOut, 240);
+	strncpy(outBuff, strOut, sizeof(outBuff) - 1);
+	outBuff[sizeof(outBuff) - 1] = 0;
 	sckOut(priority, newLine);
 }
 void SckBase::sckOut(PrioLevels priority, bool newLine)
@@ -743,18 +784,32 @@ void SckBase::prompt()
 void SckBase::loadConfig()
 {
 
-	sckOut("Loading configuration from eeprom...");
+	sckOut("Loading configuration from flash...");
 
-	Configuration savedConf = eepromConfig.read();
+	// The journal holds more than the configuration (energy, readings log), the mode is always written with it
+	if (journal.begin() && journal.has(JKEY_MODE)) {
 
-	if (savedConf.valid) config = savedConf;
-	else {
-		sckOut("Can't find valid configuration!!! loading defaults...");
-		saveConfig(true);
+		readJournalConfig();
+
+	} else {
+
+		// Journal is empty (first boot with this firmware) or flash is not working: use the eeprom copy
+		Configuration savedConf = eepromConfig.read();
+
+		if (savedConf.valid) {
+			config = savedConf;
+			if (journal.ready) {
+				sckOut("Migrating configuration from eeprom to flash journal...");
+				writeJournalConfig();
+			}
+		} else {
+			sckOut("Can't find valid configuration!!! loading defaults...");
+			saveConfig(true);
+		}
 	}
 
 	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-		OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
+		SensorRuntime *wichSensor = &sensors[static_cast<SensorType>(i)];
 		wichSensor->enabled = config.sensors[i].enabled;
 		wichSensor->everyNint = config.sensors[i].everyNint;
 	}
@@ -769,6 +824,9 @@ void SckBase::loadConfig()
 	st.tokenSet = config.token.set;
 	st.tokenError = false;
 	st.mode = config.mode;
+	scheduledMode = config.mode;
+	scheduledReadInterval = config.readInterval;
+	scheduledPublishInterval = config.publishInterval;
 }
 void SckBase::saveConfig(bool defaults)
 {
@@ -788,19 +846,29 @@ void SckBase::saveConfig(bool defaults)
 		}
 
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			config.sensors[i].enabled = sensors[static_cast<SensorType>(i)].defaultEnabled;
+			config.sensors[i].enabled = sensors.info(static_cast<SensorType>(i)).defaultEnabled;
 			config.sensors[i].everyNint = 1;
 		}
 		pendingSyncConfig = true;
 	} else {
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
-			OneSensor *wichSensor = &sensors[static_cast<SensorType>(i)];
+			SensorRuntime *wichSensor = &sensors[static_cast<SensorType>(i)];
 			config.sensors[i].enabled = wichSensor->enabled;
 			config.sensors[i].everyNint = wichSensor->everyNint;
 		}
 	}
-	eepromConfig.write(config);
-	sckOut("Saved configuration on eeprom!!", PRIO_LOW);
+	// Only changed values are written to the journal. The eeprom copy is only used while the flash doesn't work: a journal
+	// that failed a write still has the previous configuration complete, and it is the one loaded on the next boot
+	uint32_t writtenBefore = journal.recordsWritten;
+	if (writeJournalConfig()) {
+		sprintf(outBuff, "Saved configuration on flash!! (%lu values changed)", journal.recordsWritten - writtenBefore);
+		sckOut(PRIO_LOW);
+	} else if (!journal.ready) {
+		eepromConfig.write(config);
+		sckOut("Saved configuration on eeprom!!", PRIO_LOW);
+	} else {
+		sckOut("ERROR saving configuration on flash!!! it will be lost on reset");
+	}
 
 	// If battery capacity changed, update it
 	if (config.battDesignCapacity != battery.designCapacity) {
@@ -814,8 +882,15 @@ void SckBase::saveConfig(bool defaults)
 	st.tokenSet = config.token.set;
 	st.tokenError = false;
 	st.wifiStat.reset();
-	lastPublishTime = rtc.getEpoch() - config.publishInterval;
-	lastSensorUpdate = rtc.getEpoch() - config.readInterval;
+
+	// A new mode or interval starts with a reading and a publish, other changes (sensor -enable) keep the schedule
+	if (config.mode != scheduledMode || config.readInterval != scheduledReadInterval || config.publishInterval != scheduledPublishInterval) {
+		lastPublishTime = rtc.getEpoch() - config.publishInterval;
+		lastSensorUpdate = rtc.getEpoch() - config.readInterval;
+		scheduledMode = config.mode;
+		scheduledReadInterval = config.readInterval;
+		scheduledPublishInterval = config.publishInterval;
+	}
 
 	if (st.wifiSet || st.tokenSet) pendingSyncConfig = true;
 
@@ -849,6 +924,58 @@ void SckBase::saveConfig(bool defaults)
 
 	if (pendingSyncConfig && !st.espON) ESPcontrol(ESP_ON);
 }
+bool SckBase::readJournalConfig()
+{
+	// Keys that are not stored keep their default values
+	Configuration savedConf;
+
+	journal.read(JKEY_MODE, &savedConf.mode, sizeof(savedConf.mode));
+	journal.read(JKEY_PUBLISH_INTERVAL, &savedConf.publishInterval, sizeof(savedConf.publishInterval));
+	journal.read(JKEY_READ_INTERVAL, &savedConf.readInterval, sizeof(savedConf.readInterval));
+	journal.read(JKEY_MAC, &savedConf.mac, sizeof(savedConf.mac));
+	journal.read(JKEY_CREDENTIALS, &savedConf.credentials, sizeof(savedConf.credentials));
+	journal.read(JKEY_TOKEN, &savedConf.token, sizeof(savedConf.token));
+	journal.read(JKEY_SD_DEBUG, &savedConf.sdDebug, sizeof(savedConf.sdDebug));
+	journal.read(JKEY_BATT_CAPACITY, &savedConf.battDesignCapacity, sizeof(savedConf.battDesignCapacity));
+	journal.read(JKEY_SD_ARCHIVE, &savedConf.sdArchive, sizeof(savedConf.sdArchive));
+
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) {
+		if (!journal.read(JKEY_SENSORS + i, &savedConf.sensors[i], sizeof(SensorConfig))) {
+			savedConf.sensors[i].enabled = sensors.info(static_cast<SensorType>(i)).defaultEnabled;
+			savedConf.sensors[i].everyNint = 1;
+		}
+	}
+
+	config = savedConf;
+
+	return true;
+}
+static_assert(JKEY_SENSORS + SENSOR_COUNT <= SCKJOURNAL_MAX_KEYS, "Sensor journal keys don't fit on a byte");
+
+bool SckBase::writeJournalConfig()
+{
+	// One batch: a reset halfway leaves the previous configuration, never a mix of two of them
+	const uint16_t maxBytes = 9 * 4 + sizeof(config.mode) + sizeof(config.publishInterval) + sizeof(config.readInterval) + sizeof(config.mac) +
+		sizeof(config.credentials) + sizeof(config.token) + sizeof(config.sdDebug) + sizeof(config.battDesignCapacity) + sizeof(config.sdArchive) +
+		SENSOR_COUNT * (4 + sizeof(SensorConfig));
+	if (!journal.beginBatch(maxBytes)) return false;
+
+	bool result = true;
+
+	result &= journal.write(JKEY_MODE, &config.mode, sizeof(config.mode));
+	result &= journal.write(JKEY_PUBLISH_INTERVAL, &config.publishInterval, sizeof(config.publishInterval));
+	result &= journal.write(JKEY_READ_INTERVAL, &config.readInterval, sizeof(config.readInterval));
+	result &= journal.write(JKEY_MAC, &config.mac, sizeof(config.mac));
+	result &= journal.write(JKEY_CREDENTIALS, &config.credentials, sizeof(config.credentials));
+	result &= journal.write(JKEY_TOKEN, &config.token, sizeof(config.token));
+	result &= journal.write(JKEY_SD_DEBUG, &config.sdDebug, sizeof(config.sdDebug));
+	result &= journal.write(JKEY_BATT_CAPACITY, &config.battDesignCapacity, sizeof(config.battDesignCapacity));
+	result &= journal.write(JKEY_SD_ARCHIVE, &config.sdArchive, sizeof(config.sdArchive));
+
+	for (uint8_t i=0; i<SENSOR_COUNT; i++) result &= journal.write(JKEY_SENSORS + i, &config.sensors[i], sizeof(SensorConfig));
+
+	return journal.commitBatch() && result;
+}
 Configuration SckBase::getConfig()
 {
 
@@ -903,7 +1030,10 @@ bool SckBase::publishInfo()
 		/* 	"sam_bd":"2018-07-17T06:55:06Z", */
 		/* 	"mac":"AB:45:2D:33:98", */
 		/* 	"esp_ver":"0.3.0-ce87e64", */
-		/* 	"esp_bd":"2018-07-17T06:55:06Z" */
+		/* 	"esp_bd":"2018-07-17T06:55:06Z", */
+		/* 	"energy":{"day":"2018-07-16","awake":10.5,"sleep":18.1,"esp":22.4,"pm":30.2,"heater":0,"sdcard":0.2,"scale":1.12}, */
+		/* 	"perf":{"loop":1520,"worst":"espbus","max":1502,"stalls":4}, */
+		/* 	"mem":{"free":9120,"min":7844,"largest":8512,"stack":2112} */
 		/* } */
 
 		if (!st.espON) {
@@ -925,6 +1055,34 @@ bool SckBase::publishInfo()
 		json["esp_ver"] = ESPversion.c_str();
 		json["esp_bd"] = ESPbuildDate.c_str();
 
+		// Consumption (mAh) of the last complete day, the info is sent after every daily reset
+		energy.flush();
+		EnergyDay &energyDay = (energy.yesterday.day > 0) ? energy.yesterday : energy.today;
+		char energyDate[21];
+		if (energyDay.day > 0) {
+			epoch2iso(energyDay.day * 86400, energyDate);
+			energyDate[10] = 0;
+			JsonObject& energyJson = json.createNestedObject("energy");
+			energyJson["day"] = energyDate;
+			for (uint8_t i=0; i<ENERGY_COUNT; i++) energyJson[energy.titles[i]] = energy.mAh(energyDay, static_cast<EnergyDomain>(i));
+			energyJson["scale"] = energy.ratio(energyDay);
+		}
+
+		// Main loop stalls (ms)
+		PerfStage worstStage = perf.worst();
+		JsonObject& perfJson = json.createNestedObject("perf");
+		perfJson["loop"] = perf.stages[PERF_LOOP].maxMicros / 1000;
+		perfJson["worst"] = perf.titles[worstStage];
+		perfJson["max"] = perf.stages[worstStage].maxMicros / 1000;
+		perfJson["stalls"] = perf.stallCount;
+
+		// RAM (bytes)
+		JsonObject& memJson = json.createNestedObject("mem");
+		memJson["free"] = memory.freeRam();
+		memJson["min"] = memory.minFree;
+		memJson["largest"] = memory.largestBlock();
+		memJson["stack"] = memory.stackUsed();
+
 		sprintf(netBuff, "%c", ESPMES_MQTT_INFO);
 		json.printTo(&netBuff[1], json.measureLength() + 1);
 		if (sendMessage()) return true;
@@ -952,7 +1110,9 @@ void SckBase::ESPcontrol(ESPcontrols controlCommand)
 		{
 				led.update(led.WHITE, led.PULSE_STATIC);
 
-				SerialESP.begin(espFlashSpeed);
+				// Never returns, the kit resets when the flashing is done
+				SckBridge bridge;
+				bridge.begin(espFlashSpeed);
 				delay(100);
 
 				digitalWrite(pinESP_CH_PD, LOW);
@@ -966,13 +1126,7 @@ void SckBase::ESPcontrol(ESPcontrols controlCommand)
 				uint32_t flashTimeout = millis();
 				uint32_t startTimeout = millis();
 				while(1) {
-					if (SerialUSB.available()) {
-						SerialESP.write(SerialUSB.read());
-						flashTimeout = millis();
-					}
-					if (SerialESP.available()) {
-						SerialUSB.write(SerialESP.read());
-					}
+					if (bridge.update()) flashTimeout = millis();
 					if (millis() - flashTimeout > 1000) {
 						if (millis() - startTimeout > 10000) sck_reset();  // Initial 10 seconds for the flashing to start
 					}
@@ -1030,6 +1184,7 @@ void SckBase::ESPbusUpdate()
 		uint8_t len = NETPACK_TOTAL_SIZE;
 
 		if (manager.recvfromAck(netPack, &len)) {
+			SckTrace::bus(netPack, len);
 
 			if (debugESPcom) {
 				sprintf(outBuff, "Receiving msg from ESP in %i parts", netPack[0]);
@@ -1041,14 +1196,18 @@ void SckBase::ESPbusUpdate()
 			SAMMessage wichMessage = static_cast<SAMMessage>(pre);
 
 			// Get content from first package (1 byte less than the rest)
-			memcpy(netBuff, &netPack[2], NETPACK_CONTENT_SIZE - 1);
+			uint8_t parts = netFirstPack(netBuff, netPack, len);
+			if (parts == 0) {
+				if (debugESPcom) sckOut("Wrong packet from ESP, ignoring it");
+				return;
+			}
 
 			// Get the rest of the packages (if they exist)
-			for (uint8_t i=0; i<netPack[0]-1; i++) {
-				if (manager.recvfromAckTimeout(netPack, &len, 500))	{
-					memcpy(&netBuff[(i * NETPACK_CONTENT_SIZE) + (NETPACK_CONTENT_SIZE - 1)], &netPack[1], NETPACK_CONTENT_SIZE);
-				}
-				else return;
+			for (uint8_t i=1; i<parts; i++) {
+				len = NETPACK_TOTAL_SIZE;
+				if (!manager.recvfromAckTimeout(netPack, &len, 500)) return;
+				SckTrace::bus(netPack, len);
+				if (!netNextPack(netBuff, i, parts, netPack, len)) return;
 			}
 
 			if (debugESPcom) sckOut(netBuff);
@@ -1065,7 +1224,7 @@ bool SckBase::sendMessage(ESPMessage wichMessage)
 }
 bool SckBase::sendMessage(ESPMessage wichMessage, const char *content)
 {
-	sprintf(netBuff, "%c%s", wichMessage, content);
+	snprintf(netBuff, sizeof(netBuff), "%c%s", wichMessage, content);
 	return sendMessage();
 }
 bool SckBase::sendMessage()
@@ -1124,14 +1283,14 @@ void SckBase::receiveMessage(SAMMessage wichMessage)
 
 				if (json.containsKey("ss")) {
 					config.credentials.set = true;
-					strcpy(config.credentials.ssid, json["ss"]);
-					if (json.containsKey("pa")) strcpy(config.credentials.pass, json["pa"]);
+					json["ss"].as<String>().toCharArray(config.credentials.ssid, sizeof(config.credentials.ssid));
+					if (json.containsKey("pa")) json["pa"].as<String>().toCharArray(config.credentials.pass, sizeof(config.credentials.pass));
 				} else config.credentials.set = false;
 
 
 				if (json.containsKey("to")) {
 					config.token.set = true;
-					strcpy(config.token.token, json["to"]);
+					json["to"].as<String>().toCharArray(config.token.token, sizeof(config.token.token));
 				} else config.token.set = false;
 
 				st.helloPending = true;
@@ -1154,9 +1313,9 @@ void SckBase::receiveMessage(SAMMessage wichMessage)
 				ipAddress = json["ip"].as<String>();
 				hostname = json["hn"].as<String>();
 
-				sprintf(outBuff, "\r\nHostname: %s\r\nIP address: %s\r\nMAC address: %s", hostname.c_str(), ipAddress.c_str(), macAddress.c_str());
+				snprintf(outBuff, sizeof(outBuff), "\r\nHostname: %s\r\nIP address: %s\r\nMAC address: %s", hostname.c_str(), ipAddress.c_str(), macAddress.c_str());
 				sckOut();
-				sprintf(outBuff, "ESP version: %s\r\nESP build date: %s", ESPversion.c_str(), ESPbuildDate.c_str());
+				snprintf(outBuff, sizeof(outBuff), "ESP version: %s\r\nESP build date: %s", ESPversion.c_str(), ESPbuildDate.c_str());
 				sckOut();
 
 				break;
@@ -1210,6 +1369,7 @@ void SckBase::receiveMessage(SAMMessage wichMessage)
 
 			st.infoStat.setOk();
 			infoPublished = true;
+			lastInfoTime = rtc.getEpoch();
 			sckOut("Info publish OK!!");
 			break;
 
@@ -1244,7 +1404,7 @@ void SckBase::receiveMessage(SAMMessage wichMessage)
 			// Udate mac address if we haven't yet
 			if (!config.mac.valid) {
 				sckOut("Updated MAC address");
-				sprintf(config.mac.address, "%s", macAddress.c_str());
+				macAddress.toCharArray(config.mac.address, sizeof(config.mac.address));
 				config.mac.valid = true;
 				saveConfig();
 			}
@@ -1268,6 +1428,12 @@ void SckBase::mqttCustom(const char *topic, const char *payload)
 	json["to"] = topic;
 	json["pl"] = payload;
 
+	// The command and the final 0 go on netBuff too
+	if (json.measureLength() + 2 > sizeof(netBuff)) {
+		sckOut("ERROR MQTT message too long!!");
+		return;
+	}
+
 	sprintf(netBuff, "%c", ESPMES_MQTT_CUSTOM);
 	json.printTo(&netBuff[1], json.measureLength() + 1);
 
@@ -1302,6 +1468,10 @@ bool SckBase::sdDetect()
 	st.cardPresent = !digitalRead(pinCARD_DETECT);
 	st.cardPresentError = false;
 
+	// Card was removed or changed: the open file can't be used anymore (buffered data will be written when the card is back)
+	sdWriter.cardChanged = true;
+	trace.cardChanged();
+
 	if (!digitalRead(pinCARD_DETECT)) {
 		sckOut("Sdcard inserted");
 		sdInitPending = true;
@@ -1343,11 +1513,34 @@ bool SckBase::saveInfo()
 // **** Power
 void SckBase::sck_reset()
 {
+	readingsList.flushDeletes();
+	if (sdSelect()) {
+		sdWriter.sync();
+		trace.stop();
+	}
+	saveEnergy();
 	sckOut("Bye!!");
 	NVIC_SystemReset();
 }
-void SckBase::goToSleep()
+void SckBase::goToSleep(uint32_t sleepMillis)
 {
+	WakeReason reason = WAKE_FIXED;
+	uint32_t wakeTime = 0;
+
+	if (!sckOFF && sleepMillis == 0) {
+		if (tickSleep) sleepMillis = tickSleepTime;
+		else {
+			wakeTime = nextWakeup(reason);
+			if (wakeTime <= rtc.getEpoch()) return; 	// Something is already due
+		}
+	}
+
+	// Write the buffered readings (and trace records) before sleeping (power could be lost)
+	if (sdSelect()) {
+		sdWriter.sync();
+		trace.sync();
+	}
+
 	led.off();
 	if (st.espON) ESPcontrol(ESP_OFF);
 
@@ -1360,11 +1553,18 @@ void SckBase::goToSleep()
 	// Stop PM sensor
 	if (urban.sck_pm.started) urban.sck_pm.stop();
 
+	updateEnergy();
+	energy.set(ENERGY_AWAKE, 0);
+	energy.set(ENERGY_SLEEP, energy.SLEEP_CURRENT);
+
 	if (sckOFF) {
 
 		sprintf(outBuff, "Sleeping forever!!! (until a button click)");
 		sckOut();
 
+		// The battery could run out before waking up
+		readingsList.flushDeletes();
+
 		// Disable the Sanity cyclic reset so it doesn't wake us up
 		rtc.disableAlarm();
 		rtc.detachInterrupt();
@@ -1378,7 +1578,8 @@ void SckBase::goToSleep()
 		LowPower.deepSleep();
 	} else {
 
-		sprintf(outBuff, "Sleeping for %.2f seconds", (sleepTime) / 1000.0);
+		if (sleepMillis > 0) sprintf(outBuff, "Sleeping for %.2f seconds", sleepMillis / 1000.0);
+		else sprintf(outBuff, "Sleeping for %lu seconds", wakeTime - rtc.getEpoch());
 		sckOut();
 
 		st.sleeping = true;
@@ -1386,10 +1587,37 @@ void SckBase::goToSleep()
 		// Turn off USB led
 		digitalWrite(pinLED_USB, HIGH);
 
-		LowPower.deepSleep(sleepTime);
+		if (lastWakeMillis > 0) {
+			sleepStats.awakeMillis += millis() - lastWakeMillis;
+			sleepStats.awakeCycles++;
+		}
+		uint32_t sleepStarted = rtc.getEpoch();
+
+		if (sleepMillis > 0) {
+			LowPower.deepSleep(sleepMillis);
+		} else {
+			// Just one alarm for the next deadline (the daily reset alarm is restored after waking up)
+			rtc.setAlarmEpoch(wakeTime);
+			rtc.enableAlarm(rtc.MATCH_YYMMDDHHMMSS);
+			rtc.attachInterrupt(ISR_deadline); 	// ext_reset is only for the daily reset alarm
+			LowPower.deepSleep();
+		}
+
+		uint32_t wokeUp = rtc.getEpoch();
+		energy.slept((wokeUp - sleepStarted) * 1000);
+		sleepStats.wakeups++;
+		sleepStats.sleptSeconds += wokeUp - sleepStarted;
+		if (sleepMillis == 0 && wokeUp < wakeTime) sleepStats.early++;
+		else sleepStats.reasons[reason]++;
+		lastWakeMillis = millis();
+
+		// The deadline alarm took the place of the daily reset one, and it would only be restored for tomorrow
+		if (sleepMillis == 0 && reason == WAKE_RESET && wokeUp >= wakeTime) ext_reset();
 	}
 
 	st.sleeping = false;
+	energy.set(ENERGY_SLEEP, 0);
+	energy.set(ENERGY_AWAKE, energy.AWAKE_CURRENT);
 
 	// Re enable Sanity cyclic reset
 	rtc.setAlarmTime(wakeUP_H, wakeUP_M, wakeUP_S);
@@ -1402,14 +1630,31 @@ void SckBase::goToSleep()
 }
 void SckBase::updatePower()
 {
+	// Gauge and charger state only change when they raise their interrupts, the poll is a fallback for battery insertion and lost events
+	uint32_t now = rtc.getEpoch();
+	bool pollDue = (now - lastPowerPoll) >= powerPollInterval;
+	if (!battPendingEvent && !chargerPendingEvent && !pollDue) return;
+
+	// Cleared before reading so events that arrive meanwhile are not lost
+	bool chargerEvent = chargerPendingEvent;
+	chargerPendingEvent = false;
+	if (chargerEvent) powerStats.chargerEvents++;
+	if (pollDue) {
+		lastPowerPoll = now;
+		powerStats.polls++;
+	}
+	powerStats.checks++;
 
-	// Update battery present status
 	bool prevBattPresent = battery.present;
-	battery.isPresent(charger);
 	bool battChanged = false;
 
-	// Update USB connection status
-	charger.detectUSB(this);
+	if (chargerEvent || pollDue) {
+		// Update battery present status
+		battery.isPresent(charger);
+
+		// Update USB connection status
+		charger.detectUSB(this);
+	}
 
 	// If battery status changed enable/disable charging
 	if (prevBattPresent != battery.present) {
@@ -1429,12 +1674,18 @@ void SckBase::updatePower()
 	}
 
 	if (battPendingEvent) {
+		battPendingEvent = false;
+		powerStats.gaugeEvents++;
 		battery.percent();
 		sprintf(outBuff, "Battery changed: %u %%", battery.lastPercent);
 		sckOut();
-		battPendingEvent = false;
+	} else if (pollDue && battery.present) {
+		battery.percent();
 	}
 
+	// The energy ledger compares the capacity used on battery with its estimate
+	if (pollDue) energy.gauge((battery.present && !charger.onUSB) ? battery.remainCapacity() : -1);
+
 	if (charger.onUSB) {
 
 		// Reset lowBatt counter
@@ -1445,7 +1696,7 @@ void SckBase::updatePower()
 
 		// Update charge status
 		SckCharger::ChargeStatus prevChargeStatus = charger.chargeStatus;
-		charger.chargeStatus = charger.getChargeStatus();
+		if (chargerEvent || pollDue) charger.chargeStatus = charger.getChargeStatus();
 
 		bool justStoppedCharging = false;
 		// If charger status changed
@@ -1502,14 +1753,12 @@ void SckBase::updatePower()
 				// Ignore last user event and go to sleep
 				lastUserEvent = millis() - waitAfterLastEvent;
 
-				sleepTime = 60000; 			// Wake up every minute to check if USB power is back
 				while (!charger.onUSB) {
-					goToSleep();
+					goToSleep(60000); 		// Wake up every minute to check if USB power is back
 					charger.detectUSB(this); 	// When USB is detecteed the kit should reset to start on clean state
 					battery.percent();
 					if (millis() - lastUserEvent < waitAfterLastEvent) break;  // Wakeup on user interaction (will go to sleep again after sone blinks)
 				}
-				sleepTime = 2500; 			// Return to runtime default sleep period (in theory this is not needed, but just in case)
 			}
 
 		// Detect lowBatt
@@ -1527,6 +1776,72 @@ void SckBase::updatePower()
 		}
 	}
 }
+void SckBase::updateEnergy()
+{
+	energy.set(ENERGY_ESP, st.espON ? energy.ESP_CURRENT : 0);
+	energy.set(ENERGY_PM, urban.sck_pm.started ? energy.PM_CURRENT : 0);
+	energy.set(ENERGY_HEATER, urban.sck_mics4514.heaterCurrent());
+
+	// Sdcard writes are short, the writers time them
+	uint32_t sdBusy = sdWriter.busyMicros + archive.busyMicros;
+	uint32_t sdMillis = (sdBusy - sdBusyAccounted) / 1000;
+	if (sdMillis > 0) {
+		energy.spend(ENERGY_SD, energy.SD_CURRENT, sdMillis);
+		sdBusyAccounted += sdMillis * 1000;
+	}
+
+	// Days are only counted with a synced clock
+	if (!st.timeStat.ok) return;
+	uint32_t now = rtc.getEpoch();
+	if (energy.rollover(now) || now - lastEnergySave >= 3600) saveEnergy();
+}
+bool SckBase::saveEnergy()
+{
+	if (!journal.ready) return false;
+
+	energy.flush();
+	lastEnergySave = rtc.getEpoch();
+
+	bool result = journal.write(JKEY_ENERGY_TODAY, &energy.today, sizeof(EnergyDay));
+	result &= journal.write(JKEY_ENERGY_YESTERDAY, &energy.yesterday, sizeof(EnergyDay));
+
+	return result;
+}
+
+uint32_t SckBase::nextWakeup(WakeReason &reason)
+{
+	uint32_t now = rtc.getEpoch();
+
+	// Next reading
+	uint32_t wakeTime = lastSensorUpdate + config.readInterval;
+	reason = WAKE_READING;
+
+	// Sensors that are warming up (like PM) need us awake: the PM sensor is stopped and its UART doesn't receive while sleeping
+	if (pendingSensors > 0) wakeTime = now;
+
+	// Next publish
+	uint32_t publishTime = lastPublishTime + config.publishInterval;
+	if (publishTime < wakeTime) {
+		wakeTime = publishTime;
+		reason = WAKE_PUBLISH;
+	}
+
+	// Led flash
+	if (now + heartbeatInterval < wakeTime) {
+		wakeTime = now + heartbeatInterval;
+		reason = WAKE_HEARTBEAT;
+	}
+
+	// Daily sanity reset
+	uint32_t resetTime = now - (now % 86400) + (wakeUP_H * 3600) + (wakeUP_M * 60) + wakeUP_S;
+	if (resetTime <= now) resetTime += 86400;
+	if (resetTime < wakeTime) {
+		wakeTime = resetTime;
+		reason = WAKE_RESET;
+	}
+
+	return wakeTime;
+}
 
 // **** Sensors
 void SckBase::updateSensors()
@@ -1536,6 +1851,8 @@ void SckBase::updateSensors()
 	if (st.onSetup) return;
 	if (st.mode == MODE_SD && !st.cardPresent) return; // TODO this should be removed when flash memory is implemented
 
+	uint32_t perfStart = perf.start(PERF_SENSORS);
+
 	// Main reading loop
 	if (rtc.getEpoch() - lastSensorUpdate >= config.readInterval) {
 
@@ -1556,14 +1873,15 @@ void SckBase::updateSensors()
 		for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 
 			// Get next sensor based on priority
-			OneSensor wichSensor = sensors[sensors.sensorsPriorized(i)];
+			SensorType wichType = sensors.sensorsPriorized(i);
 
 			// Check if it is enabled
-			if (wichSensor.enabled) {
+			if (sensors[wichType].enabled) {
 
 				// Is time to read it?
-				if ((lastSensorUpdate - wichSensor.lastReadingTime) >= (wichSensor.everyNint * config.readInterval)) {
+				if ((lastSensorUpdate - sensors[wichType].lastReadingTime) >= (sensors[wichType].everyNint * config.readInterval)) {
 
+					OneSensor wichSensor(wichType);
 					if (!getReading(&wichSensor)) {
 
 						pendingSensorsList[pendingSensors] = wichSensor.type;
@@ -1572,8 +1890,8 @@ void SckBase::updateSensors()
 					} else {
 						// Save reading
 						if (!readingsList.appendReading(wichSensor.type, wichSensor.reading)) sckOut("Failed saving reading!!!");
-						wichSensor.lastReadingTime = lastSensorUpdate;
-						sprintf(outBuff, "%s: %s %s", wichSensor.title, wichSensor.reading.c_str(), wichSensor.unit);
+						sensors[wichType].lastReadingTime = lastSensorUpdate;
+						sprintf(outBuff, "%s: %s %s", sensors.info(wichType).title, wichSensor.reading.format(valueBuff), sensors.info(wichType).unit);
 						sckOut();
 					}
 				}
@@ -1591,7 +1909,7 @@ void SckBase::updateSensors()
 
 		for (uint8_t i=0; i<pendingSensors; i++) {
 
-			OneSensor wichSensor = sensors[pendingSensorsList[i]];
+			OneSensor wichSensor(pendingSensorsList[i]);
 
 			if (!getReading(&wichSensor)) {
 
@@ -1602,8 +1920,8 @@ void SckBase::updateSensors()
 			} else  {
 				// Save reading
 				if (!readingsList.appendReading(wichSensor.type, wichSensor.reading)) sckOut("Failed saving reading!!!");
-				wichSensor.lastReadingTime = lastSensorUpdate;
-				sprintf(outBuff, "%s: %s %s", wichSensor.title, wichSensor.reading.c_str(), wichSensor.unit);
+				sensors[wichSensor.type].lastReadingTime = lastSensorUpdate;
+				sprintf(outBuff, "%s: %s %s", sensors.info(wichSensor.type).title, wichSensor.reading.format(valueBuff), sensors.info(wichSensor.type).unit);
 				sckOut();
 			}
 		}
@@ -1617,6 +1935,7 @@ void SckBase::updateSensors()
 		}
 	}
 
+	perf.end(PERF_SENSORS, perfStart);
 
 	if (rtc.getEpoch() - lastPublishTime >= config.publishInterval) {
 		timeToPublish = true;
@@ -1625,7 +1944,7 @@ void SckBase::updateSensors()
 bool SckBase::enableSensor(SensorType wichSensor)
 {
 	bool result = false;
-	switch (sensors[wichSensor].location) {
+	switch (sensors.info(wichSensor).location) {
 		case BOARD_BASE:
 		{
 			switch (wichSensor) {
@@ -1653,7 +1972,7 @@ bool SckBase::enableSensor(SensorType wichSensor)
 	}
 
 	if (result) {
-		sprintf(outBuff, "Enabling %s", sensors[wichSensor].title);
+		sprintf(outBuff, "Enabling %s", sensors.info(wichSensor).title);
 		sensors[wichSensor].enabled = true;
 		sckOut();
 		writeHeader = true;
@@ -1665,7 +1984,7 @@ bool SckBase::enableSensor(SensorType wichSensor)
 bool SckBase::disableSensor(SensorType wichSensor)
 {
 	bool result = false;
-	switch (sensors[wichSensor].location) {
+	switch (sensors.info(wichSensor).location) {
 		case BOARD_BASE:
 		{
 			switch (wichSensor) {
@@ -1685,7 +2004,7 @@ bool SckBase::disableSensor(SensorType wichSensor)
 	}
 
 	if (result) {
-		sprintf(outBuff, "Disabling %s", sensors[wichSensor].title);
+		sprintf(outBuff, "Disabling %s", sensors.info(wichSensor).title);
 		sensors[wichSensor].enabled = false;
 		sckOut();
 		writeHeader = true;
@@ -1699,45 +2018,45 @@ bool SckBase::getReading(OneSensor *wichSensor)
 	switch (wichSensor->location) {
 		case BOARD_BASE:
 		{
+				// Battery presence is kept updated by updatePower(), no need to probe it on every reading
 				switch (wichSensor->type) {
 					case SENSOR_BATT_PERCENT:
 					{
-						if (!battery.isPresent(charger)) {
-							wichSensor->reading = String("-1");
+						if (!battery.present) {
+							wichSensor->reading = -1;
 							break;
 						}
 						uint32_t thisPercent = battery.percent();
 						if (thisPercent > 100) thisPercent = 100;
 						else if (thisPercent < 0) thisPercent = 0;
-						wichSensor->reading = String(thisPercent);
+						wichSensor->reading = thisPercent;
 						break;
 					}
 					case SENSOR_BATT_VOLTAGE:
-						if (!battery.isPresent(charger)) {
-							wichSensor->reading = String("-1");
+						if (!battery.present) {
+							wichSensor->reading = -1;
 							break;
 						}
-						wichSensor->reading = String(battery.voltage());
+						wichSensor->reading = battery.voltage();
 						break;
 
 					case SENSOR_BATT_CHARGE_RATE:
-						if (!battery.isPresent(charger)) {
-							wichSensor->reading = String("-1");
+						if (!battery.present) {
+							wichSensor->reading = -1;
 							break;
 						}
-						wichSensor->reading = String(battery.current());
+						wichSensor->reading = battery.current();
 						break;
 					case SENSOR_BATT_POWER:
 
-						if (!battery.isPresent(charger)) {
-							wichSensor->reading = String("-1");
+						if (!battery.present) {
+							wichSensor->reading = -1;
 							break;
 						}
-						wichSensor->reading = String(battery.power());
+						wichSensor->reading = battery.power();
 						break;
 					case SENSOR_SDCARD:
-						if (st.cardPresent) wichSensor->reading = String("1");
-						else wichSensor->reading = String("0");
+						wichSensor->reading = st.cardPresent ? 1 : 0;
 						break;
 					default: break;
 				}
@@ -1760,7 +2079,10 @@ bool SckBase::getReading(OneSensor *wichSensor)
 	if (wichSensor->state > 0) return false;
 
 	// Sensor reading ERROR, save null value
-	if (wichSensor->state == -1) wichSensor->reading == "null";
+	if (wichSensor->state == -1) {
+		wichSensor->reading = SensorValue();
+		return true;
+	}
 
 	// Temperature / Humidity temporary Correction
 	// TODO test to define this for 2.0 board
@@ -1770,33 +2092,80 @@ bool SckBase::getReading(OneSensor *wichSensor)
 
 		// Correct depending on battery/USB and network/sd card status
 		if (charger.onUSB) {
-			if (st.mode == MODE_NET) wichSensor->reading = String(aux_temp - 2.7);
-			else wichSensor->reading = String(aux_temp - 1.25);
+			if (st.mode == MODE_NET) wichSensor->reading = aux_temp - 2.7;
+			else wichSensor->reading = aux_temp - 1.25;
 		} else {
-			if (st.mode == MODE_NET) wichSensor->reading = String(aux_temp - 1.15);
-			else wichSensor->reading = String(aux_temp - 0.95);
+			if (st.mode == MODE_NET) wichSensor->reading = aux_temp - 1.15;
+			else wichSensor->reading = aux_temp - 0.95;
 		}
 
 	} else if(wichSensor->type == SENSOR_HUMIDITY) {
 		float aux_hum = wichSensor->reading.toFloat();
-		wichSensor->reading = String(aux_hum + 6.5);
+		wichSensor->reading = aux_hum + 6.5;
+	}
+
+	return true;
+}
+bool SckBase::streamRaw(uint8_t channels, SckStream &stream)
+{
+	uint8_t frameBuff[SCKSTREAM_MAX];
+	uint8_t payload[SCKSTREAM_RAW_MAX];
+	int32_t samples[SCKSTREAM_NOISE_BLOCK];
+	uint16_t sampleIndex = 0;
+
+	// Between readings the PM sensor is usually off, it stays on while streaming
+	bool pmWasStarted = urban.sck_pm.started;
+	if ((channels & (1 << RAW_PM)) && !urban.sck_pm.start()) channels &= ~(1 << RAW_PM);
+
+	bool noise = channels & (1 << RAW_NOISE);
+	if (noise && !urban.sck_noise.streamStart()) return false;
+
+	// Channels are polled in turn, only the MICS conversions wait (about 8 ms each on the bus, the microphone loses samples meanwhile)
+	while (!SerialUSB.available()) {
+
+		if (noise) {
+			sampleIndex += urban.sck_noise.streamRead(&samples[sampleIndex], SCKSTREAM_NOISE_BLOCK - sampleIndex);
+			if (sampleIndex == SCKSTREAM_NOISE_BLOCK) {
+				// 24 bits like the trace (the driver keeps 25, the lowest one is always 0)
+				for (uint8_t i=0; i<SCKSTREAM_NOISE_BLOCK; i++) {
+					int32_t value = samples[i] >> 1;
+					for (uint8_t b=0; b<3; b++) payload[i * 3 + b] = (value >> (8 * b)) & 0xFF;
+				}
+				SerialUSB.write(frameBuff, stream.rawFrame(frameBuff, RAW_NOISE, micros(), payload));
+				sampleIndex = 0;
+			}
+		}
+
+		for (uint8_t c=RAW_MICS_CO; c<=RAW_MICS_NO2; c++) {
+			if (!(channels & (1 << c))) continue;
+			uint16_t value = c == RAW_MICS_CO ? urban.sck_mics4514.getRawCO() : urban.sck_mics4514.getRawNO2();
+			payload[0] = value & 0xFF;
+			payload[1] = value >> 8;
+			SerialUSB.write(frameBuff, stream.rawFrame(frameBuff, static_cast<RawChannel>(c), micros(), payload));
+		}
+
+		if ((channels & (1 << RAW_PM)) && urban.sck_pm.streamFrame(payload)) {
+			SerialUSB.write(frameBuff, stream.rawFrame(frameBuff, RAW_PM, micros(), payload));
+		}
 	}
 
+	if (noise) urban.sck_noise.streamStop();
+	if ((channels & (1 << RAW_PM)) && !pmWasStarted) urban.sck_pm.stop();
 	return true;
 }
 bool SckBase::controlSensor(SensorType wichSensorType, String wichCommand)
 {
-	if (sensors[wichSensorType].controllable)  {
-		sprintf(outBuff, "%s: %s", sensors[wichSensorType].title, wichCommand.c_str());
+	if (sensors.info(wichSensorType).controllable)  {
+		snprintf(outBuff, sizeof(outBuff), "%s: %s", sensors.info(wichSensorType).title, wichCommand.c_str());
 		sckOut();
-		switch (sensors[wichSensorType].location) {
+		switch (sensors.info(wichSensorType).location) {
 				case BOARD_URBAN: urban.control(this, wichSensorType, wichCommand); break;
 				case BOARD_AUX: sckOut(auxBoards.control(wichSensorType, wichCommand)); break;
 				default: break;
 			}
 
 	} else {
-		sprintf(outBuff, "No configured command found for %s sensor!!!", sensors[wichSensorType].title);
+		sprintf(outBuff, "No configured command found for %s sensor!!!", sensors.info(wichSensorType).title);
 		sckOut();
 		return false;
 	}
@@ -1821,30 +2190,13 @@ bool SckBase::netPublish()
 	// 	*/
 
 
+	uint32_t perfStart = perf.start(PERF_PUBLISH);
 	bool result = false;
 	if (readingsList.countGroups() > 0) {
 		uint32_t thisGroup = 0;
 		if (readingsList.getFlag(thisGroup, readingsList.NET_PUBLISHED) == 0) {
 
-			memset(netBuff, 0, sizeof(netBuff));
-			uint16_t publishedReadings = 0;
-			sprintf(netBuff, "%c", ESPMES_MQTT_PUBLISH);
-
-			// Save time
-			epoch2iso(readingsList.getTime(thisGroup), ISOtimeBuff);
-			sprintf(netBuff, "%s{t:%s", netBuff, ISOtimeBuff);
-
-			uint16_t readingsOnThisGroup = readingsList.countReadings(thisGroup);
-			for (uint8_t i=0; i<readingsOnThisGroup; i++) {
-
-				OneReading thisReading = readingsList.readReading(thisGroup, i);
-				if (sensors[thisReading.type].id > 0 && !thisReading.value.startsWith("null")) {
-					sprintf(netBuff, "%s,%u:%s", netBuff, sensors[thisReading.type].id, thisReading.value.c_str());;
-					publishedReadings ++;
-				}
-			}
-
-			sprintf(netBuff, "%s%s", netBuff, "}");
+			uint16_t publishedReadings = netFormat(thisGroup);
 
 			sprintf(outBuff, "(%s) Sent %i readings to platform.", ISOtimeBuff, publishedReadings);
 			sckOut();
@@ -1861,16 +2213,48 @@ bool SckBase::netPublish()
 		}
 
 	}
+	perf.end(PERF_PUBLISH, perfStart);
 	return result;
 }
+uint16_t SckBase::netFormat(uint32_t wichGroup)
+{
+	memset(netBuff, 0, sizeof(netBuff));
+	uint16_t publishedReadings = 0;
+	sprintf(netBuff, "%c", ESPMES_MQTT_PUBLISH);
+
+	// Save time
+	epoch2iso(readingsList.getTime(wichGroup), ISOtimeBuff);
+	sprintf(netBuff, "%s{t:%s", netBuff, ISOtimeBuff);
+
+	uint16_t readingsOnThisGroup = readingsList.countReadings(wichGroup);
+	for (uint8_t i=0; i<readingsOnThisGroup; i++) {
+
+		OneReading thisReading = readingsList.readReading(wichGroup, i);
+		if (sensors.info(thisReading.type).id > 0 && !thisReading.value.isNull()) {
+			sprintf(netBuff, "%s,%u:%s", netBuff, sensors.info(thisReading.type).id, thisReading.value.format(valueBuff));
+			publishedReadings ++;
+		}
+	}
+
+	sprintf(netBuff, "%s%s", netBuff, "}");
+
+	return publishedReadings;
+}
 bool SckBase::sdPublish()
 {
 	if (!sdSelect()) return false;
 
-	sprintf(postFile.name, "%02d-%02d-%02d.CSV", rtc.getYear(), rtc.getMonth(), rtc.getDay());
-	if (!sd.exists(postFile.name)) writeHeader = true;
+	uint32_t perfStart = perf.start(PERF_PUBLISH);
+
+	char postFileName[13];
+	sprintf(postFileName, "%02d-%02d-%02d.CSV", rtc.getYear(), rtc.getMonth(), rtc.getDay());
+
+	// If the file is already open there is no need to look for it on the card
+	if (!sdWriter.isOpen(postFileName) && !sd.exists(postFileName)) writeHeader = true;
 	else {
 		if (writeHeader) {
+			sdWriter.close();
+
 			// This means actual enabled/disabled sensors are different from saved ones
 			// So we rename original file and start a new one
 			char newName[13];
@@ -1883,59 +2267,63 @@ bool SckBase::sdPublish()
 				fileNumber++;
 				if (!sd.exists(newName)) fileExists = false;
 			}
-			sd.rename(postFile.name, newName);
+			sd.rename(postFileName, newName);
 		}
 	}
 
-	postFile.file = sd.open(postFile.name, FILE_WRITE);
+	if (sdWriter.open(sd, postFileName)) {
 
-	if (postFile.file) {
+		// Binary archive, written alongside the CSV file
+		char archiveName[13];
+		sprintf(archiveName, "%02d-%02d-%02d.SCK", rtc.getYear(), rtc.getMonth(), rtc.getDay());
+		bool archiveOpen = config.sdArchive && archive.open(sd, sensors, archiveName, rtc.getEpoch());
 
 		// Write headers
 		if (writeHeader) {
-			postFile.file.print("TIME");
+			sdWriter.print("TIME");
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 				SensorType wichSensor = sensors.sensorsPriorized(i);
 				if (sensors[wichSensor].enabled) {
-					postFile.file.print(",");
-					postFile.file.print(sensors[wichSensor].shortTitle);
+					sdWriter.print(",");
+					sdWriter.print(sensors.info(wichSensor).shortTitle);
 				}
 			}
-			postFile.file.println("");
-			postFile.file.print("ISO 8601");
+			sdWriter.println();
+			sdWriter.print("ISO 8601");
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 				SensorType wichSensor = sensors.sensorsPriorized(i);
 				if (sensors[wichSensor].enabled) {
-					postFile.file.print(",");
-					if (String(sensors[wichSensor].unit).length() > 0) {
-						postFile.file.print(sensors[wichSensor].unit);
+					sdWriter.print(",");
+					if (String(sensors.info(wichSensor).unit).length() > 0) {
+						sdWriter.print(sensors.info(wichSensor).unit);
 					}
 				}
 			}
-			postFile.file.println("");
-			postFile.file.print("Time");
+			sdWriter.println();
+			sdWriter.print("Time");
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 				SensorType wichSensor = sensors.sensorsPriorized(i);
 				if (sensors[wichSensor].enabled) {
-					postFile.file.print(",");
-					postFile.file.print(sensors[wichSensor].title);
+					sdWriter.print(",");
+					sdWriter.print(sensors.info(wichSensor).title);
 				}
 			}
-			postFile.file.println("");
+			sdWriter.println();
 			for (uint8_t i=0; i<SENSOR_COUNT; i++) {
 				SensorType wichSensor = sensors.sensorsPriorized(i);
 				if (sensors[wichSensor].enabled) {
-					postFile.file.print(",");
-					postFile.file.print(sensors[wichSensor].id);
+					sdWriter.print(",");
+					sdWriter.print(sensors.info(wichSensor).id);
 				}
 			}
-			postFile.file.println("");
+			sdWriter.println();
 			writeHeader = false;
 		}
 
 		// From the saved groups check wich one's need to be published to sdcard
 		uint32_t savedGroups = readingsList.countGroups();
-		uint8_t counter = 0;
+		uint32_t counter = 0;
+		sdWriter.writeError = false;
 		for (uint32_t thisGroup=0; thisGroup<savedGroups; thisGroup++) {
 			if (readingsList.getFlag(thisGroup, readingsList.SD_PUBLISHED) == 0) {
 
@@ -1943,7 +2331,7 @@ bool SckBase::sdPublish()
 
 				// Save time
 				epoch2iso(readingsList.getTime(thisGroup), ISOtimeBuff);
-				postFile.file.print(ISOtimeBuff);
+				sdWriter.print(ISOtimeBuff);
 
 
 				// Go through all the enabled sensors
@@ -1960,47 +2348,72 @@ bool SckBase::sdPublish()
 
 								// Save reading
 								founded = true;
-								postFile.file.print(",");
-								postFile.file.print(thisReading.value);
+								sdWriter.print(",");
+								sdWriter.print(thisReading.value.format(valueBuff));
 							}
 						}
 
 						if (!founded) {
-							postFile.file.print(",");
-							postFile.file.print("null");
+							sdWriter.print(",");
+							sdWriter.print("null");
 						}
 					}
 				}
 
-				// Set SD_PUBLISHED flag for this group
-				readingsList.setFlag(thisGroup, readingsList.SD_PUBLISHED, true);
-
 				// newLine
-				postFile.file.println("");
+				sdWriter.println();
 
 				counter++;
-
-				epoch2iso(readingsList.getTime(thisGroup), ISOtimeBuff);
-				sprintf(outBuff, "(%s) Readings saved to sdcard.", ISOtimeBuff);
-				sckOut();
 			}
 		}
 
-		postFile.file.close();
-
 		if (counter > 0) {
 
+			// The groups are only flagged (and deleted on MODE_SD) once their rows are on the card, not on the RAM of the writer
+			if (!sdWriter.sync() || sdWriter.writeError) {
+				if (archiveOpen) archive.close();
+				sckOut("ERROR writing readings to sdcard!!! they will be written again on the next publish");
+				perf.end(PERF_PUBLISH, perfStart);
+				return false;
+			}
+
+			// Set SD_PUBLISHED flag for the same groups, the archive gets them here so a failed sync doesn't leave duplicated records
+			uint32_t flagged = 0;
+			for (uint32_t thisGroup=0; thisGroup<savedGroups && flagged<counter; thisGroup++) {
+				if (readingsList.getFlag(thisGroup, readingsList.SD_PUBLISHED) == 0) {
+					readingsList.setFlag(thisGroup, readingsList.SD_PUBLISHED, true);
+					flagged++;
+
+					if (archiveOpen && archive.append(readingsList.getTime(thisGroup))) {
+						uint16_t readingsOnThisGroup = readingsList.countReadings(thisGroup);
+						for (uint16_t re=0; re<readingsOnThisGroup; re++) {
+							OneReading thisReading = readingsList.readReading(thisGroup, re);
+							archive.setValue(thisReading.type, thisReading.value);
+						}
+					}
+
+					epoch2iso(readingsList.getTime(thisGroup), ISOtimeBuff);
+					sprintf(outBuff, "(%s) Readings saved to sdcard.", ISOtimeBuff);
+					sckOut();
+				}
+			}
+
 			// If we are on MODE_SD we can delete the published groups
 			if (st.mode == MODE_SD) {
-				for (uint8_t i=0; i<counter; i++) readingsList.delLastGroup();
+				for (uint32_t i=0; i<counter; i++) readingsList.delLastGroup();
 			}
 		}
+
+		if (archiveOpen && !archive.close()) sckOut("ERROR writing readings to sdcard archive!!!");
+
+		perf.end(PERF_PUBLISH, perfStart);
 		return true;
 
 	} else  {
 		st.cardPresent = false;
 		st.cardPresentError = false;
 	}
+	perf.end(PERF_PUBLISH, perfStart);
 	return false;
 }
 
@@ -2019,8 +2432,10 @@ bool SckBase::setTime(String epoch)
 		st.timeStat.setOk();
 		if (urbanPresent) {
 			// Update MICS clock
-			getReading(&sensors[SENSOR_CO_HEAT_TIME]);
-			getReading(&sensors[SENSOR_NO2_HEAT_TIME]);
+			OneSensor coHeatTime(SENSOR_CO_HEAT_TIME);
+			OneSensor no2HeatTime(SENSOR_NO2_HEAT_TIME);
+			getReading(&coHeatTime);
+			getReading(&no2HeatTime);
 		}
 
 		// Adjust variables after updating clock
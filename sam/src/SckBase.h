@@ -25,6 +25,15 @@
 #include "SckUrban.h"
 #include "SckAux.h"
 #include "SckList.h"
+#include "SckJournal.h"
+#include "SckArchive.h"
+#include "SckSdWriter.h"
+#include "SckEnergy.h"
+#include "SckPerf.h"
+#include "SckTrace.h"
+#include "SckMemory.h"
+#include "SckBridge.h"
+#include "SckStream.h"
 
 #include "version.h"
 
@@ -129,6 +138,8 @@ class SckBase
 
 		// Configuration
 		void loadConfig();
+		bool readJournalConfig();
+		bool writeJournalConfig();
 		bool publishInfo();
 		bool espInfoUpdated = false;
 		bool infoPublished = false;
@@ -142,30 +153,40 @@ class SckBase
 		// files
 		struct SckFile {char name[13]; File file;};
 		SckFile configFile {"CONFIG.TXT"};
-		SckFile postFile {};
 		SckFile debugFile {"DEBUG.TXT"};
 		SckFile infoFile {"INFO.TXT"};
+		SckArchive archive;
 		// Sd card
-		bool sdSelect();
 		volatile bool sdInitPending = false;
 		bool sdInit();
 		bool saveInfo();
 		bool infoSaved = false;
 
 		// Power
-		uint16_t sleepTime = 2500; 	// ms between micro led flashes
 		const uint16_t waitAfterLastEvent = 60000; // Time to avoid sleep after user interaction in ms
+		const uint8_t heartbeatInterval = 10; 	// seconds between micro led flashes while sleeping
+		const uint16_t tickSleepTime = 2500; 	// ms between wake ups when tickSleep is enabled
 
-		void updatePower();
+		void updatePower(); 				// Only does something on gauge or charger events or when the fallback poll is due
 		uint32_t updatePowerMillis = 0;
-		void goToSleep();
+		const uint16_t powerPollInterval = 60; 	// seconds between power checks when no interrupt arrives (battery insertion has no interrupt)
+		uint32_t lastPowerPoll = 0; 			// epoch, millis() doesn't run while sleeping
+		void updateEnergy();
+		uint32_t updateEnergyMillis = 0;
+		uint32_t sdBusyAccounted = 0; 			// Sdcard busy time already charged to the energy ledger (us)
+		uint32_t lastEnergySave = 0;
+		void goToSleep(uint32_t sleepMillis=0); 	// Sleeps until the next deadline or for a fixed time
 
 		// **** Sensors
 		uint32_t lastPublishTime = 0; 	// seconds
 		uint32_t lastSensorUpdate = 0;
+		SCKmodes scheduledMode = MODE_COUNT; 	// Mode and intervals lastPublishTime and lastSensorUpdate were set for
+		uint32_t scheduledReadInterval = 0;
+		uint32_t scheduledPublishInterval = 0;
 		bool timeToPublish = false;
 		void updateSensors();
 		bool netPublish();
+		uint16_t netFormat(uint32_t wichGroup); 	// Builds the publish message of a group on netBuff, returns the readings on it
 		bool sdPublish();
 		uint8_t pendingSensors = 0;
 		SensorType pendingSensorsList[SENSOR_COUNT];
@@ -204,16 +225,18 @@ class SckBase
 		// **** Sensors
 		AllSensors sensors;
 		bool getReading(OneSensor *wichSensor);
+		bool streamRaw(uint8_t channels, SckStream &stream); 	// Sends the driver data of the channels (bit 1 << RawChannel) until there is input on the console (monitor -binary -raw)
 		bool controlSensor(SensorType wichSensorType, String wichCommand);
 		bool enableSensor(SensorType wichSensor);
 		bool disableSensor(SensorType wichSensor);
 		bool writeHeader = false;
 
-		// RAM readings store
+		// Readings store (on flash, or RAM if flash is not available)
 		SckList readingsList;
 
 		// Configuration
 		Configuration config;
+		SckJournal journal;
 		Configuration getConfig();
 		void saveConfig(bool defaults=false);
 
@@ -239,6 +262,7 @@ class SckBase
 		const char *outLevelTitles[OUT_COUNT] PROGMEM = { "Silent",	"Normal", "Verbose"	};
 		OutLevels outputLevel = OUT_VERBOSE;
 		char outBuff[240];
+		char valueBuff[SENSORVALUE_SIZE]; 		// Sensor values are formatted here when printed, published or saved
 		void sckOut(String strOut, PrioLevels priority=PRIO_MED, bool newLine=true);	// Accepts String object
 		void sckOut(const char *strOut, PrioLevels priority=PRIO_MED, bool newLine=true);	// Accepts constant string
 		void sckOut(PrioLevels priority=PRIO_MED, bool newLine=true);
@@ -252,10 +276,36 @@ class SckBase
 		// Commands
 		AllCommands commands;
 
+		// Sleep scheduler
+		enum WakeReason { WAKE_READING, WAKE_PUBLISH, WAKE_HEARTBEAT, WAKE_RESET, WAKE_FIXED, WAKE_COUNT };
+		struct SleepStats {
+			uint32_t wakeups = 0;
+			uint32_t reasons[WAKE_COUNT] = {}; 	// Deadline that woke us up
+			uint32_t early = 0; 			// Woken up before the deadline by an interrupt (button, sdcard...)
+			uint32_t sleptSeconds = 0;
+			uint32_t awakeMillis = 0; 		// Time awake between a wake up and the next sleep
+			uint32_t awakeCycles = 0;
+		};
+		SleepStats sleepStats;
+		uint32_t lastWakeMillis = 0; 			// millis() doesn't run while sleeping, so it only counts awake time
+		bool tickSleep = false; 			// Sleep on a fixed tick instead of until the next deadline (to compare consumption)
+		uint32_t nextWakeup(WakeReason &reason); 	// Epoch of the next thing that needs the kit awake
+
+		// Main loop instrumentation
+		SckPerf perf = SckPerf(&rtc);
+		uint16_t perfInfoInterval = 0; 			// hours between info publishes with the loop stats (0: only after booting)
+		uint32_t lastInfoTime = 0;
+
+		// RAM telemetry
+		SckMemory memory;
+
 		// SDcard
 		SdFat sd;
 		bool sdDetect();
-		SckFile monitorFile {"MONITOR.CSV"};
+		bool sdSelect();
+		SckSdWriter sdWriter; 			// Daily CSV file (and monitor file), kept open between publishes
+		SckTrace trace = SckTrace(&rtc); 	// Raw inputs of the drivers for the native build (trace command)
+		const char *monitorFileName = "MONITOR.CSV";
 
 		// Power
 		uint8_t wakeUP_H = 3; 	// 3AM UTC
@@ -263,8 +313,18 @@ class SckBase
 		uint8_t wakeUP_S = 0;
 		void sck_reset();
 		SckBatt battery;
-		volatile bool battPendingEvent = false;
+		volatile bool battPendingEvent = false; 	// Gauge interrupt (1% SoC change)
 		SckCharger charger;
+		volatile bool chargerPendingEvent = false; 	// Charger interrupt (VBUS, charge status or fault change)
+		struct PowerStats {
+			uint32_t checks = 0;
+			uint32_t polls = 0;
+			uint32_t gaugeEvents = 0;
+			uint32_t chargerEvents = 0;
+		};
+		PowerStats powerStats;
+		SckEnergy energy;
+		bool saveEnergy(); 				// Saves the energy ledger on the flash journal
 		bool sckOFF = false;
 
 		// Misc
@@ -282,10 +342,14 @@ class SckBase
 #ifdef testing
 		friend class SckTest;
 #endif
+#ifdef benchmark
+		friend class SckBench;
+#endif
 };
 
 bool I2Cdetect(TwoWire *_Wire, byte address);
 void ISR_button();
 void ISR_sdDetect();
+void ISR_deadline();
 void ext_reset();
 
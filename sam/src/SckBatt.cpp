@@ -29,6 +29,7 @@ bool SckCharger::resetConfig()
 	byte conf = readREG(POWER_ON_CONF_REG);
 
 	conf |= (1<<RESET_DEFAULT_CONFIG);
+	chargeEnabled = -1;
 
 	if (writeREG(POWER_ON_CONF_REG, conf)) return true;
 	else return false;
@@ -88,13 +89,16 @@ bool SckCharger::chargeState(int8_t enable)
 {
 
 	if (enable > -1) {
+		if (enable == chargeEnabled) return chargeEnabled;
 		byte conf = readREG(POWER_ON_CONF_REG);
 		if (enable)	conf |= (1 << CHG_CONFIG);
 		else  conf &= ~(1 << CHG_CONFIG);
-		writeREG(POWER_ON_CONF_REG, conf);
+		writeREG(POWER_ON_CONF_REG, conf); 	// writeREG reads the register back, that refreshes the cache
+		return chargeEnabled;
 	}
 
-	return (readREG(POWER_ON_CONF_REG) >> CHG_CONFIG) & 1;
+	if (chargeEnabled < 0) chargeEnabled = (readREG(POWER_ON_CONF_REG) >> CHG_CONFIG) & 1;
+	return chargeEnabled;
 }
 bool SckCharger::batfetState(int8_t enable)
 {
@@ -243,6 +247,7 @@ byte SckCharger::getNewFault()
 byte SckCharger::readREG(byte wichRegister)
 {
 
+	i2cCount++;
 	Wire.beginTransmission(address);
 	Wire.write(wichRegister);
 	Wire.endTransmission(true);
@@ -250,12 +255,19 @@ byte SckCharger::readREG(byte wichRegister)
 
 	uint32_t started = millis();
 	while(Wire.available() != 1) {
-  		if (millis() - started > timeout) return -1;
+  		if (millis() - started > timeout) {
+			if (wichRegister == POWER_ON_CONF_REG) chargeEnabled = -1;
+			return -1;
+		}
    	}
-   	return Wire.read();
+	byte value = Wire.read();
+	SckTrace::i2c(&Wire, address, &wichRegister, 1, &value, 1);
+	if (wichRegister == POWER_ON_CONF_REG) chargeEnabled = (value >> CHG_CONFIG) & 1;
+   	return value;
 }
 bool SckCharger::writeREG(byte wichRegister, byte data)
 {
+	i2cCount++;
 	Wire.beginTransmission(address);
 	Wire.write(wichRegister);
 	Wire.write(data);
@@ -290,10 +302,11 @@ void SckCharger::detectUSB(SckBase *base)
 }
 
 // Battery
-bool SckBatt::isPresent(SckCharger charger)
+bool SckBatt::isPresent(SckCharger &charger)
 {
 	// First check pinBATT_INSERTION
 	uint32_t valueRead = 0;
+	adcCount++;
 	while (ADC->STATUS.bit.SYNCBUSY == 1);
 	ADC->INPUTCTRL.bit.MUXPOS = ADC_Channel6; 	// Selection for the positive ADC input
 	while (ADC->STATUS.bit.SYNCBUSY == 1);
@@ -310,6 +323,7 @@ bool SckBatt::isPresent(SckCharger charger)
 	while (ADC->STATUS.bit.SYNCBUSY == 1);
 
 	if (valueRead < 400 and millis() > 7000) {  // Give time to the charger setup after booting boot
+		i2cCount++;
 		Wire.beginTransmission(address);
 		uint8_t error = Wire.endTransmission();
 
@@ -326,12 +340,13 @@ bool SckBatt::isPresent(SckCharger charger)
 	configured = false;
 	return false;
 }
-bool SckBatt::setup(SckCharger charger, bool force)
+bool SckBatt::setup(SckCharger &charger, bool force)
 {
 	// This function should only be called if we are sure the batt is present (from inside battery.isPresent())
 	if (configured && !force) return true;
 
 	// Check if gauge is alive
+	i2cCount++;
 	Wire.beginTransmission(address);
 	uint8_t error = Wire.endTransmission();
 	if (error != 0) return false;
@@ -596,6 +611,7 @@ uint8_t SckBatt::readBlockData(uint8_t offset)
 }
 bool SckBatt::i2cWriteBytes(uint8_t subAddress, uint8_t * src, uint8_t count)
 {
+	i2cCount++;
 	Wire.beginTransmission(address);
 	Wire.write(subAddress);
 	for (int i=0; i<count; i++) Wire.write(src[i]);
@@ -606,6 +622,7 @@ bool SckBatt::i2cWriteBytes(uint8_t subAddress, uint8_t * src, uint8_t count)
 bool SckBatt::i2cReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count)
 {
 	int16_t timeout = 2000;	
+	i2cCount++;
 	Wire.beginTransmission(address);
 	Wire.write(subAddress);
 	Wire.endTransmission(true);
@@ -615,6 +632,7 @@ bool SckBatt::i2cReadBytes(uint8_t subAddress, uint8_t * dest, uint8_t count)
 		delay(1);
 	if (timeout) {
 		for (int i=0; i<count; i++) dest[i] = Wire.read();
+		SckTrace::i2c(&Wire, address, &subAddress, 1, dest, count);
 		return true;
 	}
 	
@@ -54,6 +54,8 @@ private:
 	byte readREG(byte wichRegister);
 	bool writeREG(byte wichRegister, byte data);
 
+	int8_t chargeEnabled = -1; 		// Cached CHG_CONFIG bit, only we change it (-1: unknown)
+
 public:
 
 	enum ChargeStatus {
@@ -112,6 +114,7 @@ public:
 	bool onUSB = true;
 	bool batfetON = false;
 	ChargeStatus chargeStatus = CHRG_NOT_CHARGING;
+	uint32_t i2cCount = 0; 		// I2C transactions with the charger
 
 };
 
@@ -209,11 +212,13 @@ class SckBatt
 
 		bool present = false;
 		int8_t lastPercent = -1;
+		uint32_t i2cCount = 0; 		// I2C transactions with the gauge
+		uint32_t adcCount = 0; 		// Battery insertion pin conversions
 		// Design capacity in mAh, page 49 of (http://www.ti.com/lit/ug/sluubb0/sluubb0.pdf)
 		uint16_t designCapacity = 2000; 	// Don't change this default here, change it in Config.h. This will be overwriten by config value
 
-		bool setup(SckCharger charger, bool force=false);
-		bool isPresent(SckCharger charger);
+		bool setup(SckCharger &charger, bool force=false);
+		bool isPresent(SckCharger &charger);
 
 		float voltage();
 		int16_t current();
@@ -0,0 +1,145 @@
+#include "SckBase.h"
+
+#ifdef benchmark
+#include "SckBench.h"
+
+#ifdef ARDUINO_ARCH_SAMD
+// SysTick counts the CPU clock down and reloads every millisecond (it drives millis()), together they give the cycles since boot
+uint64_t SckBench::clock()
+{
+	uint32_t ms, ticks;
+	do {
+		ms = millis();
+		ticks = SysTick->VAL;
+	} while (ms != millis());
+	return (uint64_t)ms * (SysTick->LOAD + 1) + (SysTick->LOAD - ticks);
+}
+static const char *benchUnit = "cycles";
+static const uint32_t benchClock = F_CPU;
+#else
+#include <chrono>
+uint64_t SckBench::clock()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char *benchUnit = "ns";
+static const uint32_t benchClock = 0;
+#endif
+
+constexpr const char *SckBench::titles[];
+constexpr uint16_t SckBench::ops[];
+
+void SckBench::run()
+{
+	// Results only go to the console
+	while (!SerialUSB) delay(10);
+
+	// Header: what was measured
+	char line[160];
+	snprintf(line, sizeof(line), "{\"firmware\":\"%s\",\"build\":\"%s\",\"unit\":\"%s\",\"clock\":%lu,\"repeats\":%u}",
+		benchBase->SAMversion.c_str(), benchBase->SAMbuildDate.c_str(), benchUnit, (unsigned long)benchClock, BENCH_REPEATS);
+	SerialUSB.println(line);
+
+	// A tone with some noise around the middle of the microphone range, centered like getReading() does
+	srand(1);
+	for (uint16_t i=0; i<Sck_Noise::SAMPLE_NUM; i++) samples[i] = 200000 * sin(2 * PI * 1000 * i / 44100.0) + (rand() % 20000) - 10000;
+
+	for (uint8_t r=0; r<BENCH_REPEATS; r++) repeat(r);
+	for (uint8_t k=0; k<BENCH_COUNT; k++) print(static_cast<Kernel>(k));
+
+	snprintf(line, sizeof(line), "{\"done\":%u}", BENCH_COUNT);
+	SerialUSB.println(line);
+}
+void SckBench::repeat(uint8_t wichRepeat)
+{
+	uint64_t started;
+	SckList &list = benchBase->readingsList;
+	uint32_t firstTime = 1767225600 + wichRepeat * 3600;
+
+	started = clock();
+	for (uint16_t i=0; i<ops[BENCH_EPOCH2ISO]; i++) benchBase->epoch2iso(firstTime + i * 61, benchBase->ISOtimeBuff);
+	record(BENCH_EPOCH2ISO, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t i=0; i<ops[BENCH_PRIORIZED]; i++) {
+		for (uint8_t s=0; s<SENSOR_COUNT; s++) sink += benchBase->sensors.sensorsPriorized(s);
+	}
+	record(BENCH_PRIORIZED, wichRepeat, started);
+
+	// Groups like the urban board ones, saved on top of whatever the kit has stored (group 0 is always the newest)
+	started = clock();
+	for (uint16_t g=0; g<ops[BENCH_LIST_SAVE]; g++) {
+		list.createGroup(firstTime + g * 60);
+		list.appendReading(SENSOR_BATT_PERCENT, SensorValue(100 - g));
+		list.appendReading(SENSOR_LIGHT, SensorValue(300 + g * 7));
+		list.appendReading(SENSOR_TEMPERATURE, SensorValue::fixed(2231 + g, 2));
+		list.appendReading(SENSOR_HUMIDITY, SensorValue::fixed(4510 - g * 3, 2));
+		list.appendReading(SENSOR_NOISE_DBA, SensorValue::fixed(5872 + (g % 5) * 41, 2));
+		list.appendReading(SENSOR_PRESSURE, SensorValue::fixed(10130 - g, 2));
+		list.appendReading(SENSOR_PM_1, SensorValue(8 + g % 3));
+		list.appendReading(SENSOR_PM_25, SensorValue(12 + g % 4));
+		list.appendReading(SENSOR_PM_10, SensorValue(15 + g % 5));
+		list.saveLastGroup();
+	}
+	record(BENCH_LIST_SAVE, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t g=0; g<ops[BENCH_LIST_READ]; g++) {
+		uint16_t readings = list.countReadings(g);
+		for (uint8_t i=0; i<readings; i++) sink += list.readReading(g, i).type;
+	}
+	record(BENCH_LIST_READ, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t g=0; g<ops[BENCH_NET_FORMAT]; g++) sink += benchBase->netFormat(g);
+	record(BENCH_NET_FORMAT, wichRepeat, started);
+
+	// The ESP gets the message without its type
+	started = clock();
+	for (uint16_t g=0; g<ops[BENCH_ESP_JSON]; g++) sink += readingsToJson(&benchBase->netBuff[1], payload, sizeof(payload));
+	record(BENCH_ESP_JSON, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t g=0; g<ops[BENCH_LIST_DELETE]; g++) list.delLastGroup();
+	record(BENCH_LIST_DELETE, wichRepeat, started);
+
+	// Noise pipeline, on the same samples every time (FFT() includes scaling and windowing)
+	Sck_Noise &noise = benchBase->urban.sck_noise;
+	started = clock();
+	for (uint16_t i=0; i<ops[BENCH_NOISE_SCALE]; i++) sink += noise.dynamicScale(samples, scaled);
+	record(BENCH_NOISE_SCALE, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t i=0; i<ops[BENCH_NOISE_WINDOW]; i++) noise.applyWindow(scaled, hannWindow, Sck_Noise::SAMPLE_NUM);
+	record(BENCH_NOISE_WINDOW, wichRepeat, started);
+
+	started = clock();
+	for (uint16_t i=0; i<ops[BENCH_NOISE_FFT]; i++) noise.FFT(samples);
+	record(BENCH_NOISE_FFT, wichRepeat, started);
+	sink += noise.readingFFT[10];
+}
+void SckBench::record(Kernel wichKernel, uint8_t repeat, uint64_t started)
+{
+	results[wichKernel][repeat] = (float)(clock() - started) / ops[wichKernel];
+}
+void SckBench::print(Kernel wichKernel)
+{
+	// Insertion sort, there are only a few repeats
+	float sorted[BENCH_REPEATS];
+	for (uint8_t i=0; i<BENCH_REPEATS; i++) {
+		float value = results[wichKernel][i];
+		uint8_t j = i;
+		while (j > 0 && sorted[j - 1] > value) {
+			sorted[j] = sorted[j - 1];
+			j--;
+		}
+		sorted[j] = value;
+	}
+
+	char line[128];
+	snprintf(line, sizeof(line), "{\"bench\":\"%s\",\"unit\":\"%s\",\"ops\":%u,\"min\":%.1f,\"median\":%.1f}",
+		titles[wichKernel], benchUnit, ops[wichKernel], sorted[0], sorted[BENCH_REPEATS / 2]);
+	SerialUSB.println(line);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+// Microbenchmarks of the firmware hot paths, built with -D benchmark (pio run -e bench, or -e native_bench on the workstation).
+// Every kernel runs BENCH_REPEATS times and prints one JSON line with the cost of one operation (the fastest repeat and the median):
+//
+//	{"bench":"epoch2iso","unit":"cycles","ops":100,"min":1234.5,"median":1240.0}
+//
+// On the kit the unit is CPU cycles (SysTick, the M0+ has no cycle counter), on the workstation nanoseconds.
+// tools/sckbench.py collects the lines and compares two runs. The groups saved by the list kernels are deleted afterwards.
+
+#include "SckBase.h"
+
+#define BENCH_REPEATS 7
+
+class SckBench
+{
+	private:
+		SckBase* benchBase;
+
+		enum Kernel {
+			BENCH_EPOCH2ISO,
+			BENCH_PRIORIZED,
+			BENCH_LIST_SAVE,
+			BENCH_LIST_READ,
+			BENCH_NET_FORMAT,
+			BENCH_ESP_JSON,
+			BENCH_LIST_DELETE,
+			BENCH_NOISE_SCALE,
+			BENCH_NOISE_WINDOW,
+			BENCH_NOISE_FFT,
+
+			BENCH_COUNT
+		};
+		static constexpr const char *titles[BENCH_COUNT] = {
+			"epoch2iso",
+			"sensors.priorized",
+			"list.save",
+			"list.read",
+			"net.format",
+			"esp.json",
+			"list.delete",
+			"noise.scale",
+			"noise.window",
+			"noise.fft",
+		};
+		static constexpr uint16_t ops[BENCH_COUNT] = { 100, 10, 16, 16, 16, 16, 16, 4, 4, 4 };
+
+		float results[BENCH_COUNT][BENCH_REPEATS]; 	// Cost of one operation on every repeat
+		int32_t samples[Sck_Noise::SAMPLE_NUM];
+		int16_t scaled[Sck_Noise::SAMPLE_NUM];
+		char payload[1024];
+		volatile uint32_t sink = 0; 			// Keeps the compiler from dropping the results
+
+		uint64_t clock();
+		void record(Kernel wichKernel, uint8_t repeat, uint64_t started);
+		void repeat(uint8_t wichRepeat);
+		void print(Kernel wichKernel);
+
+	public:
+		SckBench(SckBase* base) {
+			benchBase = base;
+		}
+		void run();
+};
@@ -0,0 +1,90 @@
+#include "SckBridge.h"
+
+#ifdef ARDUINO_ARCH_SAMD
+#include <utility/DMA.h> 	// DMA driver of the I2S library (the microphone uses it too)
+
+// The DMA callback only gets the channel
+static volatile bool *bridgeSending = 0;
+static void bridgeSent(int channel)
+{
+	if (bridgeSending) *bridgeSending = false;
+}
+#endif
+
+void SckBridge::begin(uint32_t wichBaud)
+{
+	setBaud(wichBaud);
+	usbBaud = SerialUSB.baud();
+
+#ifdef ARDUINO_ARCH_SAMD
+	DMA.begin();
+	channel = DMA.allocateChannel();
+	if (channel >= 0) {
+		DMA.setTransferWidth(channel, 8);
+		DMA.incSrc(channel);
+		DMA.setTriggerSource(channel, SERCOM0_DMAC_ID_TX);
+		bridgeSending = &sending;
+		DMA.onTransferComplete(channel, bridgeSent);
+	}
+#endif
+}
+bool SckBridge::update()
+{
+	// esptool changes the port speed after asking the ESP stub to change it
+	uint32_t newBaud = SerialUSB.baud();
+	if (newBaud != usbBaud) {
+		usbBaud = newBaud;
+		if (newBaud >= 9600 && newBaud != baud) setBaud(newBaud);
+	}
+
+	// From USB to the ESP
+	bool fromUsb = false;
+	int waiting = SerialUSB.available();
+	if (waiting > 0 && filled < BRIDGE_BUFF_SIZE) {
+		if (waiting > BRIDGE_BUFF_SIZE - filled) waiting = BRIDGE_BUFF_SIZE - filled;
+		filled += SerialUSB.readBytes((char *)&buff[current][filled], waiting);
+		fromUsb = true;
+	}
+	if (filled > 0 && !sending) send();
+
+	// From the ESP to USB
+	waiting = SerialESP.available();
+	if (waiting > 0) {
+		if (waiting > (int)sizeof(espBuff)) waiting = sizeof(espBuff);
+		for (uint8_t i=0; i<waiting; i++) espBuff[i] = SerialESP.read();
+		SerialUSB.write(espBuff, waiting);
+		toUsb += waiting;
+	}
+
+	return fromUsb;
+}
+void SckBridge::send()
+{
+	toEsp += filled;
+
+#ifdef ARDUINO_ARCH_SAMD
+	if (channel >= 0) {
+		sending = true;
+		DMA.transfer(channel, buff[current], (void *)&SERCOM0->USART.DATA.reg, filled);
+		current = !current;
+		filled = 0;
+		return;
+	}
+#endif
+
+	SerialESP.write(buff[current], filled);
+	filled = 0;
+}
+void SckBridge::setBaud(uint32_t wichBaud)
+{
+	if (wichBaud > BRIDGE_MAX_BAUD) wichBaud = BRIDGE_MAX_BAUD;
+
+	// What is on the way goes at the old speed
+	while (sending);
+	SerialESP.flush();
+	delay(1);
+
+	SerialESP.end();
+	SerialESP.begin(wichBaud);
+	baud = wichBaud;
+}
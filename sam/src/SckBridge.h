@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+// USB <-> ESP serial bridge used to flash the ESP (esp -flash [baud], see tools/sck.py flashESP).
+// The ESP UART follows the speed the computer sets on the USB port: esptool syncs with the ESP ROM at 115200, loads its stub,
+// asks it to change speed and then changes the port, so the bridge changes too. It starts at the speed given to the command.
+// Bytes going to the ESP (the firmware image) are sent by DMA from two buffers, one goes out on the UART while the other is
+// filled from USB. The answers of the ESP are short, they go to USB in chunks from the UART buffer.
+// SERCOM UARTs run from the 48MHz clock with 16x oversampling, 3Mbaud is the limit.
+
+#define BRIDGE_MAX_BAUD 3000000
+#define BRIDGE_BUFF_SIZE 256
+
+class SckBridge
+{
+	public:
+		uint32_t baud = 0;
+		uint32_t toEsp = 0;
+		uint32_t toUsb = 0;
+
+		void begin(uint32_t wichBaud);
+		bool update(); 		// Forwards what is waiting on both sides, returns true if something came from USB
+
+	private:
+		uint8_t buff[2][BRIDGE_BUFF_SIZE];
+		uint8_t current = 0; 		// Buffer being filled from USB, the other one can be on the DMA
+		uint16_t filled = 0;
+		uint8_t espBuff[64];
+		uint32_t usbBaud = 0; 		// Last speed set by the computer
+		int8_t channel = -1; 		// DMA channel (-1 if there is none, the bytes are written to the UART)
+		volatile bool sending = false;
+
+		void setBaud(uint32_t wichBaud);
+		void send();
+};
@@ -0,0 +1,91 @@
+#include "SckEnergy.h"
+
+constexpr const char *SckEnergy::titles[];
+
+static const float UAS_PER_MAH = 3600000.0;
+
+void SckEnergy::set(EnergyDomain wichDomain, float current)
+{
+	if (current == draw[wichDomain]) return;
+
+	account(wichDomain, now());
+	draw[wichDomain] = current;
+}
+void SckEnergy::spend(EnergyDomain wichDomain, float current, uint32_t ms)
+{
+	charge(wichDomain, current, ms);
+}
+void SckEnergy::slept(uint32_t ms)
+{
+	// Domains that were on while sleeping get charged on their next change
+	sleptMillis += ms;
+}
+bool SckEnergy::rollover(uint32_t epoch)
+{
+	uint32_t day = epoch / 86400;
+
+	// The first synced date is adopted by whatever was counted before the clock was synced
+	if (today.day == 0) today.day = day;
+	if (day == today.day) return false;
+
+	flush();
+	yesterday = today;
+	today = EnergyDay();
+	today.day = day;
+
+	return true;
+}
+void SckEnergy::gauge(int32_t remainCapacity)
+{
+	if (remainCapacity < 0) {
+		lastCapacity = -1;
+		return;
+	}
+
+	flush();
+
+	if (lastCapacity >= 0) {
+		// Capacity going up means the gauge recalibrated, the period is not counted
+		if (remainCapacity <= lastCapacity) {
+			today.gaugeUsed += lastCapacity - remainCapacity;
+			today.gaugeEstimated += estimatedTotal - estimatedAtGauge;
+		}
+	}
+
+	lastCapacity = remainCapacity;
+	estimatedAtGauge = estimatedTotal;
+}
+void SckEnergy::flush()
+{
+	uint32_t time = now();
+	for (uint8_t i=0; i<ENERGY_COUNT; i++) account(static_cast<EnergyDomain>(i), time);
+}
+float SckEnergy::ratio(const EnergyDay &wichDay)
+{
+	if (wichDay.gaugeUsed < GAUGE_MIN_MAH || wichDay.gaugeEstimated == 0) return 1;
+	return (wichDay.gaugeUsed * UAS_PER_MAH) / wichDay.gaugeEstimated;
+}
+float SckEnergy::mAh(const EnergyDay &wichDay, EnergyDomain wichDomain)
+{
+	return (wichDay.charge[wichDomain] / UAS_PER_MAH) * ratio(wichDay);
+}
+float SckEnergy::totalmAh(const EnergyDay &wichDay)
+{
+	float total = 0;
+	for (uint8_t i=0; i<ENERGY_COUNT; i++) total += mAh(wichDay, static_cast<EnergyDomain>(i));
+	return total;
+}
+void SckEnergy::account(EnergyDomain wichDomain, uint32_t time)
+{
+	charge(wichDomain, draw[wichDomain], time - since[wichDomain]);
+	since[wichDomain] = time;
+}
+void SckEnergy::charge(EnergyDomain wichDomain, float current, uint32_t ms)
+{
+	if (current <= 0 || ms == 0) return;
+
+	uint64_t thisCharge = (uint64_t)(current * ms);
+	today.onMillis[wichDomain] += ms;
+	today.charge[wichDomain] += thisCharge;
+	estimatedTotal += thisCharge;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Energy ledger: estimates how much charge each subsystem takes from the battery.
+// Every power domain is charged its current for the time it stays on. The currents are nominal values (datasheets and bench measurements)
+// except the gas sensor heaters, whose current comes from their PWM duty cycle.
+// While running on battery the drop of the gauge remaining capacity is compared with the estimate for the same period,
+// that ratio is used to scale the per subsystem figures once enough charge has been measured.
+// One record is kept for the current day and one for the previous (complete) day, SckBase saves both on the flash journal.
+
+enum EnergyDomain {
+	ENERGY_AWAKE,
+	ENERGY_SLEEP,
+	ENERGY_ESP,
+	ENERGY_PM,
+	ENERGY_HEATER,
+	ENERGY_SD,
+
+	ENERGY_COUNT
+};
+
+struct EnergyDay {
+	uint32_t day = 0; 				// Days since epoch (0: clock not synced yet)
+	uint32_t onMillis[ENERGY_COUNT] = {};
+	uint64_t charge[ENERGY_COUNT] = {}; 		// uAs (mA * ms)
+	uint32_t gaugeUsed = 0; 			// mAh measured by the gauge while on battery
+	uint64_t gaugeEstimated = 0; 			// uAs estimated for the same periods
+};
+
+class SckEnergy
+{
+	private:
+		float draw[ENERGY_COUNT] = {}; 		// mA
+		uint32_t since[ENERGY_COUNT] = {};
+		uint32_t sleptMillis = 0;
+
+		uint64_t estimatedTotal = 0; 		// uAs since boot
+		uint64_t estimatedAtGauge = 0;
+		int32_t lastCapacity = -1; 		// mAh (-1: not on battery)
+
+		void account(EnergyDomain wichDomain, uint32_t time);
+		void charge(EnergyDomain wichDomain, float current, uint32_t ms);
+
+	public:
+		// Nominal currents (mA), constants on flash like the titles
+		static constexpr float AWAKE_CURRENT = 12.0; 		// SAMD21 at 48Mhz plus regulators and leds
+		static constexpr float SLEEP_CURRENT = 0.8; 		// Whole board in deep sleep
+		static constexpr float ESP_CURRENT = 80.0; 		// ESP8266 average with WiFi connected
+		static constexpr float PM_CURRENT = 80.0; 			// PMS5003 with fan running
+		static constexpr float SD_CURRENT = 30.0; 			// Sdcard while writing
+		static constexpr uint16_t GAUGE_MIN_MAH = 5; 		// Measured charge needed before trusting the gauge ratio
+
+		static constexpr const char *titles[ENERGY_COUNT] = {
+			"awake",
+			"sleep",
+			"esp",
+			"pm",
+			"heater",
+			"sdcard",
+		};
+
+		EnergyDay today;
+		EnergyDay yesterday;
+
+		uint32_t now() { return millis() + sleptMillis; } 	// millis() doesn't run while sleeping
+		void set(EnergyDomain wichDomain, float current); 	// Changes the current of a domain (0 when it's off)
+		void spend(EnergyDomain wichDomain, float current, uint32_t ms); 	// For short activities measured by their owners
+		void slept(uint32_t ms); 				// Called after waking up
+		bool rollover(uint32_t epoch); 				// Starts a new day if the date changed, returns true if it did
+		void gauge(int32_t remainCapacity); 			// Remaining capacity in mAh, -1 when the battery is not discharging
+		void flush(); 						// Brings all domains up to date (before reporting or saving)
+
+		float ratio(const EnergyDay &wichDay); 			// Measured / estimated (1 if the gauge has not measured enough)
+		float mAh(const EnergyDay &wichDay, EnergyDomain wichDomain); 	// Scaled by the gauge ratio
+		float totalmAh(const EnergyDay &wichDay);
+};
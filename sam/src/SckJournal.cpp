@@ -0,0 +1,389 @@
+#include "SckJournal.h"
+
+static const uint8_t journalMagic[4] = {'S', 'C', 'K', 'J'};
+static const uint8_t JOURNAL_COMMITED = 0x00;
+static const uint8_t JOURNAL_MAX_VALUE = 254; 		// 0xFF on the len byte means erased flash
+static const uint8_t JOURNAL_CHUNK = 32;
+static const uint8_t JOURNAL_BATCH_BEGIN = 0x00;
+static const uint8_t JOURNAL_BATCH_COMMIT = 0x01;
+
+bool SckJournal::begin()
+{
+	ready = false;
+
+	flashSelect();
+	if (!flash.begin()) {
+		debugOut("Journal: flash not found!");
+		return false;
+	}
+	flash.setClock(133000);
+
+	uint32_t seq[SCKJOURNAL_SECTORS];
+	bool valid[SCKJOURNAL_SECTORS];
+	for (uint8_t i=0; i<SCKJOURNAL_SECTORS; i++) valid[i] = readHeader(i, seq[i]);
+
+	if (!valid[0] && !valid[1]) {
+
+		// First boot (or both sectors damaged): start a new journal
+		debugOut("Journal: no valid sector found, formating...");
+		if (!format(0, 1, true)) return false;
+		activeSector = 0;
+		sequence = 1;
+
+	} else {
+
+		// The sector with the highest sequence is the active one, the other one is left over from the previous compaction
+		if (valid[0] && (!valid[1] || seq[0] > seq[1])) activeSector = 0;
+		else activeSector = 1;
+		sequence = seq[activeSector];
+	}
+
+	if (!scan()) {
+		// A write was interrupted, keep only the commited records
+		debugOut("Journal: found an interrupted write, compacting...");
+		if (!compact()) return false;
+	}
+
+	ready = true;
+	return true;
+}
+bool SckJournal::has(uint8_t key)
+{
+	return ready && keyIndex[key] != 0;
+}
+bool SckJournal::read(uint8_t key, void *data, uint8_t len)
+{
+	if (!has(key)) return false;
+
+	flashSelect();
+	uint32_t address = sectorAddress(activeSector) + keyIndex[key];
+
+	// If the stored size doesn't match (the structure changed between firmware versions) the caller should use its defaults
+	if (flash.readByte(address) != len) return false;
+
+	return flash.readByteArray(address + 2, (uint8_t*)data, len);
+}
+bool SckJournal::write(uint8_t key, const void *data, uint8_t len)
+{
+	if (!ready || key == JKEY_BATCH || len > JOURNAL_MAX_VALUE) return false;
+
+	// Don't touch the flash if the stored value is the same
+	if (keyIndex[key] != 0) {
+
+		flashSelect();
+		uint32_t address = sectorAddress(activeSector) + keyIndex[key];
+
+		if (flash.readByte(address) == len) {
+
+			const uint8_t *newData = (const uint8_t*)data;
+			uint8_t chunk[JOURNAL_CHUNK];
+			bool equal = true;
+
+			for (uint16_t i=0; i<len && equal; i+=JOURNAL_CHUNK) {
+				uint8_t chunkSize = min((uint8_t)JOURNAL_CHUNK, (uint8_t)(len - i));
+				flash.readByteArray(address + 2 + i, chunk, chunkSize);
+				if (memcmp(chunk, newData + i, chunkSize) != 0) equal = false;
+			}
+
+			if (equal) {
+				writesSkipped++;
+				return true;
+			}
+		}
+	}
+
+	if (batching) {
+		// The begin marker goes before the first value that changed. Compacting now would leave the records already written
+		// on the batch behind, beginBatch() made room for all of them
+		if (batchStart == 0) {
+			if (!appendMarker(JOURNAL_BATCH_BEGIN)) batchFailed = true;
+			else batchStart = freeIndex;
+		}
+		if (!batchFailed && append(key, (const uint8_t*)data, len)) return true;
+		batchFailed = true;
+		return false;
+	}
+
+	if (append(key, (const uint8_t*)data, len)) return true;
+
+	// No space left (or a damaged area), move the latest values to the other sector and try again
+	if (!compact()) return false;
+	return append(key, (const uint8_t*)data, len);
+}
+bool SckJournal::beginBatch(uint16_t maxBytes)
+{
+	if (!ready) return false;
+
+	// Begin and commit markers are 5 bytes each
+	if (freeIndex + maxBytes + 10 > SCKJOURNAL_SECTOR_SIZE) {
+		if (!compact() || freeIndex + maxBytes + 10 > SCKJOURNAL_SECTOR_SIZE) return false;
+	}
+
+	batching = true;
+	batchStart = 0;
+	batchFailed = false;
+	return true;
+}
+bool SckJournal::commitBatch()
+{
+	if (!batching) return false;
+	batching = false;
+
+	// Nothing changed (or the begin marker couldn't be written)
+	if (batchStart == 0) {
+		if (batchFailed) compact();
+		return !batchFailed;
+	}
+
+	uint16_t from = batchStart;
+	batchStart = 0;
+
+	if (batchFailed || !appendMarker(JOURNAL_BATCH_COMMIT)) {
+		// Without its commit marker the batch would swallow the records written after it on the next boot
+		compact();
+		return false;
+	}
+
+	indexRecords(from, freeIndex);
+	return true;
+}
+bool SckJournal::clear()
+{
+	flashSelect();
+	uint8_t newSector = !activeSector;
+	if (!format(newSector, sequence + 1, true)) return false;
+
+	activeSector = newSector;
+	sequence++;
+	memset(keyIndex, 0, sizeof(keyIndex));
+	freeIndex = SCKJOURNAL_HEADER_SIZE;
+	batching = false;
+	batchStart = 0;
+
+	return true;
+}
+uint16_t SckJournal::countKeys()
+{
+	uint16_t total = 0;
+	for (uint16_t i=0; i<SCKJOURNAL_MAX_KEYS; i++) if (keyIndex[i] != 0) total++;
+	return total;
+}
+uint32_t SckJournal::sectorAddress(uint8_t wichSector)
+{
+	return SCKJOURNAL_ADDRESS + (wichSector * SCKJOURNAL_SECTOR_SIZE);
+}
+bool SckJournal::readHeader(uint8_t wichSector, uint32_t &seq)
+{
+	uint8_t header[9];
+	if (!flash.readByteArray(sectorAddress(wichSector), header, 9)) return false;
+
+	if (memcmp(header, journalMagic, 4) != 0) return false;
+	if (header[8] != JOURNAL_COMMITED) return false; 		// Compaction didn't finish on this sector
+
+	seq = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7];
+
+	return true;
+}
+bool SckJournal::format(uint8_t wichSector, uint32_t seq, bool commit)
+{
+	uint32_t address = sectorAddress(wichSector);
+
+	if (!flash.eraseSector(address)) return false;
+
+	uint8_t header[8];
+	memcpy(header, journalMagic, 4);
+	header[4] = seq >> 24;
+	header[5] = seq >> 16;
+	header[6] = seq >> 8;
+	header[7] = seq;
+	if (!flash.writeByteArray(address, header, 8)) return false;
+
+	// On compaction the state byte is programmed once the sector content is complete
+	if (!commit) return true;
+	return flash.writeByte(address + 8, JOURNAL_COMMITED);
+}
+bool SckJournal::scan()
+{
+	flashSelect();
+	memset(keyIndex, 0, sizeof(keyIndex));
+
+	uint32_t base = sectorAddress(activeSector);
+	uint16_t pos = SCKJOURNAL_HEADER_SIZE;
+	uint16_t openBatch = 0;
+	uint8_t chunk[JOURNAL_CHUNK];
+
+	while (pos + 4 <= SCKJOURNAL_SECTOR_SIZE) {
+
+		uint8_t head[2];
+		flash.readByteArray(base + pos, head, 2);
+
+		// Erased byte: end of the journal
+		if (head[0] == 0xFF) break;
+
+		uint16_t recordSize = head[0] + 4;
+		if (pos + recordSize > SCKJOURNAL_SECTOR_SIZE) {
+			freeIndex = pos;
+			return false;
+		}
+
+		uint8_t crc = crc8(0xFF, head, 2);
+		for (uint16_t i=0; i<head[0]; i+=JOURNAL_CHUNK) {
+			uint8_t chunkSize = min((uint8_t)JOURNAL_CHUNK, (uint8_t)(head[0] - i));
+			flash.readByteArray(base + pos + 2 + i, chunk, chunkSize);
+			crc = crc8(crc, chunk, chunkSize);
+		}
+
+		uint8_t tail[2];
+		flash.readByteArray(base + pos + 2 + head[0], tail, 2);
+		if (tail[0] != crc || tail[1] != JOURNAL_COMMITED) {
+			freeIndex = pos;
+			return false;
+		}
+
+		if (head[1] == JKEY_BATCH) {
+			uint8_t marker = flash.readByte(base + pos + 2);
+			if (marker == JOURNAL_BATCH_BEGIN) openBatch = pos + recordSize;
+			else if (openBatch != 0) {
+				indexRecords(openBatch, pos);
+				openBatch = 0;
+			}
+		} else if (openBatch == 0) keyIndex[head[1]] = pos;
+
+		pos += recordSize;
+	}
+
+	freeIndex = pos;
+
+	// A batch cut before its commit: its records are not used, compacting leaves them behind
+	if (openBatch != 0) return false;
+
+	if (debug) {
+		SerialUSB.print("Journal: sector ");
+		SerialUSB.print(activeSector);
+		SerialUSB.print(" sequence ");
+		SerialUSB.print(sequence);
+		SerialUSB.print(", ");
+		SerialUSB.print(freeIndex);
+		SerialUSB.println(" bytes used");
+	}
+
+	return true;
+}
+bool SckJournal::append(uint8_t key, const uint8_t *data, uint8_t len)
+{
+	if (freeIndex + len + 4 > SCKJOURNAL_SECTOR_SIZE) return false;
+
+	flashSelect();
+	uint32_t address = sectorAddress(activeSector) + freeIndex;
+
+	uint8_t head[2] = {len, key};
+	uint8_t crc = crc8(0xFF, head, 2);
+	crc = crc8(crc, data, len);
+
+	// Once something is programmed the space of the record is used even if the write fails, the next one can't go over it
+	bool result = flash.writeByteArray(address, head, 2);
+	if (result && len > 0) result = flash.writeByteArray(address + 2, (uint8_t*)data, len);
+	if (result) result = flash.writeByte(address + 2 + len, crc);
+
+	// Until this byte is programmed the record doesn't exist
+	if (result) result = flash.writeByte(address + 3 + len, JOURNAL_COMMITED);
+
+	uint16_t recordIndex = freeIndex;
+	freeIndex += len + 4;
+	if (!result) return false;
+
+	// Records of a batch are indexed on its commit
+	if (!batching && key != JKEY_BATCH) keyIndex[key] = recordIndex;
+	recordsWritten++;
+
+	return true;
+}
+bool SckJournal::appendMarker(uint8_t marker)
+{
+	if (append(JKEY_BATCH, &marker, 1)) {
+		recordsWritten--; 	// Not a value
+		return true;
+	}
+	return false;
+}
+void SckJournal::indexRecords(uint16_t from, uint16_t to)
+{
+	flashSelect();
+	uint32_t base = sectorAddress(activeSector);
+
+	for (uint16_t pos=from; pos<to;) {
+		uint8_t head[2];
+		flash.readByteArray(base + pos, head, 2);
+		if (head[1] != JKEY_BATCH) keyIndex[head[1]] = pos;
+		pos += head[0] + 4;
+	}
+}
+bool SckJournal::compact()
+{
+	flashSelect();
+
+	uint8_t newSector = !activeSector;
+	uint32_t from = sectorAddress(activeSector);
+	uint32_t to = sectorAddress(newSector);
+
+	if (!format(newSector, sequence + 1, false)) return false;
+
+	// Copy the latest record of every key (commit byte included)
+	uint16_t pos = SCKJOURNAL_HEADER_SIZE;
+	uint8_t chunk[JOURNAL_CHUNK];
+
+	for (uint16_t key=0; key<SCKJOURNAL_MAX_KEYS; key++) {
+
+		if (keyIndex[key] == 0) continue;
+
+		uint16_t recordSize = flash.readByte(from + keyIndex[key]) + 4;
+
+		for (uint16_t i=0; i<recordSize; i+=JOURNAL_CHUNK) {
+			uint8_t chunkSize = min((uint16_t)JOURNAL_CHUNK, (uint16_t)(recordSize - i));
+			flash.readByteArray(from + keyIndex[key] + i, chunk, chunkSize);
+			if (!flash.writeByteArray(to + pos + i, chunk, chunkSize)) {
+				scan(); 	// Restore the index of the old sector, it is still the valid one
+				return false;
+			}
+		}
+
+		keyIndex[key] = pos;
+		pos += recordSize;
+	}
+
+	// Programming the state byte makes the new sector the valid one
+	if (!flash.writeByte(to + 8, JOURNAL_COMMITED)) {
+		scan();
+		return false;
+	}
+
+	activeSector = newSector;
+	sequence++;
+	freeIndex = pos;
+	compactions++;
+
+	debugOut("Journal: compaction done");
+
+	return true;
+}
+uint8_t SckJournal::crc8(uint8_t crc, const uint8_t *data, uint8_t len)
+{
+	// Polynomial 0x31 (x8 + x5 + x4 + 1)
+	for (uint8_t i=0; i<len; i++) {
+		crc ^= data[i];
+		for (uint8_t b=0; b<8; b++) {
+			if (crc & 0x80) crc = (crc << 1) ^ 0x31;
+			else crc <<= 1;
+		}
+	}
+	return crc;
+}
+void SckJournal::flashSelect()
+{
+	digitalWrite(pinCS_SDCARD, HIGH);	// disables SDcard
+	digitalWrite(pinCS_FLASH, LOW);
+}
+void SckJournal::debugOut(const char *text)
+{
+	if (debug) SerialUSB.println(text);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPIFlash.h>
+
+#include "Pins.h"
+
+// Small key/value journal living on the last sectors of the SPI flash.
+// Values are appended as records, so changing one setting only programs a few bytes instead of rewriting the whole configuration.
+// Two sectors are used alternately: when the active one is full the latest value of every key is copied to the other one (compaction) and the old one is erased on the next compaction.
+//
+// Sector layout:	[magic 4B][sequence 4B][state 1B] ... records ...
+// Record layout:	[len][key][value (len bytes)][crc8][commit]
+//
+// A sector is only valid once its state byte is programmed (0x00), and a record only once its commit byte is programmed (0x00),
+// so a power cut at any point leaves either the old or the new value, never a mix of both.
+// Values that only make sense together (the configuration) are written as a batch: a begin marker, the records and a commit
+// marker (key JKEY_BATCH). The records of a batch are only used once its commit marker is there.
+
+#define SCKJOURNAL_SECTOR_SIZE 4096
+#define SCKJOURNAL_SECTORS 2
+#define SCKJOURNAL_ADDRESS (4194304 - (SCKJOURNAL_SECTORS * SCKJOURNAL_SECTOR_SIZE)) 	// Last two sectors of a 4Mb flash
+#define SCKJOURNAL_HEADER_SIZE 16
+#define SCKJOURNAL_MAX_KEYS 256
+
+// Journal keys (never renumber them, only add new ones, the values stored on already deployed kits depend on them)
+enum JournalKey {
+	JKEY_BATCH 			= 0x00, 	// Batch markers (not a value)
+	JKEY_MODE 			= 0x01,
+	JKEY_PUBLISH_INTERVAL 		= 0x02,
+	JKEY_READ_INTERVAL 		= 0x03,
+	JKEY_MAC 			= 0x04,
+	JKEY_CREDENTIALS 		= 0x05,
+	JKEY_TOKEN 			= 0x06,
+	JKEY_SD_DEBUG 			= 0x07,
+	JKEY_BATT_CAPACITY 		= 0x08,
+	JKEY_SD_ARCHIVE 		= 0x09,
+
+	JKEY_LIST_CHECKPOINT 		= 0x10, 	// Readings log state (see SckList.h)
+	JKEY_ENERGY_TODAY 		= 0x11, 	// Energy ledger (see SckEnergy.h)
+	JKEY_ENERGY_YESTERDAY 		= 0x12,
+
+	JKEY_SENSORS 			= 0x80 		// One key per sensor: JKEY_SENSORS + SensorType
+};
+
+class SckJournal
+{
+	private:
+		SPIFlash flash = SPIFlash(pinCS_FLASH);
+		void flashSelect();
+
+		uint8_t activeSector = 0;
+		uint32_t sequence = 0;
+		uint16_t freeIndex = 0; 				// First unused byte on the active sector
+		uint16_t keyIndex[SCKJOURNAL_MAX_KEYS]; 		// Offset of the latest record of each key on the active sector (0 if the key is not stored)
+		bool batching = false;
+		uint16_t batchStart = 0; 				// First record of the open batch (0 until something changes)
+		bool batchFailed = false;
+
+		uint32_t sectorAddress(uint8_t wichSector);
+		bool readHeader(uint8_t wichSector, uint32_t &seq);
+		bool format(uint8_t wichSector, uint32_t seq, bool commit);
+		bool scan(); 						// Builds the key index, returns false if a broken record was found
+		bool append(uint8_t key, const uint8_t *data, uint8_t len);
+		bool appendMarker(uint8_t marker);
+		void indexRecords(uint16_t from, uint16_t to); 		// Records between two offsets become the latest ones of their keys
+		bool compact();
+		uint8_t crc8(uint8_t crc, const uint8_t *data, uint8_t len);
+		void debugOut(const char *msg);
+
+	public:
+		bool ready = false;
+		bool debug = false;
+
+		// Stats
+		uint32_t recordsWritten = 0;
+		uint32_t writesSkipped = 0;
+		uint32_t compactions = 0;
+
+		bool begin(); 						// Mounts the journal (recovering from interrupted writes or compactions)
+		bool has(uint8_t key);
+		bool read(uint8_t key, void *data, uint8_t len); 	// Returns false if the key is not stored or its size doesn't match
+		bool write(uint8_t key, const void *data, uint8_t len); // Only appends if the value changed
+		bool beginBatch(uint16_t maxBytes); 			// Makes room for maxBytes of records (compacting if needed) and opens a batch
+		bool commitBatch(); 					// The values written since beginBatch() replace the old ones all at once
+		bool clear(); 						// Erases all stored values
+		uint16_t countKeys();
+		uint16_t usedBytes() { return freeIndex; }
+};
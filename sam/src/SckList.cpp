@@ -1,65 +1,454 @@
 #include "SckList.h"
 
-bool SckList::append(char value)
-{
-	// Writes value and updates de index
-	if (write(index, value)) index++;
-	else return false;
+// Room for the payload header of compressed groups
+static const uint8_t maxPayloadHeader = 10;
 
-	return true;
+static uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
 }
-bool SckList::write(uint32_t wichIndex, char value)
+static int32_t unzigzag(uint32_t value)
 {
-	if (wichIndex < SCKLIST_RAM_SIZE && !usingFlash)  {
-
-		// Use ram to store the value
-		ramBuff[wichIndex] = value;
-
-	} else {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+static uint8_t varintSize(uint32_t value)
+{
+	uint8_t size = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+static uint8_t writeVarint(uint8_t *buff, uint32_t value)
+{
+	uint8_t size = 0;
+	while (value >= 0x80) {
+		buff[size++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buff[size++] = value;
+	return size;
+}
+static uint32_t bufferVarint(const char *buff, uint16_t &index)
+{
+	uint32_t value = 0;
+	for (uint8_t shift=0; shift<35; shift+=7) {
+		uint8_t thisByte = buff[index++];
+		value |= (uint32_t)(thisByte & 0x7F) << shift;
+		if (!(thisByte & 0x80)) break;
+	}
+	return value;
+}
+bool SckList::begin(SckJournal *wichJournal)
+{
+	journal = wichJournal;
 
+	// Without the journal there is no way to find the log after a reset, so we keep the readings on RAM
+	if (journal == 0 || !journal->ready || !flashStart()) {
+		usingFlash = false;
+		restart();
 		return false;
+	}
 
-		// TODO finish flash support and enable this
+	usingFlash = true;
+	return recover();
+}
+uint32_t SckList::areaSize()
+{
+	if (usingFlash) return SCKLIST_FLASH_SIZE;
+	return SCKLIST_RAM_SIZE - SCKLIST_GROUP_SIZE;
+}
+uint32_t SckList::sectorSize()
+{
+	if (usingFlash) return SCKLIST_SECTOR_SIZE;
+	return 1;
+}
+bool SckList::write(uint32_t wichIndex, const uint8_t *data, uint16_t len)
+{
+	if (!usingFlash)  {
 
-		// If we haven't yet, move RAM readings to flash and update the index
-		/* if (!usingFlash) migrateToFlash(); */
+		// Use ram to store the value (after the open group)
+		for (uint16_t i=0; i<len; i++) ramBuff[SCKLIST_GROUP_SIZE + (wichIndex + i) % areaSize()] = data[i];
+		return true;
+	}
 
-		// Use flash to store the value
-		/* flashSelect(); */
-		/* if (!flash.writeByte(wichIndex, value)) return false; */
+	if (!eraseUpTo(wichIndex + len)) return false;
 
-		// TODO
-		// Whe migrating to flash do a sector scan to see where to start putting readings
+	flashSelect();
+	while (len > 0) {
+		// Split the write if it crosses the end of the flash area
+		uint32_t physical = wichIndex % SCKLIST_FLASH_SIZE;
+		uint16_t chunk = min((uint32_t)len, SCKLIST_FLASH_SIZE - physical);
+		if (!flash.writeByteArray(physical, (uint8_t*)data, chunk)) return false;
+		wichIndex += chunk;
+		data += chunk;
+		len -= chunk;
 	}
 	return true;
 }
+void SckList::readBytes(uint32_t wichIndex, uint8_t *data, uint16_t len)
+{
+	if (!usingFlash)  {
+		for (uint16_t i=0; i<len; i++) data[i] = ramBuff[SCKLIST_GROUP_SIZE + (wichIndex + i) % areaSize()];
+		return;
+	}
+
+	flashSelect();
+	while (len > 0) {
+		uint32_t physical = wichIndex % SCKLIST_FLASH_SIZE;
+		uint16_t chunk = min((uint32_t)len, SCKLIST_FLASH_SIZE - physical);
+		flash.readByteArray(physical, data, chunk);
+		wichIndex += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+}
 char SckList::read(uint32_t wichIndex)
 {
 	if (!usingFlash)  {
 
 		// Get value from RAM memory
-		return ramBuff[wichIndex];
+		return ramBuff[SCKLIST_GROUP_SIZE + wichIndex % areaSize()];
 
 	} else {
 
+		// Use the cached groups if possible
+		for (uint8_t slot=0; slot<2; slot++) {
+			if (wichIndex >= cachedLeftIndex[slot] && wichIndex < cachedRightIndex[slot]) return ramBuff[(slot * SCKLIST_RAM_SIZE / 2) + wichIndex - cachedLeftIndex[slot]];
+		}
+
 		// Get the value from flash
 		flashSelect();
-		char returnValue = (char)flash.readByte(wichIndex);
+		char returnValue = (char)flash.readByte(wichIndex % SCKLIST_FLASH_SIZE);
 		return returnValue;
 	}
 }
+uint16_t SckList::read16(uint32_t wichIndex)
+{
+	return ((uint8_t)read(wichIndex) << 8) | (uint8_t)read(wichIndex + 1);
+}
+bool SckList::eraseUpTo(uint32_t wichIndex)
+{
+	if (!usingFlash) return true;
+
+	// Sectors are erased just before being used for the first time on each lap
+	flashSelect();
+	while (erasedIndex < wichIndex) {
+		if (!flash.eraseSector(erasedIndex % SCKLIST_FLASH_SIZE)) return false;
+		erasedIndex += SCKLIST_SECTOR_SIZE;
+	}
+	return true;
+}
+bool SckList::writeRecord()
+{
+	for (uint8_t tries=0; tries<2; tries++) {
+
+		uint32_t leftIndex = index;
+
+		// The payload header depends on where the record is written (compressed groups point to their keyframe)
+		uint8_t payload[maxPayloadHeader];
+		uint8_t payloadSize = payloadHeader(leftIndex, payload);
+
+		uint16_t size = SCKLIST_HEADER_SIZE + payloadSize + groupIndex + SCKLIST_TRAILER_SIZE;
+		uint32_t rightIndex = leftIndex + size;
+
+		// Keep one sector free so erasing ahead never touches the start of the log
+		if (index + size - base > areaSize() - sectorSize()) {
+			debugOut("No space left for saving the group!!");
+			return false;
+		}
+
+		uint16_t back = rightIndex - lastRecordRightIndex;
+
+		uint8_t header[SCKLIST_HEADER_SIZE] = { (uint8_t)(leftIndex >> 24), (uint8_t)(leftIndex >> 16), (uint8_t)(leftIndex >> 8), (uint8_t)leftIndex, (uint8_t)(size >> 8), (uint8_t)size };
+		uint8_t flags[3] = { 0xFF, 0xFF, 0xFF };
+		uint8_t tail[4] = { (uint8_t)(back >> 8), (uint8_t)back, (uint8_t)(size >> 8), (uint8_t)size };
+		uint8_t commit = 0x00;
+
+		bool result = write(leftIndex, header, SCKLIST_HEADER_SIZE);
+		if (result) result = write(leftIndex + SCKLIST_HEADER_SIZE, payload, payloadSize);
+		if (result && groupIndex > 0) result = write(leftIndex + SCKLIST_HEADER_SIZE + payloadSize, (uint8_t*)groupBuff, groupIndex);
+		if (result && !usingFlash) result = write(rightIndex - SCKLIST_TRAILER_SIZE, flags, 3); 	// Flash is already erased
+		if (result) result = write(rightIndex - 4, tail, 4);
+
+		// The record only exists once this byte is written
+		if (result) result = write(rightIndex - SCKLIST_TRAILER_SIZE + COMMIT, &commit, 1);
+
+		if (result) {
+			index = rightIndex;
+			lastRecordRightIndex = rightIndex;
+			return true;
+		}
+
+		// Something was already written here (probably a record interrupted by a reset), try again on the next sector
+		debugOut("Failed writing group, moving to next sector");
+		index = ((leftIndex / sectorSize()) + 1) * sectorSize();
+	}
+
+	return false;
+}
+uint8_t SckList::payloadHeader(uint32_t leftIndex, uint8_t *buff)
+{
+	uint8_t size = 0;
+
+	if (!(groupEncoding & COMPRESSED)) {
+
+		buff[size++] = (uint8_t)SENSOR_COUNT; 	// Sensor type (using max sensor number for timestamp)
+		buff[size++] = 4; 			// Size of the payload (uint32_t is 4 bytes)
+
+	} else {
+
+		buff[size++] = SCKLIST_COMPRESSED;
+		buff[size++] = groupEncoding & (KEYFRAME | SAME_LAYOUT);
+
+		if (!(groupEncoding & KEYFRAME)) {
+			size += writeVarint(&buff[size], leftIndex - keyRightIndex);
+			size += writeVarint(&buff[size], zigzag(groupTime - keyTime));
+			return size;
+		}
+	}
+
+	// The timestamp byte per byte
+	for (int8_t i=3; i>=0; i--) buff[size++] = (groupTime >> (i * 8)) & 0xFF;
+
+	return size;
+}
+void SckList::encodeGroup()
+{
+	// Decide if this group is a keyframe (keyframes must be in the current log)
+	bool keyframe = keyRightIndex <= base || groupsSinceKey >= SCKLIST_KEYFRAME_EVERY || index - keyRightIndex > 60000;
+
+	GroupInfo key;
+	if (!keyframe) {
+		cacheGroupBytes(keyRightIndex, 1);
+		if (!parseGroup(keyRightIndex, key)) keyframe = true;
+	}
+
+	// Check if the sensors are the same (and in the same order) than on the keyframe
+	bool sameLayout = !keyframe;
+	uint32_t keyIndex = keyframe ? 0 : key.readingsIndex;
+	for (uint16_t i=0; i<groupIndex && sameLayout; i=skipOpenReading(i)) {
+		if (keyIndex >= key.endIndex || (uint8_t)read(keyIndex) != (uint8_t)groupBuff[i]) sameLayout = false;
+		else keyIndex = skipReading(keyIndex, true, true);
+	}
+	if (sameLayout && keyIndex < key.endIndex) sameLayout = false;
+
+	groupEncoding = COMPRESSED;
+	if (keyframe) groupEncoding |= KEYFRAME;
+
+	// The readings are already stored with absolute values, that is all keyframes and groups with other sensors need
+	if (!sameLayout) return;
+	groupEncoding |= SAME_LAYOUT;
+
+	// Sensor types are dropped and differences are never bigger than absolute values, so this can be done in place
+	uint16_t in = 0;
+	uint16_t out = 0;
+	keyIndex = key.readingsIndex;
+
+	while (in < groupIndex) {
+
+		uint16_t next = skipOpenReading(in);
+		uint8_t kind = groupBuff[in + 1];
+		in += 2;
+
+		if ((kind >> 6) == VALUE_ABSOLUTE) {
+
+			uint32_t toStore = bufferVarint(groupBuff, in);
+			uint8_t keyKind = read(keyIndex + 1);
+
+			if ((keyKind >> 6) == VALUE_ABSOLUTE && (keyKind & 0x3F) == (kind & 0x3F)) {
+				uint32_t keyValueIndex = keyIndex + 2;
+				uint32_t delta = zigzag(unzigzag(toStore) - unzigzag(readVarint(keyValueIndex)));
+				if (delta == 0) kind = (VALUE_SAME << 6) | (kind & 0x3F);
+				else if (varintSize(delta) <= varintSize(toStore)) {
+					kind = (VALUE_DELTA << 6) | (kind & 0x3F);
+					toStore = delta;
+				}
+			}
+
+			groupBuff[out++] = kind;
+			if ((kind >> 6) != VALUE_SAME) out += writeVarint((uint8_t*)&groupBuff[out], toStore);
+
+		} else {
+
+			groupBuff[out++] = kind;
+			memmove(&groupBuff[out], &groupBuff[in], next - in);
+			out += next - in;
+		}
+
+		in = next;
+		keyIndex = skipReading(keyIndex, true, true);
+	}
+
+	groupIndex = out;
+}
+uint16_t SckList::skipOpenReading(uint16_t thisIndex)
+{
+	uint8_t kind = groupBuff[thisIndex + 1];
+	thisIndex += 2;
+
+	if ((kind >> 6) == VALUE_TEXT) return thisIndex + (kind & 0x3F);
+	bufferVarint(groupBuff, thisIndex);
+	return thisIndex;
+}
+bool SckList::parseGroup(uint32_t rightIndex, GroupInfo &info)
+{
+	uint16_t size = readGroupSize(rightIndex);
+	if (size == 0) return false;
+
+	uint32_t thisIndex = rightIndex - size + SCKLIST_HEADER_SIZE;
+	info.endIndex = rightIndex - SCKLIST_TRAILER_SIZE;
+	info.sameLayout = false;
+
+	if ((uint8_t)read(thisIndex) != SCKLIST_COMPRESSED) {
+
+		info.compressed = false;
+		thisIndex += 2;
+
+	} else {
+
+		info.compressed = true;
+		uint8_t flags = read(thisIndex + 1);
+		info.sameLayout = flags & SAME_LAYOUT;
+		thisIndex += 2;
+
+		if (!(flags & KEYFRAME)) {
+
+			uint32_t keyRight = (rightIndex - size) - readVarint(thisIndex);
+			int32_t timeDelta = unzigzag(readVarint(thisIndex));
+
+			if (keyRight <= base || keyRight >= rightIndex) return false;
+
+			// Keyframe readings are needed to decode this group
+			cacheGroupBytes(keyRight, 1);
+			uint32_t keyIndex = keyRight - readGroupSize(keyRight) + SCKLIST_HEADER_SIZE + 2;
+
+			info.time = 0;
+			for (uint8_t i=0; i<4; i++) info.time = (info.time << 8) | (uint8_t)read(keyIndex + i);
+			info.time += timeDelta;
+			info.keyReadingsIndex = keyIndex + 4;
+			info.keyEndIndex = keyRight - SCKLIST_TRAILER_SIZE;
+			info.readingsIndex = thisIndex;
+
+			return true;
+		}
+	}
+
+	// Read and join the 4 bytes
+	info.time = 0;
+	for (uint8_t i=0; i<4; i++) info.time = (info.time << 8) | (uint8_t)read(thisIndex + i);
+	info.readingsIndex = thisIndex + 4;
+
+	return true;
+}
+uint32_t SckList::skipReading(uint32_t thisIndex, bool compressed, bool withType)
+{
+	// Add readingSize + 1 byte from sensorType + 1 byte from where the size is written
+	if (!compressed) return thisIndex + (uint8_t)read(thisIndex + 1) + 2;
+
+	if (withType) thisIndex++;
+	uint8_t kind = read(thisIndex++);
+
+	switch (kind >> 6) {
+		case VALUE_TEXT:
+			return thisIndex + (kind & 0x3F);
+		case VALUE_ABSOLUTE:
+		case VALUE_DELTA:
+			readVarint(thisIndex);
+			return thisIndex;
+		default:
+			return thisIndex;
+	}
+}
+uint32_t SckList::readVarint(uint32_t &thisIndex)
+{
+	uint32_t value = 0;
+	for (uint8_t shift=0; shift<35; shift+=7) {
+		uint8_t thisByte = read(thisIndex++);
+		value |= (uint32_t)(thisByte & 0x7F) << shift;
+		if (!(thisByte & 0x80)) break;
+	}
+	return value;
+}
+bool SckList::recordIsValid(uint32_t leftIndex, uint16_t &size)
+{
+	uint8_t header[SCKLIST_HEADER_SIZE];
+	readBytes(leftIndex, header, SCKLIST_HEADER_SIZE);
+
+	// Records from previous laps have a different address
+	uint32_t address = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) | header[3];
+	if (address != leftIndex) return false;
+
+	size = (header[4] << 8) | header[5];
+	if (size < SCKLIST_HEADER_SIZE + 3 + SCKLIST_TRAILER_SIZE || size > SCKLIST_HEADER_SIZE + SCKLIST_GROUP_SIZE + SCKLIST_TRAILER_SIZE) return false;
+	if (leftIndex + size - base > areaSize()) return false;
+
+	uint8_t trailer[SCKLIST_TRAILER_SIZE];
+	readBytes(leftIndex + size - SCKLIST_TRAILER_SIZE, trailer, SCKLIST_TRAILER_SIZE);
+
+	if (trailer[COMMIT] != 0x00) return false;
+	if (((trailer[6] << 8) | trailer[7]) != size) return false;
+
+	return true;
+}
+bool SckList::isDeleted(uint32_t rightIndex)
+{
+	return (uint8_t)read(rightIndex - SCKLIST_TRAILER_SIZE + DELETED) != 0xFF;
+}
+bool SckList::setRecordFlag(uint32_t rightIndex, uint8_t wichFlag)
+{
+	uint32_t flagIndex = rightIndex - SCKLIST_TRAILER_SIZE + wichFlag;
+
+	// Flash bytes can only be programmed once
+	if ((uint8_t)read(flagIndex) != 0xFF) return true;
+
+	uint8_t value = 0x00;
+	if (!write(flagIndex, &value, 1)) return false;
+
+	if (usingFlash) {
+		for (uint8_t slot=0; slot<2; slot++) {
+			if (flagIndex >= cachedLeftIndex[slot] && flagIndex < cachedRightIndex[slot]) ramBuff[(slot * SCKLIST_RAM_SIZE / 2) + flagIndex - cachedLeftIndex[slot]] = value;
+		}
+	}
+
+	return true;
+}
+uint32_t SckList::previousGroup(uint32_t rightIndex)
+{
+	while (rightIndex > base) {
+
+		uint16_t back = read16(rightIndex - 4);
+		if (back == 0 || back > rightIndex - base) return 0;
+
+		rightIndex -= back;
+		if (rightIndex <= base) return 0;
+
+		if (!isDeleted(rightIndex)) return rightIndex;
+	}
+	return 0;
+}
 uint32_t SckList::getGroupRightIndex(uint32_t wichGroup)
 {
-	if (wichGroup > totalGroups) return 0;
+	if (wichGroup >= totalGroups) return 0;
 
 	uint32_t groupCounter = 0;
 	uint32_t thisIndex = lastGroupRightIndex;
 
-	while (groupCounter < wichGroup) {
-		thisIndex = thisIndex - readGroupSize(thisIndex);
+	// Groups are usually requested in order, so start from the last one we found
+	if (cacheRightIndex != 0 && wichGroup >= cacheGroup) {
+		groupCounter = cacheGroup;
+		thisIndex = cacheRightIndex;
+	}
+
+	while (groupCounter < wichGroup && thisIndex != 0) {
+		thisIndex = previousGroup(thisIndex);
 		groupCounter++;
 	}
 
+	cacheGroup = wichGroup;
+	cacheRightIndex = thisIndex;
+
 	if (debug) {
 		SerialUSB.print("Right index of group ");
 		SerialUSB.print(wichGroup);
@@ -71,8 +460,6 @@ uint32_t SckList::getGroupRightIndex(uint32_t wichGroup)
 }
 uint32_t SckList::getGroupLeftIndex(uint32_t wichGroup)
 {
-	if (wichGroup > totalGroups) return 0;
-
 	// Get end index of the group
 	uint32_t rightIndex = getGroupRightIndex(wichGroup);
 
@@ -94,36 +481,46 @@ uint16_t SckList::readGroupSize(uint32_t rightGroupIndex)
 {
 	if (rightGroupIndex > index) return 0;
 
-	// Read and join the first two bytes (group size)
-	uGroupSize.b[1] = read(rightGroupIndex - 2);
-	uGroupSize.b[0] = read(rightGroupIndex - 1);
+	// Read and join the last two bytes (group size)
+	uint16_t groupSize = read16(rightGroupIndex - 2);
 
 	if (debug) {
 		SerialUSB.print("Size of group: ");
-		SerialUSB.println(uGroupSize.i);
+		SerialUSB.println(groupSize);
 	}
 
-	return uGroupSize.i;
+	return groupSize;
 }
-bool SckList::createGroup(uint32_t timeStamp)
+void SckList::cacheGroupBytes(uint32_t rightIndex, uint8_t slot)
 {
-	bool error = false;
+	// On flash, reading the whole group at once is much faster than byte by byte
+	if (!usingFlash || rightIndex == cachedRightIndex[0] || rightIndex == cachedRightIndex[1]) return;
 
-	// Check if there is an open group and delete it
-	if (lastGroupIsOpen()) saveLastGroup();
+	// The first slot holds the open group (the group is read from flash byte by byte meanwhile)
+	if (slot == 0 && groupOpen) return;
 
-	uint32_t preErrorIndex = index;
+	uint16_t groupSize = readGroupSize(rightIndex);
+	if (groupSize == 0 || groupSize > SCKLIST_RAM_SIZE / 2) return;
 
-	// Store timeStamp in current index
-	if (!append((char)SENSOR_COUNT)) error = true; 	// Sensor type (using max sensor number for timestamp)
-	if (!append(4)) error = true; 			// Size of the payload (uint32_t is 4 bytes)
-	uTimeStamp.i = timeStamp;
-	for (int8_t i=3; i>=0; i--) if (!append(uTimeStamp.b[i])) error = true; // The timestamp byte per byte
+	cachedLeftIndex[slot] = 0;
+	cachedRightIndex[slot] = 0;
+	readBytes(rightIndex - groupSize, (uint8_t*)&ramBuff[slot * SCKLIST_RAM_SIZE / 2], groupSize);
+	cachedLeftIndex[slot] = rightIndex - groupSize;
+	cachedRightIndex[slot] = rightIndex;
+}
+bool SckList::createGroup(uint32_t timeStamp)
+{
+	// Check if there is an open group and save it
+	if (lastGroupIsOpen()) saveLastGroup();
 
-	if (error) {
-		index = preErrorIndex;
-		return false;
-	}
+	groupIndex = 0;
+	groupTime = timeStamp;
+	groupEncoding = compress ? COMPRESSED : 0;
+	groupOpen = true;
+
+	// The open group takes the place of the first cache slot
+	cachedLeftIndex[0] = 0;
+	cachedRightIndex[0] = 0;
 
 	return true;
 };
@@ -131,82 +528,75 @@ bool SckList::saveLastGroup()
 {
 	debugOut("Saving last group");
 
-	// If last created group has no readings return false
-	if (lastGroupRightIndex + 6 == index) return false;
-
-	// Init tags in 1 for all
-	byte byteFlags = 0xFF;
-	if (!append(byteFlags)) return false;
+	if (!lastGroupIsOpen()) return false;
+	groupOpen = false;
 
-	// Save group size
-	uGroupSize.i = index - lastGroupRightIndex + 2; // Group size in bytes (including this last two bytes that are going to be filled now)
+	// If last created group has no readings discard it
+	if (groupIndex == 0) return false;
 
-	if (debug) {
-		SerialUSB.print("Current index: ");
-		SerialUSB.println(index);
-		SerialUSB.print("last Group Right index: ");
-		SerialUSB.println(lastGroupRightIndex);
-		SerialUSB.print("Saved group size is: ");
-		SerialUSB.println(uGroupSize.i);
-	}
+	if (groupEncoding & COMPRESSED) encodeGroup();
 
-	if (!append(uGroupSize.b[1])) return false;
-	if (!append(uGroupSize.b[0])) return false;
+	if (!writeRecord()) return false;
 
 	totalGroups++;
+	lastGroupRightIndex = lastRecordRightIndex;
+	cacheGroup = 0;
+	cacheRightIndex = lastGroupRightIndex;
+
+	if (groupEncoding & KEYFRAME) {
+		keyRightIndex = lastRecordRightIndex;
+		keyTime = groupTime;
+		groupsSinceKey = 0;
+	} else if (groupEncoding & COMPRESSED) {
+		groupsSinceKey++;
+	}
 
 	if (debug) {
+		SerialUSB.print("Current index: ");
+		SerialUSB.println(index);
+		SerialUSB.print("Saved group size is: ");
+		SerialUSB.println(readGroupSize(lastGroupRightIndex));
 		SerialUSB.print("Total groups: ");
 		SerialUSB.println(totalGroups);
 	}
 
-	lastGroupRightIndex = index;
+	// Groups saved after the checkpoint are found by the boot scan, this only limits how many of them need to be read
+	savedSinceCheckpoint++;
+	if (savedSinceCheckpoint >= SCKLIST_CHECKPOINT_EVERY) checkpoint();
 
 	return true;
 }
 bool SckList::lastGroupIsOpen()
 {
-	if (lastGroupRightIndex < index) return true;
-	return false;
+	return groupOpen;
 }
 bool SckList::delLastGroup()
 {
 	if (totalGroups == 0) return false;
 
+	uint32_t deletingGroup = lastGroupRightIndex;
 
-	// If last group is open we need to move it to the new end
-	if (lastGroupIsOpen()) {
-
-		uint32_t openGroupEndIndex = 0;
-		uint32_t openGroupStartIndex = 0;
-
-		debugOut("The last group is open!!");
-
-		openGroupEndIndex = index;
-		openGroupStartIndex = lastGroupRightIndex;
-
-		// The new index should be were deleted group started
-		index =  lastGroupRightIndex - readGroupSize(lastGroupRightIndex);
-
-		// And if there are groups before they end in the same place were we start.
-		lastGroupRightIndex = index;
-
-		// Copy the open group to the place where deleted group was
-		for (uint32_t i=openGroupStartIndex; i<openGroupEndIndex; i++) append(read(i));
-
-	} else {
+	totalGroups--;
+	lastGroupRightIndex = previousGroup(deletingGroup);
+	cacheGroup = 0;
+	cacheRightIndex = lastGroupRightIndex;
 
-		// Change index to remove last Group
-		index =  lastGroupRightIndex - readGroupSize(lastGroupRightIndex);
-		lastGroupRightIndex = index;
-	}
+	// The flag is also needed when starting a new log, the boot scan uses it until the next checkpoint
+	bool result = setRecordFlag(deletingGroup, DELETED);
 
-	totalGroups--;
+	// When there is nothing left we start a new log (the deleted records will be erased on the next lap)
+	if (totalGroups == 0) restart();
 
-	// After deleting the last group if we are using flash we should return to RAM
-	if (totalGroups == 0 && usingFlash) usingFlash = false;
+	// A checkpoint on every delete would wear the journal out, the boot scan finds the deletes that are not on it yet
+	deletedSinceCheckpoint++;
+	if (deletedSinceCheckpoint >= SCKLIST_CHECKPOINT_EVERY) checkpoint();
 
-	return true;
+	return result;
+}
+bool SckList::flushDeletes()
+{
+	if (deletedSinceCheckpoint == 0) return true;
+	return checkpoint();
 }
 uint32_t SckList::countGroups()
 {
@@ -216,6 +606,10 @@ uint32_t SckList::countGroups()
 	}
 	return totalGroups;
 }
+uint32_t SckList::usedBytes()
+{
+	return index - base;
+}
 uint32_t SckList::getTime(uint32_t wichGroup)
 {
 	if (debug) {
@@ -223,29 +617,22 @@ uint32_t SckList::getTime(uint32_t wichGroup)
 		SerialUSB.println(wichGroup);
 	}
 
-	if (wichGroup > totalGroups) return 0;
-
-	// Get the index where the timeStamp starts
-	uint32_t leftIndex = getGroupLeftIndex(wichGroup);
-
-	// Return error in case of wrong left index
-	if (wichGroup != totalGroups-1 && leftIndex == 0) return 0;
+	uint32_t rightIndex = getGroupRightIndex(wichGroup);
 
+	// Return error in case of wrong index
+	if (rightIndex == 0) return 0;
 
-	uint32_t timeIndex = leftIndex + 2;
+	cacheGroupBytes(rightIndex, 0);
 
-	// Read and join the 4 bytes
-	for (int8_t i=3; i>=0; i--) {
-		uTimeStamp.b[i] = read(timeIndex);
-		timeIndex++;
-	}
+	GroupInfo info;
+	if (!parseGroup(rightIndex, info)) return 0;
 
 	if (debug) {
 		SerialUSB.print("epoch: ");
-		SerialUSB.println(uTimeStamp.i);
+		SerialUSB.println(info.time);
 	}
 
-	return uTimeStamp.i;
+	return info.time;
 }
 uint16_t SckList::countReadings(uint32_t wichGroup)
 {
@@ -254,41 +641,52 @@ uint16_t SckList::countReadings(uint32_t wichGroup)
 		SerialUSB.println(wichGroup);
 	}
 
-	if (wichGroup > totalGroups) return 0;
-
-	// TODO optimize getting indexes, now there is too much duplicated work done.
 	uint32_t rightIndex = getGroupRightIndex(wichGroup);
-	uint32_t leftIndex = getGroupLeftIndex(wichGroup);
 
-	// Return error in case of wrong left index
-	if (wichGroup != totalGroups-1 && leftIndex == 0) return 0;
+	// Return error in case of wrong index
+	if (rightIndex == 0) return 0;
 
-	uint16_t counter = 0;
+	cacheGroupBytes(rightIndex, 0);
 
-	while (leftIndex < rightIndex - 3) { // The minus 3 are: 1 byte:flags, and 2 bytes: group size
+	GroupInfo info;
+	if (!parseGroup(rightIndex, info)) return 0;
 
-		uint8_t readingSize = read(leftIndex + 1); // Get reading size byte
+	uint32_t thisIndex = info.readingsIndex;
+	uint16_t counter = 0;
 
-		leftIndex += readingSize + 2; // Add readingSize + 1 byte from sensorType + 1 byte from where the size is written
-		counter++; // Count how many readings exist until we reach the end of the group
+	// Count how many readings exist until we reach the end of the group
+	while (thisIndex < info.endIndex) {
+		thisIndex = skipReading(thisIndex, info.compressed, !info.sameLayout);
+		counter++;
 	}
 
-	return counter - 1; // The first reading is TimeStamp so we don't count it as a normal reading
+	return counter;
 }
-bool SckList::appendReading(SensorType wichSensor, String value)
+bool SckList::appendReading(SensorType wichSensor, const SensorValue &value)
 {
 	// Be sure a group has been already created
 	if (!lastGroupIsOpen()) return false;
 
-	// Write Sensor Type
-	if (!append(wichSensor)) return false;
+	// Compressed groups take the numbers as fixed point (encodeGroup only turns them into differences with the keyframe), uncompressed ones as text
+	uint8_t reading[SENSORVALUE_SIZE + 2];
+	uint8_t size = 0;
+	reading[size++] = wichSensor;
 
-	// Write size of reading (in bytes)
-	uint8_t valueSize = value.length();
-	if (!append(valueSize)) return false;
+	int32_t mantissa;
+	uint8_t decimals;
+	if ((groupEncoding & COMPRESSED) && value.toFixed(mantissa, decimals) && decimals <= 0x3F) {
+		reading[size++] = (VALUE_ABSOLUTE << 6) | decimals;
+		size += writeVarint(&reading[size], zigzag(mantissa));
+	} else {
+		uint8_t valueSize = strlen(value.format((char*)&reading[2]));
+		reading[size++] = (groupEncoding & COMPRESSED) ? (VALUE_TEXT << 6) | valueSize : valueSize;
+		size += valueSize;
+	}
+
+	if (groupIndex + size > SCKLIST_GROUP_SIZE - maxPayloadHeader) return false;
 
-	// Write reading
-	for (uint8_t i=0; i<valueSize; i++) if (!append(value.charAt(i))) return false;
+	memcpy(&groupBuff[groupIndex], reading, size);
+	groupIndex += size;
 
 	return true;
 }
@@ -296,82 +694,259 @@ OneReading SckList::readReading(uint32_t wichGroup, uint8_t wichReading)
 {
 	OneReading thisReading;
 	thisReading.type = SENSOR_COUNT;
-	thisReading.value = "null";
 
-	if (wichGroup > totalGroups) return thisReading;
-	if (countReadings(wichGroup) < wichReading) return thisReading;
+	uint32_t rightIndex = getGroupRightIndex(wichGroup);
 
-	// Get first reading index
-	uint32_t leftIndex = getGroupLeftIndex(wichGroup);
+	// Return error in case of wrong index
+	if (rightIndex == 0) return thisReading;
 
-	// Return error in case of wrong left index
-	if (wichGroup != totalGroups-1 && leftIndex == 0) return thisReading;
+	cacheGroupBytes(rightIndex, 0);
+
+	GroupInfo info;
+	if (!parseGroup(rightIndex, info)) return thisReading;
+
+	// Get first reading index
+	uint32_t thisIndex = info.readingsIndex;
+	uint32_t keyIndex = info.keyReadingsIndex;
 
 	uint16_t counter = 0;
 
-	// Get to the reading
-	while (counter < wichReading + 1) {
-		uint8_t readingSize = read(leftIndex + 1); // Get reading size byte
-		leftIndex += readingSize + 2; // Add readingSize + 1 byte from sensorType + 1 byte from where the size is written
+	// Get to the reading (and to the same reading on the keyframe)
+	while (counter < wichReading && thisIndex < info.endIndex) {
+		thisIndex = skipReading(thisIndex, info.compressed, !info.sameLayout);
+		if (info.sameLayout) keyIndex = skipReading(keyIndex, true, true);
 		counter++;
 	}
 
+	if (thisIndex >= info.endIndex) return thisReading;
+
+	if (!info.compressed) {
 
-	// Get sensorType
-	thisReading.type = static_cast<SensorType>(read(leftIndex));
-	leftIndex++;
+		// Get sensorType
+		thisReading.type = static_cast<SensorType>(read(thisIndex));
+		thisIndex++;
 
-	// Get the size in bytes of the reading
-	uint32_t readingEnd = leftIndex + (uint8_t)read(leftIndex);
-	leftIndex++;
+		// Get the size in bytes of the reading
+		uint8_t readingSize = read(thisIndex);
+		thisIndex++;
 
-	// Clear null value
-	thisReading.value = "";
+		// Get the value
+		thisReading.value = readText(thisIndex, readingSize);
 
-	// Get the value
-	while (leftIndex <= readingEnd) {
-		thisReading.value.concat(read(leftIndex));
-		leftIndex++;
+		return thisReading;
 	}
 
+	// Get sensorType (from the keyframe if it's not stored on this group)
+	if (info.sameLayout) {
+		if (keyIndex >= info.keyEndIndex) return thisReading;
+		thisReading.type = static_cast<SensorType>(read(keyIndex));
+	} else {
+		thisReading.type = static_cast<SensorType>(read(thisIndex++));
+	}
+
+	uint8_t kind = read(thisIndex++);
+	int32_t mantissa = 0;
+
+	switch (kind >> 6) {
+		case VALUE_TEXT: {
+			thisReading.value = readText(thisIndex, kind & 0x3F);
+			return thisReading;
+		}
+		case VALUE_ABSOLUTE: {
+			mantissa = unzigzag(readVarint(thisIndex));
+			break;
+		}
+		default: {
+			// Relative to the same reading on the keyframe
+			if (!info.sameLayout) return thisReading;
+			uint32_t keyValueIndex = keyIndex + 2;
+			mantissa = unzigzag(readVarint(keyValueIndex));
+			if ((kind >> 6) == VALUE_DELTA) mantissa += unzigzag(readVarint(thisIndex));
+			break;
+		}
+	}
+
+	thisReading.value = SensorValue::fixed(mantissa, kind & 0x3F);
+
 	return thisReading;
 }
+SensorValue SckList::readText(uint32_t wichIndex, uint8_t len)
+{
+	char text[SENSORVALUE_SIZE];
+	if (len >= SENSORVALUE_SIZE) return SensorValue();
+	for (uint8_t i=0; i<len; i++) text[i] = read(wichIndex + i);
+
+	return SensorValue::parse(text, len);
+}
 void SckList::setFlag(uint32_t wichGroup, GroupFlags wichFlag, bool value)
 {
 	// Get group Index
-	uint32_t flagsIndex = getGroupRightIndex(wichGroup) - 3;
+	uint32_t rightIndex = getGroupRightIndex(wichGroup);
+	if (rightIndex == 0) return;
+
+	if (value) {
+		setRecordFlag(rightIndex, wichFlag);
+	} else if (!usingFlash) {
+		// Flags can't be cleared on flash
+		uint8_t cleared = 0xFF;
+		write(rightIndex - SCKLIST_TRAILER_SIZE + wichFlag, &cleared, 1);
+	}
+}
+int8_t SckList::getFlag(uint32_t wichGroup, GroupFlags wichFlag)
+{
+	if (wichGroup >= totalGroups) return -1;
+	if (wichFlag > SD_PUBLISHED) return -1;
+
+	// Get group Index
+	uint32_t rightIndex = getGroupRightIndex(wichGroup);
+	if (rightIndex == 0) return -1;
+
+	// Flags are negated (0xFF means not set)
+	return (uint8_t)read(rightIndex - SCKLIST_TRAILER_SIZE + wichFlag) != 0xFF;
+}
+bool SckList::checkpoint()
+{
+	if (!usingFlash) return true;
 
-	// Read de full flags byte
-	byte byteFlags = read(flagsIndex);
+	ListCheckpoint thisCheckpoint;
+	thisCheckpoint.base = base;
+	thisCheckpoint.index = index;
+	thisCheckpoint.lastRecordRightIndex = lastRecordRightIndex;
+	thisCheckpoint.lastGroupRightIndex = lastGroupRightIndex;
+	thisCheckpoint.totalGroups = totalGroups;
 
-	// Set or clear the requested flag (flags are negated)
-	if (value) bitClear(byteFlags, wichFlag);
-	else bitSet(byteFlags, wichFlag);
+	savedSinceCheckpoint = 0;
+	deletedSinceCheckpoint = 0;
 
-	// And write flags byte back
-	write(flagsIndex, byteFlags);
+	return journal->write(JKEY_LIST_CHECKPOINT, &thisCheckpoint, sizeof(thisCheckpoint));
 }
-int8_t SckList::getFlag(uint32_t wichGroup, GroupFlags wichFlag)
+void SckList::restart()
+{
+	debugOut("Starting a new readings log");
+
+	// On flash the new log starts on the next sector, on RAM we just go back to the beginning
+	if (usingFlash) base = ((index + SCKLIST_SECTOR_SIZE - 1) / SCKLIST_SECTOR_SIZE) * SCKLIST_SECTOR_SIZE;
+	else base = 0;
+
+	index = base;
+	if (erasedIndex < base) erasedIndex = base;
+	lastRecordRightIndex = base;
+	lastGroupRightIndex = 0;
+	totalGroups = 0;
+	cacheGroup = 0;
+	cacheRightIndex = 0;
+	keyRightIndex = 0;
+}
+bool SckList::recover()
 {
-	if (wichGroup > totalGroups) return -1;
-	if (wichFlag > 7) return -1;
+	ListCheckpoint savedCheckpoint;
+
+	if (!journal->read(JKEY_LIST_CHECKPOINT, &savedCheckpoint, sizeof(savedCheckpoint))) {
+		debugOut("No readings log found on flash, starting a new one");
+		index = 0;
+		erasedIndex = 0;
+		restart();
+		return checkpoint();
+	}
 
-	// Get group Index
-	uint32_t flagsIndex = getGroupRightIndex(wichGroup) - 3;
+	base = savedCheckpoint.base;
+	index = savedCheckpoint.index;
+	lastRecordRightIndex = savedCheckpoint.lastRecordRightIndex;
+	lastGroupRightIndex = savedCheckpoint.lastGroupRightIndex;
+	totalGroups = savedCheckpoint.totalGroups;
+	erasedIndex = ((index + SCKLIST_SECTOR_SIZE - 1) / SCKLIST_SECTOR_SIZE) * SCKLIST_SECTOR_SIZE;
+
+	// The last group of the checkpoint is always the newest one that is left, if it was deleted some groups of the checkpoint were too
+	// and the count has to start again from the beginning of the log
+	if (lastGroupRightIndex != 0 && isDeleted(lastGroupRightIndex)) {
+		lastRecordRightIndex = base;
+		lastGroupRightIndex = 0;
+		totalGroups = 0;
+		index = base;
+	}
+
+	// Look for groups saved after the checkpoint
+	recoveredGroups = 0;
+	tornRecords = 0;
+	uint32_t scanIndex = index;
+	while (scanIndex - base <= areaSize() - sectorSize()) {
+
+		uint16_t size;
+		if (recordIsValid(scanIndex, size)) {
+
+			uint32_t rightIndex = scanIndex + size;
+			if (!isDeleted(rightIndex)) {
+				lastGroupRightIndex = rightIndex;
+				totalGroups++;
+			}
+			lastRecordRightIndex = rightIndex;
+			recoveredGroups++;
+			scanIndex = rightIndex;
+			continue;
+		}
+
+		// If the next sector starts with a record the writer jumped there after a failed write
+		uint32_t nextSector = ((scanIndex / SCKLIST_SECTOR_SIZE) + 1) * SCKLIST_SECTOR_SIZE;
+		if (nextSector - base <= areaSize() - sectorSize() && recordIsValid(nextSector, size)) {
+			// Unless every group before was deleted, then a new log was started there
+			if (totalGroups == 0) base = nextSector;
+			else tornRecords++;
+			scanIndex = nextSector;
+			continue;
+		}
+
+		break;
+	}
+
+	uint8_t header[SCKLIST_HEADER_SIZE];
+	readBytes(scanIndex, header, SCKLIST_HEADER_SIZE);
+	bool headerErased = true;
+	for (uint8_t i=0; i<SCKLIST_HEADER_SIZE; i++) if (header[i] != 0xFF) headerErased = false;
+
+	if (scanIndex % SCKLIST_SECTOR_SIZE == 0) {
+
+		// Start of a sector: erase it before writing (it may have never been erased on this lap)
+		index = scanIndex;
+		erasedIndex = scanIndex;
+
+	} else if (headerErased) {
+
+		index = scanIndex;
+		erasedIndex = ((index + SCKLIST_SECTOR_SIZE - 1) / SCKLIST_SECTOR_SIZE) * SCKLIST_SECTOR_SIZE;
+
+	} else {
+
+		// A record was interrupted here, continue on next sector
+		tornRecords++;
+		index = ((scanIndex / SCKLIST_SECTOR_SIZE) + 1) * SCKLIST_SECTOR_SIZE;
+		erasedIndex = index;
+	}
+
+	if (debug) {
+		SerialUSB.print("Readings log recovered: ");
+		SerialUSB.print(totalGroups);
+		SerialUSB.print(" groups, ");
+		SerialUSB.print(recoveredGroups);
+		SerialUSB.print(" found after checkpoint, ");
+		SerialUSB.print(tornRecords);
+		SerialUSB.println(" interrupted writes");
+	}
 
-	// Read de full flags byte
-	byte byteFlags = read(flagsIndex);
+	cacheGroup = 0;
+	cacheRightIndex = lastGroupRightIndex;
 
-	uint8_t result = bitRead(byteFlags, wichFlag);
-	return !result;
+	if (recoveredGroups > 0 || tornRecords > 0) checkpoint();
+
+	return true;
 }
-void SckList::flashStart()
+bool SckList::flashStart()
 {
 	digitalWrite(pinCS_SDCARD, HIGH);	// disables SDcard
 	digitalWrite(pinCS_FLASH, LOW);
-	flash.begin();
+	if (!flash.begin()) return false;
 	flash.setClock(133000);
 	flashStarted = true;
+	return true;
 }
 void SckList::flashSelect()
 {
@@ -379,12 +954,6 @@ void SckList::flashSelect()
 	digitalWrite(pinCS_FLASH, LOW);
 	if (!flashStarted) flashStart();
 }
-void SckList::migrateToFlash()
-{
-	flashSelect();
-	for (uint32_t i=0; i<index; i++) flash.writeByte(i, ramBuff[i]);
-	usingFlash = true;
-}
 void SckList::debugOut(const char *text)
 {
 	if (debug) SerialUSB.println(text);
@@ -396,18 +965,19 @@ uint32_t SckList::getFlashCapacity()
 	flashSelect();
 	return flash.getCapacity();
 }
-bool SckList::testFlash()
+uint32_t SckList::logStart()
 {
-	flashSelect();
-
-	String writeSRT = "testing the flash!";
-	uint32_t fAddress = flash.getAddress(flash.sizeofStr(writeSRT));
-
-	flash.writeStr(fAddress, writeSRT);
-
-	String readSTR;
-	flash.readStr(fAddress, readSTR);
+	return base;
+}
+uint32_t SckList::logEnd()
+{
+	return index;
+}
+uint16_t SckList::exportBytes(uint32_t wichIndex, uint8_t *data, uint16_t len)
+{
+	if (wichIndex < base || wichIndex >= index) return 0;
+	if (len > index - wichIndex) len = index - wichIndex;
 
-	if (!readSTR.equals(writeSRT)) return false;
-	return true;
+	readBytes(wichIndex, data, len);
+	return len;
 }
@@ -5,17 +5,57 @@
 
 #include "Sensors.h"
 #include "Pins.h"
+#include "SckJournal.h"
 
-// Number of bytes to be used in RAM, 512 bytes can store around 6 groups with the default urban board sensors enabled.
+// Number of bytes of RAM used by the list. The open group takes the first SCKLIST_GROUP_SIZE bytes and, if flash is not available, the
+// rest stores the saved groups (512 bytes can store around 6 groups with the default urban board sensors enabled).
+// When flash is used the buffer caches the last group read from flash (on the bytes of the open group while there is none) and its keyframe.
 #define SCKLIST_RAM_SIZE 1024
 
-// Number of bytes to be used on FLASH (Always keep this a littel bit smaller than real size)
-#define SCKLIST_FLASH_SIZE 4190000 // 4194304 is the real size (last 4304 bytes reserved for other uses)
+// Maximum size of a group while it is being filled (it is kept on RAM until it is saved)
+#define SCKLIST_GROUP_SIZE 512
+
+// Number of bytes to be used on FLASH (always a multiple of the sector size)
+#define SCKLIST_FLASH_SIZE 4186112 // 4194304 is the real size (last two 4096 bytes sectors are reserved for the config journal, see SckJournal.h)
 // it seems 2.1 has a 8mb flash!
+#define SCKLIST_SECTOR_SIZE 4096
+
+// The log state is checkpointed on the config journal at least every this number of saved or deleted groups (the boot scan only needs to read the groups saved after the last checkpoint)
+// Deletes are also checkpointed before a reset and before sleeping until the button is pressed. If the power goes before that, the boot scan counts the groups again from the start of the log.
+#define SCKLIST_CHECKPOINT_EVERY 32
+
+// Saved groups are appended as records, flash bytes are never rewritten until their sector is erased on the next lap.
+//
+// Record:	[logical address 4B][size 2B] [payload] [NET flag][SD flag][DEL flag][commit][back 2B][size 2B]
+// Payload:	[SENSOR_COUNT][4][timeStamp 4B] {[sensorType][valueSize][value]}*
+//
+// Addresses are logical (they always grow) and wrap around the flash area, the address in the header allows the boot scan to tell records from previous laps apart.
+// Flags are one byte each (0xFF not set, 0x00 set) so every flag can be programmed on its own.
+// A record only exists once its commit byte is programmed, a power cut while writing leaves an uncommited record that is skipped.
+// Back is the distance to the end of the previous record, deleted records are kept (with the DEL flag) until the whole log is empty and then a new log starts on the next sector.
+#define SCKLIST_HEADER_SIZE 6
+#define SCKLIST_TRAILER_SIZE 8
+
+// Compressed payload:	[SCKLIST_COMPRESSED][flags] keyframe: [timeStamp 4B] | other: [distance to keyframe end (varint)][timeStamp - keyframe timeStamp (zigzag varint)]
+// 			{[sensorType (omitted if the group has the same sensors as its keyframe)][kind 2b | decimals or size 6b][value]}*
+// Numbers are stored as fixed point integers (zigzag varints), absolute on keyframes and as the difference with the keyframe reading on other groups.
+// Values without a fixed point form (null readings and floats that don't fit on the mantissa) are stored as text.
+// Each group can be decoded on its own with the help of its keyframe, which is never erased while the group exists.
+#define SCKLIST_COMPRESSED 0xFE
+#define SCKLIST_KEYFRAME_EVERY 16
 
 struct OneReading {
 	SensorType type;
-	String value;
+	SensorValue value;
+};
+
+// Stored on the config journal, enough to rebuild the list after a reset
+struct ListCheckpoint {
+	uint32_t base;
+	uint32_t index;
+	uint32_t lastRecordRightIndex;
+	uint32_t lastGroupRightIndex;
+	uint32_t totalGroups;
 };
 
 class SckList
@@ -23,35 +63,97 @@ class SckList
 	private:
 		char ramBuff[SCKLIST_RAM_SIZE];
 
-		uint32_t index = 0;
+		// Open group (not yet saved), only the readings are stored on the buffer (already in the compressed format with absolute values if compress is set when the group is created)
+		char * const groupBuff = ramBuff;
+		uint16_t groupIndex = 0;
+		uint32_t groupTime = 0;
+		bool groupOpen = false;
+		uint8_t groupEncoding = 0;
+
+		// Last keyframe (for compressed groups)
+		uint32_t keyRightIndex = 0;
+		uint32_t keyTime = 0;
+		uint8_t groupsSinceKey = 0;
+
+		uint32_t base = 0; 				// Where the current log starts
+		uint32_t index = 0; 				// Where the next record will be written
 		uint32_t totalGroups = 0;
-		uint32_t lastGroupRightIndex = 0;  	// The last position of a group that means were group starts (reading from right to left)
+		uint32_t lastGroupRightIndex = 0;  		// End of the newest not deleted group (zero if there is none)
+		uint32_t lastRecordRightIndex = 0; 		// End of the newest record (deleted or not)
+		uint32_t erasedIndex = 0; 			// Flash is erased up to here
+		uint16_t savedSinceCheckpoint = 0;
+		uint16_t deletedSinceCheckpoint = 0;
+
+		// Last group lookup (groups are usually accessed in order)
+		uint32_t cacheGroup = 0;
+		uint32_t cacheRightIndex = 0;
+
+		// Group bytes cached on ramBuff when using flash (one slot for the group and other for its keyframe)
+		uint32_t cachedLeftIndex[2] = {0, 0};
+		uint32_t cachedRightIndex[2] = {0, 0};
 
 		// Flash memory
 		SPIFlash flash = SPIFlash(pinCS_FLASH);
 		bool flashStarted = false;
 		void flashSelect(); 			// Choose between sdcard or flash memory on SPI bus (this needs to be called before using flash)
-		void migrateToFlash(); 			// When RAM buff is full we migrate all stored readings to flash until we are able to publish and empty the buffer.
+		SckJournal *journal = 0;
 
+		enum RecordFlags {
+			DELETED = 2,
+			COMMIT = 3
+		};
+
+		enum EncodingFlags {
+			KEYFRAME = 1,
+			SAME_LAYOUT = 2,
+			COMPRESSED = 4 		// Only used on RAM (compressed payloads start with SCKLIST_COMPRESSED)
+		};
 
-		union u_TimeStamp {
-			char b[4];
-			uint32_t i;
-		} uTimeStamp;
+		enum ValueKind {
+			VALUE_TEXT,
+			VALUE_ABSOLUTE,
+			VALUE_DELTA,
+			VALUE_SAME
+		};
 
-		union u_GroupSize {
-			char b[2];
-			uint16_t i;
-		} uGroupSize;
+		struct GroupInfo {
+			uint32_t time;
+			uint32_t readingsIndex;
+			uint32_t endIndex;
+			bool compressed;
+			bool sameLayout;
+			uint32_t keyReadingsIndex;
+			uint32_t keyEndIndex;
+		};
 
 		void debugOut(const char *msg);
-		bool append(char value); 						// Appends a byte at the end of the list
-		bool write(uint32_t wichIndex, char value); 				// Writes a byte on a specific index of the list
+		uint32_t areaSize();
+		uint32_t sectorSize();
+		bool write(uint32_t wichIndex, const uint8_t *data, uint16_t len); 	// Writes bytes on a specific index of the list
+		void readBytes(uint32_t wichIndex, uint8_t *data, uint16_t len);
 		char read(uint32_t index); 						// Reads a byte of an specific index of the list
+		uint16_t read16(uint32_t index);
+		bool eraseUpTo(uint32_t wichIndex); 					// Erases flash sectors until wichIndex can be written
+		bool writeRecord(); 							// Writes the open group as a new record
+		uint8_t payloadHeader(uint32_t leftIndex, uint8_t *buff); 		// Builds the start of the payload (timestamp and encoding info)
+		void encodeGroup(); 							// Turns the open group readings into differences with the keyframe (in place)
+		uint16_t skipOpenReading(uint16_t thisIndex); 				// Next reading on the open group (only for compressed groups)
+		bool parseGroup(uint32_t rightIndex, GroupInfo &info);
+		uint32_t skipReading(uint32_t thisIndex, bool compressed, bool withType);
+		uint32_t readVarint(uint32_t &thisIndex);
+		SensorValue readText(uint32_t wichIndex, uint8_t len); 		// Values stored as text (uncompressed groups and values that are not plain numbers)
+		bool recordIsValid(uint32_t leftIndex, uint16_t &size);
+		bool isDeleted(uint32_t rightIndex);
+		bool setRecordFlag(uint32_t rightIndex, uint8_t wichFlag);
+		uint32_t previousGroup(uint32_t rightIndex); 				// Right index of the previous not deleted group (zero if there is none)
 		uint32_t getGroupRightIndex(uint32_t wichGroup); 			// Returns the ending index of a specific group (zero if group don't exist)
 		uint32_t getGroupLeftIndex(uint32_t wichGroup);				// Returns the first index of a specific group
 		uint16_t readGroupSize(uint32_t rightGroupIndex); 			// Returns the group size in bytes, it requires the right index of the group
+		void cacheGroupBytes(uint32_t rightIndex, uint8_t slot);
 		bool lastGroupIsOpen(); 						// True if last created group is not yet saved
+		bool checkpoint();
+		void restart(); 							// Starts a new empty log
+		bool recover(); 							// Rebuilds the list from the last checkpoint
 
 	public:
 
@@ -61,20 +163,30 @@ class SckList
 		};
 
 		bool debug = false;
-		void flashStart();
+		bool flashStart();
+		bool begin(SckJournal *wichJournal); 					// Starts the flash and recovers the groups saved before last reset (uses RAM if flash is not available)
 
 		bool usingFlash = false;
+		bool compress = true; 							// Save new groups compressed (groups in both formats can be read)
+		uint32_t recoveredGroups = 0; 						// Groups found after the last checkpoint on boot
+		uint32_t tornRecords = 0; 						// Uncommited records found on boot
 
 		bool createGroup(uint32_t timeStamp); 					// Starts a new group, if there is an open gruop it will delete it before.
 		bool saveLastGroup(); 							// Save the last group, to be called once all sensor readings are saved
-		bool delLastGroup(); 							// Will delete the last created group (saved or not)
+		bool delLastGroup(); 							// Will delete the last saved group
+		bool flushDeletes(); 							// Checkpoints the deletes not yet on the journal (before resetting or turning off)
 		uint32_t countGroups(); 						// Will return the total of saved groups
+		uint32_t usedBytes(); 							// Bytes used by the current log (including deleted groups)
 		uint32_t getTime(uint32_t wichGroup); 					// Return the timeStamp of the requested group (group index starts on the last saved group)
 		uint16_t countReadings(uint32_t wichGroup);
-		bool appendReading(SensorType wichsensor, String value);
+		bool appendReading(SensorType wichsensor, const SensorValue &value);
 		OneReading readReading(uint32_t wichGroup, uint8_t wichReading);
 		void setFlag(uint32_t wichGroup, GroupFlags wichFlag, bool value);
 		int8_t getFlag(uint32_t wichGroup, GroupFlags wichFlag); 		// Return flags or -1 on error
 		uint32_t getFlashCapacity();
-		bool testFlash();
+
+		// Raw access to the log for the export command (records as they are stored, logical addresses)
+		uint32_t logStart(); 							// First byte of the current log
+		uint32_t logEnd(); 							// Where the next record will be written
+		uint16_t exportBytes(uint32_t wichIndex, uint8_t *data, uint16_t len); 	// Returns the bytes read (0 outside of the log)
 };
@@ -0,0 +1,110 @@
+#include "SckMemory.h"
+
+extern "C" char *sbrk(int i);
+extern uint32_t __StackTop;
+
+// newlib nano malloc free list (newlib/libc/stdlib/nano-mallocr.c), the size of each chunk includes its header
+struct MallocChunk {
+	long size;
+	MallocChunk *next;
+};
+extern "C" MallocChunk *__malloc_free_list;
+
+volatile uint8_t SckMemory::tag = PERF_LOOP;
+uint32_t SckMemory::allocations[PERF_COUNT] = {};
+uint32_t SckMemory::frees = 0;
+uint32_t SckMemory::failed = 0;
+
+extern "C" {
+	void *__real_malloc(size_t size);
+	void *__real_realloc(void *ptr, size_t size);
+	void __real_free(void *ptr);
+
+	void *__wrap_malloc(size_t size)
+	{
+		void *ptr = __real_malloc(size);
+		SckMemory::allocations[SckMemory::tag]++;
+		if (!ptr) SckMemory::failed++;
+		return ptr;
+	}
+	void *__wrap_realloc(void *ptr, size_t size)
+	{
+		void *newPtr = __real_realloc(ptr, size);
+		SckMemory::allocations[SckMemory::tag]++;
+		if (!newPtr && size > 0) SckMemory::failed++;
+		return newPtr;
+	}
+	void __wrap_free(void *ptr)
+	{
+		if (ptr) SckMemory::frees++;
+		__real_free(ptr);
+	}
+}
+
+void SckMemory::paintStack()
+{
+	uint32_t *bottom = (uint32_t *)(((uint32_t)sbrk(0) + 3) & ~3);
+	uint32_t *top = (uint32_t *)(__get_MSP() - SCKMEMORY_STACK_MARGIN);
+
+	for (uint32_t *p=bottom; p<top; p++) *p = SCKMEMORY_PATTERN;
+	paintedBottom = bottom;
+}
+void SckMemory::update()
+{
+	uint32_t nowFree = freeRam();
+	if (nowFree < minFree) minFree = nowFree;
+}
+uint32_t SckMemory::gap()
+{
+	return __get_MSP() - (uint32_t)sbrk(0);
+}
+uint32_t SckMemory::heapFree(uint16_t *blocks, uint32_t *largest)
+{
+	uint32_t total = 0;
+	uint16_t count = 0;
+	uint32_t biggest = 0;
+
+	for (MallocChunk *chunk=__malloc_free_list; chunk; chunk=chunk->next) {
+		uint32_t size = chunk->size - sizeof(long);
+		total += size;
+		count++;
+		if (size > biggest) biggest = size;
+	}
+
+	if (blocks) *blocks = count;
+	if (largest) *largest = biggest;
+	return total;
+}
+uint32_t SckMemory::freeRam()
+{
+	return gap() + heapFree();
+}
+uint32_t SckMemory::largestBlock()
+{
+	uint32_t largest = 0;
+	heapFree(0, &largest);
+
+	// The top of the heap can grow until it meets the deepest point the stack has reached
+	uint32_t top = headroom();
+	if (top > SCKMEMORY_STACK_MARGIN) top -= SCKMEMORY_STACK_MARGIN;
+	else top = 0;
+
+	return max(largest, top);
+}
+uint32_t SckMemory::stackUsed()
+{
+	return (uint32_t)&__StackTop - ((uint32_t)sbrk(0) + headroom());
+}
+uint32_t SckMemory::headroom()
+{
+	if (!paintedBottom) return gap();
+
+	// The heap overwrites the pattern from below, so the search starts at its current top
+	uint32_t *p = (uint32_t *)(((uint32_t)sbrk(0) + 3) & ~3);
+	if (p < paintedBottom) p = paintedBottom;
+
+	uint32_t *sp = (uint32_t *)__get_MSP();
+	while (p < sp && *p == SCKMEMORY_PATTERN) p++;
+
+	return (uint32_t)p - (uint32_t)sbrk(0);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "SckPerf.h"
+
+// RAM telemetry: free memory low water mark, heap fragmentation, stack high water mark and heap allocations per subsystem.
+// The stack is painted with a known pattern when booting, the deepest point it ever reached is the first word above the heap that lost the pattern.
+// The heap is newlib nano malloc: its free list is walked to find the free blocks without allocating anything (probing with malloc could raise the heap top into the stack).
+// Allocations are counted by wrapping malloc/realloc/free at link time (see build_flags on platformio.ini), Strings grow with realloc.
+// The subsystem of each allocation is the main loop stage that is running (see SckPerf.h), PERF_LOOP means outside of any stage.
+
+#define SCKMEMORY_PATTERN 0xA5A5A5A5
+#define SCKMEMORY_STACK_MARGIN 64 		// bytes below the stack pointer that are left unpainted
+
+class SckMemory
+{
+	private:
+		uint32_t *paintedBottom = 0;
+
+	public:
+		// Updated from the malloc wrappers
+		static volatile uint8_t tag; 			// Subsystem (PerfStage) doing the allocations
+		static uint32_t allocations[PERF_COUNT];
+		static uint32_t frees;
+		static uint32_t failed;
+
+		uint32_t minFree = 0xFFFFFFFF; 		// Low water mark of freeRam(), sampled every second
+
+		void paintStack(); 				// Call as early as possible after booting
+		void update();
+		uint32_t gap(); 				// Between the heap top and the stack pointer
+		uint32_t heapFree(uint16_t *blocks=0, uint32_t *largest=0); 	// Free bytes inside the heap (fragments)
+		uint32_t freeRam(); 				// gap() + heapFree()
+		uint32_t largestBlock(); 			// Biggest block malloc can give without touching the stack
+		uint32_t stackUsed(); 				// Deepest point the stack has reached since booting
+		uint32_t headroom(); 				// Smallest distance ever between the heap top and the stack
+};
@@ -0,0 +1,72 @@
+#include "SckPerf.h"
+#include "SckMemory.h"
+
+constexpr const char *SckPerf::titles[];
+
+uint32_t SckPerf::start(PerfStage wichStage)
+{
+	// Deeper stages are still timed, their allocations go to the deepest one that fits
+	if (depth < SCKPERF_DEPTH) {
+		previous[depth] = SckMemory::tag;
+		SckMemory::tag = wichStage;
+	}
+	if (depth < 255) depth++;
+
+	return micros();
+}
+void SckPerf::end(PerfStage wichStage, uint32_t started)
+{
+	if (depth > 0 && --depth < SCKPERF_DEPTH) SckMemory::tag = previous[depth];
+	record(wichStage, micros() - started);
+}
+void SckPerf::loop()
+{
+	uint32_t now = micros();
+	if (lastLoop != 0) record(PERF_LOOP, now - lastLoop);
+	lastLoop = now;
+
+	// Every stage has finished when a new loop starts
+	depth = 0;
+	SckMemory::tag = PERF_LOOP;
+}
+void SckPerf::record(PerfStage wichStage, uint32_t elapsed)
+{
+	StageStats &stats = stages[wichStage];
+
+	stats.count++;
+	stats.totalMicros += elapsed;
+	if (elapsed > stats.maxMicros) stats.maxMicros = elapsed;
+
+	uint8_t bucket = 0;
+	uint32_t limit = 100;
+	while (bucket < SCKPERF_BUCKETS - 1 && elapsed >= limit) {
+		bucket++;
+		limit *= 10;
+	}
+	stats.buckets[bucket]++;
+
+	if (elapsed >= SCKPERF_STALL_MICROS) {
+		stalls[stallIndex].stage = wichStage;
+		stalls[stallIndex].micros = elapsed;
+		stalls[stallIndex].time = rtc->getEpoch();
+		stallIndex = (stallIndex + 1) % SCKPERF_STALLS;
+		if (stallsStored < SCKPERF_STALLS) stallsStored++;
+		stallCount++;
+	}
+}
+void SckPerf::reset()
+{
+	for (uint8_t i=0; i<PERF_COUNT; i++) stages[i] = StageStats();
+	stallsStored = 0;
+	stallIndex = 0;
+	stallCount = 0;
+	lastLoop = 0;
+}
+PerfStage SckPerf::worst()
+{
+	PerfStage wichStage = PERF_INPUT;
+	for (uint8_t i=PERF_INPUT; i<PERF_COUNT; i++) {
+		if (stages[i].maxMicros > stages[wichStage].maxMicros) wichStage = static_cast<PerfStage>(i);
+	}
+	return wichStage;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <RTCZero.h>
+
+// Main loop instrumentation: time spent on each stage of the loop with micros() timestamps (the M0+ core has no cycle counter).
+// Each stage keeps its count, total and max time and a histogram by decades (<100us, <1ms, <10ms, <100ms, <1s, >=1s).
+// Every stage that takes longer than SCKPERF_STALL_MICROS is stored on a small ring buffer with the stage that caused it.
+// Stages can be nested (sensors are updated from inside the state review) so their times are inclusive.
+// Deep sleep doesn't count: micros() doesn't run while sleeping.
+// The running stage is also the subsystem heap allocations are charged to (see SckMemory.h).
+
+#define SCKPERF_BUCKETS 6
+#define SCKPERF_STALLS 8
+#define SCKPERF_STALL_MICROS 250000
+#define SCKPERF_DEPTH 4
+
+enum PerfStage {
+	PERF_LOOP, 		// Time between two consecutive loops (how long the console and the button wait)
+	PERF_INPUT,
+	PERF_ESPBUS,
+	PERF_STATE,
+	PERF_SENSORS,
+	PERF_PUBLISH,
+	PERF_POWER,
+	PERF_BUTTON,
+
+	PERF_COUNT
+};
+
+class SckPerf
+{
+	private:
+		uint32_t lastLoop = 0;
+		RTCZero* rtc;
+		uint8_t previous[SCKPERF_DEPTH]; 	// Stages interrupted by nested ones
+		uint8_t depth = 0; 			// Nested stages running, it can go over SCKPERF_DEPTH
+
+		void record(PerfStage wichStage, uint32_t elapsed);
+
+	public:
+		SckPerf(RTCZero* myrtc) {
+			rtc = myrtc;
+		}
+
+		struct StageStats {
+			uint32_t count = 0;
+			uint64_t totalMicros = 0;
+			uint32_t maxMicros = 0;
+			uint32_t buckets[SCKPERF_BUCKETS] = {};
+		};
+		struct Stall {
+			PerfStage stage;
+			uint32_t micros;
+			uint32_t time; 		// epoch
+		};
+
+		static constexpr const char *titles[PERF_COUNT] = {
+			"loop",
+			"input",
+			"espbus",
+			"state",
+			"sensors",
+			"publish",
+			"power",
+			"button",
+		};
+
+		StageStats stages[PERF_COUNT];
+		Stall stalls[SCKPERF_STALLS];
+		uint8_t stallsStored = 0;
+		uint8_t stallIndex = 0; 	// Next position of the ring
+		uint32_t stallCount = 0;
+
+		uint32_t start(PerfStage wichStage);
+		void end(PerfStage wichStage, uint32_t started);
+		void loop(); 					// Called once per main loop
+		void reset();
+		PerfStage worst(); 				// Stage with the biggest max time (not counting the loop)
+};
@@ -0,0 +1,122 @@
+#include "SckSdWriter.h"
+
+bool SckSdWriter::open(SdFat &sd, const char *wichFile)
+{
+	checkCard();
+
+	if (isOpen(wichFile)) return true;
+
+	// Data left on the buffer by a card change goes to its file first
+	if (!fileOpen && buffUsed > 0) {
+		if (!reopen(sd, name) || !sync()) return false;
+	}
+
+	close();
+
+	return reopen(sd, wichFile);
+}
+bool SckSdWriter::isOpen(const char *wichFile)
+{
+	checkCard();
+
+	return fileOpen && strncmp(name, wichFile, sizeof(name)) == 0;
+}
+bool SckSdWriter::sync()
+{
+	checkCard();
+
+	if (!fileOpen) return false;
+	if (buffUsed == 0) return true;
+
+	uint32_t started = micros();
+	uint16_t written = file.write(buff, buffUsed);
+	bool result = file.sync();
+
+	if (written < buffUsed) {
+		// Keep what couldn't be written for the next try
+		memmove(buff, &buff[written], buffUsed - written);
+		result = false;
+	}
+	buffUsed -= written;
+	position += written;
+	buffCapacity = SCKSDWRITER_BLOCK_SIZE - (position % SCKSDWRITER_BLOCK_SIZE);
+
+	lastFlushMicros = micros() - started;
+	if (lastFlushMicros > maxFlushMicros) maxFlushMicros = lastFlushMicros;
+	busyMicros += lastFlushMicros;
+	lastFlushBytes = written;
+	bytesWritten += written;
+	flushes++;
+	lastSync = millis();
+
+	return result;
+}
+bool SckSdWriter::syncDue()
+{
+	return fileOpen && buffUsed > 0 && (millis() - lastSync) >= SCKSDWRITER_SYNC_INTERVAL;
+}
+bool SckSdWriter::close()
+{
+	checkCard();
+
+	if (!fileOpen) return true;
+
+	bool result = sync();
+	if (result) {
+		file.close();
+		fileOpen = false;
+	}
+
+	return result;
+}
+size_t SckSdWriter::write(uint8_t data)
+{
+	return write(&data, 1);
+}
+size_t SckSdWriter::write(const uint8_t *data, size_t size)
+{
+	checkCard();
+
+	if (!fileOpen) {
+		writeError = true;
+		return 0;
+	}
+
+	size_t done = 0;
+	while (done < size) {
+		// Block boundary reached
+		if (buffUsed >= buffCapacity && !sync()) break;
+
+		uint16_t chunk = min((size_t)(buffCapacity - buffUsed), size - done);
+		memcpy(&buff[buffUsed], &data[done], chunk);
+		buffUsed += chunk;
+		done += chunk;
+	}
+
+	if (buffUsed >= buffCapacity || syncDue()) sync();
+	if (done < size) writeError = true;
+
+	return done;
+}
+bool SckSdWriter::reopen(SdFat &sd, const char *wichFile)
+{
+	file = sd.open(wichFile, FILE_WRITE);
+	if (!file) return false;
+
+	fileOpen = true;
+	if (wichFile != name) strncpy(name, wichFile, sizeof(name) - 1);
+	position = file.size();
+	buffCapacity = SCKSDWRITER_BLOCK_SIZE - (position % SCKSDWRITER_BLOCK_SIZE);
+	lastSync = millis();
+
+	return true;
+}
+void SckSdWriter::checkCard()
+{
+	// After a card change the handle points to a volume that doesn't exist anymore, forget it without touching the card
+	if (cardChanged) {
+		cardChanged = false;
+		file = File();
+		fileOpen = false;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include "SdFat.h"
+
+// Keeps a file open on the sdcard and stages the text printed to it on RAM.
+// The buffer is written when it reaches the end of a 512 bytes block of the file (so every write ends on a block boundary),
+// when data has been waiting for SCKSDWRITER_SYNC_INTERVAL, or when sync() is called (before sleeping or reseting, and at the
+// end of every sdcard publish: readings are only flagged as published, or deleted from flash, once they are on the card).
+// Opening and closing the file for every publish costs a directory lookup, a walk of the FAT chain to find the end of the file
+// and a directory update, keeping it open leaves only the data block and the directory entry update on each flush.
+
+#define SCKSDWRITER_BLOCK_SIZE 512
+#define SCKSDWRITER_SYNC_INTERVAL 300000 	// ms
+
+class SckSdWriter : public Print
+{
+	private:
+		File file;
+		char name[13] = "";
+		bool fileOpen = false;
+		uint32_t position = 0; 			// File size (without the buffered bytes)
+
+		uint8_t buff[SCKSDWRITER_BLOCK_SIZE];
+		uint16_t buffUsed = 0;
+		uint16_t buffCapacity = SCKSDWRITER_BLOCK_SIZE; 	// Bytes until the next block boundary of the file
+		uint32_t lastSync = 0;
+
+		bool reopen(SdFat &sd, const char *wichFile);
+		void checkCard();
+
+	public:
+		volatile bool cardChanged = false; 	// Set from the card detect interrupt, the open file can't be used anymore
+		bool writeError = false; 		// A write couldn't take all its bytes, cleared by the caller
+
+		// Stats
+		uint32_t flushes = 0;
+		uint32_t bytesWritten = 0;
+		uint16_t lastFlushBytes = 0;
+		uint32_t lastFlushMicros = 0;
+		uint32_t maxFlushMicros = 0;
+		uint32_t busyMicros = 0; 			// Total time spent writing to the card
+
+		bool open(SdFat &sd, const char *wichFile); 		// Does nothing if the file is already open
+		bool isOpen(const char *wichFile);
+		bool sync(); 						// Writes the buffered bytes and updates the directory entry
+		bool syncDue(); 					// True if buffered data has been waiting for too long
+		bool close();
+		uint16_t pending() { return buffUsed; }
+
+		using Print::write;
+		size_t write(uint8_t data);
+		size_t write(const uint8_t *data, size_t size);
+};
@@ -0,0 +1,90 @@
+#include "SckStream.h"
+
+constexpr const char *SckStream::rawTitles[];
+constexpr uint8_t SckStream::rawSizes[];
+constexpr uint32_t SckStream::rawRates[];
+
+uint8_t SckStream::header(uint8_t *raw, uint8_t wichId, uint8_t wichFormat, uint32_t wichMicros)
+{
+	raw[0] = sequence & 0xFF;
+	raw[1] = sequence >> 8;
+	raw[2] = wichId;
+	raw[3] = wichFormat;
+	for (uint8_t i=0; i<4; i++) raw[4 + i] = (wichMicros >> (8 * i)) & 0xFF;
+	sequence++;
+
+	return 8;
+}
+uint8_t SckStream::encode(const uint8_t *raw, uint8_t len, uint8_t *buff)
+{
+	if (cobs) return cobsEncode(raw, len, buff);
+
+	memcpy(buff, raw, len);
+	return len;
+}
+uint8_t SckStream::frame(uint8_t *buff, SensorType wichSensor, uint32_t wichMicros, const SensorValue &value)
+{
+	uint8_t raw[SCKSTREAM_FRAME];
+
+	SensorValue::ValueKind kind = value.isNull() ? SensorValue::VALUE_NULL : value.kind;
+	int32_t bits = kind == SensorValue::VALUE_NULL ? 0 : value.mantissa; 	// float or mantissa, same bytes
+
+	uint8_t len = header(raw, wichSensor, kind | ((kind == SensorValue::VALUE_FIXED ? value.decimals : 0) << 4), wichMicros);
+	for (uint8_t i=0; i<4; i++) raw[len++] = ((uint32_t)bits >> (8 * i)) & 0xFF;
+
+	return encode(raw, len, buff);
+}
+uint8_t SckStream::rawFrame(uint8_t *buff, RawChannel wichChannel, uint32_t wichMicros, const uint8_t *payload)
+{
+	uint8_t raw[SCKSTREAM_RAW_HEADER + SCKSTREAM_RAW_MAX];
+
+	uint8_t len = header(raw, wichChannel, SCKSTREAM_RAW_KIND, wichMicros);
+	memcpy(&raw[len], payload, rawSizes[wichChannel]);
+	len += rawSizes[wichChannel];
+
+	return encode(raw, len, buff);
+}
+RawChannel SckStream::getRawChannel(const char *name)
+{
+	for (uint8_t i=0; i<RAW_COUNT; i++) if (strcmp(name, rawTitles[i]) == 0) return static_cast<RawChannel>(i);
+	return RAW_COUNT;
+}
+uint8_t SckStream::cobsEncode(const uint8_t *in, uint8_t len, uint8_t *out)
+{
+	// Frames are shorter than 254 bytes, so one code byte per zero is enough
+	uint8_t codePlace = 0;
+	uint8_t outLen = 1;
+	uint8_t code = 1;
+
+	for (uint8_t i=0; i<len; i++) {
+		if (in[i] == 0) {
+			out[codePlace] = code;
+			codePlace = outLen++;
+			code = 1;
+		} else {
+			out[outLen++] = in[i];
+			code++;
+		}
+	}
+	out[codePlace] = code;
+	out[outLen++] = 0;
+
+	return outLen;
+}
+uint32_t SckStream::crc32(uint32_t crc, const uint8_t *data, uint16_t len)
+{
+	// Half byte table, 64 bytes of flash instead of the 1KB of the full table
+	static const uint32_t table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+		0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+		0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	crc = ~crc;
+	for (uint16_t i=0; i<len; i++) {
+		crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+		crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+	}
+	return ~crc;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Sensors.h"
+
+// Binary frames for the monitor command (monitor -binary), used to stream readings at full rate without formatting them as text.
+// Every reading is one little endian frame:
+//	seq (uint16)		Incremented on every frame, gaps show dropped frames on the host
+//	sensor (uint8)		SensorType (titles and units are sent on the text header, see monitorSensor_com)
+//	format (uint8)		Low nibble: SensorValue kind (0 null, 1 float, 2 fixed), high nibble: decimals of fixed values
+//	micros (uint32)		micros() when the reading was taken
+//	value (4 bytes)		float or int32 mantissa (mantissa / 10^decimals)
+// With -raw the frames carry what the drivers read instead of readings, as soon as it is read (monitor -binary -raw noise,mics-co,mics-no2,pm):
+//	seq (uint16), channel (uint8, RawChannel), format (uint8, always SCKSTREAM_RAW_KIND), micros (uint32) and the payload of the channel
+//	noise		SCKSTREAM_NOISE_BLOCK microphone samples at 44100 Hz, 3 bytes each (24 bits signed), micros is the time of the last one
+//	mics-co/no2	one conversion of the MICS ADC (ADS7924, uint16 with 12 bits)
+//	pm		the 30 bytes the PMS5003 sends after its start chars 42 4d (one frame per second)
+// Payload sizes are fixed per channel and listed on the text header, so frames can also be told apart without COBS.
+// With COBS framing every frame is encoded so it has no zero bytes and ends with a 0x00 delimiter, the host can resync after losing bytes.
+// Without it frames are sent as they are, one after the other. tools/sckmonitor.py captures and decodes both.
+// The export command uses the same helpers to send the raw readings log in chunks checked with crc32 (see export_com).
+
+#define SCKSTREAM_VERSION 2
+#define SCKSTREAM_FRAME 12
+#define SCKSTREAM_RAW_HEADER 8
+#define SCKSTREAM_RAW_KIND 3 			// After the SensorValue kinds
+#define SCKSTREAM_NOISE_BLOCK 32
+#define SCKSTREAM_RAW_MAX (SCKSTREAM_NOISE_BLOCK * 3) 	// Biggest raw payload
+#define SCKSTREAM_MAX (SCKSTREAM_RAW_HEADER + SCKSTREAM_RAW_MAX + 2) 	// COBS overhead byte and delimiter
+#define SCKSTREAM_EXPORT_CHUNK 256 		// Log bytes on each export chunk
+
+enum RawChannel {
+	RAW_NOISE,
+	RAW_MICS_CO,
+	RAW_MICS_NO2,
+	RAW_PM,
+
+	RAW_COUNT
+};
+
+class SckStream
+{
+	private:
+		uint8_t header(uint8_t *raw, uint8_t wichId, uint8_t wichFormat, uint32_t wichMicros);
+		uint8_t encode(const uint8_t *raw, uint8_t len, uint8_t *buff);
+
+	public:
+		bool cobs = true;
+		uint16_t sequence = 0;
+
+		void begin(bool wichCobs) {
+			cobs = wichCobs;
+			sequence = 0;
+		}
+
+		static constexpr const char *rawTitles[RAW_COUNT] = { "noise", "mics-co", "mics-no2", "pm" };
+		static constexpr uint8_t rawSizes[RAW_COUNT] = { SCKSTREAM_NOISE_BLOCK * 3, 2, 2, 30 };
+		static constexpr uint32_t rawRates[RAW_COUNT] = { 44100, 0, 0, 0 }; 	// Samples per second (0 if it depends on the loop)
+
+		// Fill buff (SCKSTREAM_MAX bytes) with the frame of one reading (or of raw driver data) and return its size
+		uint8_t frame(uint8_t *buff, SensorType wichSensor, uint32_t wichMicros, const SensorValue &value);
+		uint8_t rawFrame(uint8_t *buff, RawChannel wichChannel, uint32_t wichMicros, const uint8_t *payload);
+
+		static RawChannel getRawChannel(const char *name); 	// RAW_COUNT if there is no channel with that name
+		static uint8_t cobsEncode(const uint8_t *in, uint8_t len, uint8_t *out); 	// out needs len + 2 bytes, returns encoded size with the delimiter
+		static uint32_t crc32(uint32_t crc, const uint8_t *data, uint16_t len); 	// Same as zlib crc32 (start with 0)
+};
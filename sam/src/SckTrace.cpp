@@ -0,0 +1,177 @@
+#include "SckTrace.h"
+
+extern TwoWire auxWire;
+
+SckTrace *SckTrace::active = 0;
+
+bool SckTrace::start(SdFat &sd, const char *version)
+{
+	if (recording()) return true;
+
+	// Next free name
+	uint16_t number = 0;
+	for (; number<1000; number++) {
+		snprintf(fileName, sizeof(fileName), "TRACE%03u.SKT", number);
+		if (!sd.exists(fileName)) break;
+	}
+	if (number == 1000) return false;
+
+	writer = new SckSdWriter;
+	staging = new uint8_t[SCKTRACE_STAGING_SIZE];
+	if (!writer || !staging || !writer->open(sd, fileName)) {
+		delete writer;
+		delete[] staging;
+		writer = 0;
+		staging = 0;
+		return false;
+	}
+
+	started = rtc->getEpoch();
+	for (uint8_t i=0; i<TRACE_RECORD_COUNT; i++) records[i] = 0;
+	dropped = 0;
+	i2sCount = 0;
+	lastI2c = 0;
+	lastMicros = micros();
+	lastEpoch = started;
+
+	uint8_t header[28] = { 'S', 'C', 'K', 'T', SCKTRACE_VERSION, i2sDecimation, streams, 0 };
+	memcpy(&header[8], &started, 4);
+	size_t versionLen = strlen(version);
+	memcpy(&header[12], version, versionLen < 16 ? versionLen : 16);
+	staged = 0;
+	bytes = writer->write(header, sizeof(header));
+
+	active = this;
+	return bytes == sizeof(header);
+}
+bool SckTrace::stop()
+{
+	if (!recording()) return true;
+
+	active = 0;
+	bool result = update() && writer->close();
+
+	delete writer;
+	delete[] staging;
+	writer = 0;
+	staging = 0;
+	staged = 0;
+
+	return result;
+}
+bool SckTrace::update()
+{
+	if (!recording() || staged == 0) return true;
+
+	uint16_t written = writer->write(staging, staged);
+	bytes += written;
+	bool result = written == staged;
+	staged = 0; 		// What couldn't be written is lost, the next records still have the right times
+	if (!result) dropped++;
+
+	return result;
+}
+bool SckTrace::sync()
+{
+	if (!recording()) return true;
+	return update() && writer->sync();
+}
+void SckTrace::cardChanged()
+{
+	if (!recording()) return;
+	writer->cardChanged = true;
+	stop();
+}
+bool SckTrace::begin(uint8_t type, uint32_t size)
+{
+	if (!(streams & (1 << type))) return false;
+
+	// Type, time (5 bytes hold 35 bits, more than 9 hours), size and payload
+	if (staged + 1 + 10 + 3 + size > SCKTRACE_STAGING_SIZE) {
+		dropped++;
+		return false;
+	}
+
+	uint32_t now = micros();
+	uint32_t epoch = rtc->getEpoch();
+	uint64_t elapsed = now - lastMicros;
+
+	// micros() doesn't run while sleeping (and wraps every 71 minutes), the RTC does
+	if (epoch - lastEpoch > elapsed / 1000000 + 1) elapsed = (uint64_t)(epoch - lastEpoch) * 1000000;
+	lastMicros = now;
+	lastEpoch = epoch;
+
+	staging[staged++] = type;
+	putVarint(elapsed);
+	putVarint(size);
+	records[type]++;
+	return true;
+}
+void SckTrace::put(const uint8_t *data, uint16_t size)
+{
+	memcpy(&staging[staged], data, size);
+	staged += size;
+}
+void SckTrace::putVarint(uint64_t value)
+{
+	while (value >= 0x80) {
+		staging[staged++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	staging[staged++] = value;
+}
+
+void SckTrace::pm(const uint8_t *data, uint8_t size)
+{
+	if (!active || !active->begin(TRACE_PM, 2 + size)) return;
+	const uint8_t start[2] = { 0x42, 0x4d };
+	active->put(start, 2);
+	active->put(data, size);
+}
+void SckTrace::i2c(TwoWire *bus, uint8_t address, const uint8_t *written, uint8_t writtenSize, const uint8_t *data, uint8_t size, int16_t readRegister)
+{
+	if (!active) return;
+	uint8_t header[3] = { (uint8_t)(bus == &auxWire ? 1 : 0), address, writtenSize };
+	uint8_t registerSize = 0;
+	uint8_t wichRegister = readRegister;
+	if (readRegister >= 0) {
+		header[0] |= 0x80;
+		registerSize = 1;
+	}
+
+	// FNV-1a of the whole transaction
+	uint32_t hash = 2166136261;
+	const uint8_t *parts[4] = { header, written, &wichRegister, data };
+	uint8_t sizes[4] = { 3, writtenSize, registerSize, size };
+	for (uint8_t p=0; p<4; p++) for (uint8_t i=0; i<sizes[p]; i++) hash = (hash ^ parts[p][i]) * 16777619;
+	if (hash == active->lastI2c) return;
+
+	if (!active->begin(TRACE_I2C, 3 + writtenSize + registerSize + size)) return;
+	active->lastI2c = hash;
+	active->put(header, 3);
+	active->put(written, writtenSize);
+	active->put(&wichRegister, registerSize);
+	active->put(data, size);
+}
+void SckTrace::i2s(const int32_t *samples, uint16_t count)
+{
+	if (!active) return;
+	if (active->i2sCount > 0) {
+		if (++active->i2sCount >= active->i2sDecimation) active->i2sCount = 0;
+		return;
+	}
+	if (active->i2sDecimation > 1) active->i2sCount = 1;
+	if (!active->begin(TRACE_I2S, count * 3)) return;
+
+	// The noise driver keeps 25 bits (sample >> 7 of a 24 bits sample left justified on 32), the lowest one is always 0
+	for (uint16_t i=0; i<count; i++) {
+		int32_t value = samples[i] >> 1;
+		uint8_t sample[3] = { (uint8_t)(value & 0xFF), (uint8_t)(value >> 8 & 0xFF), (uint8_t)(value >> 16 & 0xFF) };
+		active->put(sample, 3);
+	}
+}
+void SckTrace::bus(const uint8_t *packet, uint8_t size)
+{
+	if (!active || !active->begin(TRACE_BUS, size)) return;
+	active->put(packet, size);
+}
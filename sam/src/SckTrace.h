@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include <RTCZero.h>
+#include <Wire.h>
+#include "SdFat.h"
+
+#include "SckSdWriter.h"
+
+// Trace recorder: the raw inputs of the drivers, with their time, on a binary file of the sdcard (TRACEnnn.SKT, a new one for every
+// recording). The native build replays them through the same drivers (replay event, see host/HostScript.h) so different
+// builds can be compared with the data of a real kit.
+//
+// Header:	[SCKT][version][i2s decimation][streams][reserved][start epoch 4B][SAM version 16B, zero padded]
+// Records:	[type][time varint][size varint][payload]
+//	time		micros since the previous record (whole seconds of the RTC across a sleep, micros() doesn't run while sleeping)
+//	TRACE_PM	the frame as it was read from the PMS5003 (42 4d and the bytes after them)
+//	TRACE_I2C	[bus (0 Wire, 1 auxWire)][address][written bytes count][written bytes][read bytes], one transaction of the
+//			gauge, the charger, the SHT31 or the MPL3115A2 (its data registers 0x01-0x05, read again after the library).
+//			With 0x80 on the bus the read bytes start with the register they come from, read after the write (the
+//			BH1730 measures with the configuration written and keeps the result on its data registers)
+//	TRACE_I2S	the 512 samples of a noise reading as the microphone gives them (24 bits each), one of every i2s decimation readings
+//	TRACE_BUS	a packet from the ESP as RHReliableDatagram gives it ([total parts][content])
+// Varints are 7 bits per byte, low bits first, the high bit set on every byte but the last. All numbers are little endian.
+//
+// Drivers only stage records on RAM, the main loop writes them to the card (update()). Records that don't fit on the staging
+// buffer are dropped and counted, an I2C transaction equal to the previous one is not recorded again (the replay keeps the
+// last answer of every register and command). Buffers are only allocated while recording, a reset or a card change ends the recording.
+
+#define SCKTRACE_VERSION 1
+#define SCKTRACE_STAGING_SIZE 2048 	// Bytes of records between two main loops (a noise reading takes 1541)
+#define SCKTRACE_I2S_DECIMATION 10
+
+enum TraceRecord {
+	TRACE_PM = 1,
+	TRACE_I2C,
+	TRACE_I2S,
+	TRACE_BUS,
+
+	TRACE_RECORD_COUNT
+};
+
+#define SCKTRACE_ALL_STREAMS ((1 << TRACE_PM) | (1 << TRACE_I2C) | (1 << TRACE_I2S) | (1 << TRACE_BUS))
+
+class SckTrace
+{
+	private:
+		static SckTrace *active; 			// The one recording (drivers record through the static functions)
+
+		RTCZero* rtc;
+		SckSdWriter *writer = 0;
+		uint8_t *staging = 0;
+		uint16_t staged = 0;
+		uint32_t lastMicros = 0;
+		uint32_t lastEpoch = 0;
+		uint8_t i2sCount = 0; 				// Noise readings since the last recorded one
+		uint32_t lastI2c = 0; 				// Hash of the last I2C transaction (polling loops repeat the same one)
+
+		bool begin(uint8_t type, uint32_t size); 	// Stages the record header, false if the record doesn't fit
+		void put(const uint8_t *data, uint16_t size);
+		void putVarint(uint64_t value);
+
+	public:
+		SckTrace(RTCZero* myrtc) {
+			rtc = myrtc;
+		}
+
+		char fileName[13] = "";
+		uint8_t streams = SCKTRACE_ALL_STREAMS; 		// Bit (1 << TraceRecord) of every recorded stream
+		uint8_t i2sDecimation = SCKTRACE_I2S_DECIMATION; 	// 1 records every noise reading
+
+		// Stats of the current (or last) recording
+		uint32_t started = 0; 				// epoch
+		uint32_t records[TRACE_RECORD_COUNT] = {};
+		uint32_t dropped = 0;
+		uint32_t bytes = 0;
+
+		bool start(SdFat &sd, const char *version); 	// Opens the next free TRACEnnn.SKT and writes its header
+		bool stop(); 					// Writes what is staged and closes the file
+		bool recording() { return writer != 0; }
+		bool update(); 					// Writes the staged records (call with the sdcard selected)
+		bool sync(); 					// update() and the blocks buffered on the writer, before sleeping
+		void cardChanged(); 				// The file can't be used anymore: ends the recording
+
+		// Called from the drivers, they do nothing when nothing is recording
+		static bool wants(TraceRecord type) { return active && (active->streams & (1 << type)); }
+		static void pm(const uint8_t *data, uint8_t size); 	// Bytes after the start chars
+		static void i2c(TwoWire *bus, uint8_t address, const uint8_t *written, uint8_t writtenSize, const uint8_t *data, uint8_t size, int16_t readRegister=-1);
+		static void i2s(const int32_t *samples, uint16_t count);
+		static void bus(const uint8_t *packet, uint8_t size);
+};
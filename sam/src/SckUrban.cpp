@@ -102,44 +102,44 @@ void SckUrban::getReading(SckBase *base, OneSensor *wichSensor)
 {
 	wichSensor->state = 0;
 	switch(wichSensor->type) {
-		case SENSOR_LIGHT:			if (sck_bh1730fvc.get()) 			{ wichSensor->reading = String(sck_bh1730fvc.reading); return; } break;
-		case SENSOR_TEMPERATURE: 		if (sck_sht31.getReading()) 			{ wichSensor->reading = String(sck_sht31.temperature); return; } break;
-		case SENSOR_HUMIDITY: 			if (sck_sht31.getReading()) 			{ wichSensor->reading = String(sck_sht31.humidity); return; } break;
-		case SENSOR_CO_RESISTANCE: 		if (sck_mics4514.getCOresistance())		{ wichSensor->reading = String(sck_mics4514.coResistance); return; } break;
-		case SENSOR_CO_HEAT_VOLT: 								wichSensor->reading = String(sck_mics4514.getCOheatVoltage()); return; break;
-		case SENSOR_CO_HEAT_TIME: 								wichSensor->reading = String(sck_mics4514.getHeatTime(rtc->getEpoch())); return; break; 
-		case SENSOR_NO2_RESISTANCE: 		if (sck_mics4514.getNO2resistance()) 		{ wichSensor->reading = String(sck_mics4514.no2Resistance); return; } break;
-		case SENSOR_NO2_HEAT_VOLT: 								wichSensor->reading = String(sck_mics4514.getNO2heatVoltage()); return; break;
-		case SENSOR_NO2_HEAT_TIME: 								wichSensor->reading = String(sck_mics4514.getHeatTime(rtc->getEpoch())); return; break; 
-		case SENSOR_NO2_LOAD_RESISTANCE:	if (sck_mics4514.getNO2load()) 			{ wichSensor->reading = String(sck_mics4514.no2LoadResistor); return; } break;
-		case SENSOR_NOISE_DBA: 			if (sck_noise.getReading(SENSOR_NOISE_DBA)) 	{ wichSensor->reading = String(sck_noise.readingDB); return; } break;
-		case SENSOR_NOISE_DBC: 			if (sck_noise.getReading(SENSOR_NOISE_DBC)) 	{ wichSensor->reading = String(sck_noise.readingDB); return; } break;
-		case SENSOR_NOISE_DBZ: 			if (sck_noise.getReading(SENSOR_NOISE_DBZ)) 	{ wichSensor->reading = String(sck_noise.readingDB); return; } break;
+		case SENSOR_LIGHT:			if (sck_bh1730fvc.get()) 			{ wichSensor->reading = sck_bh1730fvc.reading; return; } break;
+		case SENSOR_TEMPERATURE: 		if (sck_sht31.getReading()) 			{ wichSensor->reading = sck_sht31.temperature; return; } break;
+		case SENSOR_HUMIDITY: 			if (sck_sht31.getReading()) 			{ wichSensor->reading = sck_sht31.humidity; return; } break;
+		case SENSOR_CO_RESISTANCE: 		if (sck_mics4514.getCOresistance())		{ wichSensor->reading = sck_mics4514.coResistance; return; } break;
+		case SENSOR_CO_HEAT_VOLT: 								wichSensor->reading = sck_mics4514.getCOheatVoltage(); return; break;
+		case SENSOR_CO_HEAT_TIME: 								wichSensor->reading = sck_mics4514.getHeatTime(rtc->getEpoch()); return; break; 
+		case SENSOR_NO2_RESISTANCE: 		if (sck_mics4514.getNO2resistance()) 		{ wichSensor->reading = sck_mics4514.no2Resistance; return; } break;
+		case SENSOR_NO2_HEAT_VOLT: 								wichSensor->reading = sck_mics4514.getNO2heatVoltage(); return; break;
+		case SENSOR_NO2_HEAT_TIME: 								wichSensor->reading = sck_mics4514.getHeatTime(rtc->getEpoch()); return; break; 
+		case SENSOR_NO2_LOAD_RESISTANCE:	if (sck_mics4514.getNO2load()) 			{ wichSensor->reading = sck_mics4514.no2LoadResistor; return; } break;
+		case SENSOR_NOISE_DBA: 			if (sck_noise.getReading(SENSOR_NOISE_DBA)) 	{ wichSensor->reading = sck_noise.readingDB; return; } break;
+		case SENSOR_NOISE_DBC: 			if (sck_noise.getReading(SENSOR_NOISE_DBC)) 	{ wichSensor->reading = sck_noise.readingDB; return; } break;
+		case SENSOR_NOISE_DBZ: 			if (sck_noise.getReading(SENSOR_NOISE_DBZ)) 	{ wichSensor->reading = sck_noise.readingDB; return; } break;
 		case SENSOR_NOISE_FFT: 			if (sck_noise.getReading(SENSOR_NOISE_FFT)) 	{
 								// TODO find a way to give access to readingsFFT instead of storing them on a String (too much RAM)
 								// For now it just prints the values to console
 								for (uint16_t i=1; i<sck_noise.FFT_NUM; i++) SerialUSB.println(sck_noise.readingFFT[i]);
 								return;
 							}
-		case SENSOR_ALTITUDE:			if (sck_mpl3115A2.getAltitude()) 		{ wichSensor->reading = String(sck_mpl3115A2.altitude); return; } break;
-		case SENSOR_PRESSURE:			if (sck_mpl3115A2.getPressure()) 		{ wichSensor->reading = String(sck_mpl3115A2.pressure); return; } break;
-		case SENSOR_PRESSURE_TEMP:		if (sck_mpl3115A2.getTemperature()) 		{ wichSensor->reading = String(sck_mpl3115A2.temperature); return; } break;
-		case SENSOR_PARTICLE_RED:		if (sck_max30105.getRed()) 			{ wichSensor->reading = String(sck_max30105.redChann); return; } break;
-		case SENSOR_PARTICLE_GREEN:		if (sck_max30105.getGreen()) 			{ wichSensor->reading = String(sck_max30105.greenChann); return; } break;
-		case SENSOR_PARTICLE_IR:		if (sck_max30105.getIR()) 			{ wichSensor->reading = String(sck_max30105.IRchann); return; } break;
-		case SENSOR_PARTICLE_TEMPERATURE: 	if (sck_max30105.getTemperature()) 		{ wichSensor->reading = String(sck_max30105.temperature); return; } break;
-		case SENSOR_PM_1: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pm1); return;
-		case SENSOR_PM_25: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pm25); return;
-		case SENSOR_PM_10: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pm10); return;
-		case SENSOR_PN_03: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn03); return;
-		case SENSOR_PN_05: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn05); return;
-		case SENSOR_PN_1: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn1); return;
-		case SENSOR_PN_25: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn25); return;
-		case SENSOR_PN_5: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn5); return;
-		case SENSOR_PN_10: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = String(sck_pm.pn10); return;
+		case SENSOR_ALTITUDE:			if (sck_mpl3115A2.getAltitude()) 		{ wichSensor->reading = sck_mpl3115A2.altitude; return; } break;
+		case SENSOR_PRESSURE:			if (sck_mpl3115A2.getPressure()) 		{ wichSensor->reading = sck_mpl3115A2.pressure; return; } break;
+		case SENSOR_PRESSURE_TEMP:		if (sck_mpl3115A2.getTemperature()) 		{ wichSensor->reading = sck_mpl3115A2.temperature; return; } break;
+		case SENSOR_PARTICLE_RED:		if (sck_max30105.getRed()) 			{ wichSensor->reading = sck_max30105.redChann; return; } break;
+		case SENSOR_PARTICLE_GREEN:		if (sck_max30105.getGreen()) 			{ wichSensor->reading = sck_max30105.greenChann; return; } break;
+		case SENSOR_PARTICLE_IR:		if (sck_max30105.getIR()) 			{ wichSensor->reading = sck_max30105.IRchann; return; } break;
+		case SENSOR_PARTICLE_TEMPERATURE: 	if (sck_max30105.getTemperature()) 		{ wichSensor->reading = sck_max30105.temperature; return; } break;
+		case SENSOR_PM_1: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pm1; return;
+		case SENSOR_PM_25: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pm25; return;
+		case SENSOR_PM_10: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pm10; return;
+		case SENSOR_PN_03: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn03; return;
+		case SENSOR_PN_05: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn05; return;
+		case SENSOR_PN_1: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn1; return;
+		case SENSOR_PN_25: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn25; return;
+		case SENSOR_PN_5: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn5; return;
+		case SENSOR_PN_10: 			wichSensor->state = sck_pm.oneShot(sck_pm.oneShotPeriod); if (wichSensor->state == -1) break; if (wichSensor->state == 0) wichSensor->reading = sck_pm.pn10; return;
 		default: break;
 	}
-	wichSensor->reading = "null";
+	wichSensor->reading = SensorValue();
 	wichSensor->state = -1;
 }
 
@@ -300,12 +300,15 @@ bool Sck_BH1730FVC::updateValues()
 	Wire.requestFrom(address, 4);
 
 	// Get result
-	uint16_t IDATA0 = 0;
-	uint16_t IDATA1 = 0;
-	IDATA0 = Wire.read();
-	IDATA0 = IDATA0 | (Wire.read()<<8);
-	IDATA1 = Wire.read();
-	IDATA1 = IDATA1 | (Wire.read()<<8);
+	uint8_t raw[4];
+	for (uint8_t i=0; i<4; i++) raw[i] = Wire.read();
+	if (SckTrace::wants(TRACE_I2C)) {
+		uint8_t configuration[9] = { 0x80 };
+		memcpy(&configuration[1], DATA, 8);
+		SckTrace::i2c(&Wire, address, configuration, 9, raw, 4, 0x94);
+	}
+	uint16_t IDATA0 = raw[0] | (raw[1]<<8);
+	uint16_t IDATA1 = raw[2] | (raw[3]<<8);
 	DATA0 = (float)IDATA0;
 	DATA1 = (float)IDATA1;
 
@@ -423,6 +426,8 @@ bool Sck_SHT31::update()
 		if (debug) SerialUSB.print(readbuffer[i]);
 	}
 	if (debug) SerialUSB.println();
+	const uint8_t command[2] = { (uint8_t)(SINGLE_SHOT_HIGH_REP >> 8), (uint8_t)(SINGLE_SHOT_HIGH_REP & 0xFF) };
+	SckTrace::i2c(_Wire, address, command, 2, readbuffer, 6);
 
 	uint16_t ST, SRH;
 	ST = readbuffer[0];
@@ -790,6 +795,16 @@ uint32_t Sck_MICS4514::getHeatTime(uint32_t currentTime)
 	if (startHeaterTime == 0) startHeaterTime = currentTime;
 	return currentTime - startHeaterTime;
 }
+float Sck_MICS4514::heaterCurrent()
+{
+	if (!heaterRunning) return 0;
+
+	// The PWM switches the heater voltage over the heater and its series resistor
+	float coCurrent = (dutyCycle_CO / 100.0) * heater_VCC / (heaterResistance_CO + heater_seriesResistor);
+	float no2Current = (dutyCycle_NO2 / 100.0) * heater_VCC / (heaterResistance_NO2 + heater_seriesResistor);
+
+	return (coCurrent + no2Current) * 1000;
+}
 float Sck_MICS4514::average(uint8_t wichPin)
 {
 
@@ -803,21 +818,23 @@ float Sck_MICS4514::average(uint8_t wichPin)
 }
 float Sck_MICS4514::getADC(uint8_t wichChannel)
 {
-	byte dir[4] = {2,4,6,8};
-	byte ask = B11000000 + wichChannel;
-
 	uint32_t result = 0;
 	uint8_t numberOfSamples = 20;
 
 	// Average 5 samples
-	for (uint8_t i=0; i<numberOfSamples; i++) {
-		writeI2C(ADC_DIR, 0, ask);
-		writeI2C(ADC_DIR, 0, ask);
-		result += (readI2C(ADC_DIR, dir[wichChannel])<<4) + (readI2C(ADC_DIR, dir[wichChannel] + 1)>>4);
-	}
+	for (uint8_t i=0; i<numberOfSamples; i++) result += getRawADC(wichChannel);
 	float resultInVoltage = (float)(result / numberOfSamples) * VCC / ANALOG_RESOLUTION;
 	return resultInVoltage;
 }
+uint16_t Sck_MICS4514::getRawADC(uint8_t wichChannel)
+{
+	byte dir[4] = {2,4,6,8};
+	byte ask = B11000000 + wichChannel;
+
+	writeI2C(ADC_DIR, 0, ask);
+	writeI2C(ADC_DIR, 0, ask);
+	return (readI2C(ADC_DIR, dir[wichChannel])<<4) + (readI2C(ADC_DIR, dir[wichChannel] + 1)>>4);
+}
 void Sck_MICS4514::writeI2C(byte deviceaddress, byte address, byte data )
 {
 	Wire.beginTransmission(deviceaddress);
@@ -880,6 +897,7 @@ bool Sck_Noise::getReading(SensorType wichSensor)
 		}
 	}
 	I2S.end();
+	SckTrace::i2s(source, SAMPLE_NUM);
 
 	// Get de average of recorded samples
 	int32_t sum = 0;
@@ -936,6 +954,24 @@ bool Sck_Noise::getReading(SensorType wichSensor)
 
 	return true;
 }
+bool Sck_Noise::streamStart()
+{
+	return I2S.begin(I2S_PHILIPS_MODE, sampleRate, 32);
+}
+uint16_t Sck_Noise::streamRead(int32_t *buff, uint16_t count)
+{
+	// Same samples as getReading (the channel without the mic reads 0)
+	uint16_t bufferIndex = 0;
+	while (bufferIndex < count && I2S.available()) {
+		int32_t sample = I2S.read();
+		if (sample) buff[bufferIndex++] = sample>>7;
+	}
+	return bufferIndex;
+}
+void Sck_Noise::streamStop()
+{
+	I2S.end();
+}
 bool Sck_Noise::FFT(int32_t *source)
 {
 	int16_t scaledSource[SAMPLE_NUM];
@@ -1178,6 +1214,7 @@ bool Sck_MPL3115A2::getAltitude()
 
 	// TODO timeout to prevent hangs on external lib
 	altitude = Adafruit_mpl3115A2.getAltitude();
+	trace();
 
 	return true;
 }
@@ -1188,6 +1225,7 @@ bool Sck_MPL3115A2::getPressure()
 
 	// TODO timeout to prevent hangs on external lib
 	pressure = Adafruit_mpl3115A2.getPressure() / 1000;
+	trace();
 
 	return true;
 }
@@ -1199,9 +1237,27 @@ bool Sck_MPL3115A2::getTemperature()
 	// TODO timeout to prevent hangs on external lib
 	altitude = Adafruit_mpl3115A2.getAltitude();
 	temperature =  Adafruit_mpl3115A2.getTemperature();	// Only works after a getAltitude! don't call this allone
+	trace();
 
 	return true;
 }
+void Sck_MPL3115A2::trace()
+{
+	if (!SckTrace::wants(TRACE_I2C)) return;
+
+	// The mode (CTRL_REG1 ALT bit says if OUT_P has pressure or altitude) and the data registers (OUT_P and OUT_T)
+	const uint8_t registers[2] = { 0x26, 0x01 };
+	const uint8_t sizes[2] = { 1, 5 };
+	for (uint8_t r=0; r<2; r++) {
+		uint8_t data[5];
+		Wire.beginTransmission(address);
+		Wire.write(registers[r]);
+		if (Wire.endTransmission(false) != 0) return;
+		if (Wire.requestFrom(address, sizes[r]) < sizes[r]) return;
+		for (uint8_t i=0; i<sizes[r]; i++) data[i] = Wire.read();
+		SckTrace::i2c(&Wire, address, &registers[r], 1, data, sizes[r]);
+	}
+}
 
 // Dust Particles
 bool Sck_MAX30105::start()
@@ -1342,6 +1398,7 @@ bool Sck_PM::update()
 
 		unsigned char buff[buffLong];
 		byte howMany =  SerialPM.readBytes(buff, buffLong);
+		SckTrace::pm(buff, howMany);
 
 		// Is buffer complete?
 		if (howMany < 30) {
@@ -1374,6 +1431,26 @@ bool Sck_PM::update()
 	}
 	return false;
 }
+bool Sck_PM::streamFrame(uint8_t *frame)
+{
+	while (SerialPM.available()) {
+		uint8_t received = SerialPM.read();
+
+		if (streamIndex == 0) {
+			if (received == 0x42) streamIndex = 1;
+		} else if (streamIndex == 1) {
+			if (received == 0x4d) streamIndex = 2;
+			else if (received != 0x42) streamIndex = 0;
+		} else {
+			frame[streamIndex - 2] = received;
+			if (++streamIndex == buffLong + 2) {
+				streamIndex = 0;
+				return true;
+			}
+		}
+	}
+	return false;
+}
 int16_t Sck_PM::oneShot(uint16_t period)
 {
 	int16_t pendingSeconds = period;
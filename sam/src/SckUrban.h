@@ -163,8 +163,12 @@ class Sck_MICS4514
 		bool setNO2load(uint32_t value);
 		bool getNO2load();
 		uint32_t getHeatTime(uint32_t currentTime);
+		float heaterCurrent(); 		// Average current of both heaters (mA)
 		float average(uint8_t wichPin);
 		float getADC(uint8_t wichChannel);
+		uint16_t getRawADC(uint8_t wichChannel); 	// One conversion (12 bits), getADC averages 20 of them
+		uint16_t getRawCO() { return getRawADC(CO_ADC_CHANN); }
+		uint16_t getRawNO2() { return getRawADC(NO2_ADC_CHANN); }
 };
 
 // Noise
@@ -182,6 +186,9 @@ class Sck_Noise
 		void applyWindow(int16_t *src, const uint16_t *window, uint16_t len);
 		double dynamicScale(int32_t *source, int16_t *scaledSource);
 		void fft2db();
+#ifdef benchmark
+		friend class SckBench;
+#endif
 
 	public:
 		bool debugFlag = false;
@@ -194,6 +201,10 @@ class Sck_Noise
 		bool stop();
 		bool getReading(SensorType wichSensor);
 
+		// Raw samples for monitor -binary -raw, the I2S keeps running between reads
+		bool streamStart();
+		uint16_t streamRead(int32_t *buff, uint16_t count); 	// Samples already on the bus (up to count), it doesn't wait for more
+		void streamStop();
 };
 
 // Barometric pressure and Altitude
@@ -204,6 +215,7 @@ class Sck_MPL3115A2
 
 	private:
 		Adafruit_MPL3115A2 Adafruit_mpl3115A2 = Adafruit_MPL3115A2();
+		void trace(); 		// Records the data registers the library has read (see SckTrace.h)
 
 	public:
 		uint8_t address = 0x60;
@@ -249,6 +261,7 @@ class Sck_PM
 		uint32_t lastReading = 0;
 
 		static const uint8_t buffLong = 30; 	// Excluding both start chars
+		uint8_t streamIndex = 0; 		// Bytes of the frame received by streamFrame (start chars included)
 
 		// Serial transmission from PMS
 		// 0: Start char 1 0x42 (fixed)
@@ -305,6 +318,7 @@ class Sck_PM
 		bool update();
 		int16_t oneShot(uint16_t period);
 		bool reset();
+		bool streamFrame(uint8_t *frame); 	// Reads the bytes already received, true when frame (30 bytes, without the start chars) has a complete one (for monitor -binary -raw)
 };
 
 class SckBase;
@@ -318,9 +332,7 @@ class SckUrban
 		};
 		RTCZero* rtc;
 	public:
-		SckUrban(RTCZero* myrtc) {
-			rtc = myrtc;
-		}
+		SckUrban(RTCZero* myrtc) : rtc(myrtc) {} 	// Initialized before the members that take it (sck_pm)
 
 		bool setup();
 		bool start(SensorType wichSensor);
@@ -3,12 +3,18 @@
 #ifdef testing
 #include "SckTest.h"
 #endif
+#ifdef benchmark
+#include "SckBench.h"
+#endif
 
 SckBase base;
 
 #ifdef testing
 SckTest sckTest(&base);
 #endif
+#ifdef benchmark
+SckBench sckBench(&base);
+#endif
 
 bool reset_pending = false;
 
@@ -30,21 +36,32 @@ void ISR_button() {
 void ISR_battery() {
 	base.battPendingEvent = true;
 }
+// Charger events interrupt
+void ISR_charger() {
+	base.chargerPendingEvent = true;
+}
 // Card detect interrupt
 void ISR_sdDetect() {
 	base.sdDetect();
 }
+// Deadline alarm: it only has to wake the kit up, the main loop does the rest
+void ISR_deadline() {
+}
 // void ISR_alarm() {
 // 	base.wakeUp();
 // };
 
 void setup() {
 
+	base.memory.paintStack();
 	base.setup();
 
 #ifdef testing
 	sckTest.test_full();
 #endif
+#ifdef benchmark
+	sckBench.run();
+#endif
 }
 
 void loop() {
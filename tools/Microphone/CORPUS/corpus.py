@@ -0,0 +1,108 @@
+#!/usr/bin/python
+
+import sys, os, math, random, struct, wave
+
+'''
+Makes the calibrated test signals of the noise bench (sam/host/noise_bench.cpp): mono WAV files, 24 bits at 44100 Hz,
+half a second each (the bench loops them). Levels follow the calibration of the kit (Sck_Noise::getReading): a full
+scale sine (0 dBFS peak) is 120 dB SPL, and any signal is at 120 + 20 * log10(sqrt(2) * rms / full scale).
+
+The levels are the ones at the output of the microphone, before the equalization of the kit.
+'''
+
+RATE = 44100
+SECONDS = 0.5
+FULL_SCALE = 2 ** 23
+FULL_SCALE_DBSPL = 120
+
+def usage():
+    print('USAGE:\n\ncorpus.py [output folder (default: this folder)]')
+    sys.exit()
+
+def amplitude(level):
+    ''' Peak of a sine (or sqrt(2) * rms of anything else) at this dB SPL '''
+    return FULL_SCALE * 10 ** ((level - FULL_SCALE_DBSPL) / 20.0)
+
+def weightA(freq):
+    ''' IEC 61672 A weighting in dB '''
+    f2 = freq * freq
+    ra = 12194.217 ** 2 * f2 * f2 / ((f2 + 20.598997 ** 2) * math.sqrt((f2 + 107.65265 ** 2) * (f2 + 737.86223 ** 2)) * (f2 + 12194.217 ** 2))
+    return 20 * math.log10(ra) + 2.0
+
+def weightC(freq):
+    ''' IEC 61672 C weighting in dB '''
+    f2 = freq * freq
+    rc = 12194.217 ** 2 * f2 / ((f2 + 20.598997 ** 2) * (f2 + 12194.217 ** 2))
+    return 20 * math.log10(rc) + 0.062
+
+def tones(parts):
+    ''' Sum of sines, parts are (Hz, dB SPL) '''
+    count = int(RATE * SECONDS)
+    return [sum(amplitude(level) * math.sin(2 * math.pi * freq * n / RATE) for freq, level in parts) for n in range(count)]
+
+def white(seed):
+    rng = random.Random(seed)
+    return [rng.gauss(0, 1) for n in range(int(RATE * SECONDS))]
+
+def pink(seed):
+    ''' White noise through Paul Kellet's filter (-3 dB per octave) '''
+    b = [0.0] * 7
+    out = []
+    for w in white(seed):
+        b[0] = 0.99886 * b[0] + w * 0.0555179
+        b[1] = 0.99332 * b[1] + w * 0.0750759
+        b[2] = 0.96900 * b[2] + w * 0.1538520
+        b[3] = 0.86650 * b[3] + w * 0.3104856
+        b[4] = 0.55000 * b[4] + w * 0.5329522
+        b[5] = -0.7616 * b[5] - w * 0.0168980
+        out.append(sum(b[:6]) + b[6] + w * 0.5362)
+        b[6] = w * 0.115926
+    return out
+
+def atLevel(samples, level):
+    ''' Scales a signal to a level, without its mean '''
+    mean = sum(samples) / len(samples)
+    samples = [s - mean for s in samples]
+    rms = math.sqrt(sum(s * s for s in samples) / len(samples))
+    gain = amplitude(level) / (math.sqrt(2) * rms)
+    return [s * gain for s in samples]
+
+def writeWav(path, samples):
+    frames = bytearray()
+    for s in samples:
+        value = int(round(max(-FULL_SCALE, min(FULL_SCALE - 1, s))))
+        frames += struct.pack('<i', value)[:3]
+    out = wave.open(path, 'wb')
+    out.setnchannels(1)
+    out.setsampwidth(3)
+    out.setframerate(RATE)
+    out.writeframes(bytes(frames))
+    out.close()
+
+# Name, signal, dBZ, dBA, dBC (None for the broadband ones: they depend on the spectrum)
+SIGNALS = [
+    ('sine_1k_94dB', lambda: tones([(1000, 94)]), 94, 94 + weightA(1000), 94 + weightC(1000)),
+    ('sine_1k_60dB', lambda: tones([(1000, 60)]), 60, 60 + weightA(1000), 60 + weightC(1000)),
+    ('sine_125_80dB', lambda: tones([(125, 80)]), 80, 80 + weightA(125), 80 + weightC(125)),
+    ('sine_4k_70dB', lambda: tones([(4000, 70)]), 70, 70 + weightA(4000), 70 + weightC(4000)),
+    ('sine_8k_70dB', lambda: tones([(8000, 70)]), 70, 70 + weightA(8000), 70 + weightC(8000)),
+    ('tones_250_1k_4k_70dB', lambda: tones([(250, 70), (1000, 70), (4000, 70)]), 70 + 10 * math.log10(3),
+        10 * math.log10(sum(10 ** ((70 + weightA(f)) / 10) for f in [250, 1000, 4000])),
+        10 * math.log10(sum(10 ** ((70 + weightC(f)) / 10) for f in [250, 1000, 4000]))),
+    ('white_50dB', lambda: atLevel(white(1), 50), 50, None, None),
+    ('pink_70dB', lambda: atLevel(pink(2), 70), 70, None, None),
+    ('white_35dB', lambda: atLevel(white(3), 35), 35, None, None),
+]
+
+if __name__ == '__main__':
+
+    if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+    folder = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+
+    def show(value):
+        return '-' if value is None else '%.1f' % value
+
+    print('file, dBZ, dBA, dBC')
+    for name, make, dbz, dba, dbc in SIGNALS:
+        writeWav(os.path.join(folder, name + '.wav'), make())
+        print('%s.wav, %s, %s, %s' % (name, show(dbz), show(dba), show(dbc)))
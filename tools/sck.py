@@ -15,6 +15,14 @@ import sys
 import binascii
 import json
 import requests
+import struct
+import zlib
+import multiprocessing
+
+try:
+    raw_input
+except NameError:
+    raw_input = input
 
 '''
 Smartcitizen Kit python library.
@@ -63,16 +71,22 @@ class sck:
     wifi_pass = ''
 
     verbose = 2     # 0 -> never print anything, 1 -> print only errors, 2 -> print everything
+    lastError = ''
+    espFlashSeconds = 0
+
+    # Held while a kit enters the bootloader when its drive can't be told apart from the others (see setBootLoaderMode)
+    bootLock = None
 
-    def begin(self):
+    def begin(self, serialNum=None):
         devList = list(serial.tools.list_ports.comports())
         i = 0
         kit_list = []
         for d in devList:
             try:
                 if 'Smartcitizen' in d.description:
+                    if serialNum is not None and d.serial_number != serialNum: continue
                     i+=1
-                    print('['+str(i)+'] Smartcitizen Kit S/N: ' + d.serial_number)
+                    if serialNum is None: print('['+str(i)+'] Smartcitizen Kit S/N: ' + d.serial_number)
                     kit_list.append(d)
             except:
                 pass
@@ -168,20 +182,44 @@ class sck:
     def setBootLoaderMode(self):
         self.updateSerial()
         self.serialPort.close()
+        before = list(uf2conv.getdrives())
         self.serialPort = serial.Serial(self.serialPort_name, 1200)
         self.serialPort.setDTR(False)
-        time.sleep(5)
-        mps = uf2conv.getdrives()
-        for p in mps:
-            if 'INFO_UF2.TXT' in os.listdir(p):
-                return p
+
+        # With more kits attached the drive has to be this kit one: found by its USB serial number where the OS tells it,
+        # otherwise the drive that shows up after the reset (only one kit resets at a time then, see flashSAM)
+        onlyOwn = self.bootLock is not None and self.drivesBySerial()
+        timeout = time.time() + 15
+        while time.time() < timeout:
+            time.sleep(0.5)
+            mountpoint = self.kitDrive()
+            if mountpoint: return mountpoint
+            if onlyOwn: continue
+            new = [p for p in uf2conv.getdrives() if p not in before]
+            if new: return new[0]
+        if self.bootLock is None:
+            for p in uf2conv.getdrives(): return p
         self.err_out('Cant find the mount point fo the SCK')
         return False
 
+    def drivesBySerial(self):
+        return os.path.isdir('/dev/disk/by-id') and os.path.exists('/proc/mounts')
+
+    def kitDrive(self):
+        ''' Mount point of the bootloader drive with the serial number of this kit (Linux only, None if not found) '''
+        byId = '/dev/disk/by-id'
+        if not self.sam_serialNum or not self.drivesBySerial(): return None
+        devices = [os.path.realpath(os.path.join(byId, name)) for name in os.listdir(byId) if name.startswith('usb-') and self.sam_serialNum.lower() in name.lower()]
+        with open('/proc/mounts') as mounts:
+            for line in mounts:
+                fields = line.split()
+                if fields[0] in devices: return fields[1].replace('\\040', ' ')
+        return None
+
     def buildSAM(self, out=sys.__stdout__):
         os.chdir(self.paths['base'])
         os.chdir('sam')
-        piorun = subprocess.call(['pio', 'run'], stdout=out, stderr=subprocess.STDOUT)
+        piorun = subprocess.call(['pio', 'run', '-e', 'sck2'], stdout=out, stderr=subprocess.STDOUT)
         if piorun == 0:
             try:
                 shutil.copyfile(os.path.join(os.getcwd(), '.pio', 'build', 'sck2', 'firmware.bin'), os.path.join(self.paths['binFolder'], self.files['samBin']))
@@ -197,14 +235,20 @@ class sck:
         os.chdir(self.paths['base'])
         return True
 
-    def flashSAM(self, out=sys.__stdout__):
+    def flashSAM(self, out=sys.__stdout__, uf2=None):
+        ''' uf2 is the firmware file to flash (default: bin/SAM_firmware.uf2) '''
         os.chdir(self.paths['base'])
-        mountpoint = self.setBootLoaderMode()
+        locked = self.bootLock is not None and not self.drivesBySerial()
+        if locked: self.bootLock.acquire()
         try:
-            shutil.copyfile(os.path.join(self.paths['binFolder'], self.files['samUf2']), os.path.join(mountpoint, self.files['samUf2']))
+            mountpoint = self.setBootLoaderMode()
+            if not mountpoint: return False
+            shutil.copyfile(uf2 or os.path.join(self.paths['binFolder'], self.files['samUf2']), os.path.join(mountpoint, self.files['samUf2']))
         except:
             self.err_out('Failed transferring firmware to SAM')
             return False
+        finally:
+            if locked: self.bootLock.release()
         time.sleep(2)
         return True
 
@@ -236,12 +280,17 @@ class sck:
         self.err_out('Failed building ESP firmware')
         return False
 
-    def flashESP(self, speed=921600, out=sys.__stdout__):
+    def flashESP(self, speed=921600, out=sys.__stdout__, compress=True):
+        ''' esptool syncs at 115200 and then switches the ESP and the SAM bridge to speed (up to 3000000, see sam/src/SckBridge.h)
+        The time from the bridge request to the end of the upload is kept on espFlashSeconds '''
         os.chdir(self.paths['base'])
+        started = time.time()
         if not self.getBridge(speed): return False
-        flashedESP = subprocess.call(['tools/esptool.py', '--before', 'no_reset', '--port', self.serialPort_name, '--baud', str(int(speed)), 'write_flash', '0x000000', os.path.join(self.paths['binFolder'], self.files['espBin'])], stdout=out, stderr=subprocess.STDOUT)
+        flashedESP = subprocess.call(['tools/esptool.py', '--before', 'no_reset', '--port', self.serialPort_name, '--baud', str(int(speed)), 'write_flash', '--compress' if compress else '--no-compress', '0x000000', os.path.join(self.paths['binFolder'], self.files['espBin'])], stdout=out, stderr=subprocess.STDOUT)
         # flashedESP = subprocess.call([self.paths['esptool'], '-cp', self.serialPort_name, '-cb', str(speed), '-ca', '0x000000', '-cf', os.path.join(self.paths['binFolder'], self.files['espBin'])], stdout=out, stderr=subprocess.STDOUT)
         if flashedESP == 0:
+            self.espFlashSeconds = time.time() - started
+            self.std_out('ESP flashed in %.1f seconds at %u baud%s' % (self.espFlashSeconds, speed, '' if compress else ' (uncompressed)'))
             time.sleep(1)
             return True
         else:
@@ -293,20 +342,107 @@ class sck:
     def end(self):
         if self.serialPort.is_open: self.serialPort.close()
 
-    def register(self):
+    def exportReadings(self, outName, fresh=False, withDeleted=False):
+        ''' Pulls the readings stored on the kit (export command) to outName.sckraw and decodes them to outName.csv
+        An interrupted export of the same kit is resumed where it stopped unless fresh is True '''
+        import scklog
+        rawName = outName + '.sckraw'
+        infoName = outName + '.json'
+
+        self.updateSerial()
+        self.checkConsole()
+        self.serialPort.timeout = 5
+
+        info = None
+        if not fresh and os.path.exists(infoName) and os.path.exists(rawName):
+            with open(infoName) as f: info = json.load(f)
+            if info.get('serial') != self.sam_serialNum: info = None
+
+        done = False
+        for tries in range(5):
+            self.serialPort.write(b'\r\n')
+            time.sleep(0.5)
+            self.serialPort.reset_input_buffer()
+
+            command = 'export'
+            if info is not None: command += ' -from ' + str(info['base'] + os.path.getsize(rawName))
+            self.serialPort.write((command + '\r\n').encode())
+
+            header = self.exportHeader()
+            if header is None or (info is not None and header['base'] != info['base']):
+                # The log on the kit changed since the last export, start again
+                self.std_out('Starting a new export')
+                info = None
+                continue
+            if info is None:
+                info = header
+                info['serial'] = self.sam_serialNum
+                open(rawName, 'wb').close()
+            info['end'] = header['end']
+
+            # Chunks: [address 4B][size 2B][bytes][crc32 4B], an empty chunk ends the export
+            expected = header['from']
+            started = time.time()
+            with open(rawName, 'ab') as raw:
+                while True:
+                    head = self.serialPort.read(6)
+                    if len(head) < 6: break
+                    address, size = struct.unpack('<IH', head)
+                    body = self.serialPort.read(size + 4)
+                    if len(body) < size + 4 or address != expected: break
+                    if zlib.crc32(head + body[:size]) & 0xFFFFFFFF != struct.unpack_from('<I', body, size)[0]: break
+                    if size == 0:
+                        done = True
+                        break
+                    raw.write(body[:size])
+                    expected += size
+            with open(infoName, 'w') as f: json.dump(info, f)
+
+            received = expected - header['from']
+            self.std_out('Received %u bytes (%u of %u) at %.1f KB/s' % (received, expected - info['base'], info['end'] - info['base'], received / 1024.0 / max(time.time() - started, 0.001)))
+            if done: break
+            self.err_out('Export interrupted, resuming...')
+
+        # Stop the export if it is still running
+        self.serialPort.write(b'\r\n')
+        if not done:
+            self.err_out('Export failed, run it again to resume')
+            return False
+
+        groups = scklog.writeCsv(rawName, outName + '.csv', withDeleted)
+        self.std_out('%u groups saved to %s' % (groups, outName + '.csv'))
+        return True
+
+    def exportHeader(self):
+        ''' Reads the text header of the export command (None if it fails) '''
+        header = None
+        while True:
+            line = self.serialPort.readline().decode('utf-8', 'replace').strip()
+            if not line or 'ERROR' in line: return None
+            if '#SCKEXPORT' in line:
+                # The prompt of the kit can be on the same line
+                fields = line[line.index('#SCKEXPORT'):].split()
+                header = {'version': int(fields[1]), 'base': int(fields[2]), 'end': int(fields[3]), 'from': int(fields[4]), 'sector': int(fields[5]), 'sensors': {}}
+            elif header is None: continue
+            elif line == '#START': return header
+            elif line.startswith('#'):
+                fields = line[1:].split('\t')
+                if len(fields) >= 4: header['sensors'][fields[0]] = {'id': fields[1], 'title': fields[2], 'unit': fields[3]}
+
+    def credentials(self):
+        ''' Platform bearer and WiFi for the kits, from secret.py or asked '''
         try:
             import secret
             print("Founded secrets.py:")
             print("bearer: " + secret.bearer)
             print("Wifi ssid: " + secret.wifi_ssid)
             print("Wifi pass: " + secret.wifi_pass)
-            bearer = secret.bearer
-            wifi_ssid = secret.wifi_ssid
-            wifi_pass = secret.wifi_pass
+            return secret.bearer, secret.wifi_ssid, secret.wifi_pass
         except:
-            bearer = raw_input("Platform bearer: ")
-            wifi_ssid = raw_input("WiFi ssid: ")
-            wifi_pass = raw_input("WiFi password: ")
+            return raw_input("Platform bearer: "), raw_input("WiFi ssid: "), raw_input("WiFi password: ")
+
+    def register(self, bearer=None, wifi_ssid=None, wifi_pass=None):
+        if bearer is None: bearer, wifi_ssid, wifi_pass = self.credentials()
 
         headers = {'Authorization':'Bearer ' + bearer, 'Content-type': 'application/json',}
         device = {}
@@ -326,7 +462,7 @@ class sck:
         device['user_tags'] = 'Lab, Research, Experimental'
 
         device_json = json.dumps(device)
-        backed_device = requests.post('https://api.smartcitizen.me/v0/devices', data=device_json, headers=headers)
+        backed_device = requests.post('https://api.smartcitizen.me/v0/devices', data=device_json, headers=headers, timeout=30)
         self.id = str(backed_device.json()['id'])
         self.platform_url = "https://smartcitizen.me/kits/" + self.id
 
@@ -362,8 +498,218 @@ class sck:
         if self.verbose >= 2: print(msg)
 
     def err_out(self, msg):
+        self.lastError = msg
         if self.verbose >= 1:
             sys.stdout.write("\033[1;31m")
             print('ERROR ' + msg)
             sys.stdout.write("\033[0;0m")
 
+def listKits():
+    ''' Serial number and port of every kit attached '''
+    kits = []
+    for d in serial.tools.list_ports.comports():
+        try:
+            if 'Smartcitizen' in d.description: kits.append((d.serial_number, d.device))
+        except:
+            pass
+    return kits
+
+def fleetInit(lock):
+    sck.bootLock = lock
+
+def fleetWorker(job):
+    ''' Flashes and provisions one kit, in its own process. The output of every step goes to bin/fleet/serial.log '''
+    serialNum, port, actions, options = job
+    result = {'serial': serialNum, 'port': port, 'ok': True, 'error': '', 'steps': {}}
+
+    kit = sck()
+    kit.verbose = 0
+    kit.sam_serialNum = serialNum
+    kit.serialPort_name = port
+
+    with open(os.path.join(kit.paths['binFolder'], 'fleet', serialNum + '.log'), 'w') as log:
+        for action in ['sam', 'esp', 'register']:
+            if action not in actions: continue
+            started = time.time()
+            try:
+                if action == 'sam': ok = kit.flashSAM(out=log)
+                elif action == 'esp': ok = kit.flashESP(options['speed'], out=log)
+                elif action == 'register':
+                    kit.getInfo()
+                    kit.platform_name = options['name'] + ' #' + kit.esp_macAddress[-5:].replace(':', '')
+                    kit.register(*options['credentials'])
+                    ok = True
+            except BaseException as e:
+                # updateSerial() exits when the kit doesn't show up
+                ok = False
+                if not kit.lastError: kit.lastError = repr(e)
+            result['steps'][action] = {'ok': ok, 'seconds': round(time.time() - started, 1)}
+            if not ok:
+                result['ok'] = False
+                result['error'] = kit.lastError or 'Failed ' + action
+                break
+
+        # What the kit runs now
+        if result['ok']:
+            try:
+                kit.infoReady = False
+                kit.getInfo()
+            except BaseException:
+                pass
+        for field in ['esp_macAddress', 'sam_firmVer', 'esp_firmVer', 'token', 'platform_name', 'platform_url']:
+            result[field] = getattr(kit, field, '')
+        try:
+            kit.end()
+        except:
+            pass
+    return result
+
+def fleet(actions, options):
+    ''' Runs the actions on every kit attached at the same time, building the firmware only once '''
+    kits = listKits()
+    if options['kits']: kits = [k for k in kits if k[0] in options['kits']]
+    if not kits:
+        print('No kits found')
+        return []
+    print('%u kits found' % len(kits))
+
+    builder = sck()
+    if not os.path.exists(os.path.join(builder.paths['binFolder'], 'fleet')): os.makedirs(os.path.join(builder.paths['binFolder'], 'fleet'))
+    with open(os.path.join(builder.paths['binFolder'], 'fleet', 'build.log'), 'w') as log:
+        if 'sam' in actions and ('build' in actions or not os.path.exists(os.path.join(builder.paths['binFolder'], builder.files['samUf2']))):
+            print('Building SAM firmware...')
+            if not builder.buildSAM(out=log): return []
+        if 'esp' in actions and ('build' in actions or not os.path.exists(os.path.join(builder.paths['binFolder'], builder.files['espBin']))):
+            print('Building ESP firmware...')
+            if not builder.buildESP(out=log): return []
+    if 'register' in actions and options['credentials'] is None: options['credentials'] = builder.credentials()
+
+    started = time.time()
+    jobs = [(serialNum, port, actions, options) for serialNum, port in kits]
+    pool = multiprocessing.Pool(min(options['jobs'] or len(jobs), len(jobs)), fleetInit, (multiprocessing.Lock(),))
+    results = []
+    for result in pool.imap_unordered(fleetWorker, jobs):
+        print('%s %s %s' % (result['serial'], 'OK' if result['ok'] else 'ERROR', result['error'] or ' '.join('%s %.0fs' % (step, value['seconds']) for step, value in result['steps'].items())))
+        results.append(result)
+    pool.close()
+    print('%u of %u kits done in %.0f seconds' % (len([r for r in results if r['ok']]), len(results), time.time() - started))
+
+    # One process writes the inventory
+    if 'inventory' in actions:
+        for result in results:
+            if not result['ok']: continue
+            kit = sck()
+            kit.infoReady = True
+            kit.sam_serialNum = result['serial']
+            kit.esp_macAddress = result['esp_macAddress']
+            kit.sam_firmVer = result['sam_firmVer']
+            kit.esp_firmVer = result['esp_firmVer']
+            kit.token = result['token']
+            kit.platform_name = result['platform_name']
+            kit.platform_url = result['platform_url']
+            kit.description = options['description']
+            kit.inventory_add()
+
+    return results
+
+if __name__ == '__main__':
+
+    if len(sys.argv) > 1 and sys.argv[1] == 'fleet':
+        if len(sys.argv) < 3 or '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv:
+            print('USAGE:\n\nsck.py fleet [options] action[s]')
+            print('\nRuns the actions on every kit attached, one process per kit')
+            print('actions: build (rebuild the firmware first), sam, esp, register, inventory')
+            print('\noptions:')
+            print('  -kits serial[,serial]: only these kits')
+            print('  -j N: kits at the same time (default: all)')
+            print('  -speed baud: ESP flashing speed, up to 3000000 (default: 921600)')
+            print('  -n name: platform name of the registered kits, followed by # and the end of the MAC address (default: test)')
+            print('  -d description: for the inventory')
+            print('  -o report.json: results of every kit (default: bin/fleet/report.json)')
+            sys.exit()
+
+        options = {'kits': None, 'jobs': 0, 'speed': 921600, 'name': 'test', 'description': '', 'credentials': None, 'out': None}
+        actions = []
+        args = sys.argv[2:]
+        while args:
+            arg = args.pop(0)
+            if arg == '-kits': options['kits'] = args.pop(0).split(',')
+            elif arg == '-j': options['jobs'] = int(args.pop(0))
+            elif arg == '-speed': options['speed'] = int(args.pop(0))
+            elif arg == '-n': options['name'] = args.pop(0)
+            elif arg == '-d': options['description'] = args.pop(0)
+            elif arg == '-o': options['out'] = args.pop(0)
+            else: actions.append(arg)
+        if not actions or [a for a in actions if a not in ['build', 'sam', 'esp', 'register', 'inventory']]:
+            print('Unknown action, see sck.py fleet -h')
+            sys.exit(1)
+
+        results = fleet(actions, options)
+        outName = options['out'] or os.path.join(sck.paths['binFolder'], 'fleet', 'report.json')
+        if results:
+            with open(outName, 'w') as outFile: json.dump(results, outFile, indent=1)
+            print('Report saved to ' + outName)
+        if not results or not all(r['ok'] for r in results): sys.exit(1)
+        sys.exit()
+
+    if len(sys.argv) > 1 and sys.argv[1] == 'flashtimes':
+        if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv:
+            print('USAGE:\n\nsck.py flashtimes [options]')
+            print('\nFlashes bin/ESP_firmware.bin on the kit attached at every speed, compressed and uncompressed, and prints the times')
+            print('\noptions:')
+            print('  -speeds baud[,baud]: (default: 115200,921600,2000000)')
+            print('  -sam file.uf2[,file.uf2]: flashes each SAM firmware before its round of times, to compare them (default: the one on the kit)')
+            print('  -o times.json: saves the times')
+            sys.exit()
+
+        speeds = [115200, 921600, 2000000]
+        samFiles = [None]
+        outName = None
+        args = sys.argv[2:]
+        while args:
+            arg = args.pop(0)
+            if arg == '-speeds': speeds = [int(speed) for speed in args.pop(0).split(',')]
+            elif arg == '-sam': samFiles = [os.path.abspath(name) for name in args.pop(0).split(',')]
+            elif arg == '-o': outName = args.pop(0)
+            else:
+                print('Unknown option, see sck.py flashtimes -h')
+                sys.exit(1)
+
+        kit = sck()
+        if kit.begin() is False: sys.exit(1)
+        imageSize = os.path.getsize(os.path.join(kit.paths['binFolder'], kit.files['espBin']))
+        rounds = []
+        with open(os.devnull, 'w') as devnull:
+            for samFile in samFiles:
+                if samFile and not kit.flashSAM(devnull, samFile): sys.exit(1)
+                kit.infoReady = False
+                kit.getInfo()
+                times = []
+                for speed in speeds:
+                    for compress in [True, False]:
+                        ok = kit.flashESP(speed, devnull, compress)
+                        times.append({'speed': speed, 'compress': compress, 'ok': ok, 'seconds': round(kit.espFlashSeconds, 1) if ok else None})
+                rounds.append({'sam': kit.sam_firmVer, 'uf2': os.path.basename(samFile) if samFile else None, 'times': times})
+        kit.end()
+
+        for thisRound in rounds:
+            print('\nSAM firmware %s%s, %u bytes ESP image\n' % (thisRound['sam'], ' (%s)' % thisRound['uf2'] if thisRound['uf2'] else '', imageSize))
+            print('%10s %12s %12s' % ('baud', 'compressed', 'uncompressed'))
+            for speed in speeds:
+                row = [t for t in thisRound['times'] if t['speed'] == speed]
+                print('%10u %12s %12s' % tuple([speed] + [('%.1fs' % t['seconds']) if t['ok'] else 'failed' for t in row]))
+        if outName:
+            with open(outName, 'w') as outFile: json.dump({'image': imageSize, 'rounds': rounds}, outFile, indent=1)
+        sys.exit(0 if all(t['ok'] for r in rounds for t in r['times']) else 1)
+
+    if len(sys.argv) < 3 or sys.argv[1] != 'export' or '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv:
+        print('USAGE:\n\nsck.py export [options] name')
+        print('\nPulls the readings stored on the kit to name.sckraw and decodes them to name.csv')
+        print('An interrupted export is resumed from where it stopped')
+        print('\noptions: -fresh: start from the beginning -deleted: also write the groups already deleted on the kit')
+        sys.exit()
+
+    kit = sck()
+    if kit.begin() is False: sys.exit(1)
+    if not kit.exportReadings(sys.argv[-1], '-fresh' in sys.argv, '-deleted' in sys.argv): sys.exit(1)
+    kit.end()
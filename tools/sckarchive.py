@@ -0,0 +1,236 @@
+#!/usr/bin/python
+
+import sys, os, struct, datetime, math, signal
+
+'''
+Converts the binary sdcard archive of the kit (YY-MM-DD.SCK files, see sam/src/SckArchive.h) to CSV or Parquet.
+Files are read block by block, so big archives can be converted without loading them in memory.
+'''
+
+BLOCK_SIZE = 512
+VERSION = 1
+NONE = 0xFFFFFFFF
+
+def usage():
+    print('USAGE:\n\nsckarchive.py [options] file.SCK [file.SCK ...]')
+    print('\noptions:')
+    print('  -o folder: output folder (default: same folder as the archive), use - to write CSV to stdout')
+    print('  -f csv/parquet: output format (default: csv, parquet needs pyarrow)')
+    print('  -hour H: start on this hour of the day (uses the file index)')
+    print('  -index: print the file index and exit')
+    sys.exit()
+
+class Segment:
+    ''' A header followed by data blocks, all records of a segment have the same columns '''
+
+    def __init__(self, data):
+        magic, version, self.columns, self.headerBlocks, _, self.created, self.recordSize, self.layout = struct.unpack_from('<4sBBBBIHH', data, 0)
+        if magic != b'SCKH' or version != VERSION: raise ValueError('Invalid segment header')
+
+        self.types = []
+        self.ids = []
+        self.titles = []
+        self.units = []
+        pos = 16
+        for i in range(self.columns):
+            self.types.append(data[pos])
+            self.ids.append(data[pos + 1])
+            pos += 2
+            end = data.index(b'\0', pos)
+            self.titles.append(data[pos:end].decode('utf-8', 'replace'))
+            pos = end + 1
+            end = data.index(b'\0', pos)
+            self.units.append(data[pos:end].decode('utf-8', 'replace'))
+            pos = end + 1
+
+        self.record = struct.Struct('<I%df' % self.columns)
+
+class Archive:
+
+    def __init__(self, fileName):
+        self.file = open(fileName, 'rb')
+        block = self.file.read(BLOCK_SIZE)
+        magic, version, _, self.layout, self.headerBlock = struct.unpack_from('<4sBBHI', block, 0)
+        if magic != b'SCKI' or version != VERSION: raise ValueError('%s is not a kit archive' % fileName)
+        self.hourHeader = struct.unpack_from('<24I', block, 12)
+        self.hourData = struct.unpack_from('<24I', block, 12 + 24 * 4)
+
+    def readSegment(self, wichBlock):
+        self.file.seek(wichBlock * BLOCK_SIZE)
+        first = self.file.read(BLOCK_SIZE)
+        headerBlocks = first[6]
+        return Segment(first + self.file.read((headerBlocks - 1) * BLOCK_SIZE))
+
+    def rows(self, startHour=0):
+        ''' Yields (segment, time, values) for every record, values are None when missing '''
+
+        start = 1
+        segment = None
+        if startHour > 0:
+            hours = [h for h in range(startHour, 24) if self.hourData[h] != NONE]
+            if not hours: return
+            segment = self.readSegment(self.hourHeader[hours[0]])
+            start = self.hourData[hours[0]]
+
+        self.file.seek(start * BLOCK_SIZE)
+        thisBlock = start
+        while True:
+            block = self.file.read(BLOCK_SIZE)
+            if len(block) < 8: break
+
+            if block[:4] == b'SCKH':
+                rest = self.file.read((block[6] - 1) * BLOCK_SIZE)
+                segment = Segment(block + rest)
+                thisBlock += block[6]
+                continue
+
+            thisBlock += 1
+            if block[:4] != b'SCKD' or segment is None: continue
+
+            records, recordSize = struct.unpack_from('<HH', block, 4)
+            if recordSize != segment.recordSize: continue
+
+            for r in range(records):
+                record = segment.record.unpack_from(block, 8 + r * recordSize)
+                if record[0] < startHour * 3600 + (record[0] // 86400) * 86400: continue
+                yield segment, record[0], [None if math.isnan(v) else v for v in record[1:]]
+
+    def close(self):
+        self.file.close()
+
+def isoTime(epoch):
+    return datetime.datetime.utcfromtimestamp(epoch).strftime('%Y-%m-%dT%H:%M:%SZ')
+
+def formatValue(value):
+    if value is None: return 'null'
+    # Floats keep 7 significant digits, enough to give back the values the kit stored
+    return '%.7g' % value
+
+class CsvWriter:
+    ''' Writes the same CSV files the kit writes, one file per segment '''
+
+    def __init__(self, outName):
+        self.outName = outName
+        self.out = None
+        self.count = 0
+
+    def segment(self, segment):
+        if self.outName == '-':
+            self.out = sys.stdout
+        else:
+            if self.out is not None: self.out.close()
+            name = self.outName + ('.csv' if self.count == 0 else '_%d.csv' % self.count)
+            self.out = open(name, 'w')
+            print('Writing %s' % name, file=sys.stderr)
+        self.count += 1
+
+        self.out.write('TIME,' + ','.join(segment.titles) + '\n')
+        self.out.write('ISO 8601,' + ','.join(segment.units) + '\n')
+        self.out.write('Time,' + ','.join(segment.titles) + '\n')
+        self.out.write(',' + ','.join([str(i) for i in segment.ids]) + '\n')
+
+    def row(self, time, values):
+        self.out.write(isoTime(time) + ',' + ','.join([formatValue(v) for v in values]) + '\n')
+
+    def close(self):
+        if self.out is not None and self.out is not sys.stdout: self.out.close()
+
+class ParquetWriter:
+    ''' Columnar output, one file per segment written in row groups '''
+
+    batchSize = 10000
+
+    def __init__(self, outName):
+        try:
+            import pyarrow, pyarrow.parquet
+        except ImportError:
+            print('Parquet output needs pyarrow (pip install pyarrow)')
+            sys.exit(1)
+        self.pa = pyarrow
+        self.pq = pyarrow.parquet
+        self.outName = outName
+        self.writer = None
+        self.count = 0
+
+    def segment(self, segment):
+        self.flush()
+        if self.writer is not None: self.writer.close()
+        fields = [self.pa.field('time', self.pa.timestamp('s', tz='UTC'))]
+        for title, unit, sensorId in zip(segment.titles, segment.units, segment.ids):
+            fields.append(self.pa.field(title, self.pa.float32(), metadata={'unit': unit, 'id': str(sensorId)}))
+        self.schema = self.pa.schema(fields)
+        name = self.outName + ('.parquet' if self.count == 0 else '_%d.parquet' % self.count)
+        print('Writing %s' % name, file=sys.stderr)
+        self.writer = self.pq.ParquetWriter(name, self.schema)
+        self.columns = [[] for f in fields]
+        self.count += 1
+
+    def row(self, time, values):
+        self.columns[0].append(time)
+        for i, v in enumerate(values): self.columns[i + 1].append(v)
+        if len(self.columns[0]) >= self.batchSize: self.flush()
+
+    def flush(self):
+        if self.writer is None or not self.columns[0]: return
+        arrays = [self.pa.array(c, type=f.type) for c, f in zip(self.columns, self.schema)]
+        self.writer.write_table(self.pa.Table.from_arrays(arrays, schema=self.schema))
+        self.columns = [[] for c in self.columns]
+
+    def close(self):
+        self.flush()
+        if self.writer is not None: self.writer.close()
+
+if __name__ == '__main__':
+
+    # Piped to head or less: end quietly when the reader goes away (there is no SIGPIPE on Windows)
+    if hasattr(signal, 'SIGPIPE'): signal.signal(signal.SIGPIPE, signal.SIG_DFL)
+
+    if len(sys.argv) < 2 or '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    args = sys.argv[1:]
+    outFolder = None
+    outFormat = 'csv'
+    startHour = 0
+    showIndex = False
+    files = []
+    while args:
+        arg = args.pop(0)
+        if arg == '-o': outFolder = args.pop(0)
+        elif arg == '-f': outFormat = args.pop(0)
+        elif arg == '-hour': startHour = int(args.pop(0))
+        elif arg == '-index': showIndex = True
+        else: files.append(arg)
+
+    if outFormat not in ['csv', 'parquet']: usage()
+    if outFolder == '-' and outFormat != 'csv': usage()
+
+    for fileName in files:
+        try:
+            archive = Archive(fileName)
+        except (IOError, ValueError) as e:
+            print('ERROR: %s' % e, file=sys.stderr)
+            continue
+
+        if showIndex:
+            print('%s (current segment on block %u)' % (fileName, archive.headerBlock))
+            for h in range(24):
+                if archive.hourData[h] != NONE: print('  %02d:00 header block %u, data block %u' % (h, archive.hourHeader[h], archive.hourData[h]))
+            archive.close()
+            continue
+
+        baseName = os.path.splitext(os.path.basename(fileName))[0]
+        if outFolder == '-': outName = '-'
+        else: outName = os.path.join(outFolder if outFolder else os.path.dirname(fileName), baseName)
+
+        writer = CsvWriter(outName) if outFormat == 'csv' else ParquetWriter(outName)
+        segment = None
+        rows = 0
+        for thisSegment, time, values in archive.rows(startHour):
+            if thisSegment is not segment:
+                segment = thisSegment
+                writer.segment(segment)
+            writer.row(time, values)
+            rows += 1
+        writer.close()
+        archive.close()
+        print('%s: %u readings' % (fileName, rows), file=sys.stderr)
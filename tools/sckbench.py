@@ -0,0 +1,142 @@
+#!/usr/bin/python
+
+import sys, os, json, subprocess, time
+
+'''
+Collects the results of the firmware microbenchmarks (sam/src/SckBench.h) and compares them between firmware versions.
+The bench build prints one JSON line per kernel: on a kit (pio run -e bench -t upload) the cost is in CPU cycles, on the
+workstation (pio run -e native_bench) in nanoseconds. Results of different units can't be compared.
+'''
+
+DEFAULT_NATIVE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'sam', '.pio', 'build', 'native_bench', 'program')
+
+def usage():
+    print('USAGE:\n\nsckbench.py [options]')
+    print('\noptions:')
+    print('  -port PORT: reads the results from a kit running the bench build (default: the first kit found)')
+    print('  -native [program]: runs the workstation bench build instead (default: sam/.pio/build/native_bench/program)')
+    print('  -i file.json: uses results saved before instead of running the bench')
+    print('  -o file.json: saves the results')
+    print('  -compare old.json: prints the change of every kernel against a previous run, exits with 1 if one got slower than the threshold')
+    print('  -threshold percent: slowdown that counts as a regression (default: 10)')
+    print('  -stat min/median: value compared (default: min, the least noisy)')
+    print('  -timeout seconds: waiting for a kit (default: 120)')
+    sys.exit()
+
+def parseLines(lines):
+    ''' Keeps the JSON lines of the bench among the rest of the console output '''
+
+    results = {'results': {}}
+    done = False
+    for line in lines:
+        line = line.strip()
+        if not line.startswith('{'): continue
+        try:
+            item = json.loads(line)
+        except ValueError:
+            continue
+        if 'firmware' in item: results.update(item)
+        elif 'bench' in item: results['results'][item.pop('bench')] = item
+        elif 'done' in item:
+            done = True
+            break
+    return results, done
+
+def fromNative(program):
+    if not os.path.isfile(program):
+        print('Native bench build not found: %s (cd sam && pio run -e native_bench)' % program, file=sys.stderr)
+        sys.exit(1)
+    output = subprocess.check_output([program, '-t', '1'], stdin=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return parseLines(output.decode('utf-8', 'replace').split('\n'))
+
+def serialLines(port, timeout):
+    import serial
+    connection = serial.Serial(port, 115200, timeout=1)
+    started = time.time()
+    while time.time() - started < timeout:
+        line = connection.readline()
+        if line: yield line.decode('utf-8', 'replace')
+    connection.close()
+
+def fromKit(port, timeout):
+    if port is None:
+        import serial.tools.list_ports
+        kits = [d.device for d in serial.tools.list_ports.comports() if d.description and 'Smartcitizen' in d.description]
+        if not kits:
+            print('No kit found', file=sys.stderr)
+            sys.exit(1)
+        port = kits[0]
+    print('Waiting for the results on %s (reset the kit if it already finished)...' % port, file=sys.stderr)
+    return parseLines(serialLines(port, timeout))
+
+def compare(old, new, threshold, stat):
+    if old.get('unit') != new.get('unit'):
+        print('Can\'t compare %s with %s' % (old.get('unit'), new.get('unit')), file=sys.stderr)
+        return False
+
+    print('%-20s %12s %12s %9s' % ('kernel', old.get('firmware', 'old'), new.get('firmware', 'new'), 'change'))
+    regressions = 0
+    for name in sorted(set(old['results']) | set(new['results'])):
+        if name not in old['results'] or name not in new['results']:
+            print('%-20s %12s %12s' % (name, old['results'].get(name, {}).get(stat, '-'), new['results'].get(name, {}).get(stat, '-')))
+            continue
+        before = old['results'][name][stat]
+        after = new['results'][name][stat]
+        change = (after - before) * 100.0 / before if before else 0
+        mark = ''
+        if change > threshold:
+            mark = ' SLOWER'
+            regressions += 1
+        elif change < -threshold: mark = ' faster'
+        print('%-20s %12.1f %12.1f %+8.1f%%%s' % (name, before, after, change, mark))
+
+    print('\n%u regressions over %g%% (%s %s)' % (regressions, threshold, stat, new.get('unit')))
+    return regressions == 0
+
+if __name__ == '__main__':
+
+    if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    port = None
+    native = None
+    inName = None
+    outName = None
+    oldName = None
+    threshold = 10.0
+    stat = 'min'
+    timeout = 120
+
+    args = sys.argv[1:]
+    try:
+        while args:
+            arg = args.pop(0)
+            if arg == '-port': port = args.pop(0)
+            elif arg == '-native': native = args.pop(0) if args and not args[0].startswith('-') else DEFAULT_NATIVE
+            elif arg == '-i': inName = args.pop(0)
+            elif arg == '-o': outName = args.pop(0)
+            elif arg == '-compare': oldName = args.pop(0)
+            elif arg == '-threshold': threshold = float(args.pop(0))
+            elif arg == '-stat': stat = args.pop(0)
+            elif arg == '-timeout': timeout = float(args.pop(0))
+            else: usage()
+    except (IndexError, ValueError):
+        usage()
+    if stat not in ['min', 'median']: usage()
+
+    if inName:
+        with open(inName) as inFile: results, done = json.load(inFile), True
+    elif native: results, done = fromNative(native)
+    else: results, done = fromKit(port, timeout)
+
+    if not done:
+        print('The bench didn\'t finish (%u kernels received)' % len(results['results']), file=sys.stderr)
+        sys.exit(1)
+
+    if outName:
+        with open(outName, 'w') as outFile: json.dump(results, outFile, indent=1, sort_keys=True)
+
+    if oldName:
+        with open(oldName) as oldFile: old = json.load(oldFile)
+        sys.exit(0 if compare(old, results, threshold, stat) else 1)
+    elif not outName:
+        print(json.dumps(results, indent=1, sort_keys=True))
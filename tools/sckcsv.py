@@ -0,0 +1,297 @@
+#!/usr/bin/python
+
+import sys, os, re, calendar, time, multiprocessing, signal
+
+'''
+Merges the daily CSV files of a kit in sdcard mode (YY-MM-DD.CSV, and YY-MM-DD.01, .02... renamed when the enabled sensors
+changed) into one dataset: one column per sensor seen on any file, rows in time order, optionally resampled to fixed
+intervals. Files are parsed in parallel and merged in date order keeping only a window of rows in memory, so the size
+of the archive doesn't matter.
+
+Every file starts with four header lines (short titles, units, titles and platform ids, see SckBase::sdPublish). Rows are
+written when the kit publishes to the sdcard, so a file can have rows of the day before and they don't need to be sorted.
+'''
+
+NAME = re.compile(r'^(\d\d)-(\d\d)-(\d\d)\.(CSV|\d\d)$', re.IGNORECASE)
+AGGREGATES = ['mean', 'min', 'max', 'count', 'last']
+
+def usage():
+    print('USAGE:\n\nsckcsv.py [options] folder|file [folder|file ...]')
+    print('\noptions:')
+    print('  -o file: output (default: - for CSV on stdout)')
+    print('  -f csv/parquet: output format (default: csv, parquet needs pyarrow)')
+    print('  -every N[s/m/h/d]: resample to this interval (default: keep the times of the kit)')
+    print('  -agg mean,min,max,count,last: values of every interval, one column per sensor and aggregate (default: mean)')
+    print('  -sensors TITLE[,TITLE]: only these sensors, by short title as on the first header line')
+    print('  -from YYYY-MM-DD / -to YYYY-MM-DD: only this days (to included)')
+    print('  -window H: hours a reading can arrive late, on a later file (default: 48)')
+    print('  -j N: files parsed at the same time (default: one per cpu)')
+    sys.exit()
+
+def interval(text):
+    units = {'s': 1, 'm': 60, 'h': 3600, 'd': 86400}
+    if text[-1] in units: return int(float(text[:-1]) * units[text[-1]])
+    return int(text)
+
+def parseTime(text):
+    ''' 2019-03-01T10:20:30Z, faster than strptime '''
+    return calendar.timegm((int(text[0:4]), int(text[5:7]), int(text[8:10]), int(text[11:13]), int(text[14:16]), int(text[17:19]), 0, 0, 0))
+
+def isoTime(epoch):
+    return time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime(epoch))
+
+def fileKey(path):
+    ''' Day of the file and its order inside the day: the renamed fragments are older than the .CSV '''
+    match = NAME.match(os.path.basename(path))
+    year, month, day, ext = match.groups()
+    return (int(year), int(month), int(day), 100 if ext.upper() == 'CSV' else int(ext))
+
+def fileDay(path):
+    key = fileKey(path)
+    return calendar.timegm((2000 + key[0], key[1], key[2], 0, 0, 0, 0, 0, 0))
+
+def findFiles(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in os.listdir(path):
+                if NAME.match(name): files.append(os.path.join(path, name))
+        elif NAME.match(os.path.basename(path)): files.append(path)
+        else: print('Skipping %s (not a kit CSV file)' % path, file=sys.stderr)
+    return sorted(files, key=fileKey)
+
+def readHeader(lines):
+    ''' The four header lines, as columns of (short title, unit, title, id) '''
+    rows = [line.rstrip('\r\n').split(',') for line in lines]
+    if len(rows) < 4 or rows[0][0] != 'TIME': return None
+    columns = []
+    for i in range(1, len(rows[0])):
+        columns.append(tuple(rows[r][i] if i < len(rows[r]) else '' for r in range(4)))
+    return columns
+
+def headers(path):
+    ''' Every header of a file (a new one starts on a line with TIME) '''
+    found = []
+    with open(path, errors='replace') as inFile:
+        for line in inFile:
+            if line.startswith('TIME,'):
+                header = readHeader([line] + [next(inFile, '') for i in range(3)])
+                if header: found.append(header)
+    return found
+
+def parseFile(job):
+    ''' Partial aggregates of one file: {interval start: {column: [sum, count, min, max, last time, last value]}}, sorted '''
+    path, step, columns, first, last = job
+    buckets = {}
+    bad = 0
+    current = None
+    with open(path, errors='replace') as inFile:
+        for line in inFile:
+            if line.startswith('TIME,'):
+                header = readHeader([line] + [next(inFile, '') for i in range(3)])
+                current = [columns.get(column[0]) for column in header] if header else None
+                continue
+            if current is None: continue
+
+            fields = line.rstrip('\r\n').split(',')
+            try:
+                epoch = parseTime(fields[0])
+            except (ValueError, IndexError):
+                bad += 1
+                continue
+            if len(fields) != len(current) + 1:
+                bad += 1 	# Cut by a power loss
+                continue
+            if (first is not None and epoch < first) or (last is not None and epoch >= last): continue
+
+            start = epoch - epoch % step if step else epoch
+            bucket = buckets.get(start)
+            if bucket is None: bucket = buckets[start] = {}
+            for column, text in zip(current, fields[1:]):
+                if column is None or text == 'null' or text == '': continue
+                try:
+                    value = float(text)
+                except ValueError:
+                    continue
+                partial = bucket.get(column)
+                if partial is None: bucket[column] = [value, 1, value, value, epoch, value]
+                else:
+                    partial[0] += value
+                    partial[1] += 1
+                    if value < partial[2]: partial[2] = value
+                    if value > partial[3]: partial[3] = value
+                    if epoch >= partial[4]: partial[4], partial[5] = epoch, value
+    return path, sorted(buckets.items()), bad
+
+def mergeInto(bucket, other):
+    for column, partial in other.items():
+        mine = bucket.get(column)
+        if mine is None: bucket[column] = partial
+        else:
+            mine[0] += partial[0]
+            mine[1] += partial[1]
+            mine[2] = min(mine[2], partial[2])
+            mine[3] = max(mine[3], partial[3])
+            if partial[4] >= mine[4]: mine[4], mine[5] = partial[4], partial[5]
+
+def values(bucket, columnCount, aggregates):
+    row = []
+    for column in range(columnCount):
+        partial = bucket.get(column)
+        for agg in aggregates:
+            if partial is None: row.append(0 if agg == 'count' else None)
+            elif agg == 'mean': row.append(partial[0] / partial[1])
+            elif agg == 'min': row.append(partial[2])
+            elif agg == 'max': row.append(partial[3])
+            elif agg == 'count': row.append(partial[1])
+            else: row.append(partial[5])
+    return row
+
+def formatValue(value):
+    if value is None: return 'null'
+    return '%.7g' % value
+
+class CsvWriter:
+    ''' One CSV file with the header lines of the kit, the titles carry the aggregate when there is more than one '''
+
+    def __init__(self, outName, titles):
+        self.out = sys.stdout if outName == '-' else open(outName, 'w')
+        self.out.write('TIME,' + ','.join(t[0] for t in titles) + '\n')
+        self.out.write('ISO 8601,' + ','.join(t[1] for t in titles) + '\n')
+        self.out.write('Time,' + ','.join(t[2] for t in titles) + '\n')
+        self.out.write(',' + ','.join(t[3] for t in titles) + '\n')
+
+    def row(self, epoch, values):
+        self.out.write(isoTime(epoch) + ',' + ','.join([formatValue(v) for v in values]) + '\n')
+
+    def close(self):
+        if self.out is not sys.stdout: self.out.close()
+
+class ParquetWriter:
+    ''' Columnar output written in row groups '''
+
+    batchSize = 10000
+
+    def __init__(self, outName, titles):
+        try:
+            import pyarrow, pyarrow.parquet
+        except ImportError:
+            print('Parquet output needs pyarrow (pip install pyarrow)')
+            sys.exit(1)
+        self.pa = pyarrow
+        fields = [pyarrow.field('time', pyarrow.timestamp('s', tz='UTC'))]
+        for shortTitle, unit, title, sensorId in titles:
+            fields.append(pyarrow.field(shortTitle, pyarrow.float64(), metadata={'unit': unit, 'title': title, 'id': sensorId}))
+        self.schema = pyarrow.schema(fields)
+        self.writer = pyarrow.parquet.ParquetWriter(outName, self.schema)
+        self.columns = [[] for f in fields]
+
+    def row(self, epoch, values):
+        self.columns[0].append(epoch)
+        for i, v in enumerate(values): self.columns[i + 1].append(v)
+        if len(self.columns[0]) >= self.batchSize: self.flush()
+
+    def flush(self):
+        if not self.columns[0]: return
+        arrays = [self.pa.array(c, type=f.type) for c, f in zip(self.columns, self.schema)]
+        self.writer.write_table(self.pa.Table.from_arrays(arrays, schema=self.schema))
+        self.columns = [[] for c in self.columns]
+
+    def close(self):
+        self.flush()
+        self.writer.close()
+
+if __name__ == '__main__':
+
+    # Piped to head or less: end quietly when the reader goes away (there is no SIGPIPE on Windows)
+    if hasattr(signal, 'SIGPIPE'): signal.signal(signal.SIGPIPE, signal.SIG_DFL)
+
+    if len(sys.argv) < 2 or '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    outName = '-'
+    outFormat = 'csv'
+    step = 0
+    aggregates = ['mean']
+    only = None
+    first = None
+    last = None
+    window = 48 * 3600
+    jobs = multiprocessing.cpu_count()
+    paths = []
+
+    args = sys.argv[1:]
+    try:
+        while args:
+            arg = args.pop(0)
+            if arg == '-o': outName = args.pop(0)
+            elif arg == '-f': outFormat = args.pop(0)
+            elif arg == '-every': step = interval(args.pop(0))
+            elif arg == '-agg': aggregates = args.pop(0).split(',')
+            elif arg == '-sensors': only = args.pop(0).split(',')
+            elif arg == '-from': first = calendar.timegm(time.strptime(args.pop(0), '%Y-%m-%d'))
+            elif arg == '-to': last = calendar.timegm(time.strptime(args.pop(0), '%Y-%m-%d')) + 86400
+            elif arg == '-window': window = int(float(args.pop(0)) * 3600)
+            elif arg == '-j': jobs = max(1, int(args.pop(0)))
+            else: paths.append(arg)
+    except (IndexError, ValueError):
+        usage()
+    if outFormat not in ['csv', 'parquet'] or (outFormat == 'parquet' and outName == '-') or [a for a in aggregates if a not in AGGREGATES]: usage()
+
+    files = findFiles(paths)
+    if not files:
+        print('No kit CSV files found', file=sys.stderr)
+        sys.exit(1)
+    # Files of days out of the range can still have rows of the days inside it
+    if first is not None: files = [f for f in files if fileDay(f) + 86400 + window > first]
+    if last is not None: files = [f for f in files if fileDay(f) < last + window]
+
+    started = time.time()
+    pool = multiprocessing.Pool(jobs)
+
+    # Columns: every sensor on any header, in the order they first show up
+    columns = {}
+    titles = []
+    for fileHeaders in pool.imap(headers, files, chunksize=16):
+        for header in fileHeaders:
+            for column in header:
+                if column[0] in columns or (only is not None and column[0] not in only): continue
+                columns[column[0]] = len(titles)
+                titles.append(column)
+    outTitles = []
+    for title in titles:
+        for agg in aggregates:
+            if len(aggregates) == 1: outTitles.append(title)
+            else: outTitles.append((title[0] + '_' + agg, '' if agg == 'count' else title[1], title[2] + ' ' + agg, title[3]))
+
+    writer = CsvWriter(outName, outTitles) if outFormat == 'csv' else ParquetWriter(outName, outTitles)
+
+    # Files come back in date order, intervals are written when no later file can have readings for them
+    pending = {}
+    written = -1
+    rows = 0
+    late = 0
+    bad = 0
+    jobList = [(f, step, columns, first, last) for f in files]
+    for path, buckets, badRows in pool.imap(parseFile, jobList, chunksize=1):
+        bad += badRows
+        for start, bucket in buckets:
+            if start <= written:
+                late += 1
+                continue
+            if start in pending: mergeInto(pending[start], bucket)
+            else: pending[start] = bucket
+
+        ready = sorted(start for start in pending if start < fileDay(path) - window)
+        for start in ready:
+            writer.row(start, values(pending.pop(start), len(titles), aggregates))
+            written = start
+            rows += 1
+    for start in sorted(pending):
+        writer.row(start, values(pending[start], len(titles), aggregates))
+        rows += 1
+    writer.close()
+    pool.close()
+
+    print('%u files, %u sensors, %u rows in %.1f seconds' % (len(files), len(titles), rows, time.time() - started), file=sys.stderr)
+    if bad: print('%u rows skipped (incomplete or without time)' % bad, file=sys.stderr)
+    if late: print('%u intervals arrived more than %g hours late and were skipped, try a bigger -window' % (late, window / 3600.0), file=sys.stderr)
@@ -0,0 +1,340 @@
+#!/usr/bin/python
+
+import sys, asyncio, json, random, struct, time, math
+
+'''
+Emulates a fleet of kits publishing to an MQTT broker, to measure the ingestion path without touching the real platform
+(run it against mock-api/mqtt.js). Every kit behaves like the firmware in network mode: it takes a reading group every
+readint, and every pubint it turns the ESP on, connects with its token, sends the hello (first session) and the info
+(after boot and once a day) and then publishes its pending groups one by one, newest first, before turning the ESP off.
+Topics and payloads are the same the ESP sends (esp/src/SckESP.cpp).
+
+Outages make kits keep their groups on flash and drain them in a burst when they come back: -outage for random ones per
+kit, -blackout for the whole fleet losing the platform at once. Kit time runs -speed times faster than the real one.
+'''
+
+DEFAULT_EPOCH = 1767225600      # 2026-01-01 00:00 UTC
+
+# Default urban board sensors: platform id, base value, daily swing, decimals (lib/Sensors/Sensors.h)
+SENSORS = [
+    (10, 80, 15, 0),            # Battery
+    (14, 300, 290, 0),          # Light
+    (55, 21, 6, 2),             # Temperature
+    (56, 55, 15, 2),            # Humidity
+    (53, 55, 12, 2),            # Noise dBA
+    (58, 101.3, 0.5, 2),        # Barometric pressure
+    (89, 8, 5, 0),              # PM 1.0
+    (87, 12, 8, 0),             # PM 2.5
+    (88, 15, 10, 0),            # PM 10.0
+]
+
+def usage():
+    print('USAGE:\n\nsckfleet.py [options]')
+    print('\noptions:')
+    print('  -kits N: kits on the fleet (default: 1000)')
+    print('  -host HOST: broker (default: localhost)')
+    print('  -port PORT: (default: 1883)')
+    print('  -hours H: kit time to emulate (default: 24)')
+    print('  -speed X: kit seconds per real second (default: 60)')
+    print('  -readint S: seconds between readings (default: 60)')
+    print('  -pubint S: seconds between publishes (default: 3600)')
+    print('  -outage P,H: chance of every publish to find no network, and how many hours it lasts at most (default: 0,6)')
+    print('  -blackout START,H: the whole fleet loses the platform START hours after the start, for H hours')
+    print('  -drain ms: real time between groups of a drain, the SAM-ESP round trip of every publish (default: 100)')
+    print('  -batch N: groups on every readings message, to try batching (the firmware sends 1)')
+    print('  -qos 0/1: the firmware publishes with 0, 1 measures the broker ack latency (default: 0)')
+    print('  -epoch seconds: kit time when the fleet starts (default: %u)' % DEFAULT_EPOCH)
+    print('  -seed N: random seed (default: 1)')
+    print('  -o report.json: saves the results')
+    sys.exit()
+
+def epoch2iso(epoch):
+    return time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime(epoch))
+
+def netMessage(epoch, readings):
+    ''' The readings of a group as the SAM sends them to the ESP (SckBase::netFormat, without the message type) '''
+
+    return '{t:' + epoch2iso(epoch) + ''.join(',%u:%s' % reading for reading in readings) + '}'
+
+def readingsToJson(message):
+    ''' Same as readingsToJson() on lib/Shared: {t:2017-03-24T13:35:14Z,29:48.45,...} -> {"data":[{"recorded_at":...}]} '''
+
+    payload = '{"data":[{"recorded_at":"' + message[3:23] + '","sensors":[{"id":'
+    for char in message[24:]:
+        if char == ':': payload += ',"value":'
+        elif char == ',': payload += '},{"id":'
+        else: payload += char
+    return payload + ']}]}'
+
+def batchToJson(messages):
+    ''' Several groups on one message, a format proposal: the data list of every group together '''
+
+    groups = [readingsToJson(message)[9:-2] for message in messages]
+    return '{"data":[' + ','.join(groups) + ']}'
+
+def info(kit, epoch):
+    ''' What the SAM builds on publishInfo() '''
+
+    return json.dumps({
+        'time': epoch2iso(epoch), 'hw_ver': '2.1', 'id': kit.uniqueID, 'sam_ver': '0.9.7-fleet', 'sam_bd': '2026-01-01T00:00:00Z',
+        'mac': kit.mac, 'esp_ver': '0.9.7-fleet', 'esp_bd': '2026-01-01T00:00:00Z',
+        'energy': {'day': epoch2iso(epoch - 86400)[:10], 'awake': 10.5, 'sleep': 18.1, 'esp': 22.4, 'pm': 30.2, 'heater': 0, 'sdcard': 0.2, 'scale': 1.0},
+        'perf': {'loop': 12, 'worst': 'espbus', 'max': 150, 'stalls': 0},
+        'mem': {'free': 9120, 'min': 7844, 'largest': 8512, 'stack': 2112},
+    }, separators=(',', ':'))
+
+class Stats:
+    def __init__(self):
+        self.sessions = 0
+        self.connectErrors = 0
+        self.outages = 0
+        self.messages = 0
+        self.groups = 0
+        self.bytes = 0
+        self.connectLatency = []
+        self.ackLatency = []
+        self.maxBacklog = 0
+
+    def latency(self, values):
+        if not values: return None
+        values = sorted(values)
+        return { 'average': sum(values) / len(values), 'p50': values[len(values) // 2], 'p99': values[int(len(values) * 0.99)], 'max': values[-1] }
+
+class Mqtt:
+    ''' The part of MQTT 3.1.1 PubSubClient uses '''
+
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+        self.packetID = 0
+
+    @staticmethod
+    def packet(kind, body):
+        header = bytearray([kind])
+        length = len(body)
+        while True:
+            digit = length % 128
+            length //= 128
+            header.append(digit | 0x80 if length else digit)
+            if not length: break
+        return bytes(header) + body
+
+    @staticmethod
+    def string(text):
+        data = text.encode()
+        return struct.pack('>H', len(data)) + data
+
+    async def read(self):
+        kind = (await self.reader.readexactly(1))[0]
+        length = 0
+        multiplier = 1
+        while True:
+            digit = (await self.reader.readexactly(1))[0]
+            length += (digit & 0x7F) * multiplier
+            multiplier *= 128
+            if not digit & 0x80: break
+        return kind >> 4, await self.reader.readexactly(length)
+
+    async def connect(self, clientID):
+        body = self.string('MQTT') + bytes([4, 0x02]) + struct.pack('>H', 15) + self.string(clientID)
+        self.writer.write(self.packet(0x10, body))
+        kind, body = await self.read()
+        return kind == 2 and body[1] == 0
+
+    async def publish(self, topic, payload, qos):
+        body = self.string(topic)
+        if qos:
+            self.packetID = self.packetID % 65535 + 1
+            body += struct.pack('>H', self.packetID)
+        self.writer.write(self.packet(0x30 | (qos << 1), body + payload.encode()))
+        if qos:
+            kind, body = await self.read()
+            return kind == 4
+        await self.writer.drain()
+        return True
+
+    async def disconnect(self):
+        self.writer.write(self.packet(0xE0, b''))
+        await self.writer.drain()
+        self.writer.close()
+
+class Kit:
+    def __init__(self, index, options, start):
+        self.options = options
+        self.random = random.Random(options['seed'] * 100003 + index)
+        self.token = '%06x' % (0xA00000 + index)
+        self.uniqueID = '%032X' % (0x5CC20000000000000000000000000000 + index)
+        self.mac = ':'.join('%02X' % ((0x5CCF7F000000 + index) >> shift & 0xFF) for shift in range(40, -8, -8))
+        self.phase = self.random.random() * 2 * math.pi
+
+        # Kits were turned on at different times, one reading already taken
+        self.readTime = start - self.random.randrange(options['pubint'])
+        self.pending = []
+        self.takeReadings(start)
+        self.publishTime = start + self.random.randrange(options['pubint'])
+        self.helloPending = True
+        self.infoTime = None
+        self.outageEnd = 0
+
+    def takeReadings(self, now):
+        while self.readTime <= now:
+            day = 2 * math.pi * (self.readTime % 86400) / 86400
+            readings = []
+            for id, base, swing, decimals in SENSORS:
+                value = base + swing * math.sin(day + self.phase) + self.random.uniform(-swing, swing) / 10
+                readings.append((id, ('%.' + str(decimals) + 'f') % max(value, 0)))
+            self.pending.insert(0, netMessage(self.readTime, readings))  # Newest first, like the flash list
+            self.readTime += self.options['readint']
+
+    def offline(self, now):
+        blackout = self.options['blackout']
+        if blackout and blackout[0] <= now < blackout[1]: return True
+        if now < self.outageEnd: return True
+        if self.random.random() < self.options['outage'][0]:
+            self.outageEnd = now + self.random.uniform(0, self.options['outage'][1] * 3600)
+            return True
+        return False
+
+    async def session(self, now, stats):
+        ''' One publish: ESP on, hello/info/readings, ESP off '''
+
+        if self.offline(now):
+            stats.outages += 1
+            return
+
+        stats.sessions += 1
+        stats.maxBacklog = max(stats.maxBacklog, len(self.pending))
+        started = time.time()
+        try:
+            reader, writer = await asyncio.open_connection(self.options['host'], self.options['port'])
+            mqtt = Mqtt(reader, writer)
+            if not await mqtt.connect(self.token): raise ConnectionError()
+        except (OSError, ConnectionError, asyncio.IncompleteReadError):
+            stats.connectErrors += 1
+            return
+        stats.connectLatency.append((time.time() - started) * 1000)
+
+        qos = self.options['qos']
+        drain = self.options['drain'] / 1000.0
+        try:
+            if self.helloPending:
+                await self.send(mqtt, 'device/sck/%s/hello' % self.token, '%s:Hello' % self.token, stats)
+                self.helloPending = False
+            if self.infoTime is None or now - self.infoTime >= 86400:
+                await self.send(mqtt, 'device/sck/%s/info' % self.token, info(self, now), stats)
+                self.infoTime = now
+
+            topic = 'device/sck/%s/readings' % self.token
+            batch = self.options['batch']
+            while self.pending:
+                messages = self.pending[:batch]
+                payload = readingsToJson(messages[0]) if batch == 1 else batchToJson(messages)
+                if not await self.send(mqtt, topic, payload, stats): break
+                del self.pending[:len(messages)]
+                stats.groups += len(messages)
+                if drain: await asyncio.sleep(drain)
+            await mqtt.disconnect()
+        except (OSError, asyncio.IncompleteReadError):
+            stats.connectErrors += 1
+
+    async def send(self, mqtt, topic, payload, stats):
+        started = time.time()
+        if not await mqtt.publish(topic, payload, self.options['qos']): return False
+        if self.options['qos']: stats.ackLatency.append((time.time() - started) * 1000)
+        stats.messages += 1
+        stats.bytes += len(payload)
+        return True
+
+    async def run(self, clock, end, stats):
+        while self.publishTime < end:
+            await clock.sleepUntil(self.publishTime)
+            self.takeReadings(self.publishTime)
+            await self.session(self.publishTime, stats)
+            self.publishTime += self.options['pubint']
+
+class Clock:
+    ''' Kit time, running speed times faster than the real one '''
+
+    def __init__(self, start, speed):
+        self.start = start
+        self.speed = speed
+        self.realStart = time.time()
+
+    def now(self):
+        return self.start + (time.time() - self.realStart) * self.speed
+
+    async def sleepUntil(self, epoch):
+        wait = (epoch - self.now()) / self.speed
+        if wait > 0: await asyncio.sleep(wait)
+
+async def progress(clock, end, stats):
+    last = 0
+    while True:
+        await asyncio.sleep(5)
+        print('%s: %u sessions, %u messages (%.0f/s), %u groups, %u connect errors, %u outages' % (epoch2iso(min(clock.now(), end)),
+            stats.sessions, stats.messages, (stats.messages - last) / 5.0, stats.groups, stats.connectErrors, stats.outages), file=sys.stderr)
+        last = stats.messages
+
+async def fleet(options):
+    start = options['epoch']
+    end = start + options['hours'] * 3600
+    stats = Stats()
+    kits = [Kit(i, options, start) for i in range(options['kits'])]
+    clock = Clock(start, options['speed'])
+    monitor = asyncio.ensure_future(progress(clock, end, stats))
+    realStart = time.time()
+    await asyncio.gather(*[kit.run(clock, end, stats) for kit in kits])
+    monitor.cancel()
+    seconds = time.time() - realStart
+
+    return {
+        'kits': options['kits'], 'hours': options['hours'], 'readint': options['readint'], 'pubint': options['pubint'],
+        'batch': options['batch'], 'qos': options['qos'], 'realSeconds': seconds,
+        'sessions': stats.sessions, 'outages': stats.outages, 'connectErrors': stats.connectErrors,
+        'messages': stats.messages, 'groups': stats.groups, 'bytes': stats.bytes,
+        'messagesPerSecond': stats.messages / seconds, 'groupsPerSecond': stats.groups / seconds,
+        'pendingGroups': sum(len(kit.pending) for kit in kits), 'maxBacklog': stats.maxBacklog,
+        'connectLatency': stats.latency(stats.connectLatency), 'ackLatency': stats.latency(stats.ackLatency),
+    }
+
+if __name__ == '__main__':
+
+    if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    options = { 'kits': 1000, 'host': 'localhost', 'port': 1883, 'hours': 24, 'speed': 60, 'readint': 60, 'pubint': 3600,
+        'outage': (0, 6), 'blackout': None, 'drain': 100, 'batch': 1, 'qos': 0, 'epoch': DEFAULT_EPOCH, 'seed': 1, 'out': None }
+
+    args = sys.argv[1:]
+    try:
+        while args:
+            arg = args.pop(0)
+            if arg == '-kits': options['kits'] = int(args.pop(0))
+            elif arg == '-host': options['host'] = args.pop(0)
+            elif arg == '-port': options['port'] = int(args.pop(0))
+            elif arg == '-hours': options['hours'] = float(args.pop(0))
+            elif arg == '-speed': options['speed'] = float(args.pop(0))
+            elif arg == '-readint': options['readint'] = int(args.pop(0))
+            elif arg == '-pubint': options['pubint'] = int(args.pop(0))
+            elif arg == '-outage': options['outage'] = tuple(float(value) for value in args.pop(0).split(','))
+            elif arg == '-blackout': options['blackout'] = tuple(float(value) for value in args.pop(0).split(','))
+            elif arg == '-drain': options['drain'] = float(args.pop(0))
+            elif arg == '-batch': options['batch'] = max(1, int(args.pop(0)))
+            elif arg == '-qos': options['qos'] = int(args.pop(0))
+            elif arg == '-epoch': options['epoch'] = int(args.pop(0))
+            elif arg == '-seed': options['seed'] = int(args.pop(0))
+            elif arg == '-o': options['out'] = args.pop(0)
+            else: usage()
+    except (IndexError, ValueError):
+        usage()
+    if len(options['outage']) != 2 or options['qos'] not in [0, 1] or options['readint'] <= 0 or options['pubint'] <= 0: usage()
+    if options['blackout']:
+        if len(options['blackout']) != 2: usage()
+        begin, hours = options['blackout']
+        options['blackout'] = (options['epoch'] + begin * 3600, options['epoch'] + (begin + hours) * 3600)
+
+    print('%u kits for %g hours at %gx...' % (options['kits'], options['hours'], options['speed']), file=sys.stderr)
+    report = asyncio.get_event_loop().run_until_complete(fleet(options))
+
+    print(json.dumps(report, indent=1))
+    if options['out']:
+        with open(options['out'], 'w') as outFile: json.dump(report, outFile, indent=1)
@@ -0,0 +1,202 @@
+#!/usr/bin/python
+
+import sys, os, struct, json, datetime
+
+'''
+Decodes the readings log of the kit (sam/src/SckList.h) as sent by the export command (see sck.py export).
+The export is saved as the raw log bytes (file.sckraw) plus a json file with the log limits and the sensor names,
+this module turns them into a CSV file with one row per saved group.
+'''
+
+HEADER_SIZE = 6
+TRAILER_SIZE = 8
+GROUP_SIZE = 512
+COMPRESSED = 0xFE
+KEYFRAME = 1
+SAME_LAYOUT = 2
+VALUE_TEXT = 0
+VALUE_ABSOLUTE = 1
+VALUE_DELTA = 2
+VALUE_SAME = 3
+
+def usage():
+    print('USAGE:\n\nscklog.py [options] file.sckraw')
+    print('\noptions:')
+    print('  -o file.csv: output file (default: same name as the export)')
+    print('  -deleted: also write the groups that were already deleted on the kit')
+    sys.exit()
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        thisByte = data[pos]
+        pos += 1
+        value |= (thisByte & 0x7F) << shift
+        shift += 7
+        if not thisByte & 0x80 or shift >= 35: return value, pos
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+def formatFixed(mantissa, decimals):
+    ''' Same text the kit gives for fixed point values '''
+    text = str(abs(mantissa)).rjust(decimals + 1, '0')
+    if decimals > 0: text = text[:-decimals] + '.' + text[-decimals:]
+    return ('-' if mantissa < 0 else '') + text
+
+class Reading:
+
+    def __init__(self, sensor, decimals=0, mantissa=None, text=None):
+        self.sensor = sensor
+        self.decimals = decimals
+        self.mantissa = mantissa
+        self.text = text
+
+    def value(self):
+        if self.text is not None: return self.text
+        return formatFixed(self.mantissa, self.decimals)
+
+class Group:
+
+    def __init__(self, address, time, readings, published, sdcard, deleted):
+        self.address = address
+        self.time = time
+        self.readings = readings
+        self.published = published
+        self.sdcard = sdcard
+        self.deleted = deleted
+
+def groups(log, base, sector=1):
+    ''' Yields every commited group of the log (log holds the bytes starting on logical address base) '''
+
+    keyframes = {}
+    end = base + len(log)
+    address = base
+    while address + HEADER_SIZE + 3 + TRAILER_SIZE <= end:
+        pos = address - base
+        recordAddress, size = struct.unpack_from('>IH', log, pos)
+
+        # Records from previous laps, torn records and gaps left by failed writes: skip to the next sector
+        valid = recordAddress == address and HEADER_SIZE + 3 + TRAILER_SIZE <= size <= HEADER_SIZE + GROUP_SIZE + TRAILER_SIZE and address + size <= end
+        if valid:
+            trailer = log[pos + size - TRAILER_SIZE:pos + size]
+            valid = trailer[3] == 0x00 and struct.unpack_from('>H', trailer, 6)[0] == size
+        if not valid:
+            address = (address // sector + 1) * sector
+            continue
+
+        payload = log[pos + HEADER_SIZE:pos + size - TRAILER_SIZE]
+        right = address + size
+        group = decodePayload(payload, address, keyframes)
+        if group is not None:
+            time, readings, keyframe = group
+            if keyframe: keyframes[right] = (time, readings)
+            yield Group(address, time, readings, trailer[0] == 0, trailer[1] == 0, trailer[2] == 0)
+        address = right
+
+def decodePayload(payload, address, keyframes):
+    ''' Returns (time, readings, keyframe) or None if the group can't be decoded '''
+
+    if payload[0] != COMPRESSED:
+        time = struct.unpack_from('>I', payload, 2)[0]
+        readings = []
+        pos = 6
+        while pos + 2 <= len(payload):
+            sensor, size = payload[pos], payload[pos + 1]
+            readings.append(Reading(sensor, text=payload[pos + 2:pos + 2 + size].decode('utf-8', 'replace')))
+            pos += size + 2
+        return time, readings, False
+
+    flags = payload[1]
+    pos = 2
+    key = None
+    if flags & KEYFRAME:
+        time = struct.unpack_from('>I', payload, pos)[0]
+        pos += 4
+    else:
+        distance, pos = varint(payload, pos)
+        delta, pos = varint(payload, pos)
+        key = keyframes.get(address - distance)
+        if key is None: return None
+        time = key[0] + unzigzag(delta)
+
+    readings = []
+    while pos < len(payload):
+        keyReading = None
+        if flags & SAME_LAYOUT:
+            if key is None or len(readings) >= len(key[1]): return None
+            keyReading = key[1][len(readings)]
+            sensor = keyReading.sensor
+        else:
+            sensor = payload[pos]
+            pos += 1
+        kind = payload[pos]
+        pos += 1
+        decimals = kind & 0x3F
+
+        if kind >> 6 == VALUE_TEXT:
+            readings.append(Reading(sensor, text=payload[pos:pos + decimals].decode('utf-8', 'replace')))
+            pos += decimals
+        elif kind >> 6 == VALUE_ABSOLUTE:
+            value, pos = varint(payload, pos)
+            readings.append(Reading(sensor, decimals, unzigzag(value)))
+        else:
+            if keyReading is None or keyReading.mantissa is None: return None
+            mantissa = keyReading.mantissa
+            if kind >> 6 == VALUE_DELTA:
+                value, pos = varint(payload, pos)
+                mantissa += unzigzag(value)
+            readings.append(Reading(sensor, decimals, mantissa))
+
+    return time, readings, bool(flags & KEYFRAME)
+
+def isoTime(epoch):
+    return datetime.datetime.utcfromtimestamp(epoch).strftime('%Y-%m-%dT%H:%M:%SZ')
+
+def writeCsv(rawName, outName=None, withDeleted=False):
+    ''' Writes the CSV of an export (same header rows as the sdcard files of the kit), returns the number of groups '''
+
+    with open(os.path.splitext(rawName)[0] + '.json') as f: info = json.load(f)
+    with open(rawName, 'rb') as f: log = f.read()
+    sensors = dict((int(k), v) for k, v in info['sensors'].items())
+
+    rows = [g for g in groups(log, info['base'], info['sector']) if withDeleted or not g.deleted]
+
+    # One column per sensor, in the order they first appear
+    columns = []
+    for g in rows:
+        for r in g.readings:
+            if r.sensor not in columns: columns.append(r.sensor)
+    titles = [sensors.get(c, {}).get('title', str(c)) for c in columns]
+    units = [sensors.get(c, {}).get('unit', '') for c in columns]
+    ids = [str(sensors.get(c, {}).get('id', '')) for c in columns]
+
+    if outName is None: outName = os.path.splitext(rawName)[0] + '.csv'
+    with open(outName, 'w') as out:
+        out.write('TIME,' + ','.join(titles) + '\n')
+        out.write('ISO 8601,' + ','.join(units) + '\n')
+        out.write('Time,' + ','.join(titles) + '\n')
+        out.write(',' + ','.join(ids) + '\n')
+        for g in rows:
+            values = dict((r.sensor, r.value()) for r in g.readings)
+            out.write(isoTime(g.time) + ',' + ','.join([values.get(c, '') for c in columns]) + '\n')
+
+    return len(rows)
+
+if __name__ == '__main__':
+
+    if len(sys.argv) < 2 or '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    args = sys.argv[1:]
+    outName = None
+    withDeleted = False
+    files = []
+    while args:
+        arg = args.pop(0)
+        if arg == '-o': outName = args.pop(0)
+        elif arg == '-deleted': withDeleted = True
+        else: files.append(arg)
+
+    for rawName in files:
+        print('%s: %u groups' % (rawName, writeCsv(rawName, outName, withDeleted)), file=sys.stderr)
@@ -0,0 +1,253 @@
+#!/usr/bin/python
+
+import sys, os, struct, time, glob
+
+'''
+Captures and decodes the binary stream of the monitor command (monitor -binary, see sam/src/SckStream.h).
+Readings are written as CSV (one line per reading) and dropped frames are counted with the sequence number.
+With -raw the kit sends what its drivers read (microphone samples, MICS ADC conversions and PM frames) instead of readings,
+one CSV line per sample. The capture can be saved and decoded again later with -i.
+At the end the rate of every sensor or channel is reported (measured with the micros of the kit).
+'''
+
+VERSIONS = (1, 2)
+FRAME = struct.Struct('<HBBIi')
+RAW_HEADER = struct.Struct('<HBBI')
+KIND_NULL = 0
+KIND_FLOAT = 1
+KIND_FIXED = 2
+KIND_RAW = 3
+
+def usage():
+    print('USAGE:\n\nsckmonitor.py [options] [sensorName[,sensorNameN] | rawChannel[,rawChannelN]]')
+    print('\noptions:')
+    print('  -p port: serial port of the kit (default: first /dev/ttyACM*)')
+    print('  -nocobs: ask for frames without COBS framing (no resync after lost bytes)')
+    print('  -raw: stream driver data instead of readings (channels: noise, mics-co, mics-no2, pm; default: all enabled)')
+    print('  -t seconds: stop after this time (default: until Ctrl-C)')
+    print('  -o file.csv: output file (default: stdout)')
+    print('  -save file: also save the raw capture')
+    print('  -i file: decode a saved capture instead of reading the kit')
+    sys.exit()
+
+def cobsDecode(data):
+    ''' Returns the decoded frame or None if the encoding is broken '''
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data) + 1: return None
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code < 0xFF and pos < len(data): out.append(0)
+    return bytes(out)
+
+class Decoder:
+    ''' Feed it the bytes as they come, it parses the text header and then yields the readings '''
+
+    def __init__(self):
+        self.buff = bytearray()
+        self.started = False
+        self.cobs = True
+        self.sensors = {}
+        self.raw = {}
+        self.stats = {}
+        self.lastSeq = None
+        self.lastMicros = None
+        self.microsHigh = 0
+        self.frames = 0
+        self.dropped = 0
+        self.bad = 0
+
+    def feed(self, data):
+        self.buff += data
+        if not self.started: self.header()
+        if not self.started: return
+
+        if self.cobs:
+            while True:
+                end = self.buff.find(b'\0')
+                if end < 0: break
+                encoded = bytes(self.buff[:end])
+                del self.buff[:end + 1]
+                raw = cobsDecode(encoded)
+                if raw is None or len(raw) < RAW_HEADER.size or len(raw) != self.frameSize(raw):
+                    self.bad += 1
+                    continue
+                for row in self.rows(raw): yield row
+        else:
+            while len(self.buff) >= RAW_HEADER.size:
+                size = self.frameSize(self.buff)
+                if size is None:
+                    self.bad += 1
+                    del self.buff[:1]
+                    continue
+                if len(self.buff) < size: break
+                raw = bytes(self.buff[:size])
+                del self.buff[:size]
+                for row in self.rows(raw): yield row
+
+    def frameSize(self, raw):
+        ''' Raw frames have the payload size of their channel, None for unknown channels '''
+        if raw[3] & 0x0F != KIND_RAW: return FRAME.size
+        if raw[2] not in self.raw: return None
+        return RAW_HEADER.size + self.raw[raw[2]][1]
+
+    def header(self):
+        while True:
+            end = self.buff.find(b'\n')
+            if end < 0: return
+            line = self.buff[:end].decode('utf-8', 'replace').strip()
+            del self.buff[:end + 1]
+
+            if '#SCKSTREAM' in line:
+                # The prompt of the kit can be on the same line
+                fields = line[line.index('#SCKSTREAM'):].split()
+                if int(fields[1]) not in VERSIONS: raise ValueError('Unknown stream version %s' % fields[1])
+                self.cobs = fields[2] == 'cobs'
+                self.sensors = {}
+                self.raw = {}
+            elif line == '#START':
+                self.started = True
+                return
+            elif line.startswith('#'):
+                fields = line[1:].split('\t')
+                if len(fields) >= 5 and fields[1] == 'raw': self.raw[int(fields[0])] = (fields[2], int(fields[3]), int(fields[4]))
+                elif len(fields) >= 4: self.sensors[int(fields[0])] = (fields[2], fields[3], fields[1])
+            elif line.startswith('ERROR') or 'disabled' in line:
+                raise ValueError(line)
+
+    def rows(self, raw):
+        ''' Decodes one frame: (seq, micros, title, value) for every value it has '''
+        seq, channel, form, micros = RAW_HEADER.unpack(raw[:RAW_HEADER.size])
+        self.frames += 1
+
+        if self.lastSeq is not None: self.dropped += (seq - self.lastSeq - 1) & 0xFFFF
+        self.lastSeq = seq
+
+        # micros() wraps every 71 minutes
+        if self.lastMicros is not None and micros < self.lastMicros: self.microsHigh += 1 << 32
+        self.lastMicros = micros
+        micros += self.microsHigh
+
+        kind = form & 0x0F
+        if kind != KIND_RAW:
+            value = struct.unpack('<i', raw[RAW_HEADER.size:])[0]
+            if kind == KIND_FLOAT: number = struct.unpack('<f', struct.pack('<i', value))[0]
+            elif kind == KIND_FIXED: number = value / 10.0 ** (form >> 4)
+            else: number = None
+            title = self.title(channel)
+            self.count(title, micros, 1)
+            return [(seq, micros, title, 'null' if number is None else '%.7g' % number)]
+
+        title, size, rate = self.raw[channel]
+        payload = raw[RAW_HEADER.size:]
+        if title == 'noise':
+            # 24 bits samples, micros is the time of the last one
+            samples = [int.from_bytes(payload[i:i + 3], 'little', signed=True) for i in range(0, size, 3)]
+            self.count(title, micros, len(samples), len(samples) * 1e6 / rate)
+            return [(seq, micros - int((len(samples) - 1 - i) * 1e6 / rate), title, str(sample)) for i, sample in enumerate(samples)]
+        self.count(title, micros, 1)
+        if title == 'pm': return [(seq, micros, title, payload.hex())]
+        return [(seq, micros, title, str(struct.unpack('<H', payload)[0]))]
+
+    def count(self, title, micros, samples, period=None):
+        ''' With a fixed sample rate, frames that come later than they should show samples lost on the kit (not frames) '''
+        stats = self.stats.setdefault(title, [0, 0, micros, micros, 0])
+        if period and stats[0] and micros - stats[3] > period * 1.5: stats[4] += 1
+        stats[0] += 1
+        stats[1] += samples
+        stats[3] = micros
+
+    def report(self):
+        ''' Frames and samples per second of every sensor or channel, with the time of the kit '''
+        lines = []
+        for title, (frames, samples, first, last, gaps) in sorted(self.stats.items()):
+            if frames < 2 or last == first: lines.append('%s: %u frames' % (title, frames))
+            else:
+                seconds = (last - first) / 1e6
+                lines.append('%s: %u frames, %.1f frames/s, %.0f samples/s%s' % (title, frames, (frames - 1) / seconds, (samples - samples / frames) / seconds, ', %u gaps' % gaps if gaps else ''))
+        return lines
+
+    def title(self, sensor):
+        return self.sensors.get(sensor, (str(sensor), '', ''))[0]
+
+def openPort(portName):
+    try:
+        import serial
+    except ImportError:
+        print('Reading the kit needs pyserial (pip install pyserial)')
+        sys.exit(1)
+    if portName is None:
+        ports = sorted(glob.glob('/dev/ttyACM*'))
+        if not ports:
+            print('ERROR: no kit found')
+            sys.exit(1)
+        portName = ports[0]
+    return serial.Serial(portName, 115200, timeout=0.1)
+
+if __name__ == '__main__':
+
+    if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    args = sys.argv[1:]
+    portName = None
+    cobs = True
+    duration = None
+    outName = None
+    saveName = None
+    inName = None
+    raw = False
+    sensors = ''
+    while args:
+        arg = args.pop(0)
+        if arg == '-p': portName = args.pop(0)
+        elif arg == '-nocobs': cobs = False
+        elif arg == '-raw': raw = True
+        elif arg == '-t': duration = float(args.pop(0))
+        elif arg == '-o': outName = args.pop(0)
+        elif arg == '-save': saveName = args.pop(0)
+        elif arg == '-i': inName = args.pop(0)
+        else: sensors = (sensors + ' ' + arg).strip()
+
+    out = open(outName, 'w') if outName else sys.stdout
+    save = open(saveName, 'wb') if saveName else None
+    decoder = Decoder()
+    port = None
+    if inName:
+        source = open(inName, 'rb')
+    else:
+        port = openPort(portName)
+        port.write(b'\r\n')
+        time.sleep(0.5)
+        port.reset_input_buffer()
+        port.write(('monitor -binary %s%s%s\r\n' % ('' if cobs else '-nocobs ', '-raw ' if raw else '', sensors)).encode())
+        source = port
+
+    out.write('seq,micros,sensor,value\n')
+    started = time.time()
+    try:
+        while duration is None or time.time() - started < duration:
+            data = source.read(4096)
+            if not data:
+                if inName: break
+                continue
+            if save: save.write(data)
+            for seq, micros, title, value in decoder.feed(data):
+                out.write('%u,%u,%s,%s\n' % (seq, micros, title, value))
+    except KeyboardInterrupt:
+        pass
+    except ValueError as e:
+        print('ERROR: %s' % e, file=sys.stderr)
+
+    # Any input stops the stream on the kit
+    if port is not None:
+        port.write(b'\r\n')
+        port.close()
+    if save: save.close()
+    if out is not sys.stdout: out.close()
+
+    elapsed = time.time() - started
+    print('%u frames, %u dropped, %u bad' % (decoder.frames, decoder.dropped, decoder.bad), file=sys.stderr)
+    if decoder.frames and not inName: print('%.1f frames/s' % (decoder.frames / elapsed), file=sys.stderr)
+    for line in decoder.report(): print(line, file=sys.stderr)
@@ -0,0 +1,162 @@
+#!/usr/bin/python
+
+import sys, os, json, itertools, subprocess, tempfile, shutil, multiprocessing
+
+'''
+Runs the kit firmware on the workstation (native build, see sam/host/main.cpp) for days of virtual time, once for every
+combination of the configs asked, and prints a table with what each one did: publishes and their latency, wakeups,
+storage written and the lowest free RAM. Traces and audio files replay what a real kit measured.
+
+The kit runs on battery in network mode (so it sleeps between readings like on the field) with the models of
+sam/host/HostDevices.h around it. Build the program first: cd sam && pio run -e native
+'''
+
+DEFAULT_PROGRAM = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'sam', '.pio', 'build', 'native', 'program')
+DEFAULT_EPOCH = 1767225600      # 2026-01-01 00:00 UTC
+
+def usage():
+    print('USAGE:\n\nscksim.py [options]')
+    print('\noptions:')
+    print('  -days N: virtual time of every run (default: 7)')
+    print('  -readint S[,S...]: reading intervals to try, in seconds (default: 60)')
+    print('  -pubint S[,S...]: publish intervals to try, in seconds (default: 3600)')
+    print('  -disable SET[,SET...]: sensors to disable in every try, names joined with + (none: keep the defaults),')
+    print('     like -disable "none,PM 1.0+Light"')
+    print('  -pm file.csv: PMS5003 trace, rows of seconds,pm1,pm2.5,pm10[,pn0.3,pn0.5,pn1,pn2.5,pn5,pn10]')
+    print('  -battery file.csv: battery trace, rows of seconds,percent[,mV,mA]')
+    print('  -urban file.csv: urban board trace, rows of seconds,lux,C,%,kPa')
+    print('  -lap S: traces start over every S seconds (default: 86400, 0 plays them once)')
+    print('  -wav file.wav: what the microphone hears (loops)')
+    print('  -script file: more events for every run, appended to the generated script (see sam/host/HostScript.h)')
+    print('  -usb: stay on USB power (the kit never sleeps)')
+    print('  -nosd: without sdcard')
+    print('  -epoch seconds: world time when the runs start (default: %u)' % DEFAULT_EPOCH)
+    print('  -loop micros: virtual time of every pass of the firmware loop (default: 1000)')
+    print('  -program path: native build (default: sam/.pio/build/native/program)')
+    print('  -j N: runs at the same time (default: one per cpu)')
+    print('  -o folder: keeps the scripts, reports and series of every run there (default: a temporary folder)')
+    print('  -json: prints the reports as a json list instead of the table')
+    sys.exit()
+
+def numbers(text):
+    return [int(value) for value in text.split(',')]
+
+def sensorSets(text):
+    sets = []
+    for item in text.split(','):
+        if item.strip().lower() == 'none': sets.append([])
+        else: sets.append([name.strip() for name in item.split('+') if name.strip()])
+    return sets
+
+def script(run, options):
+    ''' The events of a run: configuration while on USB, then the world it lives in '''
+
+    lines = ['# scksim.py: read every %us, publish every %us' % (run['readint'], run['pubint'])]
+    lines.append('1 usb config -mode network -wifi "sim" "sim" -token 000000 -pubint %u -readint %u' % (run['pubint'], run['readint']))
+    for name in run['disable']: lines.append('+1 usb sensor -disable %s' % name)
+    for event in ['pm', 'battery', 'urban']:
+        if options[event]: lines.append('+0 trace %s %s %u' % (os.path.abspath(options[event]), event, options['lap']))
+    if options['wav']: lines.append('+0 i2s wav %s' % os.path.abspath(options['wav']))
+    if not options['usb']: lines.append('+2 power battery')
+    if options['script']:
+        with open(options['script']) as extra: lines += [line.rstrip('\n') for line in extra]
+    return '\n'.join(lines) + '\n'
+
+def runOne(job):
+    run, options, folder = job
+    os.makedirs(folder, exist_ok=True)
+    if not options['nosd']: os.makedirs(os.path.join(folder, 'sdcard'), exist_ok=True)
+    with open(os.path.join(folder, 'script.txt'), 'w') as scriptFile: scriptFile.write(script(run, options))
+
+    command = [os.path.abspath(options['program']), '-script', 'script.txt', '-t', str(int(options['days'] * 86400)),
+        '-epoch', str(options['epoch']), '-loop', str(options['loop']), '-sd', 'sdcard', '-flash', 'flash.bin',
+        '-report', 'report.json', '-series', 'series.csv']
+    with open(os.path.join(folder, 'console.txt'), 'wb') as console, open(os.path.join(folder, 'summary.txt'), 'wb') as summary:
+        result = subprocess.call(command, cwd=folder, stdin=subprocess.DEVNULL, stdout=console, stderr=summary)
+
+    try:
+        with open(os.path.join(folder, 'report.json')) as reportFile: report = json.load(reportFile)
+    except (IOError, ValueError):
+        report = None
+    return run, report, result
+
+def table(results):
+    columns = ['readint', 'pubint', 'sensors', 'publishes', 'errors', 'latency avg', 'latency max', 'wakeups/day', 'awake %', 'flash KB/day', 'sd KB/day', 'pending', 'min RAM', 'boots', 'real s']
+    rows = []
+    for run, report, result in results:
+        config = [str(run['readint']), str(run['pubint']), '-' + '-'.join(run['disable']) if run['disable'] else 'default']
+        if report is None:
+            rows.append(config + ['failed (exit %d)' % result] + [''] * (len(columns) - 4))
+            continue
+        days = report['seconds'] / 86400.0
+        rows.append(config + [
+            str(report['publishes']),
+            str(report['publishErrors']),
+            '%.0f' % report['latencyAverage'],
+            str(report['latencyMax']),
+            '%.0f' % (report['wakeups'] / days),
+            '%.1f' % (100 - report['sleptSeconds'] * 100.0 / report['seconds']),
+            '%.1f' % (report['flashProgrammed'] / 1024.0 / days),
+            '%.1f' % (report['sdBytes'] / 1024.0 / days),
+            str(report['pendingGroups']),
+            str(report['minFreeRam']) if report['minFreeRam'] is not None else '-',
+            str(report['boots']),
+            '%.1f' % report['realSeconds'],
+        ])
+
+    widths = [max(len(columns[i]), max(len(row[i]) for row in rows)) for i in range(len(columns))]
+    print('  '.join(columns[i].rjust(widths[i]) for i in range(len(columns))))
+    for row in rows: print('  '.join(row[i].rjust(widths[i]) for i in range(len(columns))))
+
+if __name__ == '__main__':
+
+    if '-h' in sys.argv or '--help' in sys.argv or '-help' in sys.argv: usage()
+
+    options = { 'days': 7, 'readint': [60], 'pubint': [3600], 'disable': [[]], 'pm': None, 'battery': None, 'urban': None,
+        'lap': 86400, 'wav': None, 'script': None, 'usb': False, 'nosd': False, 'epoch': DEFAULT_EPOCH, 'loop': 1000,
+        'program': DEFAULT_PROGRAM, 'jobs': multiprocessing.cpu_count(), 'out': None, 'json': False }
+
+    args = sys.argv[1:]
+    try:
+        while args:
+            arg = args.pop(0)
+            if arg == '-days': options['days'] = float(args.pop(0))
+            elif arg == '-readint': options['readint'] = numbers(args.pop(0))
+            elif arg == '-pubint': options['pubint'] = numbers(args.pop(0))
+            elif arg == '-disable': options['disable'] = sensorSets(args.pop(0))
+            elif arg in ['-pm', '-battery', '-urban']: options[arg[1:]] = args.pop(0)
+            elif arg == '-lap': options['lap'] = int(args.pop(0))
+            elif arg == '-wav': options['wav'] = args.pop(0)
+            elif arg == '-script': options['script'] = args.pop(0)
+            elif arg == '-usb': options['usb'] = True
+            elif arg == '-nosd': options['nosd'] = True
+            elif arg == '-epoch': options['epoch'] = int(args.pop(0))
+            elif arg == '-loop': options['loop'] = int(args.pop(0))
+            elif arg == '-program': options['program'] = args.pop(0)
+            elif arg == '-j': options['jobs'] = max(1, int(args.pop(0)))
+            elif arg == '-o': options['out'] = args.pop(0)
+            elif arg == '-json': options['json'] = True
+            else: usage()
+    except (IndexError, ValueError):
+        usage()
+
+    if not os.path.isfile(options['program']):
+        print('Native build not found: %s (cd sam && pio run -e native)' % options['program'], file=sys.stderr)
+        sys.exit(1)
+
+    out = options['out'] or tempfile.mkdtemp(prefix='scksim')
+    jobs = []
+    for readint, pubint, disable in itertools.product(options['readint'], options['pubint'], options['disable']):
+        run = { 'readint': readint, 'pubint': pubint, 'disable': disable }
+        name = 'r%u-p%u-%s' % (readint, pubint, '-'.join(name.replace(' ', '').replace('.', '') for name in disable) or 'default')
+        jobs.append((run, options, os.path.join(out, name)))
+
+    print('%u runs of %g days...' % (len(jobs), options['days']), file=sys.stderr)
+    pool = multiprocessing.Pool(min(options['jobs'], len(jobs)))
+    results = pool.map(runOne, jobs)
+    pool.close()
+
+    if options['json']: print(json.dumps([dict(report or {}, **run) for run, report, result in results], indent=1))
+    else: table(results)
+
+    if options['out'] is None: shutil.rmtree(out)